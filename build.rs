@@ -11,6 +11,35 @@ fn main() {
     println!("cargo:rerun-if-changed=src/c/tcp_socket.h");
     println!("cargo:rerun-if-changed=src/c/vma_common.c");
     println!("cargo:rerun-if-changed=src/c/vma_common.h");
+    println!("cargo:rerun-if-changed=src/c/vma_stats.c");
+    println!("cargo:rerun-if-changed=src/c/vma_stats.h");
+    println!("cargo:rerun-if-changed=src/c/vma_xtreme_engine.c");
+    println!("cargo:rerun-if-changed=src/c/vma_xtreme_engine.h");
+    println!("cargo:rerun-if-changed=src/c/tcp_server_poller.c");
+    println!("cargo:rerun-if-changed=src/c/tcp_server_poller.h");
+    println!("cargo:rerun-if-changed=src/c/udp_mcast_receiver.c");
+    println!("cargo:rerun-if-changed=src/c/udp_mcast_receiver.h");
+    println!("cargo:rerun-if-changed=src/c/udp_rx_group.c");
+    println!("cargo:rerun-if-changed=src/c/udp_rx_group.h");
+    println!("cargo:rerun-if-changed=src/c/tcp_framer.c");
+    println!("cargo:rerun-if-changed=src/c/tcp_framer.h");
+    println!("cargo:rerun-if-changed=src/c/tcp_server_runtime.c");
+    println!("cargo:rerun-if-changed=src/c/tcp_server_runtime.h");
+    println!("cargo:rerun-if-changed=src/c/tcp_conn_pool.c");
+    println!("cargo:rerun-if-changed=src/c/tcp_conn_pool.h");
+    println!("cargo:rerun-if-changed=src/c/tcp_heartbeat.c");
+    println!("cargo:rerun-if-changed=src/c/tcp_heartbeat.h");
+    println!("cargo:rerun-if-changed=src/c/vma_buffer_pool.c");
+    println!("cargo:rerun-if-changed=src/c/vma_buffer_pool.h");
+    println!("cargo:rerun-if-changed=src/c/udp_packet_ring.c");
+    println!("cargo:rerun-if-changed=src/c/udp_packet_ring.h");
+    println!("cargo:rerun-if-changed=src/c/vma_trace.c");
+    println!("cargo:rerun-if-changed=src/c/vma_trace.h");
+    println!("cargo:rerun-if-changed=src/c/udp_pacer.c");
+    println!("cargo:rerun-if-changed=src/c/udp_pacer.h");
+    println!("cargo:rerun-if-changed=src/c/vma_fast_path.c");
+    println!("cargo:rerun-if-changed=src/c/vma_fast_path.h");
+    println!("cargo:rerun-if-env-changed=VMA_SOCKET_MARCH");
     
     // Basic build configuration
     let mut common_build = cc::Build::new();
@@ -21,12 +50,40 @@ fn main() {
         .flag("-fPIC")
         .flag("-D_GNU_SOURCE");
     
+    // Hot-path tracing is compiled in only with the "trace" feature
+    if std::env::var_os("CARGO_FEATURE_TRACE").is_some() {
+        common_build.define("VMA_TRACE", None);
+    }
+    
+    // "native": -O3 in every profile, tuned for this CPU (or VMA_SOCKET_MARCH)
+    if std::env::var_os("CARGO_FEATURE_NATIVE").is_some() {
+        let march = std::env::var("VMA_SOCKET_MARCH").unwrap_or_else(|_| "native".to_string());
+        common_build.opt_level(3).flag(&format!("-march={}", march));
+    }
+    
+    // "lto": emit LLVM bitcode so -Clinker-plugin-lto can inline the C hot path into Rust
+    if std::env::var_os("CARGO_FEATURE_LTO").is_some() {
+        if std::env::var_os("CC").is_none() {
+            common_build.compiler("clang");
+        }
+        if std::env::var_os("AR").is_none() {
+            common_build.archiver("llvm-ar");
+        }
+        common_build.flag("-flto=thin");
+    }
+    
     // Compile VMA common code
     common_build
         .clone()
         .file(c_src_path.join("vma_common.c"))
         .compile("vma_common");
     
+    // Compile statistics code
+    common_build
+        .clone()
+        .file(c_src_path.join("vma_stats.c"))
+        .compile("vma_stats");
+    
     // Compile UDP socket code
     common_build
         .clone()
@@ -39,6 +96,84 @@ fn main() {
         .file(c_src_path.join("tcp_socket.c"))
         .compile("tcp_socket");
     
+    // Compile SocketXtreme engine code
+    common_build
+        .clone()
+        .file(c_src_path.join("vma_xtreme_engine.c"))
+        .compile("vma_xtreme_engine");
+    
+    // Compile TCP server poller code
+    common_build
+        .clone()
+        .file(c_src_path.join("tcp_server_poller.c"))
+        .compile("tcp_server_poller");
+    
+    // Compile multicast feed receiver code
+    common_build
+        .clone()
+        .file(c_src_path.join("udp_mcast_receiver.c"))
+        .compile("udp_mcast_receiver");
+    
+    // Compile reuseport receiver group code
+    common_build
+        .clone()
+        .file(c_src_path.join("udp_rx_group.c"))
+        .compile("udp_rx_group");
+    
+    // Compile TCP message framing code
+    common_build
+        .clone()
+        .file(c_src_path.join("tcp_framer.c"))
+        .compile("tcp_framer");
+    
+    // Compile TCP server runtime code
+    common_build
+        .clone()
+        .file(c_src_path.join("tcp_server_runtime.c"))
+        .compile("tcp_server_runtime");
+    
+    // Compile TCP connection pool code
+    common_build
+        .clone()
+        .file(c_src_path.join("tcp_conn_pool.c"))
+        .compile("tcp_conn_pool");
+    
+    // Compile TCP heartbeat scheduler code
+    common_build
+        .clone()
+        .file(c_src_path.join("tcp_heartbeat.c"))
+        .compile("tcp_heartbeat");
+    
+    // Compile receive buffer pool code
+    common_build
+        .clone()
+        .file(c_src_path.join("vma_buffer_pool.c"))
+        .compile("vma_buffer_pool");
+    
+    // Compile UDP packet ring code
+    common_build
+        .clone()
+        .file(c_src_path.join("udp_packet_ring.c"))
+        .compile("udp_packet_ring");
+    
+    // Compile hot-path tracing code
+    common_build
+        .clone()
+        .file(c_src_path.join("vma_trace.c"))
+        .compile("vma_trace");
+    
+    // Compile UDP pacer code
+    common_build
+        .clone()
+        .file(c_src_path.join("udp_pacer.c"))
+        .compile("udp_pacer");
+    
+    // Compile fast-path handle code
+    common_build
+        .clone()
+        .file(c_src_path.join("vma_fast_path.c"))
+        .compile("vma_fast_path");
+    
     // Link VMA library - needed for symbols
     println!("cargo:rustc-link-lib=vma");
 }
\ No newline at end of file
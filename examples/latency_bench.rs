@@ -0,0 +1,927 @@
+//! End-to-end latency and throughput benchmark.
+//!
+//! Runs UDP and TCP ping-pong and one-way tests over a matrix of message
+//! sizes, batch sizes, thread counts and `VmaOptions` presets, and reports
+//! p50/p99/p99.9/max latency, throughput and CPU cost per message for every
+//! combination.
+//!
+//! - ping-pong: the client sends `batch` messages and waits for all of them to
+//!   be echoed back; the latency is the round trip of the whole batch.
+//! - one-way: the sender stamps every message with the send time and the
+//!   receiver records the difference (both ends must share a clock, so run
+//!   them on one host).
+//!
+//! Each thread runs its own client/server pair on its own port, and the
+//! histograms of all pairs are merged.
+//!
+//! ```bash
+//! ./run.sh latency_bench --proto udp,tcp --sizes 64,1024,65536 --configs low_latency,vma_options.json --json results.json
+//! ```
+
+use std::env;
+use std::fs;
+use std::io::{Error, ErrorKind, Write};
+use std::net::{Ipv4Addr, SocketAddr, SocketAddrV4};
+use std::process;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{mpsc, Arc};
+use std::thread;
+
+use flashlog::get_unix_nano;
+use serde::Serialize;
+use vma_socket::common::VmaOptions;
+use vma_socket::tcp::{Client, TcpResult, VmaTcpSocket};
+use vma_socket::udp::{RecvBatch, UdpSendMsg, VmaUdpSocket};
+
+// Largest UDP payload over IPv4
+const UDP_MAX_PAYLOAD: usize = 65507;
+// Every message carries an 8-byte sequence number and an 8-byte send time
+const HEADER_SIZE: usize = 16;
+// How long a receiver waits for a message before counting it lost
+const RECV_TIMEOUT_NS: u64 = 200_000_000;
+// How long a ping-pong client waits for an echo before counting it lost
+const ECHO_TIMEOUT_NS: u64 = 20_000_000;
+// Consecutive ping-pong rounds with losses after which a case is abandoned
+const MAX_LOSSY_ROUNDS: u32 = 50;
+// How long servers wait between checks of the stop flag
+const IDLE_TIMEOUT_NS: u64 = 10_000_000;
+
+const USAGE: &str = "\
+Usage: latency_bench [options]
+  --proto LIST     udp,tcp (default both)
+  --mode LIST      pingpong,oneway (default both)
+  --sizes LIST     message sizes in bytes (default 64,256,1024,4096,16384,65536)
+  --batches LIST   messages per send call (default 1)
+  --threads LIST   concurrent client/server pairs (default 1)
+  --configs LIST   default, low_latency, high_throughput or a VmaOptions JSON file
+                   (default low_latency,high_throughput)
+  --iters N        measured rounds per pair (default 100000)
+  --warmup N       unmeasured rounds per pair (default 10000)
+  --rate N         one-way send rate per pair in messages/s (default 0: unpaced)
+  --ip ADDR        address servers bind to (default 127.0.0.1)
+  --port N         first port; pair i uses port + i (default 19000)
+  --cores LIST     cores to pin to: pair i uses cores 2i (client) and 2i+1 (server)
+  --json PATH      write the results as a JSON array ('-' for stdout)";
+
+/// Power-of-two bucketed histogram with 64 linear sub-buckets per power of two.
+///
+/// Values are kept to within 1/64 (under 1.6%), like an HDR histogram with
+/// two significant digits, in a fixed 30 KB of counters.
+#[derive(Clone)]
+struct Histogram {
+    counts: Vec<u64>,
+    total: u64,
+    sum: u128,
+    min: u64,
+    max: u64,
+}
+
+const SUB_BITS: u32 = 6;
+const SUB_COUNT: usize = 1 << SUB_BITS;
+
+impl Histogram {
+    fn new() -> Self {
+        Histogram {
+            counts: vec![0; (65 - SUB_BITS as usize) * SUB_COUNT],
+            total: 0,
+            sum: 0,
+            min: u64::MAX,
+            max: 0,
+        }
+    }
+
+    /// Bucket index: values below 2 * SUB_COUNT are exact, larger ones keep
+    /// their top SUB_BITS + 1 bits.
+    fn index(value: u64) -> usize {
+        let bits = 64 - value.leading_zeros();
+        if bits <= SUB_BITS + 1 {
+            return value as usize;
+        }
+        let shift = bits - SUB_BITS - 1;
+        (shift as usize + 1) * SUB_COUNT + ((value >> shift) as usize - SUB_COUNT)
+    }
+
+    /// Largest value that falls into a bucket.
+    fn highest_in(index: usize) -> u64 {
+        if index < 2 * SUB_COUNT {
+            return index as u64;
+        }
+        let shift = (index / SUB_COUNT - 1) as u32;
+        let sub = (index % SUB_COUNT + SUB_COUNT) as u64;
+        ((sub + 1) << shift) - 1
+    }
+
+    fn record(&mut self, value: u64) {
+        self.counts[Self::index(value)] += 1;
+        self.total += 1;
+        self.sum += value as u128;
+        self.min = self.min.min(value);
+        self.max = self.max.max(value);
+    }
+
+    fn merge(&mut self, other: &Histogram) {
+        for (count, add) in self.counts.iter_mut().zip(&other.counts) {
+            *count += add;
+        }
+        self.total += other.total;
+        self.sum += other.sum;
+        self.min = self.min.min(other.min);
+        self.max = self.max.max(other.max);
+    }
+
+    fn mean(&self) -> f64 {
+        if self.total == 0 { 0.0 } else { self.sum as f64 / self.total as f64 }
+    }
+
+    /// Value at a percentile (0-100), capped at the recorded maximum.
+    fn percentile(&self, percentile: f64) -> u64 {
+        if self.total == 0 {
+            return 0;
+        }
+        let rank = ((percentile / 100.0) * self.total as f64).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for (index, count) in self.counts.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Self::highest_in(index).min(self.max);
+            }
+        }
+        self.max
+    }
+}
+
+/// Time stamp counter, for cycles per message.
+#[cfg(target_arch = "x86_64")]
+fn cycles() -> u64 {
+    unsafe { core::arch::x86_64::_rdtsc() }
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn cycles() -> u64 {
+    0
+}
+
+/// CPU time used by the calling thread in nanoseconds.
+fn thread_cpu_nano() -> u64 {
+    let mut ts = libc::timespec { tv_sec: 0, tv_nsec: 0 };
+    unsafe { libc::clock_gettime(libc::CLOCK_THREAD_CPUTIME_ID, &mut ts) };
+    ts.tv_sec as u64 * 1_000_000_000 + ts.tv_nsec as u64
+}
+
+fn pin(core: Option<usize>) {
+    if let Some(id) = core {
+        core_affinity::set_for_current(core_affinity::CoreId { id });
+    }
+}
+
+/// Send schedule of a one-way sender (no waiting when unpaced).
+struct Pacer {
+    start_nano: u64,
+    interval_nano: f64,
+}
+
+impl Pacer {
+    fn new(rate: u64) -> Self {
+        Pacer {
+            start_nano: get_unix_nano(),
+            interval_nano: if rate == 0 { 0.0 } else { 1e9 / rate as f64 },
+        }
+    }
+
+    /// Wait until message `seq` is due.
+    fn wait(&self, seq: u64) {
+        if self.interval_nano == 0.0 {
+            return;
+        }
+        let due = self.start_nano + (seq as f64 * self.interval_nano) as u64;
+        while get_unix_nano() < due {
+            std::hint::spin_loop();
+        }
+    }
+}
+
+fn stamp(message: &mut [u8], seq: u64) {
+    message[0..8].copy_from_slice(&seq.to_le_bytes());
+    message[8..16].copy_from_slice(&get_unix_nano().to_le_bytes());
+}
+
+fn read_stamp(message: &[u8]) -> (u64, u64) {
+    let seq = u64::from_le_bytes(message[0..8].try_into().unwrap());
+    let sent = u64::from_le_bytes(message[8..16].try_into().unwrap());
+    (seq, sent)
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum Proto {
+    Udp,
+    Tcp,
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum Mode {
+    PingPong,
+    OneWay,
+}
+
+struct Settings {
+    protos: Vec<Proto>,
+    modes: Vec<Mode>,
+    sizes: Vec<usize>,
+    batches: Vec<usize>,
+    threads: Vec<usize>,
+    configs: Vec<(String, VmaOptions)>,
+    iters: u64,
+    warmup: u64,
+    rate: u64,
+    ip: Ipv4Addr,
+    port: u16,
+    cores: Vec<usize>,
+    json: Option<String>,
+}
+
+/// One point of the matrix.
+struct Case<'a> {
+    proto: Proto,
+    mode: Mode,
+    size: usize,
+    batch: usize,
+    threads: usize,
+    config: &'a str,
+    options: &'a VmaOptions,
+}
+
+/// What one client/server pair measured.
+struct PairResult {
+    histogram: Histogram,
+    messages: u64,
+    lost: u64,
+    elapsed_nano: u64,
+    cycles: u64,
+    cpu_nano: u64,
+}
+
+/// Machine-readable result of one case (latencies in nanoseconds).
+#[derive(Serialize)]
+struct CaseResult {
+    proto: &'static str,
+    mode: &'static str,
+    config: String,
+    size: usize,
+    batch: usize,
+    threads: usize,
+    messages: u64,
+    lost: u64,
+    msgs_per_sec: f64,
+    mbytes_per_sec: f64,
+    min_ns: u64,
+    mean_ns: f64,
+    p50_ns: u64,
+    p90_ns: u64,
+    p99_ns: u64,
+    p999_ns: u64,
+    max_ns: u64,
+    cycles_per_msg: f64,
+    cpu_ns_per_msg: f64,
+}
+
+fn parse_list<T: std::str::FromStr>(value: &str, what: &str) -> Vec<T> {
+    value
+        .split(',')
+        .filter(|item| !item.is_empty())
+        .map(|item| item.parse().unwrap_or_else(|_| fail(&format!("invalid {}: {}", what, item))))
+        .collect()
+}
+
+fn load_config(name: &str) -> VmaOptions {
+    match name {
+        "default" => VmaOptions::default(),
+        "low_latency" => VmaOptions::low_latency(),
+        "high_throughput" => VmaOptions::high_throughput(),
+        path => {
+            let text = fs::read_to_string(path)
+                .unwrap_or_else(|e| fail(&format!("cannot read {}: {}", path, e)));
+            serde_json::from_str(&text)
+                .unwrap_or_else(|e| fail(&format!("invalid options in {}: {}", path, e)))
+        }
+    }
+}
+
+fn fail(message: &str) -> ! {
+    eprintln!("{}\n\n{}", message, USAGE);
+    process::exit(1);
+}
+
+fn parse_args() -> Settings {
+    let mut settings = Settings {
+        protos: vec![Proto::Udp, Proto::Tcp],
+        modes: vec![Mode::PingPong, Mode::OneWay],
+        sizes: vec![64, 256, 1024, 4096, 16384, 65536],
+        batches: vec![1],
+        threads: vec![1],
+        configs: Vec::new(),
+        iters: 100_000,
+        warmup: 10_000,
+        rate: 0,
+        ip: Ipv4Addr::LOCALHOST,
+        port: 19000,
+        cores: Vec::new(),
+        json: None,
+    };
+    let mut config_names = vec!["low_latency".to_string(), "high_throughput".to_string()];
+
+    let args: Vec<String> = env::args().skip(1).collect();
+    let mut i = 0;
+    while i < args.len() {
+        let flag = args[i].as_str();
+        if flag == "-h" || flag == "--help" {
+            println!("{}", USAGE);
+            process::exit(0);
+        }
+        let value = args.get(i + 1).map(|s| s.as_str()).unwrap_or_else(|| fail(&format!("missing value for {}", flag)));
+        match flag {
+            "--proto" => {
+                settings.protos = value.split(',').map(|p| match p {
+                    "udp" => Proto::Udp,
+                    "tcp" => Proto::Tcp,
+                    _ => fail(&format!("unknown protocol: {}", p)),
+                }).collect();
+            }
+            "--mode" => {
+                settings.modes = value.split(',').map(|m| match m {
+                    "pingpong" => Mode::PingPong,
+                    "oneway" => Mode::OneWay,
+                    _ => fail(&format!("unknown mode: {}", m)),
+                }).collect();
+            }
+            "--sizes" => settings.sizes = parse_list(value, "size"),
+            "--batches" => settings.batches = parse_list(value, "batch size"),
+            "--threads" => settings.threads = parse_list(value, "thread count"),
+            "--configs" => config_names = value.split(',').map(String::from).collect(),
+            "--iters" => settings.iters = parse_list(value, "iteration count")[0],
+            "--warmup" => settings.warmup = parse_list(value, "warmup count")[0],
+            "--rate" => settings.rate = parse_list(value, "rate")[0],
+            "--ip" => settings.ip = value.parse().unwrap_or_else(|_| fail(&format!("invalid address: {}", value))),
+            "--port" => settings.port = parse_list(value, "port")[0],
+            "--cores" => settings.cores = parse_list(value, "core"),
+            "--json" => settings.json = Some(value.to_string()),
+            _ => fail(&format!("unknown option: {}", flag)),
+        }
+        i += 2;
+    }
+
+    settings.configs = config_names.iter().map(|name| (name.clone(), load_config(name))).collect();
+    settings
+}
+
+fn main() {
+    let settings = parse_args();
+    env::set_var("VMA_RX_POLL_OS_RATIO", "1000000");
+
+    println!(
+        "{:<4} {:<8} {:<16} {:>6} {:>5} {:>3} {:>10} {:>8} {:>9} {:>9} {:>9} {:>9} {:>9} {:>8} {:>8}",
+        "prot", "mode", "config", "size", "batch", "thr", "msg/s", "MB/s",
+        "p50(ns)", "p99", "p99.9", "max", "mean", "cyc/msg", "lost"
+    );
+
+    let mut results = Vec::new();
+    let mut port = settings.port;
+    for (config, options) in &settings.configs {
+        for &proto in &settings.protos {
+            for &mode in &settings.modes {
+                for &size in &settings.sizes {
+                    for &batch in &settings.batches {
+                        for &threads in &settings.threads {
+                            let case = Case { proto, mode, size, batch, threads, config, options };
+                            match run_case(&case, &settings, port) {
+                                Ok(result) => {
+                                    print_result(&result);
+                                    results.push(result);
+                                }
+                                Err(e) => eprintln!(
+                                    "{:<4} {:<8} {:<16} {:>6} {:>5} {:>3} failed: {}",
+                                    proto_name(proto), mode_name(mode), config, size, batch, threads, e
+                                ),
+                            }
+                            // Fresh ports so a lingering socket from the last case cannot interfere
+                            port = port.wrapping_add(threads as u16);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if let Some(path) = &settings.json {
+        let json = serde_json::to_string_pretty(&results).expect("results serialize");
+        if path == "-" {
+            println!("{}", json);
+        } else if let Err(e) = fs::File::create(path).and_then(|mut file| file.write_all(json.as_bytes())) {
+            eprintln!("cannot write {}: {}", path, e);
+            process::exit(1);
+        }
+    }
+}
+
+fn proto_name(proto: Proto) -> &'static str {
+    match proto {
+        Proto::Udp => "udp",
+        Proto::Tcp => "tcp",
+    }
+}
+
+fn mode_name(mode: Mode) -> &'static str {
+    match mode {
+        Mode::PingPong => "pingpong",
+        Mode::OneWay => "oneway",
+    }
+}
+
+fn print_result(r: &CaseResult) {
+    println!(
+        "{:<4} {:<8} {:<16} {:>6} {:>5} {:>3} {:>10.0} {:>8.1} {:>9} {:>9} {:>9} {:>9} {:>9.0} {:>8.0} {:>8}",
+        r.proto, r.mode, r.config, r.size, r.batch, r.threads, r.msgs_per_sec, r.mbytes_per_sec,
+        r.p50_ns, r.p99_ns, r.p999_ns, r.max_ns, r.mean_ns, r.cycles_per_msg, r.lost
+    );
+}
+
+fn run_case(case: &Case, settings: &Settings, base_port: u16) -> Result<CaseResult, Error> {
+    let mut size = case.size.max(HEADER_SIZE);
+    if case.proto == Proto::Udp {
+        size = size.min(UDP_MAX_PAYLOAD);
+    }
+    let batch = case.batch.max(1);
+
+    let mut pairs = Vec::new();
+    for index in 0..case.threads {
+        let port = base_port.wrapping_add(index as u16);
+        let client_core = settings.cores.get(2 * index).copied();
+        let server_core = settings.cores.get(2 * index + 1).copied();
+        let options = case.options.clone();
+        let (proto, mode, ip) = (case.proto, case.mode, settings.ip);
+        let (iters, warmup, rate) = (settings.iters, settings.warmup, settings.rate);
+        pairs.push(thread::spawn(move || {
+            let pair = Pair { ip, port, size, batch, iters, warmup, rate, options, client_core, server_core };
+            match (proto, mode) {
+                (Proto::Udp, Mode::PingPong) => pair.udp_ping_pong(),
+                (Proto::Udp, Mode::OneWay) => pair.udp_one_way(),
+                (Proto::Tcp, Mode::PingPong) => pair.tcp_ping_pong(),
+                (Proto::Tcp, Mode::OneWay) => pair.tcp_one_way(),
+            }
+        }));
+    }
+
+    let mut histogram = Histogram::new();
+    let (mut messages, mut lost, mut elapsed, mut cycles, mut cpu) = (0u64, 0u64, 0u64, 0u64, 0u64);
+    for pair in pairs {
+        let result = pair.join().map_err(|_| Error::new(ErrorKind::Other, "benchmark thread panicked"))??;
+        histogram.merge(&result.histogram);
+        messages += result.messages;
+        lost += result.lost;
+        elapsed = elapsed.max(result.elapsed_nano);
+        cycles += result.cycles;
+        cpu += result.cpu_nano;
+    }
+
+    let seconds = elapsed.max(1) as f64 / 1e9;
+    let per_msg = |total: u64| if messages == 0 { 0.0 } else { total as f64 / messages as f64 };
+    Ok(CaseResult {
+        proto: proto_name(case.proto),
+        mode: mode_name(case.mode),
+        config: case.config.to_string(),
+        size,
+        batch,
+        threads: case.threads,
+        messages,
+        lost,
+        msgs_per_sec: messages as f64 / seconds,
+        mbytes_per_sec: (messages * size as u64) as f64 / seconds / 1e6,
+        min_ns: if histogram.total == 0 { 0 } else { histogram.min },
+        mean_ns: histogram.mean(),
+        p50_ns: histogram.percentile(50.0),
+        p90_ns: histogram.percentile(90.0),
+        p99_ns: histogram.percentile(99.0),
+        p999_ns: histogram.percentile(99.9),
+        max_ns: histogram.max,
+        cycles_per_msg: per_msg(cycles),
+        cpu_ns_per_msg: per_msg(cpu),
+    })
+}
+
+/// One client/server pair of a case.
+struct Pair {
+    ip: Ipv4Addr,
+    port: u16,
+    size: usize,
+    batch: usize,
+    iters: u64,
+    warmup: u64,
+    rate: u64,
+    options: VmaOptions,
+    client_core: Option<usize>,
+    server_core: Option<usize>,
+}
+
+/// Measurement window of the thread that records latencies.
+struct Meter {
+    histogram: Histogram,
+    start_nano: u64,
+    start_cycles: u64,
+    start_cpu: u64,
+}
+
+impl Meter {
+    fn start() -> Self {
+        Meter {
+            histogram: Histogram::new(),
+            start_nano: get_unix_nano(),
+            start_cycles: cycles(),
+            start_cpu: thread_cpu_nano(),
+        }
+    }
+
+    fn finish(self, messages: u64, lost: u64) -> PairResult {
+        PairResult {
+            histogram: self.histogram,
+            messages,
+            lost,
+            elapsed_nano: get_unix_nano() - self.start_nano,
+            cycles: cycles() - self.start_cycles,
+            cpu_nano: thread_cpu_nano() - self.start_cpu,
+        }
+    }
+}
+
+impl Pair {
+    /// Start the server side on its own thread and wait until it is listening.
+    fn spawn_server<F>(&self, server: F) -> Result<(thread::JoinHandle<()>, Arc<AtomicBool>), Error>
+    where
+        F: FnOnce(mpsc::Sender<Result<(), Error>>, Arc<AtomicBool>) + Send + 'static,
+    {
+        let stop = Arc::new(AtomicBool::new(false));
+        let (ready_tx, ready_rx) = mpsc::channel();
+        let server_stop = stop.clone();
+        let core = self.server_core;
+        let handle = thread::spawn(move || {
+            pin(core);
+            server(ready_tx, server_stop);
+        });
+        ready_rx
+            .recv()
+            .map_err(|_| Error::new(ErrorKind::Other, "server thread exited"))??;
+        Ok((handle, stop))
+    }
+
+    fn bind_udp(&self) -> Result<VmaUdpSocket, Error> {
+        let mut socket = VmaUdpSocket::with_options(self.options.clone())?;
+        socket.bind(self.ip.to_string(), self.port)?;
+        Ok(socket)
+    }
+
+    fn connect_tcp(&self) -> Result<VmaTcpSocket, Error> {
+        let mut socket = VmaTcpSocket::with_options(self.options.clone())?;
+        for _ in 0..100 {
+            if socket.connect(self.ip.to_string(), self.port, Some(RECV_TIMEOUT_NS))? {
+                return Ok(socket);
+            }
+        }
+        Err(Error::new(ErrorKind::TimedOut, "connect timed out"))
+    }
+
+    fn listen_tcp(&self) -> Result<VmaTcpSocket, Error> {
+        let mut listener = VmaTcpSocket::with_options(self.options.clone())?;
+        listener.bind(self.ip.to_string(), self.port)?;
+        listener.listen(16)?;
+        Ok(listener)
+    }
+
+    /// Echo every datagram back to its sender until stopped.
+    fn udp_ping_pong(&self) -> Result<PairResult, Error> {
+        let socket = self.bind_udp()?;
+        let (stride, batch) = (self.size, self.batch);
+        let (server, stop) = self.spawn_server(move |ready, stop| {
+            let mut socket = socket;
+            let _ = ready.send(Ok(()));
+            let mut packets = RecvBatch::new(batch, stride);
+            while !stop.load(Ordering::Relaxed) {
+                if !matches!(socket.recv_batch(&mut packets, Some(IDLE_TIMEOUT_NS)), Ok(n) if n > 0) {
+                    continue;
+                }
+                let mut replies: Vec<UdpSendMsg> = packets
+                    .iter()
+                    .filter_map(|p| match p.src_addr {
+                        SocketAddr::V4(src) => Some(UdpSendMsg::new(p.data, src)),
+                        SocketAddr::V6(_) => None,
+                    })
+                    .collect();
+                let _ = socket.send_batch(&mut replies);
+            }
+        })?;
+
+        pin(self.client_core);
+        let result = (|| {
+            let mut socket = VmaUdpSocket::with_options(self.options.clone())?;
+            socket.connect(self.ip.to_string(), self.port)?;
+            let dest = SocketAddrV4::new(self.ip, self.port);
+            let mut messages = vec![vec![0u8; self.size]; self.batch];
+            let mut packets = RecvBatch::new(self.batch, self.size);
+            let mut buffer = vec![0u8; self.size];
+            let (mut lost, mut lossy) = (0, 0);
+
+            let mut round = |socket: &mut VmaUdpSocket, seq: u64| -> Result<u64, Error> {
+                for (i, message) in messages.iter_mut().enumerate() {
+                    stamp(message, seq * self.batch as u64 + i as u64);
+                }
+                // Echoes of a round that already timed out are not counted
+                let first = seq * self.batch as u64;
+                let current = |data: &[u8]| data.len() >= HEADER_SIZE && read_stamp(data).0 >= first;
+                let mut received = 0;
+                if self.batch == 1 {
+                    socket.send(&messages[0])?;
+                    while received < 1 {
+                        match socket.recv(&mut buffer, Some(ECHO_TIMEOUT_NS))? {
+                            0 => break,
+                            n if current(&buffer[..n]) => received += 1,
+                            _ => {}
+                        }
+                    }
+                } else {
+                    let mut msgs: Vec<UdpSendMsg> = messages.iter().map(|m| UdpSendMsg::new(m, dest)).collect();
+                    socket.send_batch(&mut msgs)?;
+                    while received < self.batch {
+                        if socket.recv_batch(&mut packets, Some(ECHO_TIMEOUT_NS))? == 0 {
+                            break;
+                        }
+                        received += packets.iter().filter(|p| current(p.data)).count();
+                    }
+                }
+                let missing = (self.batch - received) as u64;
+                lossy = if missing == 0 { 0 } else { lossy + 1 };
+                if lossy >= MAX_LOSSY_ROUNDS {
+                    return Err(Error::new(ErrorKind::TimedOut, "datagrams keep getting lost (socket buffers too small?)"));
+                }
+                Ok(missing)
+            };
+
+            for seq in 0..self.warmup {
+                round(&mut socket, seq)?;
+            }
+            let mut meter = Meter::start();
+            for seq in self.warmup..self.warmup + self.iters {
+                let sent = get_unix_nano();
+                let missing = round(&mut socket, seq)?;
+                if missing == 0 {
+                    meter.histogram.record(get_unix_nano() - sent);
+                }
+                lost += missing;
+            }
+            let messages = self.iters * self.batch as u64 - lost;
+            Ok(meter.finish(messages, lost))
+        })();
+
+        stop.store(true, Ordering::Relaxed);
+        let _ = server.join();
+        result
+    }
+
+    /// Stream stamped datagrams to a receiver that records their age.
+    fn udp_one_way(&self) -> Result<PairResult, Error> {
+        let socket = self.bind_udp()?;
+        let (stride, batch, warmup, total) = (self.size, self.batch, self.warmup, self.warmup + self.iters);
+        let (result_tx, result_rx) = mpsc::channel();
+        let (receiver, done) = self.spawn_server(move |ready, done| {
+            let mut socket = socket;
+            let _ = ready.send(Ok(()));
+            let mut packets = RecvBatch::new(batch, stride);
+            let mut meter: Option<Meter> = None;
+            let (mut received, mut measured) = (0u64, 0u64);
+            let mut idle_since = None;
+            while received < total {
+                let n = match socket.recv_batch(&mut packets, Some(IDLE_TIMEOUT_NS)) {
+                    Ok(n) => n,
+                    Err(_) => break,
+                };
+                if n == 0 {
+                    // Once the sender is done, anything not here by the timeout is lost
+                    if done.load(Ordering::Acquire) {
+                        let since = *idle_since.get_or_insert_with(get_unix_nano);
+                        if get_unix_nano() - since > RECV_TIMEOUT_NS {
+                            break;
+                        }
+                    }
+                    continue;
+                }
+                idle_since = None;
+                let now = get_unix_nano();
+                for packet in packets.iter() {
+                    let (seq, sent) = read_stamp(packet.data);
+                    received += 1;
+                    if seq < warmup {
+                        continue;
+                    }
+                    measured += 1;
+                    meter.get_or_insert_with(Meter::start).histogram.record(now.saturating_sub(sent));
+                }
+            }
+            let meter = meter.unwrap_or_else(Meter::start);
+            let _ = result_tx.send(meter.finish(measured, total - warmup - measured));
+        })?;
+
+        pin(self.client_core);
+        let sent = (|| -> Result<(), Error> {
+            let mut socket = VmaUdpSocket::with_options(self.options.clone())?;
+            socket.connect(self.ip.to_string(), self.port)?;
+            let dest = SocketAddrV4::new(self.ip, self.port);
+            let mut messages = vec![vec![0u8; self.size]; self.batch];
+            let pacer = Pacer::new(self.rate);
+            let mut seq = 0;
+            while seq < total {
+                let count = (total - seq).min(self.batch as u64) as usize;
+                pacer.wait(seq);
+                for message in &mut messages[..count] {
+                    stamp(message, seq);
+                    seq += 1;
+                }
+                if count == 1 {
+                    socket.send(&messages[0])?;
+                } else {
+                    let mut msgs: Vec<UdpSendMsg> = messages[..count].iter().map(|m| UdpSendMsg::new(m, dest)).collect();
+                    socket.send_batch(&mut msgs)?;
+                }
+            }
+            Ok(())
+        })();
+
+        done.store(true, Ordering::Release);
+        let _ = receiver.join();
+        sent?;
+        result_rx.recv().map_err(|_| Error::new(ErrorKind::Other, "receiver thread exited"))
+    }
+
+    /// Echo the byte stream back until the client disconnects.
+    fn tcp_ping_pong(&self) -> Result<PairResult, Error> {
+        let listener = self.listen_tcp()?;
+        let stride = self.size * self.batch;
+        let (server, stop) = self.spawn_server(move |ready, stop| {
+            let mut listener = listener;
+            let _ = ready.send(Ok(()));
+            let Some(mut client) = accept(&mut listener, &stop) else { return };
+            let mut buffer = vec![0u8; stride];
+            while !stop.load(Ordering::Relaxed) {
+                match client.recv(&mut buffer, Some(IDLE_TIMEOUT_NS)) {
+                    Ok(n) => {
+                        if send_all_client(&mut client, &buffer[..n]).is_err() {
+                            break;
+                        }
+                    }
+                    Err(TcpResult::TcpErrorTimeout) => continue,
+                    Err(_) => break,
+                }
+            }
+        })?;
+
+        pin(self.client_core);
+        let result = (|| {
+            let mut socket = self.connect_tcp()?;
+            let mut request = vec![0u8; self.size * self.batch];
+            let mut reply = vec![0u8; self.size * self.batch];
+            // Never have more in flight than the socket buffers hold, or both
+            // ends block in send while the echo waits to be read
+            let window = match self.options.buffer_size {
+                0 => request.len(),
+                size => size as usize,
+            };
+
+            let mut round = |socket: &mut VmaTcpSocket, seq: u64| -> Result<(), Error> {
+                for (i, message) in request.chunks_mut(self.size).enumerate() {
+                    stamp(message, seq * self.batch as u64 + i as u64);
+                }
+                let (mut sent, mut received) = (0, 0);
+                while received < reply.len() {
+                    if sent < request.len() && sent - received < window {
+                        let end = request.len().min(received + window);
+                        send_all(socket, &request[sent..end])?;
+                        sent = end;
+                    } else {
+                        received += recv_some(socket, &mut reply[received..sent])?;
+                    }
+                }
+                Ok(())
+            };
+
+            for seq in 0..self.warmup {
+                round(&mut socket, seq)?;
+            }
+            let mut meter = Meter::start();
+            for seq in self.warmup..self.warmup + self.iters {
+                let sent = get_unix_nano();
+                round(&mut socket, seq)?;
+                meter.histogram.record(get_unix_nano() - sent);
+            }
+            Ok(meter.finish(self.iters * self.batch as u64, 0))
+        })();
+
+        stop.store(true, Ordering::Relaxed);
+        let _ = server.join();
+        result
+    }
+
+    /// Stream stamped messages to a receiver that records their age.
+    fn tcp_one_way(&self) -> Result<PairResult, Error> {
+        let listener = self.listen_tcp()?;
+        let (size, warmup, total) = (self.size, self.warmup, self.warmup + self.iters);
+        let (result_tx, result_rx) = mpsc::channel();
+        let (receiver, stop) = self.spawn_server(move |ready, stop| {
+            let mut listener = listener;
+            let _ = ready.send(Ok(()));
+            let Some(mut client) = accept(&mut listener, &stop) else { return };
+            let mut buffer = vec![0u8; 64 * 1024 + size];
+            let mut filled = 0;
+            let mut received = 0u64;
+            let mut meter: Option<Meter> = None;
+            while received < total {
+                let n = match client.recv(&mut buffer[filled..], Some(RECV_TIMEOUT_NS)) {
+                    Ok(n) => n,
+                    Err(TcpResult::TcpErrorTimeout) if !stop.load(Ordering::Relaxed) => continue,
+                    Err(_) => break,
+                };
+                filled += n;
+                let now = get_unix_nano();
+                let complete = filled / size * size;
+                for message in buffer[..complete].chunks(size) {
+                    let (seq, sent) = read_stamp(message);
+                    received += 1;
+                    if seq >= warmup {
+                        meter.get_or_insert_with(Meter::start).histogram.record(now.saturating_sub(sent));
+                    }
+                }
+                buffer.copy_within(complete..filled, 0);
+                filled -= complete;
+            }
+            let measured = received.saturating_sub(warmup);
+            let meter = meter.unwrap_or_else(Meter::start);
+            let _ = result_tx.send(meter.finish(measured, total - warmup - measured.min(total - warmup)));
+        })?;
+
+        pin(self.client_core);
+        let sent = (|| -> Result<(), Error> {
+            let mut socket = self.connect_tcp()?;
+            let mut messages = vec![0u8; self.size * self.batch];
+            let pacer = Pacer::new(self.rate);
+            let mut seq = 0;
+            while seq < total {
+                let count = (total - seq).min(self.batch as u64) as usize;
+                pacer.wait(seq);
+                for message in messages.chunks_mut(self.size).take(count) {
+                    stamp(message, seq);
+                    seq += 1;
+                }
+                send_all(&mut socket, &messages[..count * self.size])?;
+            }
+            Ok(())
+        })();
+
+        if sent.is_err() {
+            stop.store(true, Ordering::Relaxed);
+        }
+        let _ = receiver.join();
+        sent?;
+        result_rx.recv().map_err(|_| Error::new(ErrorKind::Other, "receiver thread exited"))
+    }
+}
+
+fn accept(listener: &mut VmaTcpSocket, stop: &AtomicBool) -> Option<Client> {
+    while !stop.load(Ordering::Relaxed) {
+        match listener.accept(Some(IDLE_TIMEOUT_NS)) {
+            Ok(Some(client)) => return Some(client),
+            Ok(None) => continue,
+            Err(_) => return None,
+        }
+    }
+    None
+}
+
+fn send_all(socket: &mut VmaTcpSocket, mut data: &[u8]) -> Result<(), Error> {
+    while !data.is_empty() {
+        let sent = socket.send(data)?;
+        data = &data[sent..];
+    }
+    Ok(())
+}
+
+fn send_all_client(client: &mut Client, mut data: &[u8]) -> Result<(), Error> {
+    while !data.is_empty() {
+        match client.send(data) {
+            Ok(sent) => data = &data[sent..],
+            Err(TcpResult::TcpErrorWouldBlock) => continue,
+            Err(e) => return Err(e.into()),
+        }
+    }
+    Ok(())
+}
+
+fn recv_some(socket: &mut VmaTcpSocket, buffer: &mut [u8]) -> Result<usize, Error> {
+    match socket.recv(buffer, Some(RECV_TIMEOUT_NS))? {
+        0 => Err(Error::new(ErrorKind::UnexpectedEof, "connection closed or timed out")),
+        n => Ok(n),
+    }
+}
@@ -0,0 +1,98 @@
+use std::collections::BTreeMap;
+use std::env;
+use std::process;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+use std::thread;
+use std::time::{Duration, Instant};
+use vma_socket::trace::{TraceEvent, TraceReader};
+
+const POLL_INTERVAL: Duration = Duration::from_millis(5);
+
+fn percentile(sorted: &[u64], p: f64) -> u64 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let index = ((sorted.len() as f64 - 1.0) * p / 100.0).round() as usize;
+    sorted[index]
+}
+
+fn print_phase(name: &str, values: &mut Vec<u64>) {
+    values.sort_unstable();
+    println!(
+        "    {:<8} p50 {:>9} ns   p99 {:>9} ns   max {:>9} ns",
+        name,
+        percentile(values, 50.0),
+        percentile(values, 99.0),
+        values.last().copied().unwrap_or(0)
+    );
+}
+
+fn main() {
+    let args: Vec<String> = env::args().collect();
+    if args.len() < 2 {
+        println!("Usage: {} <pid> [seconds]", args[0]);
+        println!("  Traces the socket calls of a process built with the \"trace\" feature");
+        println!("  Default: 10 seconds (Ctrl-C stops early)");
+        process::exit(1);
+    }
+
+    let pid: u32 = args[1].parse().unwrap_or_else(|_| {
+        println!("Invalid pid: {}", args[1]);
+        process::exit(1);
+    });
+    let seconds: u64 = args.get(2).map(|s| s.parse().unwrap_or(10)).unwrap_or(10);
+
+    let mut reader = match TraceReader::attach(pid) {
+        Ok(reader) => reader,
+        Err(e) => {
+            println!("Cannot attach to /dev/shm/vma_trace.{}: {}", pid, e);
+            process::exit(1);
+        }
+    };
+
+    let running = Arc::new(AtomicBool::new(true));
+    let r = running.clone();
+    ctrlc::set_handler(move || {
+        r.store(false, Ordering::SeqCst);
+    })
+    .expect("Error setting Ctrl-C handler");
+
+    // Leave the process as we found it
+    let was_enabled = reader.is_enabled();
+    reader.set_enabled(true);
+    println!("Tracing process {} for {} seconds...", pid, seconds);
+
+    let mut events: Vec<TraceEvent> = Vec::new();
+    let deadline = Instant::now() + Duration::from_secs(seconds);
+    while running.load(Ordering::SeqCst) && Instant::now() < deadline {
+        reader.poll(&mut events);
+        thread::sleep(POLL_INTERVAL);
+    }
+    reader.set_enabled(was_enabled);
+    reader.poll(&mut events);
+
+    // Group by operation: (count, errors, wait, syscall, post, total)
+    let mut by_op: BTreeMap<&'static str, (u64, u64, Vec<u64>, Vec<u64>, Vec<u64>, Vec<u64>)> = BTreeMap::new();
+    for event in &events {
+        let entry = by_op.entry(event.op.name()).or_default();
+        entry.0 += 1;
+        if event.result != 0 {
+            entry.1 += 1;
+        }
+        entry.2.push(event.wait_ns);
+        entry.3.push(event.syscall_ns);
+        entry.4.push(event.post_ns);
+        entry.5.push(event.total_ns);
+    }
+
+    println!("\n===== Trace Summary =====");
+    println!("Events: {} (lost: {}, untraced threads: {})", events.len(), reader.lost(), reader.unclaimed_threads());
+    for (name, (count, errors, wait, syscall, post, total)) in by_op.iter_mut() {
+        println!("  {} ({} calls, {} not successful)", name, count, errors);
+        print_phase("wait", wait);
+        print_phase("syscall", syscall);
+        print_phase("post", post);
+        print_phase("total", total);
+    }
+}
@@ -0,0 +1,420 @@
+//! Hugepage-backed, NUMA-aware receive buffer pool shared between C and Rust.
+//!
+//! A [`BufferPool`] carves one mapping (explicit hugepages if available,
+//! otherwise transparent hugepages) into fixed-size, cache-line aligned
+//! buffers, optionally placed on the NUMA node of the receiving NIC. All
+//! memory is faulted in when the pool is created, so receiving never takes a
+//! page fault or calls the allocator.
+//!
+//! Buffers are handed out as [`PooledBuffer`]s that go back to the pool when
+//! dropped, from any thread. Allocation and release go through a small
+//! per-thread cache first and touch the shared lock-free list only once per
+//! half cache.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::buffer_pool::{BufferPool, BufferPoolConfig};
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! let pool = BufferPool::new(&BufferPoolConfig::for_local_ip("10.0.0.1")).unwrap();
+//!
+//! let mut socket = VmaUdpSocket::new().unwrap();
+//! socket.bind("10.0.0.1", 5001).unwrap();
+//!
+//! let mut packets = Vec::new();
+//! socket.recv_batch_pooled(&pool, &mut packets, 32, Some(100_000_000)).unwrap();
+//! for packet in packets.drain(..) {
+//!     // hand `packet` to another thread; its buffer returns to the pool on drop
+//!     println!("{} bytes from {}", packet.data.len(), packet.src_addr);
+//! }
+//! ```
+
+use std::cell::UnsafeCell;
+use std::ffi::{c_void, CString};
+use std::fmt;
+use std::io::{Error, ErrorKind};
+use std::ops::{Deref, DerefMut};
+use std::mem;
+use std::os::raw::{c_char, c_int};
+use std::ptr::NonNull;
+use std::sync::Arc;
+
+/// Pool configuration (C `vma_buffer_pool_config_t`, zero fields select the defaults).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct BufferPoolConfig {
+    /// Bytes per buffer, rounded up to a cache line (0 for 2048)
+    pub buffer_size: u32,
+    /// Number of buffers (0 for 4096)
+    pub buffer_count: u32,
+    /// Back the pool with hugepages (explicit hugepages, falling back to transparent hugepages)
+    pub use_hugepages: bool,
+    /// Place the memory on `numa_node`
+    pub bind_numa: bool,
+    /// NUMA node, used when `bind_numa` is set
+    pub numa_node: c_int,
+}
+
+impl BufferPoolConfig {
+    /// Hugepage-backed defaults placed on the NUMA node of the NIC that owns `ip`.
+    ///
+    /// If the node cannot be determined the pool is simply not bound.
+    pub fn for_local_ip(ip: &str) -> Self {
+        let node = numa_node_for_ip(ip);
+        BufferPoolConfig {
+            use_hugepages: true,
+            bind_numa: node.is_some(),
+            numa_node: node.unwrap_or(-1),
+            ..Default::default()
+        }
+    }
+}
+
+/// Memory backing the buffers.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PoolBacking {
+    /// Regular pages
+    Normal,
+    /// Transparent hugepages requested for a regular mapping
+    TransparentHugepages,
+    /// Explicit hugepages
+    Hugetlb,
+}
+
+// Backing kinds (match `vma_pool_backing_t`)
+const BACKING_THP: c_int = 1;
+const BACKING_HUGETLB: c_int = 2;
+
+// Result codes (match `vma_pool_result_t`)
+const POOL_SUCCESS: c_int = 0;
+const POOL_ERROR_NO_MEMORY: c_int = -2;
+
+/// Pool counters.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PoolStats {
+    /// Buffers handed out
+    pub allocs: u64,
+    /// Buffers returned
+    pub frees: u64,
+    /// Allocations that found the pool empty
+    pub exhausted: u64,
+}
+
+/// C representation of the pool structure.
+#[repr(C)]
+struct BufferPoolRaw {
+    base: *mut u8,
+    region_size: usize,
+    buffer_size: u32,
+    stride: u32,
+    buffer_count: u32,
+    cache_limit: u32,
+    backing: c_int,
+    numa_node: c_int,
+    next: *mut u32,
+    head: u64,
+    caches: *mut c_void,
+    stats: PoolStats,
+    registry_next: *mut BufferPoolRaw,
+}
+
+extern "C" {
+    fn vma_buffer_pool_init(pool: *mut BufferPoolRaw, config: *const BufferPoolConfig) -> c_int;
+    fn vma_buffer_pool_close(pool: *mut BufferPoolRaw) -> c_int;
+    fn vma_buffer_pool_alloc(pool: *mut BufferPoolRaw) -> *mut c_void;
+    fn vma_buffer_pool_free(pool: *mut BufferPoolRaw, buffer: *mut c_void);
+    fn vma_buffer_pool_available(pool: *const BufferPoolRaw) -> u32;
+    fn vma_buffer_pool_get_stats(pool: *const BufferPoolRaw, stats: *mut PoolStats) -> c_int;
+    fn vma_numa_node_for_ip(ip: *const c_char) -> c_int;
+}
+
+/// NUMA node of the network device that owns a local IPv4 address.
+///
+/// Returns `None` for unknown addresses, virtual devices and non-NUMA systems.
+pub fn numa_node_for_ip(ip: &str) -> Option<i32> {
+    let ip = CString::new(ip).ok()?;
+    let node = unsafe { vma_numa_node_for_ip(ip.as_ptr()) };
+    if node < 0 {
+        None
+    } else {
+        Some(node)
+    }
+}
+
+// The C pool synchronizes internally; the cell only marks it as shared mutable state.
+struct PoolInner {
+    raw: UnsafeCell<BufferPoolRaw>,
+}
+
+unsafe impl Send for PoolInner {}
+unsafe impl Sync for PoolInner {}
+
+impl PoolInner {
+    #[inline]
+    fn raw(&self) -> *mut BufferPoolRaw {
+        self.raw.get()
+    }
+}
+
+impl Drop for PoolInner {
+    fn drop(&mut self) {
+        // Every PooledBuffer holds a reference, so all buffers are back by now.
+        unsafe {
+            vma_buffer_pool_close(self.raw());
+        }
+    }
+}
+
+/// Shared receive buffer pool (cheap to clone, usable from any thread).
+#[derive(Clone)]
+pub struct BufferPool {
+    inner: Arc<PoolInner>,
+}
+
+impl BufferPool {
+    /// Create a pool and fault in all of its memory.
+    pub fn new(config: &BufferPoolConfig) -> Result<Self, Error> {
+        let inner = Arc::new(PoolInner { raw: UnsafeCell::new(unsafe { mem::zeroed() }) });
+        match unsafe { vma_buffer_pool_init(inner.raw(), config) } {
+            POOL_SUCCESS => Ok(BufferPool { inner }),
+            POOL_ERROR_NO_MEMORY => Err(Error::new(ErrorKind::OutOfMemory, "Buffer pool allocation failed")),
+            _ => Err(Error::new(ErrorKind::InvalidInput, "Invalid buffer pool configuration")),
+        }
+    }
+
+    /// Take a buffer, or `None` if every buffer is in use.
+    #[inline]
+    pub fn alloc(&self) -> Option<PooledBuffer> {
+        let ptr = NonNull::new(unsafe { vma_buffer_pool_alloc(self.inner.raw()) } as *mut u8)?;
+        Some(PooledBuffer { pool: self.inner.clone(), ptr, len: self.buffer_size() })
+    }
+
+    /// Wrap a buffer the C layer took from this pool.
+    ///
+    /// # Safety
+    ///
+    /// `ptr` must have come from `vma_buffer_pool_alloc` on this pool, must not
+    /// be owned by anything else, and `len` must not exceed the buffer size.
+    pub(crate) unsafe fn from_raw(&self, ptr: *mut c_void, len: usize) -> PooledBuffer {
+        PooledBuffer {
+            pool: self.inner.clone(),
+            ptr: NonNull::new_unchecked(ptr as *mut u8),
+            len,
+        }
+    }
+
+    /// Pointer to the C pool structure.
+    pub(crate) fn as_raw(&self) -> *mut c_void {
+        self.inner.raw() as *mut c_void
+    }
+
+    /// Bytes per buffer.
+    pub fn buffer_size(&self) -> usize {
+        unsafe { (*self.inner.raw()).buffer_size as usize }
+    }
+
+    /// Total number of buffers.
+    pub fn capacity(&self) -> usize {
+        unsafe { (*self.inner.raw()).buffer_count as usize }
+    }
+
+    /// Number of buffers not handed out (approximate while other threads allocate).
+    pub fn available(&self) -> usize {
+        unsafe { vma_buffer_pool_available(self.inner.raw()) as usize }
+    }
+
+    /// Memory backing in effect.
+    pub fn backing(&self) -> PoolBacking {
+        match unsafe { (*self.inner.raw()).backing } {
+            BACKING_HUGETLB => PoolBacking::Hugetlb,
+            BACKING_THP => PoolBacking::TransparentHugepages,
+            _ => PoolBacking::Normal,
+        }
+    }
+
+    /// NUMA node the memory was bound to, if any.
+    pub fn numa_node(&self) -> Option<i32> {
+        let node = unsafe { (*self.inner.raw()).numa_node };
+        if node < 0 {
+            None
+        } else {
+            Some(node)
+        }
+    }
+
+    /// Read the pool counters (summed over all threads).
+    pub fn stats(&self) -> PoolStats {
+        let mut stats = PoolStats::default();
+        unsafe {
+            vma_buffer_pool_get_stats(self.inner.raw(), &mut stats);
+        }
+        stats
+    }
+}
+
+impl fmt::Debug for BufferPool {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("BufferPool")
+            .field("buffer_size", &self.buffer_size())
+            .field("capacity", &self.capacity())
+            .field("available", &self.available())
+            .field("backing", &self.backing())
+            .field("numa_node", &self.numa_node())
+            .finish()
+    }
+}
+
+/// A buffer owned by the holder until dropped, then returned to its pool.
+///
+/// Dereferences to the first `len()` bytes; a freshly allocated buffer spans
+/// the whole buffer size.
+pub struct PooledBuffer {
+    pool: Arc<PoolInner>,
+    ptr: NonNull<u8>,
+    len: usize,
+}
+
+// The buffer is exclusively owned and the pool is thread-safe.
+unsafe impl Send for PooledBuffer {}
+unsafe impl Sync for PooledBuffer {}
+
+impl PooledBuffer {
+    /// Bytes available in the buffer.
+    pub fn capacity(&self) -> usize {
+        unsafe { (*self.pool.raw()).buffer_size as usize }
+    }
+
+    /// Set the number of valid bytes (capped at the capacity).
+    pub fn set_len(&mut self, len: usize) {
+        self.len = len.min(self.capacity());
+    }
+
+    /// Pointer to the start of the buffer.
+    pub fn as_mut_ptr(&mut self) -> *mut u8 {
+        self.ptr.as_ptr()
+    }
+}
+
+impl Deref for PooledBuffer {
+    type Target = [u8];
+
+    #[inline]
+    fn deref(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl DerefMut for PooledBuffer {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl fmt::Debug for PooledBuffer {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("PooledBuffer").field("ptr", &self.ptr).field("len", &self.len).finish()
+    }
+}
+
+impl Drop for PooledBuffer {
+    /// Return the buffer to the pool when it goes out of scope.
+    fn drop(&mut self) {
+        unsafe { vma_buffer_pool_free(self.pool.raw(), self.ptr.as_ptr() as *mut c_void) }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::collections::HashSet;
+    use std::sync::mpsc;
+    use std::thread;
+
+    fn pool(buffer_count: u32) -> BufferPool {
+        BufferPool::new(&BufferPoolConfig { buffer_size: 100, buffer_count, ..Default::default() }).unwrap()
+    }
+
+    // Take every buffer the calling thread can get, checking they are distinct
+    fn drain(pool: &BufferPool) -> Vec<PooledBuffer> {
+        let mut buffers = Vec::new();
+        let mut seen = HashSet::new();
+        while let Some(mut buffer) = pool.alloc() {
+            assert!(seen.insert(buffer.as_mut_ptr() as usize), "buffer handed out twice");
+            buffer[0] = buffers.len() as u8;
+            buffers.push(buffer);
+        }
+        buffers
+    }
+
+    #[test]
+    fn test_exhaust_and_refill() {
+        let pool = pool(256);
+        assert_eq!(pool.buffer_size(), 100);
+
+        let mut buffers = drain(&pool);
+        assert_eq!(buffers.len(), 256);
+        assert_eq!(pool.available(), 0);
+        assert_eq!(pool.stats().exhausted, 1);
+        for buffer in buffers.iter_mut() {
+            assert_eq!(buffer.as_mut_ptr() as usize % 64, 0);
+            assert_eq!(buffer.len(), 100);
+        }
+
+        drop(buffers);
+        assert_eq!(pool.available(), 256);
+        assert_eq!(drain(&pool).len(), 256);
+        let stats = pool.stats();
+        assert_eq!((stats.allocs, stats.frees, stats.exhausted), (512, 512, 2));
+    }
+
+    #[test]
+    fn test_cross_thread_return() {
+        let pool = pool(1024);
+        let cache_limit = unsafe { (*pool.inner.raw()).cache_limit } as usize;
+        let (to_worker, buffers) = mpsc::channel::<Vec<PooledBuffer>>();
+        let (to_main, freed) = mpsc::channel();
+        let (done, finish) = mpsc::channel::<()>();
+
+        // The worker frees what the main thread allocated and stays alive
+        let worker = thread::spawn(move || {
+            drop(buffers.recv().unwrap());
+            to_main.send(()).unwrap();
+            finish.recv().unwrap();
+        });
+        to_worker.send(drain(&pool)).unwrap();
+        freed.recv().unwrap();
+
+        // Only the worker's own cache can still hold buffers
+        let again = drain(&pool);
+        assert!(again.len() >= 1024 - cache_limit, "{} of 1024 came back", again.len());
+        let stats = pool.stats();
+        assert_eq!(stats.frees, 1024);
+        assert_eq!(stats.allocs, 1024 + again.len() as u64);
+
+        done.send(()).unwrap();
+        worker.join().unwrap();
+    }
+
+    #[test]
+    fn test_thread_exit_flush() {
+        let pool = pool(1024);
+        let worker_pool = pool.clone();
+
+        // Freed on the worker, some buffers stay in its private cache until it exits
+        let cached = thread::spawn(move || {
+            let buffers = drain(&worker_pool);
+            assert_eq!(buffers.len(), 1024);
+            drop(buffers);
+            unsafe { (*worker_pool.inner.raw()).cache_limit }
+        })
+        .join()
+        .unwrap();
+        assert!(cached > 0);
+
+        // The exit handed them back: this thread gets every buffer
+        assert_eq!(drain(&pool).len(), 1024);
+    }
+}
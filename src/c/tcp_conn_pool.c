@@ -0,0 +1,205 @@
+/**
+ * tcp_conn_pool.c - Pre-warmed TCP connection pool for fast failover
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "tcp_conn_pool.h"
+
+// Remove spare i, keeping the rest contiguous
+static tcp_socket_t take_spare(tcp_conn_pool_t* pool, size_t i) {
+    tcp_socket_t spare = pool->spares[i];
+    pool->spares[i] = pool->spares[pool->spare_count - 1];
+    pool->spare_count--;
+    return spare;
+}
+
+static tcp_result_t connect_to(tcp_socket_t* socket, const struct sockaddr_in* addr, int timeout_ms) {
+    char ip[INET_ADDRSTRLEN];
+    if (!inet_ntop(AF_INET, &addr->sin_addr, ip, sizeof(ip))) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    return tcp_socket_connect(socket, ip, ntohs(addr->sin_port), timeout_ms);
+}
+
+tcp_result_t tcp_pool_init(tcp_conn_pool_t* pool, const vma_options_t* options, size_t target, bool preconnect) {
+    if (!pool || target == 0 || target > TCP_POOL_MAX_SPARES) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    memset(pool, 0, sizeof(tcp_conn_pool_t));
+
+    if (options) {
+        pool->vma_options = *options;
+    } else {
+        set_default_options(&pool->vma_options);
+    }
+
+    pool->target = target;
+    pool->preconnect = preconnect;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_pool_close(tcp_conn_pool_t* pool) {
+    if (!pool) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < pool->spare_count; i++) {
+        tcp_socket_close(&pool->spares[i]);
+    }
+    pool->spare_count = 0;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_pool_add_endpoint(tcp_conn_pool_t* pool, const char* ip, uint16_t port) {
+    if (!pool || !ip || pool->endpoint_count >= TCP_POOL_MAX_ENDPOINTS) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    struct sockaddr_in* endpoint = &pool->endpoints[pool->endpoint_count];
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->sin_family = AF_INET;
+    endpoint->sin_port = htons(port);
+
+    if (inet_pton(AF_INET, ip, &endpoint->sin_addr) <= 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    pool->endpoint_count++;
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_pool_refill(tcp_conn_pool_t* pool, int timeout_ms, size_t* ready) {
+    if (!pool) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    // Drop pre-connected spares whose peer went away while they waited
+    for (size_t i = 0; i < pool->spare_count;) {
+        tcp_socket_t* spare = &pool->spares[i];
+        if (spare->state == TCP_STATE_CONNECTED && !tcp_socket_probe(spare)) {
+            tcp_socket_t dead = take_spare(pool, i);
+            tcp_socket_close(&dead);
+            pool->stats.stale++;
+            continue;
+        }
+        i++;
+    }
+
+    while (pool->spare_count < pool->target) {
+        tcp_socket_t* spare = &pool->spares[pool->spare_count];
+
+        // Socket creation, options and VMA offload setup happen here, not at failover
+        if (tcp_socket_init(spare, &pool->vma_options) != TCP_SUCCESS) {
+            pool->stats.failures++;
+            break;
+        }
+        pool->stats.created++;
+
+        if (pool->preconnect && pool->endpoint_count > 0) {
+            const struct sockaddr_in* endpoint = &pool->endpoints[pool->next_endpoint % pool->endpoint_count];
+            pool->next_endpoint++;
+
+            if (connect_to(spare, endpoint, timeout_ms) != TCP_SUCCESS) {
+                // Give up for this round rather than retrying inline; the next refill tries again
+                tcp_socket_close(spare);
+                pool->stats.failures++;
+                break;
+            }
+            pool->stats.connected++;
+        }
+
+        pool->spare_count++;
+    }
+
+    if (ready) {
+        *ready = pool->spare_count;
+    }
+
+    return TCP_SUCCESS;
+}
+
+// Move a spare into the live socket, keeping the socket's statistics
+static void install_spare(tcp_socket_t* socket, tcp_socket_t* spare) {
+    vma_stats_t* stats = socket->stats;
+    bool owns_stats = socket->owns_stats;
+    vma_wait_stats_t wait_stats = socket->wait_stats;
+
+    if (socket->socket_fd >= 0) {
+        close(socket->socket_fd);
+    }
+    if (spare->owns_stats) {
+        vma_stats_destroy(spare->stats);
+    }
+
+    *socket = *spare;
+    socket->stats = stats;
+    socket->owns_stats = owns_stats;
+    socket->wait_stats = wait_stats;
+}
+
+tcp_result_t tcp_pool_replace(tcp_conn_pool_t* pool, tcp_socket_t* socket, int timeout_ms) {
+    if (!pool || !socket) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    // A live pre-connected spare needs no system call beyond the liveness probe
+    // (idle spares see no traffic, so their state has to be asked of the kernel)
+    for (size_t i = pool->spare_count; i-- > 0;) {
+        tcp_socket_t* spare = &pool->spares[i];
+        if (spare->state != TCP_STATE_CONNECTED) {
+            continue;
+        }
+
+        tcp_socket_t candidate = take_spare(pool, i);
+        if (!tcp_socket_probe(&candidate)) {
+            tcp_socket_close(&candidate);
+            pool->stats.stale++;
+            continue;
+        }
+
+        install_spare(socket, &candidate);
+        pool->stats.swaps++;
+        return TCP_SUCCESS;
+    }
+
+    if (pool->spare_count == 0) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+
+    // Configured but unconnected: only the handshake is left
+    const struct sockaddr_in* peer = &socket->remote_addr;
+    if (peer->sin_family == 0) {
+        if (pool->endpoint_count == 0) {
+            return TCP_ERROR_NOT_INITIALIZED;
+        }
+        peer = &pool->endpoints[0];
+    }
+
+    struct sockaddr_in target = *peer;
+    tcp_socket_t candidate = take_spare(pool, pool->spare_count - 1);
+    tcp_result_t result = connect_to(&candidate, &target, timeout_ms);
+    if (result != TCP_SUCCESS) {
+        tcp_socket_close(&candidate);
+        pool->stats.failures++;
+        return result;
+    }
+
+    install_spare(socket, &candidate);
+    pool->stats.swaps++;
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_pool_get_stats(const tcp_conn_pool_t* pool, tcp_pool_stats_t* stats) {
+    if (!pool || !stats) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    *stats = pool->stats;
+    return TCP_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/**
+ * tcp_conn_pool.h - Pre-warmed TCP connection pool for fast failover
+ */
+
+#ifndef TCP_CONN_POOL_H
+#define TCP_CONN_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "vma_common.h"
+#include "tcp_socket.h"
+
+// Maximum number of spare sockets kept by a pool
+#define TCP_POOL_MAX_SPARES 16
+
+// Maximum number of standby endpoints
+#define TCP_POOL_MAX_ENDPOINTS 8
+
+// Pool counters
+typedef struct {
+    uint64_t created;              // Spare sockets created
+    uint64_t connected;            // Spares connected ahead of time
+    uint64_t swaps;                // Spares swapped into a live socket
+    uint64_t stale;                // Pre-connected spares found dead and discarded
+    uint64_t failures;             // Spare creations or connects that failed
+} tcp_pool_stats_t;
+
+// Pool structure
+typedef struct {
+    vma_options_t vma_options;                      // Options every spare is created with
+    tcp_socket_t spares[TCP_POOL_MAX_SPARES];       // Ready sockets (first spare_count entries)
+    size_t spare_count;                             // Number of ready sockets
+    size_t target;                                  // Number of spares to keep
+    struct sockaddr_in endpoints[TCP_POOL_MAX_ENDPOINTS]; // Standby endpoints
+    size_t endpoint_count;                          // Number of endpoints
+    size_t next_endpoint;                           // Round-robin position for pre-connects
+    bool preconnect;                                // Connect spares to the endpoints during refill
+    tcp_pool_stats_t stats;                         // Counters
+} tcp_conn_pool_t;
+
+/**
+ * Initialize an empty pool (no socket is created until tcp_pool_refill)
+ *
+ * @param pool Pointer to the pool structure to initialize
+ * @param options VMA options for every spare (use default if NULL)
+ * @param target Number of spares to keep (at most TCP_POOL_MAX_SPARES)
+ * @param preconnect Connect spares to the standby endpoints ahead of time
+ * @return Result code
+ */
+tcp_result_t tcp_pool_init(tcp_conn_pool_t* pool, const vma_options_t* options, size_t target, bool preconnect);
+
+/**
+ * Close every spare and release the pool
+ *
+ * @param pool Pointer to the pool structure
+ * @return Result code
+ */
+tcp_result_t tcp_pool_close(tcp_conn_pool_t* pool);
+
+/**
+ * Add a standby endpoint (spares are connected to the endpoints in turn)
+ *
+ * @param pool Pointer to the pool structure
+ * @param ip Endpoint IP address
+ * @param port Endpoint port
+ * @return Result code
+ */
+tcp_result_t tcp_pool_add_endpoint(tcp_conn_pool_t* pool, const char* ip, uint16_t port);
+
+/**
+ * Top the pool up to its target (call off the hot path)
+ *
+ * Discards pre-connected spares whose connection died, creates missing
+ * spares and, with preconnect, connects them.
+ *
+ * @param pool Pointer to the pool structure
+ * @param timeout_ms Connect timeout per spare in milliseconds
+ * @param ready Number of spares ready afterwards (can be NULL)
+ * @return Result code (TCP_SUCCESS even when some spares failed; see stats)
+ */
+tcp_result_t tcp_pool_refill(tcp_conn_pool_t* pool, int timeout_ms, size_t* ready);
+
+/**
+ * Replace a dropped connection with a spare in one step
+ *
+ * A live pre-connected spare is swapped in directly; otherwise an unconnected
+ * spare is connected to the socket's previous peer (or the first endpoint),
+ * so only the handshake is left. The socket keeps its statistics block and
+ * wait counters; the old descriptor is closed.
+ *
+ * @param pool Pointer to the pool structure
+ * @param socket Socket to replace
+ * @param timeout_ms Connect timeout in milliseconds when the spare is not connected yet
+ * @return Result code (TCP_ERROR_NOT_INITIALIZED if the pool is empty)
+ */
+tcp_result_t tcp_pool_replace(tcp_conn_pool_t* pool, tcp_socket_t* socket, int timeout_ms);
+
+/**
+ * Read the pool counters
+ *
+ * @param pool Pointer to the pool structure
+ * @param stats Destination for the counters
+ * @return Result code
+ */
+tcp_result_t tcp_pool_get_stats(const tcp_conn_pool_t* pool, tcp_pool_stats_t* stats);
+
+#endif /* TCP_CONN_POOL_H */
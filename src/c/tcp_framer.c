@@ -0,0 +1,301 @@
+/**
+ * tcp_framer.c - Length-prefixed message framing over a TCP connection
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "tcp_framer.h"
+
+// Round the capacity up to a power of two of at least one page
+static size_t ring_capacity(size_t requested) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t capacity = page > 0 ? page : 4096;
+
+    while (capacity < requested) {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+// Map the same pages twice back to back so any capacity-sized window is contiguous
+static uint8_t* map_mirrored(size_t capacity) {
+    int fd = memfd_create("tcp_framer", MFD_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)capacity) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // Reserve both halves first so nothing else can land in between
+    uint8_t* base = mmap(NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * capacity);
+        close(fd);
+        return NULL;
+    }
+
+    // The mappings keep the memory alive
+    close(fd);
+    return base;
+}
+
+static tcp_result_t framer_init(tcp_framer_t* framer, int fd, const vma_wait_mode_t* wait_mode,
+                                vma_stats_t* stats, const tcp_frame_format_t* format,
+                                size_t capacity, bool mirrored) {
+    if (!framer || fd < 0 || !format) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (format->length_width != 2 && format->length_width != 4) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    memset(framer, 0, sizeof(tcp_framer_t));
+    framer->socket_fd = fd;
+    framer->format = *format;
+    framer->wait_mode = *wait_mode;
+    framer->stats = stats;
+
+    size_t field_end = format->length_offset + format->length_width;
+    if (framer->format.header_size == 0) {
+        framer->format.header_size = field_end;
+    } else if (framer->format.header_size < field_end) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    framer->capacity = ring_capacity(capacity > 0 ? capacity : TCP_FRAMER_DEFAULT_CAPACITY);
+    framer->mask = framer->capacity - 1;
+
+    // A message must fit in the ring in one piece
+    if (framer->format.max_message == 0 || framer->format.max_message > framer->capacity) {
+        framer->format.max_message = framer->capacity;
+    }
+    if (framer->format.max_message < framer->format.header_size) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (mirrored) {
+        framer->ring = map_mirrored(framer->capacity);
+        framer->mirrored = framer->ring != NULL;
+    }
+
+    // Without memfd or a free address range, fall back to a linear buffer
+    if (!framer->ring) {
+        framer->ring = malloc(framer->capacity);
+        if (!framer->ring) {
+            return TCP_ERROR_SOCKET_CREATE;
+        }
+    }
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_framer_init_socket(tcp_framer_t* framer, tcp_socket_t* socket,
+                                    const tcp_frame_format_t* format, size_t capacity, bool mirrored) {
+    if (!socket || socket->state != TCP_STATE_CONNECTED) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+
+    tcp_result_t result = framer_init(framer, socket->socket_fd, &socket->wait_mode, socket->stats,
+                                      format, capacity, mirrored);
+    if (result == TCP_SUCCESS) {
+        framer->socket = socket;
+    }
+    return result;
+}
+
+tcp_result_t tcp_framer_init_client(tcp_framer_t* framer, const tcp_client_t* client,
+                                    const tcp_frame_format_t* format, size_t capacity, bool mirrored) {
+    if (!client) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    return framer_init(framer, client->socket_fd, &client->wait_mode, NULL,
+                    format, capacity, mirrored);
+}
+
+tcp_result_t tcp_framer_close(tcp_framer_t* framer) {
+    if (!framer) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (framer->ring) {
+        if (framer->mirrored) {
+            munmap(framer->ring, 2 * framer->capacity);
+        } else {
+            free(framer->ring);
+        }
+    }
+
+    framer->ring = NULL;
+    framer->head = 0;
+    framer->tail = 0;
+
+    return TCP_SUCCESS;
+}
+
+// Read the length field of the message starting at header
+static size_t read_length(const tcp_frame_format_t* format, const uint8_t* header) {
+    const uint8_t* field = header + format->length_offset;
+
+    if (format->length_width == 2) {
+        return format->big_endian ? ((size_t)field[0] << 8) | field[1]
+                                : ((size_t)field[1] << 8) | field[0];
+    }
+
+    return format->big_endian ?
+        ((size_t)field[0] << 24) | ((size_t)field[1] << 16) | ((size_t)field[2] << 8) | field[3] :
+        ((size_t)field[3] << 24) | ((size_t)field[2] << 16) | ((size_t)field[1] << 8) | field[0];
+}
+
+// Hand out the complete messages at the head of the ring
+static tcp_result_t parse_messages(tcp_framer_t* framer, tcp_frame_t* frames, size_t max_frames,
+                                size_t* count) {
+    const tcp_frame_format_t* format = &framer->format;
+
+    while (*count < max_frames) {
+        size_t available = (size_t)(framer->tail - framer->head);
+        if (available < format->header_size) {
+            break;
+        }
+
+        // Mirrored positions run freely, linear ones stay below capacity
+        const uint8_t* message = framer->ring + (framer->head & framer->mask);
+        size_t length = read_length(format, message);
+        if (!format->length_includes_header) {
+            length += format->header_size;
+        }
+
+        if (length < format->header_size || length > format->max_message) {
+            // Deliver what came before; the bad header stays at the head
+            return *count > 0 ? TCP_SUCCESS : TCP_ERROR_PROTOCOL;
+        }
+
+        if (available < length) {
+            break;
+        }
+
+        frames[*count].data = message;
+        frames[*count].length = length;
+        frames[*count].payload_offset = format->header_size;
+        framer->head += length;
+        (*count)++;
+    }
+
+    return TCP_SUCCESS;
+}
+
+// Free space in the ring for the next receive (linear mode moves the partial message to the front)
+static size_t prepare_space(tcp_framer_t* framer, uint8_t** dest) {
+    size_t used = (size_t)(framer->tail - framer->head);
+
+    if (framer->mirrored) {
+        *dest = framer->ring + (framer->tail & framer->mask);
+        return framer->capacity - used;
+    }
+
+    if (framer->head > 0) {
+        memmove(framer->ring, framer->ring + framer->head, used);
+        framer->head = 0;
+        framer->tail = used;
+    }
+
+    *dest = framer->ring + framer->tail;
+    return framer->capacity - used;
+}
+
+tcp_result_t tcp_recv_messages(tcp_framer_t* framer, tcp_frame_t* frames, size_t max_frames,
+                            int timeout_ms, size_t* n) {
+    if (!framer || !framer->ring || !frames || max_frames == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (n) {
+        *n = 0;
+    }
+
+    // Messages left over from the last receive need no system call
+    size_t count = 0;
+    tcp_result_t result = parse_messages(framer, frames, max_frames, &count);
+    if (result != TCP_SUCCESS || count > 0) {
+        framer->rx_messages += count;
+        if (n) {
+            *n = count;
+        }
+        return result;
+    }
+
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+
+    // Receive until at least one message is complete or the deadline passes
+    uint64_t bytes = 0;
+    uint64_t start_ticks = 0;
+    while (count == 0) {
+        uint8_t* dest;
+        size_t space = prepare_space(framer, &dest);
+        if (space == 0) {
+            // Only possible with a header that max_message should have rejected
+            return TCP_ERROR_PROTOCOL;
+        }
+
+        start_ticks = vma_clock_ticks();
+        ssize_t res = recv(framer->socket_fd, dest, space, MSG_DONTWAIT);
+
+        if (res > 0) {
+            framer->tail += (uint64_t)res;
+            framer->rx_bytes += (uint64_t)res;
+            bytes += (uint64_t)res;
+
+            result = parse_messages(framer, frames, max_frames, &count);
+            if (result != TCP_SUCCESS) {
+                return result;
+            }
+            continue;
+        }
+
+        if (res == 0) {
+            // Connection closed by peer (a partial message is discarded with it)
+            tcp_socket_mark_disconnected(framer->socket);
+            return TCP_ERROR_CLOSED;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            vma_stats_rx_miss(framer->stats, false, deadline.empty_polls);
+            tcp_socket_mark_disconnected(framer->socket);
+            return TCP_ERROR_RECV;
+        }
+
+        int wait_result = vma_deadline_wait(&deadline, framer->socket_fd,
+                                            &framer->wait_mode, &framer->wait_stats);
+        if (wait_result <= 0) {
+            // A partial message stays buffered for the next call
+            vma_stats_rx_miss(framer->stats, wait_result == 0, deadline.empty_polls);
+            return wait_result == 0 ? TCP_ERROR_TIMEOUT : TCP_ERROR_RECV;
+        }
+    }
+
+    vma_deadline_done(&deadline, &framer->wait_mode, &framer->wait_stats);
+    vma_stats_rx(framer->stats, count, bytes, vma_clock_ticks() - start_ticks, deadline.empty_polls);
+    framer->rx_messages += count;
+
+    if (n) {
+        *n = count;
+    }
+
+    return TCP_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/**
+ * tcp_framer.h - Length-prefixed message framing over a TCP connection
+ */
+
+#ifndef TCP_FRAMER_H
+#define TCP_FRAMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "vma_common.h"
+#include "vma_stats.h"
+#include "tcp_socket.h"
+
+// Default receive ring capacity (rounded up to a power of two of at least a page)
+#define TCP_FRAMER_DEFAULT_CAPACITY (256 * 1024)
+
+// Message header layout
+typedef struct {
+    size_t length_offset;          // Byte offset of the length field within the header
+    size_t length_width;           // Width of the length field in bytes (2 or 4)
+    bool big_endian;               // Network byte order (false for little endian)
+    size_t header_size;            // Total header size (0 for length_offset + length_width)
+    bool length_includes_header;   // Whether the length counts the header as well as the payload
+    size_t max_message;            // Largest accepted message including the header (0 for the ring capacity)
+} tcp_frame_format_t;
+
+// Complete message (view into the receive ring)
+typedef struct {
+    const void* data;              // Start of the message (the header)
+    size_t length;                 // Message length including the header
+    size_t payload_offset;         // Offset of the payload from data (the header size)
+} tcp_frame_t;
+
+// Framer structure
+typedef struct {
+    int socket_fd;                 // Connection file descriptor (not owned)
+    tcp_socket_t* socket;          // Socket marked disconnected on close or error (NULL for accepted clients)
+    tcp_frame_format_t format;     // Header layout (header_size and max_message resolved)
+    uint8_t* ring;                 // Receive ring (mapped twice back to back when mirrored)
+    size_t capacity;               // Ring capacity in bytes
+    bool mirrored;                 // Whether the ring is a mirrored double mapping
+    size_t mask;                   // capacity - 1 (capacity is a power of two)
+    uint64_t head;                 // Read position (start of the first unreturned byte)
+    uint64_t tail;                 // Write position
+    vma_wait_mode_t wait_mode;     // Receive wait policy (copied from the connection)
+    vma_wait_stats_t wait_stats;   // Spin hits vs. blocking wakeups
+    vma_stats_t* stats;            // Connection statistics block (NULL for accepted clients)
+    uint64_t rx_messages;          // Number of messages returned
+    uint64_t rx_bytes;             // Number of bytes received
+} tcp_framer_t;
+
+/**
+ * Attach a framer to a connected TCP socket
+ *
+ * The framer receives on the descriptor and marks the socket disconnected
+ * when the peer closes or a receive fails. The socket must stay open; if it
+ * is moved, point framer->socket at its new address before the next call.
+ *
+ * @param framer Pointer to the framer structure to initialize
+ * @param socket Connected TCP socket
+ * @param format Header layout
+ * @param capacity Ring capacity in bytes (0 for TCP_FRAMER_DEFAULT_CAPACITY)
+ * @param mirrored Map the ring twice so messages crossing the end stay contiguous
+ * @return Result code
+ */
+tcp_result_t tcp_framer_init_socket(tcp_framer_t* framer, tcp_socket_t* socket,
+                                    const tcp_frame_format_t* format, size_t capacity, bool mirrored);
+
+/**
+ * Attach a framer to an accepted client connection
+ *
+ * @param framer Pointer to the framer structure to initialize
+ * @param client Accepted client
+ * @param format Header layout
+ * @param capacity Ring capacity in bytes (0 for TCP_FRAMER_DEFAULT_CAPACITY)
+ * @param mirrored Map the ring twice so messages crossing the end stay contiguous
+ * @return Result code
+ */
+tcp_result_t tcp_framer_init_client(tcp_framer_t* framer, const tcp_client_t* client,
+                                    const tcp_frame_format_t* format, size_t capacity, bool mirrored);
+
+/**
+ * Release the receive ring (the connection is not closed)
+ *
+ * @param framer Pointer to the framer structure
+ * @return Result code
+ */
+tcp_result_t tcp_framer_close(tcp_framer_t* framer);
+
+/**
+ * Receive complete messages
+ *
+ * Returns the messages already buffered without a system call; otherwise
+ * receives once into the ring (retrying until the deadline while nothing or
+ * only a partial message arrived) and returns every complete message. Views
+ * stay valid until the next call or tcp_framer_close.
+ *
+ * @param framer Pointer to the framer structure
+ * @param frames Output message array
+ * @param max_frames Size of the message array
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of messages stored (can be NULL)
+ * @return Result code (TCP_ERROR_PROTOCOL for a length outside the accepted range)
+ */
+tcp_result_t tcp_recv_messages(tcp_framer_t* framer, tcp_frame_t* frames, size_t max_frames,
+                            int timeout_ms, size_t* n);
+
+#endif /* TCP_FRAMER_H */
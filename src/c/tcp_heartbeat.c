@@ -0,0 +1,271 @@
+/**
+ * tcp_heartbeat.c - Heartbeat scheduler with per-connection deadlines in a timer wheel
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_heartbeat.h"
+
+#define DEFAULT_SLOT_COUNT 1024
+#define NS_PER_MS 1000000ULL
+
+static uint32_t* list_head(tcp_heartbeat_t* hb, const tcp_heartbeat_entry_t* entry) {
+    return entry->slot == TCP_HEARTBEAT_NONE ? &hb->walking : &hb->slots[entry->slot];
+}
+
+static void unlink_entry(tcp_heartbeat_t* hb, uint32_t id) {
+    tcp_heartbeat_entry_t* entry = &hb->entries[id];
+
+    if (entry->prev != TCP_HEARTBEAT_NONE) {
+        hb->entries[entry->prev].next = entry->next;
+    } else {
+        *list_head(hb, entry) = entry->next;
+    }
+    if (entry->next != TCP_HEARTBEAT_NONE) {
+        hb->entries[entry->next].prev = entry->prev;
+    }
+    entry->prev = TCP_HEARTBEAT_NONE;
+    entry->next = TCP_HEARTBEAT_NONE;
+}
+
+static void push_entry(tcp_heartbeat_t* hb, uint32_t* head, uint32_t id) {
+    tcp_heartbeat_entry_t* entry = &hb->entries[id];
+
+    entry->prev = TCP_HEARTBEAT_NONE;
+    entry->next = *head;
+    if (*head != TCP_HEARTBEAT_NONE) {
+        hb->entries[*head].prev = id;
+    }
+    *head = id;
+}
+
+// Earliest of the two deadlines (UINT64_MAX when both are disabled)
+static uint64_t next_deadline(const tcp_heartbeat_entry_t* entry) {
+    uint64_t deadline = UINT64_MAX;
+
+    if (entry->interval_ns > 0) {
+        deadline = entry->last_tx_ns + entry->interval_ns;
+    }
+    if (entry->timeout_ns > 0 && entry->last_rx_ns + entry->timeout_ns < deadline) {
+        deadline = entry->last_rx_ns + entry->timeout_ns;
+    }
+
+    return deadline;
+}
+
+// Link an entry into the slot of its next deadline. Deadlines in a tick that
+// was already processed go to the current tick, which the next advance visits
+// again, and deadlines beyond one rotation are re-examined (and relinked) when
+// their slot comes round.
+static void schedule_entry(tcp_heartbeat_t* hb, uint32_t id) {
+    tcp_heartbeat_entry_t* entry = &hb->entries[id];
+    uint64_t deadline = next_deadline(entry);
+    uint64_t tick = deadline == UINT64_MAX ? hb->current_tick + hb->slot_count - 1 : deadline / hb->tick_ns;
+
+    if (tick < hb->current_tick) {
+        tick = hb->current_tick;
+    }
+
+    entry->slot = (uint32_t)(tick & hb->slot_mask);
+    push_entry(hb, &hb->slots[entry->slot], id);
+}
+
+static void free_entry(tcp_heartbeat_t* hb, uint32_t id) {
+    tcp_heartbeat_entry_t* entry = &hb->entries[id];
+
+    entry->active = false;
+    entry->socket = NULL;
+    entry->slot = TCP_HEARTBEAT_NONE;
+    entry->prev = TCP_HEARTBEAT_NONE;
+    entry->next = hb->free_head;
+    hb->free_head = id;
+    hb->count--;
+}
+
+tcp_result_t tcp_heartbeat_init(tcp_heartbeat_t* hb, uint32_t capacity, uint32_t tick_ms, uint32_t slot_count) {
+    if (!hb || capacity == 0 || capacity == TCP_HEARTBEAT_NONE) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    memset(hb, 0, sizeof(tcp_heartbeat_t));
+
+    if (slot_count == 0) {
+        slot_count = DEFAULT_SLOT_COUNT;
+    }
+    uint32_t slots = 1;
+    while (slots < slot_count && slots < (1U << 30)) {
+        slots <<= 1;
+    }
+
+    hb->entries = calloc(capacity, sizeof(tcp_heartbeat_entry_t));
+    hb->slots = malloc(slots * sizeof(uint32_t));
+    if (!hb->entries || !hb->slots) {
+        free(hb->entries);
+        free(hb->slots);
+        memset(hb, 0, sizeof(tcp_heartbeat_t));
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    for (uint32_t i = 0; i < slots; i++) {
+        hb->slots[i] = TCP_HEARTBEAT_NONE;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        hb->entries[i].next = i + 1 < capacity ? i + 1 : TCP_HEARTBEAT_NONE;
+        hb->entries[i].prev = TCP_HEARTBEAT_NONE;
+        hb->entries[i].slot = TCP_HEARTBEAT_NONE;
+    }
+
+    hb->capacity = capacity;
+    hb->free_head = 0;
+    hb->slot_count = slots;
+    hb->slot_mask = slots - 1;
+    hb->tick_ns = (uint64_t)(tick_ms > 0 ? tick_ms : 1) * NS_PER_MS;
+    hb->walking = TCP_HEARTBEAT_NONE;
+
+    vma_clock_init();
+    hb->current_tick = vma_clock_ns() / hb->tick_ns;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_heartbeat_close(tcp_heartbeat_t* hb) {
+    if (!hb) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    free(hb->entries);
+    free(hb->slots);
+    memset(hb, 0, sizeof(tcp_heartbeat_t));
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_heartbeat_add(tcp_heartbeat_t* hb, tcp_socket_t* socket, uint64_t user_data,
+                            uint32_t interval_ms, uint32_t timeout_ms, uint32_t* id) {
+    if (!hb || !hb->entries || !id) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (hb->free_head == TCP_HEARTBEAT_NONE) {
+        return TCP_ERROR_WOULD_BLOCK;
+    }
+
+    uint32_t index = hb->free_head;
+    tcp_heartbeat_entry_t* entry = &hb->entries[index];
+    hb->free_head = entry->next;
+
+    uint64_t now = vma_clock_ns();
+    entry->socket = socket;
+    entry->user_data = user_data;
+    entry->last_rx_ns = now;
+    entry->last_tx_ns = now;
+    entry->interval_ns = (uint64_t)interval_ms * NS_PER_MS;
+    entry->timeout_ns = (uint64_t)timeout_ms * NS_PER_MS;
+    entry->active = true;
+    hb->count++;
+
+    schedule_entry(hb, index);
+
+    *id = index;
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_heartbeat_remove(tcp_heartbeat_t* hb, uint32_t id) {
+    if (!hb || !hb->entries || id >= hb->capacity || !hb->entries[id].active) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    unlink_entry(hb, id);
+    free_entry(hb, id);
+
+    return TCP_SUCCESS;
+}
+
+void tcp_heartbeat_touch_rx(tcp_heartbeat_t* hb, uint32_t id) {
+    // Only the timestamp moves; the entry is relinked lazily when its old slot comes round
+    if (hb && id < hb->capacity) {
+        hb->entries[id].last_rx_ns = vma_clock_ns();
+    }
+}
+
+void tcp_heartbeat_touch_tx(tcp_heartbeat_t* hb, uint32_t id) {
+    if (hb && id < hb->capacity) {
+        hb->entries[id].last_tx_ns = vma_clock_ns();
+    }
+}
+
+tcp_result_t tcp_heartbeat_advance(tcp_heartbeat_t* hb, tcp_heartbeat_callback_t callback, void* context,
+                                size_t* n) {
+    return tcp_heartbeat_advance_at(hb, vma_clock_ns(), callback, context, n);
+}
+
+tcp_result_t tcp_heartbeat_advance_at(tcp_heartbeat_t* hb, uint64_t now, tcp_heartbeat_callback_t callback,
+                                    void* context, size_t* n) {
+    if (!hb || !hb->entries || !callback) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t now_tick = now / hb->tick_ns;
+    size_t events = 0;
+
+    // After a long gap every slot is visited once; deadlines sit in their slot modulo the wheel size
+    if (now_tick >= hb->current_tick + hb->slot_count) {
+        hb->current_tick = now_tick - hb->slot_count + 1;
+    }
+
+    // The current tick is not over yet: it stays current so a later call revisits its slot
+    for (;;) {
+        uint32_t slot = (uint32_t)(hb->current_tick & hb->slot_mask);
+
+        // Detach the slot so relinked entries never land in the list being walked
+        hb->walking = hb->slots[slot];
+        hb->slots[slot] = TCP_HEARTBEAT_NONE;
+        for (uint32_t i = hb->walking; i != TCP_HEARTBEAT_NONE; i = hb->entries[i].next) {
+            hb->entries[i].slot = TCP_HEARTBEAT_NONE;
+        }
+
+        while (hb->walking != TCP_HEARTBEAT_NONE) {
+            uint32_t id = hb->walking;
+            tcp_heartbeat_entry_t* entry = &hb->entries[id];
+            unlink_entry(hb, id);
+
+            tcp_heartbeat_event_t event;
+            event.id = id;
+            event.user_data = entry->user_data;
+
+            if (entry->timeout_ns > 0 && now >= entry->last_rx_ns + entry->timeout_ns) {
+                event.type = TCP_HEARTBEAT_TIMEOUT;
+                event.idle_ns = now - entry->last_rx_ns;
+                tcp_socket_mark_disconnected(entry->socket);
+                free_entry(hb, id);
+                callback(&event, context);
+                events++;
+                continue;
+            }
+
+            if (entry->interval_ns > 0 && now >= entry->last_tx_ns + entry->interval_ns) {
+                event.type = TCP_HEARTBEAT_DUE;
+                event.idle_ns = now - entry->last_tx_ns;
+                entry->last_tx_ns = now;
+                schedule_entry(hb, id);
+                callback(&event, context);
+                events++;
+                continue;
+            }
+
+            // Touched since it was scheduled: move to the new deadline
+            schedule_entry(hb, id);
+        }
+
+        if (hb->current_tick >= now_tick) {
+            break;
+        }
+        hb->current_tick++;
+    }
+
+    if (n) {
+        *n = events;
+    }
+
+    return TCP_SUCCESS;
+}
@@ -0,0 +1,152 @@
+/**
+ * tcp_heartbeat.h - Heartbeat scheduler with per-connection deadlines in a timer wheel
+ */
+
+#ifndef TCP_HEARTBEAT_H
+#define TCP_HEARTBEAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "vma_common.h"
+#include "tcp_socket.h"
+
+// Invalid entry index (list terminator)
+#define TCP_HEARTBEAT_NONE UINT32_MAX
+
+// Heartbeat event types
+typedef enum {
+    TCP_HEARTBEAT_DUE = 1,             // Nothing was sent for interval_ms (send a heartbeat)
+    TCP_HEARTBEAT_TIMEOUT = 2          // Nothing was received for timeout_ms (entry removed)
+} tcp_heartbeat_event_type_t;
+
+// Heartbeat event
+typedef struct {
+    tcp_heartbeat_event_type_t type;   // Event type
+    uint32_t id;                       // Entry the event belongs to
+    uint64_t user_data;                // Value given at registration
+    uint64_t idle_ns;                  // Time since the last send (DUE) or receive (TIMEOUT)
+} tcp_heartbeat_event_t;
+
+// Tracked connection (linked into the wheel slot of its next deadline)
+typedef struct {
+    tcp_socket_t* socket;              // Socket marked disconnected on timeout (can be NULL)
+    uint64_t user_data;                // Application value reported with every event
+    uint64_t last_rx_ns;               // Last receive (vma_clock_ns timeline)
+    uint64_t last_tx_ns;               // Last send
+    uint64_t interval_ns;              // Send a heartbeat after this much send idle time (0 disables)
+    uint64_t timeout_ns;               // Declare the peer dead after this much receive idle time (0 disables)
+    uint32_t prev;                     // Previous entry in the slot list
+    uint32_t next;                     // Next entry in the slot list (or free list)
+    uint32_t slot;                     // Slot the entry is linked into (TCP_HEARTBEAT_NONE while being processed)
+    bool active;                       // Whether the entry is in use
+} tcp_heartbeat_entry_t;
+
+// Scheduler structure (single-threaded: touch, add, remove and advance on one thread)
+typedef struct {
+    tcp_heartbeat_entry_t* entries;    // capacity entries
+    uint32_t capacity;                 // Maximum number of tracked connections
+    uint32_t free_head;                // First free entry
+    uint32_t* slots;                   // slot_count list heads
+    uint32_t slot_count;               // Number of wheel slots (power of two)
+    uint32_t slot_mask;                // slot_count - 1
+    uint64_t tick_ns;                  // Time covered by one slot
+    uint64_t current_tick;             // Latest tick processed (visited again until it is over)
+    uint32_t walking;                  // Entries detached from the slot being processed
+    uint32_t count;                    // Number of tracked connections
+} tcp_heartbeat_t;
+
+// Event callback (may call touch and remove, but not add)
+typedef void (*tcp_heartbeat_callback_t)(const tcp_heartbeat_event_t* event, void* context);
+
+/**
+ * Initialize a heartbeat scheduler
+ *
+ * Touching a connection is a clock read and a store; deadlines are only
+ * re-evaluated when their slot comes round in tcp_heartbeat_advance.
+ *
+ * @param hb Pointer to the scheduler structure to initialize
+ * @param capacity Maximum number of tracked connections
+ * @param tick_ms Wheel resolution in milliseconds (0 for 1)
+ * @param slot_count Number of wheel slots (rounded to a power of two, 0 for 1024)
+ * @return Result code
+ */
+tcp_result_t tcp_heartbeat_init(tcp_heartbeat_t* hb, uint32_t capacity, uint32_t tick_ms, uint32_t slot_count);
+
+/**
+ * Release a scheduler (tracked sockets are not touched)
+ *
+ * @param hb Pointer to the scheduler structure
+ * @return Result code
+ */
+tcp_result_t tcp_heartbeat_close(tcp_heartbeat_t* hb);
+
+/**
+ * Start tracking a connection (both idle timers start now)
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param socket Socket marked disconnected when the timeout expires (can be NULL)
+ * @param user_data Value reported with every event
+ * @param interval_ms Send idle time before a DUE event (0 disables)
+ * @param timeout_ms Receive idle time before a TIMEOUT event (0 disables)
+ * @param id Entry identifier for touch and remove
+ * @return Result code (TCP_ERROR_WOULD_BLOCK if the scheduler is full)
+ */
+tcp_result_t tcp_heartbeat_add(tcp_heartbeat_t* hb, tcp_socket_t* socket, uint64_t user_data,
+                            uint32_t interval_ms, uint32_t timeout_ms, uint32_t* id);
+
+/**
+ * Stop tracking a connection
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param id Entry identifier
+ * @return Result code
+ */
+tcp_result_t tcp_heartbeat_remove(tcp_heartbeat_t* hb, uint32_t id);
+
+/**
+ * Record that data was received (restarts the timeout)
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param id Entry identifier
+ */
+void tcp_heartbeat_touch_rx(tcp_heartbeat_t* hb, uint32_t id);
+
+/**
+ * Record that data was sent (restarts the heartbeat interval)
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param id Entry identifier
+ */
+void tcp_heartbeat_touch_tx(tcp_heartbeat_t* hb, uint32_t id);
+
+/**
+ * Process every slot up to the current time and report expired deadlines
+ *
+ * Call regularly (about once per tick) from the thread that owns the connections.
+ * A DUE event restarts the interval; a TIMEOUT event marks the socket
+ * disconnected (if one was given) and removes the entry.
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param callback Function receiving each event
+ * @param context Value passed to the callback
+ * @param n Number of events reported (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_heartbeat_advance(tcp_heartbeat_t* hb, tcp_heartbeat_callback_t callback, void* context,
+                                size_t* n);
+
+/**
+ * Process every slot up to a given time (tcp_heartbeat_advance with an explicit clock)
+ *
+ * @param hb Pointer to the scheduler structure
+ * @param now_ns Current vma_clock_ns time
+ * @param callback Function receiving each event
+ * @param context Value passed to the callback
+ * @param n Number of events reported (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_heartbeat_advance_at(tcp_heartbeat_t* hb, uint64_t now_ns, tcp_heartbeat_callback_t callback,
+                                    void* context, size_t* n);
+
+#endif /* TCP_HEARTBEAT_H */
@@ -0,0 +1,261 @@
+/**
+ * tcp_server_poller.c - epoll-based readiness multiplexer for TCP servers
+ */
+
+#include "tcp_server_poller.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// Default initial size of the registration table
+#define TCP_POLLER_DEFAULT_SLOTS 1024
+
+// Grow the registration table so that fd is a valid index
+static tcp_result_t ensure_slot(tcp_server_poller_t* poller, int fd) {
+    if (fd < poller->slot_capacity) {
+        return TCP_SUCCESS;
+    }
+
+    int new_capacity = poller->slot_capacity > 0 ? poller->slot_capacity : TCP_POLLER_DEFAULT_SLOTS;
+    while (new_capacity <= fd) {
+        new_capacity *= 2;
+    }
+
+    tcp_poller_slot_t* slots = realloc(poller->slots, (size_t)new_capacity * sizeof(tcp_poller_slot_t));
+    if (!slots) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    memset(slots + poller->slot_capacity, 0,
+           (size_t)(new_capacity - poller->slot_capacity) * sizeof(tcp_poller_slot_t));
+    poller->slots = slots;
+    poller->slot_capacity = new_capacity;
+    return TCP_SUCCESS;
+}
+
+static uint32_t epoll_mask(bool want_write) {
+    uint32_t mask = EPOLLIN | EPOLLRDHUP;
+    if (want_write) {
+        mask |= EPOLLOUT;
+    }
+    return mask;
+}
+
+static tcp_result_t register_fd(tcp_server_poller_t* poller, int fd, tcp_client_t* client,
+                                bool is_listener, uint64_t user_data) {
+    if (!poller || poller->epoll_fd < 0 || fd < 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    tcp_result_t result = ensure_slot(poller, fd);
+    if (result != TCP_SUCCESS) {
+        return result;
+    }
+
+    tcp_poller_slot_t* slot = &poller->slots[fd];
+    if (slot->registered) {
+        return TCP_ERROR_ALREADY_CONNECTED;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = epoll_mask(false);
+    ev.data.fd = fd;
+    if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        return TCP_ERROR_SOCKET_OPTION;
+    }
+
+    slot->user_data = user_data;
+    slot->client = client;
+    slot->registered = true;
+    slot->is_listener = is_listener;
+    slot->want_write = false;
+    poller->registered++;
+
+    if (is_listener) {
+        poller->listener_fd = fd;
+    }
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_poller_init(tcp_server_poller_t* poller, int expected_fds) {
+    if (!poller) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    memset(poller, 0, sizeof(tcp_server_poller_t));
+    poller->listener_fd = -1;
+
+    poller->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (poller->epoll_fd < 0) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    // Size the table from the expected count; fds are small integers so this
+    // usually avoids any reallocation on the accept path
+    int initial = expected_fds > 0 ? expected_fds : TCP_POLLER_DEFAULT_SLOTS;
+    if (ensure_slot(poller, initial - 1) != TCP_SUCCESS) {
+        close(poller->epoll_fd);
+        poller->epoll_fd = -1;
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_poller_close(tcp_server_poller_t* poller) {
+    if (!poller) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (poller->epoll_fd >= 0) {
+        close(poller->epoll_fd);
+        poller->epoll_fd = -1;
+    }
+
+    free(poller->slots);
+    poller->slots = NULL;
+    poller->slot_capacity = 0;
+    poller->registered = 0;
+    poller->listener_fd = -1;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_poller_add_listener(tcp_server_poller_t* poller, tcp_socket_t* socket, uint64_t user_data) {
+    if (!socket || socket->socket_fd < 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    return register_fd(poller, socket->socket_fd, NULL, true, user_data);
+}
+
+tcp_result_t tcp_poller_add_listener_fd(tcp_server_poller_t* poller, int fd, uint64_t user_data) {
+    return register_fd(poller, fd, NULL, true, user_data);
+}
+
+tcp_result_t tcp_poller_add_client(tcp_server_poller_t* poller, tcp_client_t* client, uint64_t user_data) {
+    if (!client || client->socket_fd < 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    return register_fd(poller, client->socket_fd, client, false, user_data);
+}
+
+tcp_result_t tcp_poller_add_fd(tcp_server_poller_t* poller, int fd, uint64_t user_data) {
+    return register_fd(poller, fd, NULL, false, user_data);
+}
+
+tcp_result_t tcp_poller_set_writable(tcp_server_poller_t* poller, int fd, bool want_write) {
+    if (!poller || poller->epoll_fd < 0 || fd < 0 || fd >= poller->slot_capacity) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    tcp_poller_slot_t* slot = &poller->slots[fd];
+    if (!slot->registered) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (slot->want_write == want_write) {
+        return TCP_SUCCESS;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = epoll_mask(want_write);
+    ev.data.fd = fd;
+    if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        return TCP_ERROR_SOCKET_OPTION;
+    }
+
+    slot->want_write = want_write;
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_poller_remove(tcp_server_poller_t* poller, int fd) {
+    if (!poller || poller->epoll_fd < 0 || fd < 0 || fd >= poller->slot_capacity) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    tcp_poller_slot_t* slot = &poller->slots[fd];
+    if (!slot->registered) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    // Removal can fail if the fd was already closed; the slot is cleared regardless
+    epoll_ctl(poller->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    if (slot->is_listener) {
+        poller->listener_fd = -1;
+    }
+    memset(slot, 0, sizeof(tcp_poller_slot_t));
+    poller->registered--;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_poller_wait(tcp_server_poller_t* poller, tcp_poller_event_t* events, size_t max_events,
+                            int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!poller || poller->epoll_fd < 0 || !events || max_events == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (max_events > TCP_POLLER_MAX_EVENTS) {
+        max_events = TCP_POLLER_MAX_EVENTS;
+    }
+
+    struct epoll_event ready[TCP_POLLER_MAX_EVENTS];
+    int count = epoll_wait(poller->epoll_fd, ready, (int)max_events, timeout_ms);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return TCP_ERROR_TIMEOUT;
+        }
+        return TCP_ERROR_RECV;
+    }
+    if (count == 0) {
+        return TCP_ERROR_TIMEOUT;
+    }
+
+    size_t stored = 0;
+    for (int i = 0; i < count; i++) {
+        int fd = ready[i].data.fd;
+        if (fd < 0 || fd >= poller->slot_capacity || !poller->slots[fd].registered) {
+            continue;  // Removed while the event was pending
+        }
+
+        const tcp_poller_slot_t* slot = &poller->slots[fd];
+        uint32_t flags = 0;
+        if (ready[i].events & EPOLLIN) {
+            flags |= TCP_POLLER_READABLE;
+        }
+        if (ready[i].events & EPOLLOUT) {
+            flags |= TCP_POLLER_WRITABLE;
+        }
+        if (ready[i].events & (EPOLLRDHUP | EPOLLHUP)) {
+            flags |= TCP_POLLER_HANGUP;
+        }
+        if (ready[i].events & EPOLLERR) {
+            flags |= TCP_POLLER_ERROR;
+        }
+
+        tcp_poller_event_t* out = &events[stored++];
+        out->fd = fd;
+        out->events = flags;
+        out->user_data = slot->user_data;
+        out->is_listener = slot->is_listener;
+        out->client = slot->client;
+    }
+
+    if (n) {
+        *n = stored;
+    }
+
+    return stored > 0 ? TCP_SUCCESS : TCP_ERROR_TIMEOUT;
+}
@@ -0,0 +1,140 @@
+/**
+ * tcp_server_poller.h - epoll-based readiness multiplexer for TCP servers
+ */
+
+#ifndef TCP_SERVER_POLLER_H
+#define TCP_SERVER_POLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tcp_socket.h"
+
+// Maximum number of events returned by a single wait
+#define TCP_POLLER_MAX_EVENTS 256
+
+// Readiness flags reported in tcp_poller_event_t.events
+#define TCP_POLLER_READABLE 0x01   // Data (or a pending connection on the listener) is available
+#define TCP_POLLER_WRITABLE 0x02   // Socket has send buffer space (only if requested)
+#define TCP_POLLER_HANGUP   0x04   // Peer closed the connection
+#define TCP_POLLER_ERROR    0x08   // Socket error
+
+// Registration slot (indexed by file descriptor)
+typedef struct {
+    uint64_t user_data;            // Application value reported with every event
+    tcp_client_t* client;          // Registered client structure (NULL for fd registrations)
+    bool registered;               // Whether the slot is in use
+    bool is_listener;              // Whether the fd is the listening socket
+    bool want_write;               // Whether writability is reported
+} tcp_poller_slot_t;
+
+// Poller structure
+typedef struct {
+    int epoll_fd;                  // epoll descriptor (offloaded by VMA when preloaded)
+    int listener_fd;               // Registered listening socket (-1 if none)
+    tcp_poller_slot_t* slots;      // Registration table indexed by fd
+    int slot_capacity;             // Number of entries in slots
+    int registered;                // Number of registered descriptors
+} tcp_server_poller_t;
+
+// Readiness event
+typedef struct {
+    int fd;                        // Ready descriptor
+    uint32_t events;               // TCP_POLLER_* flags
+    uint64_t user_data;            // Value given at registration
+    bool is_listener;              // Whether this is the listening socket (call accept)
+    tcp_client_t* client;          // Registered client structure (NULL for fd registrations)
+} tcp_poller_event_t;
+
+/**
+ * Create a poller
+ *
+ * @param poller Pointer to the poller structure to initialize
+ * @param expected_fds Expected number of descriptors (sizes the initial table, 0 for default)
+ * @return Result code
+ */
+tcp_result_t tcp_poller_init(tcp_server_poller_t* poller, int expected_fds);
+
+/**
+ * Release a poller (registered sockets are not closed)
+ *
+ * @param poller Pointer to the poller structure
+ * @return Result code
+ */
+tcp_result_t tcp_poller_close(tcp_server_poller_t* poller);
+
+/**
+ * Register the listening socket
+ *
+ * @param poller Pointer to the poller structure
+ * @param socket Listening TCP socket
+ * @param user_data Value reported with the listener's events
+ * @return Result code
+ */
+tcp_result_t tcp_poller_add_listener(tcp_server_poller_t* poller, tcp_socket_t* socket, uint64_t user_data);
+
+/**
+ * Register a listening socket by file descriptor
+ *
+ * @param poller Pointer to the poller structure
+ * @param fd Listening socket file descriptor
+ * @param user_data Value reported with the listener's events
+ * @return Result code
+ */
+tcp_result_t tcp_poller_add_listener_fd(tcp_server_poller_t* poller, int fd, uint64_t user_data);
+
+/**
+ * Register an accepted client
+ *
+ * The client structure must stay at the same address while registered.
+ *
+ * @param poller Pointer to the poller structure
+ * @param client Accepted client
+ * @param user_data Value reported with the client's events
+ * @return Result code
+ */
+tcp_result_t tcp_poller_add_client(tcp_server_poller_t* poller, tcp_client_t* client, uint64_t user_data);
+
+/**
+ * Register a descriptor without an associated client structure
+ *
+ * @param poller Pointer to the poller structure
+ * @param fd Socket file descriptor
+ * @param user_data Value reported with the descriptor's events
+ * @return Result code
+ */
+tcp_result_t tcp_poller_add_fd(tcp_server_poller_t* poller, int fd, uint64_t user_data);
+
+/**
+ * Enable or disable writability reporting for a descriptor
+ *
+ * @param poller Pointer to the poller structure
+ * @param fd Registered file descriptor
+ * @param want_write Whether to report TCP_POLLER_WRITABLE
+ * @return Result code
+ */
+tcp_result_t tcp_poller_set_writable(tcp_server_poller_t* poller, int fd, bool want_write);
+
+/**
+ * Unregister a descriptor (call before closing it)
+ *
+ * @param poller Pointer to the poller structure
+ * @param fd Registered file descriptor
+ * @return Result code
+ */
+tcp_result_t tcp_poller_remove(tcp_server_poller_t* poller, int fd);
+
+/**
+ * Wait for ready descriptors
+ *
+ * @param poller Pointer to the poller structure
+ * @param events Output event array
+ * @param max_events Size of the event array (capped at TCP_POLLER_MAX_EVENTS)
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of events stored (can be NULL)
+ * @return Result code (TCP_ERROR_TIMEOUT if nothing became ready)
+ */
+tcp_result_t tcp_poller_wait(tcp_server_poller_t* poller, tcp_poller_event_t* events, size_t max_events,
+                            int timeout_ms, size_t* n);
+
+#endif /* TCP_SERVER_POLLER_H */
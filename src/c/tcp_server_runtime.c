@@ -0,0 +1,489 @@
+/**
+ * tcp_server_runtime.c - Multi-threaded TCP server with per-core connection ownership
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "tcp_server_runtime.h"
+#include <mellanox/vma_extra.h>
+
+// Defaults for zero-valued configuration fields
+#define TCP_RUNTIME_DEFAULT_QUEUE 256
+#define TCP_RUNTIME_DEFAULT_CONNECTIONS 1024
+#define TCP_RUNTIME_DEFAULT_BACKLOG 1024
+#define TCP_RUNTIME_DEFAULT_POLL_MS 100
+
+// Connections accepted per acceptor call
+#define TCP_RUNTIME_ACCEPT_BATCH 64
+
+// Pause after a failed accept call so a persistent error (EMFILE/ENFILE) does not spin the acceptor
+#define TCP_RUNTIME_ACCEPT_BACKOFF_US 10000
+
+// Poller user data of the worker's wakeup eventfd
+#define TCP_RUNTIME_WAKE_TOKEN UINT64_MAX
+
+// Counters have one writer; relaxed stores keep concurrent readers tear-free
+static inline void bump(uint64_t* counter) {
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+static bool queue_push(tcp_runtime_queue_t* queue, const tcp_client_t* client) {
+    uint32_t tail = queue->tail;
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head > queue->mask) {
+        return false;
+    }
+
+    queue->slots[tail & queue->mask] = *client;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool queue_pop(tcp_runtime_queue_t* queue, tcp_client_t* client) {
+    uint32_t head = queue->head;
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *client = queue->slots[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Connections open plus connections still queued for the worker
+static uint32_t worker_load(tcp_runtime_worker_t* worker) {
+    uint32_t head = __atomic_load_n(&worker->queue.head, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&worker->stats.connections, __ATOMIC_RELAXED) + (worker->queue.tail - head);
+}
+
+static uint32_t pick_worker(tcp_server_runtime_t* runtime, const tcp_client_t* client) {
+    if (runtime->config.assign == TCP_RUNTIME_ASSIGN_HASH) {
+        uint32_t hash = (uint32_t)client->addr.sin_addr.s_addr * 2654435761u;
+        hash ^= (uint32_t)client->addr.sin_port * 40503u;
+        return (hash ^ (hash >> 16)) % runtime->worker_count;
+    }
+
+    uint32_t best = 0;
+    uint32_t best_load = worker_load(&runtime->workers[0]);
+    for (uint32_t i = 1; i < runtime->worker_count; i++) {
+        uint32_t load = worker_load(&runtime->workers[i]);
+        if (load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+static void close_connection(tcp_runtime_worker_t* worker, uint32_t slot) {
+    tcp_server_runtime_t* runtime = worker->runtime;
+    tcp_client_t* client = &worker->clients[slot];
+
+    runtime->callback(worker->index, client, TCP_RUNTIME_EVENT_CLOSED, runtime->context);
+
+    tcp_poller_remove(&worker->poller, client->socket_fd);
+    tcp_socket_close_client(client);
+
+    worker->free_slots[worker->free_count++] = slot;
+    __atomic_store_n(&worker->stats.connections, worker->stats.connections - 1, __ATOMIC_RELAXED);
+    bump(&worker->stats.closed);
+}
+
+// Take ownership of a handed-off connection on the worker's thread
+static void adopt_connection(tcp_runtime_worker_t* worker, const tcp_client_t* handoff) {
+    tcp_server_runtime_t* runtime = worker->runtime;
+
+    if (worker->free_count == 0) {
+        close(handoff->socket_fd);
+        bump(&worker->stats.rejected);
+        return;
+    }
+
+    uint32_t slot = worker->free_slots[--worker->free_count];
+    tcp_client_t* client = &worker->clients[slot];
+    *client = *handoff;
+
+    // First use from this thread: VMA places the connection on the worker's own ring.
+    // Not fatal without VMA.
+    struct vma_ring_alloc_logic_attr ring_attr;
+    memset(&ring_attr, 0, sizeof(ring_attr));
+    ring_attr.ring_alloc_logic = RING_LOGIC_PER_THREAD;
+    ring_attr.ingress = 1;
+    ring_attr.engress = 1;
+    ring_attr.comp_mask = VMA_RING_ALLOC_MASK_RING_INGRESS | VMA_RING_ALLOC_MASK_RING_ENGRESS;
+    setsockopt(client->socket_fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC, &ring_attr, sizeof(ring_attr));
+
+    if (tcp_poller_add_client(&worker->poller, client, slot) != TCP_SUCCESS) {
+        tcp_socket_close_client(client);
+        worker->free_slots[worker->free_count++] = slot;
+        bump(&worker->stats.rejected);
+        return;
+    }
+
+    __atomic_store_n(&worker->stats.connections, worker->stats.connections + 1, __ATOMIC_RELAXED);
+    bump(&worker->stats.accepted);
+
+    if (!runtime->callback(worker->index, client, TCP_RUNTIME_EVENT_OPEN, runtime->context)) {
+        close_connection(worker, slot);
+    }
+}
+
+static void* worker_main(void* arg) {
+    tcp_runtime_worker_t* worker = (tcp_runtime_worker_t*)arg;
+    tcp_server_runtime_t* runtime = worker->runtime;
+
+    if (worker->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    // Allocated after pinning so the pages are local to the worker's core
+    tcp_poller_event_t* events = calloc(TCP_POLLER_MAX_EVENTS, sizeof(tcp_poller_event_t));
+
+    while (events && __atomic_load_n(&runtime->running, __ATOMIC_ACQUIRE)) {
+        tcp_client_t handoff;
+        while (queue_pop(&worker->queue, &handoff)) {
+            adopt_connection(worker, &handoff);
+        }
+
+        size_t ready = 0;
+        if (tcp_poller_wait(&worker->poller, events, TCP_POLLER_MAX_EVENTS,
+                            runtime->config.poll_timeout_ms, &ready) != TCP_SUCCESS) {
+            continue;
+        }
+
+        for (size_t i = 0; i < ready; i++) {
+            tcp_poller_event_t* event = &events[i];
+
+            if (event->user_data == TCP_RUNTIME_WAKE_TOKEN) {
+                uint64_t value;
+                ssize_t drained = read(worker->wake_fd, &value, sizeof(value));
+                (void)drained;
+                continue;
+            }
+
+            uint32_t slot = (uint32_t)event->user_data;
+            tcp_client_t* client = &worker->clients[slot];
+            if (client->socket_fd != event->fd) {
+                // Closed by an earlier event in this batch
+                continue;
+            }
+
+            bool keep = true;
+            if (event->events & TCP_POLLER_READABLE) {
+                bump(&worker->stats.events);
+                keep = runtime->callback(worker->index, client, TCP_RUNTIME_EVENT_READABLE, runtime->context);
+            }
+
+            // The callback saw the last data before a hangup
+            if (!keep || (event->events & (TCP_POLLER_HANGUP | TCP_POLLER_ERROR))) {
+                close_connection(worker, slot);
+            }
+        }
+    }
+
+    free(events);
+    return NULL;
+}
+
+static void* acceptor_main(void* arg) {
+    tcp_server_runtime_t* runtime = (tcp_server_runtime_t*)arg;
+    tcp_client_t accepted[TCP_RUNTIME_ACCEPT_BATCH];
+
+    while (__atomic_load_n(&runtime->running, __ATOMIC_ACQUIRE)) {
+        size_t count = 0;
+        tcp_result_t result = tcp_socket_accept_batch(&runtime->listener, accepted, TCP_RUNTIME_ACCEPT_BATCH,
+                                                    runtime->config.poll_timeout_ms, &count);
+        if (result == TCP_ERROR_ACCEPT) {
+            // A failed accept (e.g. EMFILE/ENFILE) leaves the connection queued, so the next call
+            // fails at once; back off instead of spinning on the readable listener
+            __atomic_store_n(&runtime->accept_failures, runtime->accept_failures + 1, __ATOMIC_RELAXED);
+            usleep(TCP_RUNTIME_ACCEPT_BACKOFF_US);
+            continue;
+        }
+        if (result != TCP_SUCCESS) {
+            // Timeouts just re-check the stop flag
+            continue;
+        }
+
+        bool woken[TCP_RUNTIME_MAX_WORKERS] = { false };
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = pick_worker(runtime, &accepted[i]);
+            tcp_runtime_worker_t* worker = &runtime->workers[index];
+
+            if (!queue_push(&worker->queue, &accepted[i])) {
+                close(accepted[i].socket_fd);
+                __atomic_store_n(&runtime->handoff_failures, runtime->handoff_failures + 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            woken[index] = true;
+        }
+
+        // One wakeup per worker and batch
+        for (uint32_t i = 0; i < runtime->worker_count; i++) {
+            if (woken[i]) {
+                uint64_t one = 1;
+                ssize_t written = write(runtime->workers[i].wake_fd, &one, sizeof(one));
+                (void)written;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static tcp_result_t init_worker(tcp_server_runtime_t* runtime, tcp_runtime_worker_t* worker,
+                                const vma_options_t* options) {
+    uint32_t queue_size = runtime->config.queue_size;
+    uint32_t max_connections = runtime->config.max_connections;
+
+    worker->runtime = runtime;
+    worker->wake_fd = -1;
+    worker->poller.epoll_fd = -1;
+    worker->cpu = options->cpu_cores_count > 0 ?
+                options->cpu_cores[worker->index % (uint32_t)options->cpu_cores_count] : -1;
+
+    worker->clients = calloc(max_connections, sizeof(tcp_client_t));
+    if (!worker->clients) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+    for (uint32_t i = 0; i < max_connections; i++) {
+        worker->clients[i].socket_fd = -1;
+    }
+
+    worker->queue.slots = calloc(queue_size, sizeof(tcp_client_t));
+    worker->queue.mask = queue_size - 1;
+    worker->free_slots = calloc(max_connections, sizeof(uint32_t));
+    if (!worker->queue.slots || !worker->free_slots) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    // Hand out low slots first
+    for (uint32_t i = 0; i < max_connections; i++) {
+        worker->free_slots[i] = max_connections - 1 - i;
+    }
+    worker->free_count = max_connections;
+
+    tcp_result_t result = tcp_poller_init(&worker->poller, 0);
+    if (result != TCP_SUCCESS) {
+        return result;
+    }
+
+    worker->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker->wake_fd < 0) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    return tcp_poller_add_fd(&worker->poller, worker->wake_fd, TCP_RUNTIME_WAKE_TOKEN);
+}
+
+tcp_result_t tcp_runtime_init(tcp_server_runtime_t* runtime, const vma_options_t* options,
+                            const tcp_runtime_config_t* config, const char* ip, uint16_t port,
+                            tcp_runtime_callback_t callback, void* context) {
+    if (!runtime || !config || !callback) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    memset(runtime, 0, sizeof(tcp_server_runtime_t));
+    runtime->listener.socket_fd = -1;
+
+    vma_options_t listener_options;
+    if (options) {
+        listener_options = *options;
+    } else {
+        set_default_options(&listener_options);
+    }
+
+    runtime->config = *config;
+    if (runtime->config.worker_count == 0) {
+        runtime->config.worker_count = listener_options.cpu_cores_count > 0 ?
+                                    (uint32_t)listener_options.cpu_cores_count : 1;
+    }
+    if (runtime->config.worker_count > TCP_RUNTIME_MAX_WORKERS) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    if (runtime->config.queue_size == 0) {
+        runtime->config.queue_size = TCP_RUNTIME_DEFAULT_QUEUE;
+    }
+    uint32_t queue_size = 1;
+    while (queue_size < runtime->config.queue_size) {
+        queue_size <<= 1;
+    }
+    runtime->config.queue_size = queue_size;
+    if (runtime->config.max_connections == 0) {
+        runtime->config.max_connections = TCP_RUNTIME_DEFAULT_CONNECTIONS;
+    }
+    if (runtime->config.backlog <= 0) {
+        runtime->config.backlog = TCP_RUNTIME_DEFAULT_BACKLOG;
+    }
+    if (runtime->config.poll_timeout_ms <= 0) {
+        runtime->config.poll_timeout_ms = TCP_RUNTIME_DEFAULT_POLL_MS;
+    }
+
+    runtime->callback = callback;
+    runtime->context = context;
+
+    tcp_result_t result = tcp_socket_init(&runtime->listener, &listener_options);
+    if (result == TCP_SUCCESS) {
+        result = tcp_socket_bind(&runtime->listener, ip, port);
+    }
+    if (result == TCP_SUCCESS) {
+        result = tcp_socket_listen(&runtime->listener, runtime->config.backlog);
+    }
+    if (result != TCP_SUCCESS) {
+        tcp_runtime_close(runtime);
+        return result;
+    }
+
+    runtime->workers = calloc(runtime->config.worker_count, sizeof(tcp_runtime_worker_t));
+    if (!runtime->workers) {
+        tcp_runtime_close(runtime);
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+
+    for (uint32_t i = 0; i < runtime->config.worker_count; i++) {
+        tcp_runtime_worker_t* worker = &runtime->workers[i];
+        worker->index = i;
+        runtime->worker_count++;
+
+        result = init_worker(runtime, worker, &listener_options);
+        if (result != TCP_SUCCESS) {
+            tcp_runtime_close(runtime);
+            return result;
+        }
+    }
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_runtime_start(tcp_server_runtime_t* runtime) {
+    if (!runtime || !runtime->workers || runtime->worker_count == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (__atomic_load_n(&runtime->running, __ATOMIC_ACQUIRE)) {
+        return TCP_SUCCESS;
+    }
+
+    __atomic_store_n(&runtime->running, 1, __ATOMIC_RELEASE);
+
+    for (uint32_t i = 0; i < runtime->worker_count; i++) {
+        tcp_runtime_worker_t* worker = &runtime->workers[i];
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            tcp_runtime_stop(runtime);
+            return TCP_ERROR_SOCKET_CREATE;
+        }
+        worker->thread_started = true;
+    }
+
+    if (pthread_create(&runtime->acceptor, NULL, acceptor_main, runtime) != 0) {
+        tcp_runtime_stop(runtime);
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+    runtime->acceptor_started = true;
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_runtime_stop(tcp_server_runtime_t* runtime) {
+    if (!runtime) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    __atomic_store_n(&runtime->running, 0, __ATOMIC_RELEASE);
+
+    if (runtime->acceptor_started) {
+        pthread_join(runtime->acceptor, NULL);
+        runtime->acceptor_started = false;
+    }
+
+    for (uint32_t i = 0; i < runtime->worker_count; i++) {
+        tcp_runtime_worker_t* worker = &runtime->workers[i];
+        if (worker->thread_started) {
+            pthread_join(worker->thread, NULL);
+            worker->thread_started = false;
+        }
+    }
+
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_runtime_close(tcp_server_runtime_t* runtime) {
+    if (!runtime) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    tcp_runtime_stop(runtime);
+
+    for (uint32_t i = 0; i < runtime->worker_count; i++) {
+        tcp_runtime_worker_t* worker = &runtime->workers[i];
+
+        // Connections never adopted are still in the queue
+        tcp_client_t handoff;
+        while (worker->queue.slots && queue_pop(&worker->queue, &handoff)) {
+            close(handoff.socket_fd);
+        }
+
+        if (worker->clients) {
+            for (uint32_t slot = 0; slot < runtime->config.max_connections; slot++) {
+                if (worker->clients[slot].socket_fd >= 0) {
+                    close_connection(worker, slot);
+                }
+            }
+        }
+
+        tcp_poller_close(&worker->poller);
+        if (worker->wake_fd >= 0) {
+            close(worker->wake_fd);
+        }
+
+        free(worker->queue.slots);
+        free(worker->clients);
+        free(worker->free_slots);
+    }
+
+    free(runtime->workers);
+    runtime->workers = NULL;
+    runtime->worker_count = 0;
+
+    if (runtime->listener.socket_fd >= 0) {
+        tcp_socket_close(&runtime->listener);
+    }
+
+    return TCP_SUCCESS;
+}
+
+uint64_t tcp_runtime_get_handoff_failures(const tcp_server_runtime_t* runtime) {
+    return runtime ? __atomic_load_n(&runtime->handoff_failures, __ATOMIC_RELAXED) : 0;
+}
+
+uint64_t tcp_runtime_get_accept_failures(const tcp_server_runtime_t* runtime) {
+    return runtime ? __atomic_load_n(&runtime->accept_failures, __ATOMIC_RELAXED) : 0;
+}
+
+tcp_result_t tcp_runtime_get_worker_stats(const tcp_server_runtime_t* runtime, uint32_t worker,
+                                        tcp_runtime_worker_stats_t* stats) {
+    if (!runtime || !stats || worker >= runtime->worker_count) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    const tcp_runtime_worker_stats_t* source = &runtime->workers[worker].stats;
+    stats->accepted = __atomic_load_n(&source->accepted, __ATOMIC_RELAXED);
+    stats->closed = __atomic_load_n(&source->closed, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&source->rejected, __ATOMIC_RELAXED);
+    stats->events = __atomic_load_n(&source->events, __ATOMIC_RELAXED);
+    stats->connections = __atomic_load_n(&source->connections, __ATOMIC_RELAXED);
+
+    return TCP_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/**
+ * tcp_server_runtime.h - Multi-threaded TCP server with per-core connection ownership
+ */
+
+#ifndef TCP_SERVER_RUNTIME_H
+#define TCP_SERVER_RUNTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "vma_common.h"
+#include "tcp_socket.h"
+#include "tcp_server_poller.h"
+
+// Maximum number of worker threads
+#define TCP_RUNTIME_MAX_WORKERS MAX_CPU_CORES
+
+// Cache line size used to keep queue indices apart
+#define TCP_RUNTIME_CACHE_LINE 64
+
+// How the acceptor picks a worker for a new connection
+typedef enum {
+    TCP_RUNTIME_ASSIGN_LEAST_LOADED = 0,   // Worker with the fewest open connections
+    TCP_RUNTIME_ASSIGN_HASH = 1            // Hash of the peer address and port
+} tcp_runtime_assign_t;
+
+// Connection events reported to the callback
+typedef enum {
+    TCP_RUNTIME_EVENT_OPEN = 1,            // Connection adopted by the worker
+    TCP_RUNTIME_EVENT_READABLE = 2,        // Data is available (read with a 0 timeout)
+    TCP_RUNTIME_EVENT_CLOSED = 3           // Connection is about to be closed
+} tcp_runtime_event_t;
+
+// Runtime configuration (zero fields select the defaults)
+typedef struct {
+    uint32_t worker_count;         // Number of workers (0 for one per cpu_cores entry, at least 1)
+    tcp_runtime_assign_t assign;   // Worker selection policy
+    uint32_t queue_size;           // Handoff queue entries per worker (rounded to a power of two, 0 for 256)
+    uint32_t max_connections;      // Open connections per worker (0 for 1024)
+    int backlog;                   // Listen backlog (0 for 1024)
+    int poll_timeout_ms;           // Wait timeout between stop checks (0 for 100)
+} tcp_runtime_config_t;
+
+// Event callback, invoked on the owning worker's thread; return false to close the connection
+typedef bool (*tcp_runtime_callback_t)(uint32_t worker, tcp_client_t* client, tcp_runtime_event_t event,
+                                        void* context);
+
+// Per-worker counters
+typedef struct {
+    uint64_t accepted;             // Connections handed to this worker
+    uint64_t closed;               // Connections closed by this worker
+    uint64_t rejected;             // Connections closed because the worker was full
+    uint64_t events;               // Readable events delivered
+    uint32_t connections;          // Connections currently open
+} tcp_runtime_worker_stats_t;
+
+// Single-producer single-consumer handoff queue (acceptor -> worker)
+typedef struct {
+    tcp_client_t* slots;           // queue_size entries
+    uint32_t mask;                 // queue_size - 1
+    uint32_t head __attribute__((aligned(TCP_RUNTIME_CACHE_LINE)));  // Next entry to consume (worker)
+    uint32_t tail __attribute__((aligned(TCP_RUNTIME_CACHE_LINE)));  // Next entry to produce (acceptor)
+} tcp_runtime_queue_t;
+
+struct tcp_server_runtime;
+
+// Worker: owns its connections, poller and queue
+typedef struct {
+    tcp_runtime_queue_t queue;     // New connections from the acceptor
+    struct tcp_server_runtime* runtime; // Owning runtime
+    uint32_t index;                // Worker index
+    int cpu;                       // CPU the worker is pinned to (-1 for unpinned)
+    int wake_fd;                   // eventfd signalled after a handoff
+    tcp_server_poller_t poller;    // Readiness for the worker's connections
+    tcp_client_t* clients;         // max_connections slots (stable addresses)
+    uint32_t* free_slots;          // Stack of free slot indices
+    uint32_t free_count;           // Number of free slots
+    tcp_runtime_worker_stats_t stats; // Counters (connections is read atomically by the acceptor)
+    pthread_t thread;              // Worker thread
+    bool thread_started;           // Whether thread is joinable
+} tcp_runtime_worker_t;
+
+// Runtime structure
+typedef struct tcp_server_runtime {
+    tcp_socket_t listener;         // Listening socket (owned by the acceptor thread while running)
+    tcp_runtime_worker_t* workers; // worker_count workers
+    uint32_t worker_count;         // Number of workers
+    tcp_runtime_config_t config;   // Effective configuration
+    tcp_runtime_callback_t callback; // Event callback
+    void* context;                 // Callback context
+    pthread_t acceptor;            // Acceptor thread
+    bool acceptor_started;         // Whether acceptor is joinable
+    uint64_t handoff_failures;     // Connections closed because the chosen queue was full (acceptor)
+    uint64_t accept_failures;      // Accept calls that failed, e.g. on EMFILE/ENFILE (acceptor)
+    int running;                   // Threads keep running while set (atomic)
+} tcp_server_runtime_t;
+
+/**
+ * Bind and listen, and prepare the workers without starting any thread
+ *
+ * Worker i is pinned to options->cpu_cores[i % cpu_cores_count] when cores
+ * are given; the acceptor runs unpinned.
+ *
+ * @param runtime Pointer to the runtime structure to initialize
+ * @param options VMA options for the listener (use default if NULL)
+ * @param config Runtime configuration
+ * @param ip IP address to bind to (use INADDR_ANY if NULL)
+ * @param port Port to bind to
+ * @param callback Event callback
+ * @param context Value passed to the callback
+ * @return Result code
+ */
+tcp_result_t tcp_runtime_init(tcp_server_runtime_t* runtime, const vma_options_t* options,
+                            const tcp_runtime_config_t* config, const char* ip, uint16_t port,
+                            tcp_runtime_callback_t callback, void* context);
+
+/**
+ * Start the worker threads and the acceptor
+ *
+ * @param runtime Pointer to the runtime structure
+ * @return Result code
+ */
+tcp_result_t tcp_runtime_start(tcp_server_runtime_t* runtime);
+
+/**
+ * Stop and join all threads (returns within about poll_timeout_ms)
+ *
+ * Open connections stay with their workers and are closed by tcp_runtime_close.
+ *
+ * @param runtime Pointer to the runtime structure
+ * @return Result code
+ */
+tcp_result_t tcp_runtime_stop(tcp_server_runtime_t* runtime);
+
+/**
+ * Stop the threads, close every connection and the listener, and release the runtime
+ *
+ * @param runtime Pointer to the runtime structure
+ * @return Result code
+ */
+tcp_result_t tcp_runtime_close(tcp_server_runtime_t* runtime);
+
+/**
+ * Number of connections the acceptor had to close because a handoff queue was full
+ *
+ * @param runtime Pointer to the runtime structure
+ * @return Connections dropped at handoff
+ */
+uint64_t tcp_runtime_get_handoff_failures(const tcp_server_runtime_t* runtime);
+
+/**
+ * Number of accept calls that failed (descriptor limits and the like); each one backs the acceptor off briefly
+ *
+ * @param runtime Pointer to the runtime structure
+ * @return Failed accept calls
+ */
+uint64_t tcp_runtime_get_accept_failures(const tcp_server_runtime_t* runtime);
+
+/**
+ * Read one worker's counters (approximate while running)
+ *
+ * @param runtime Pointer to the runtime structure
+ * @param worker Worker index
+ * @param stats Destination for the counters
+ * @return Result code
+ */
+tcp_result_t tcp_runtime_get_worker_stats(const tcp_server_runtime_t* runtime, uint32_t worker,
+                                        tcp_runtime_worker_stats_t* stats);
+
+#endif /* TCP_SERVER_RUNTIME_H */
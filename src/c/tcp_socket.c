@@ -19,14 +19,33 @@
 #include <stdbool.h>
 #include <signal.h>
 #include <errno.h>
+#include <poll.h>
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
 #include "tcp_socket.h"
 #include "vma_common.h"
+#include "vma_trace.h"
 #include <mellanox/vma_extra.h>
 
+// Fallbacks for headers that predate zero-copy sends
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 // Forward declarations of static functions
 static bool would_block(void);
 static int wait_for_socket(int fd, bool for_read, int timeout_ms);
+static tcp_result_t wait_for_data(int fd, vma_deadline_t* deadline, const vma_wait_mode_t* mode,
+                                const vma_wait_stats_t* stats, vma_stats_t* counters);
 static int set_nonblocking(int fd);
 static int set_blocking(int fd);
 
@@ -51,121 +70,145 @@ static int set_blocking(int fd) {
 
 // Wait for socket readiness with timeout
 static int wait_for_socket(int fd, bool for_read, int timeout_ms) {
-    fd_set fds;
-    struct timeval tv;
-    
-    FD_ZERO(&fds);
-    FD_SET(fd, &fds);
-    
-    if (timeout_ms >= 0) {
-        tv.tv_sec = timeout_ms / 1000;
-        tv.tv_usec = (timeout_ms % 1000) * 1000;
-    }
-    
-    if (for_read) {
-        return select(fd + 1, &fds, NULL, NULL, timeout_ms >= 0 ? &tv : NULL);
-    } else {
-        return select(fd + 1, NULL, &fds, NULL, timeout_ms >= 0 ? &tv : NULL);
-    }
+    return vma_wait_fd(fd, for_read, timeout_ms);
 }
 
-tcp_result_t tcp_socket_init(tcp_socket_t* sock, const vma_options_t* options) {
-    if (!sock) {
-        return TCP_ERROR_INVALID_PARAM;
+// Wait after a receive found nothing queued: spins until the deadline in polling
+// mode, otherwise blocks in poll() for the time left
+static tcp_result_t wait_for_data(int fd, vma_deadline_t* deadline, const vma_wait_mode_t* mode,
+                                const vma_wait_stats_t* stats, vma_stats_t* counters) {
+    int wait_result = vma_deadline_wait(deadline, fd, mode, stats);
+    
+    if (wait_result == 0) {
+        vma_stats_rx_miss(counters, true, deadline->empty_polls);
+        return TCP_ERROR_TIMEOUT;
+    } else if (wait_result < 0) {
+        vma_stats_rx_miss(counters, false, deadline->empty_polls);
+        return TCP_ERROR_RECV;
     }
     
-    // Initialize socket structure
-    memset(sock, 0, sizeof(tcp_socket_t));
-    sock->socket_fd = -1;
-    sock->state = TCP_STATE_DISCONNECTED;
-    
-    // Set options
-    if (options) {
-        sock->vma_options = *options;
-    } else {
-        set_default_options(&sock->vma_options);
-    }
+    return TCP_SUCCESS;
+}
 
-    // Create socket
-    sock->socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock->socket_fd < 0) {
-        return TCP_ERROR_SOCKET_CREATE;
-    }
+// Latency options shared by connecting and accepted sockets; not fatal
+static void apply_latency_options(int fd) {
+    // Set TCP nodelay (disable Nagle's algorithm)
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
     
+    // Enable TCP quickack for lower latency
+    int quickack = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &quickack, sizeof(quickack));
+}
+
+// Apply every option a connecting socket gets. Fresh, reconnected and pooled
+// sockets all go through here so they behave identically.
+static tcp_result_t apply_socket_options(int fd, const vma_options_t* options) {
     // Set buffer size
-    if (sock->vma_options.buffer_size > 0) {
-        int buffer_size = sock->vma_options.buffer_size;
-        
-        // Set send buffer size
-        if (setsockopt(sock->socket_fd, SOL_SOCKET, SO_SNDBUF, 
-                    &buffer_size, sizeof(buffer_size)) < 0) {
-            close(sock->socket_fd);
-            sock->socket_fd = -1;
-            return TCP_ERROR_SOCKET_OPTION;
-        }
+    if (options->buffer_size > 0) {
+        int buffer_size = options->buffer_size;
         
-        // Set receive buffer size
-        if (setsockopt(sock->socket_fd, SOL_SOCKET, SO_RCVBUF, 
-                    &buffer_size, sizeof(buffer_size)) < 0) {
-            close(sock->socket_fd);
-            sock->socket_fd = -1;
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size)) < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size)) < 0) {
             return TCP_ERROR_SOCKET_OPTION;
         }
     }
     
     // Enable TCP keepalive
     int keepalive = 1;
-    if (setsockopt(sock->socket_fd, SOL_SOCKET, SO_KEEPALIVE, 
-                &keepalive, sizeof(keepalive)) < 0) {
-        close(sock->socket_fd);
-        sock->socket_fd = -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) < 0) {
         return TCP_ERROR_SOCKET_OPTION;
     }
     
-    // Optimize VMA ring allocation when using SocketXtreme
-    if (sock->vma_options.use_socketxtreme) {
-        int optval = 1;
-        setsockopt(sock->socket_fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC, &optval, sizeof(optval));
+    // Place the socket on its VMA ring (before bind or connect attaches one)
+    if (vma_ring_placement_apply(fd, options) < 0) {
+        return TCP_ERROR_SOCKET_OPTION;
     }
     
-    // Configure keepalive parameters
+    // Configure keepalive parameters (not fatal)
     int keepidle = 60;  // Start sending keepalive probes after this many seconds of idle time
     int keepintvl = 10; // Send a keepalive probe every this many seconds
     int keepcnt = 5;    // Number of keepalive probes to send before considering the connection dead
-    
-    // Set TCP keepalive parameters
-    if (setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_KEEPIDLE, 
-                &keepidle, sizeof(keepidle)) < 0 ||
-        setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_KEEPINTVL, 
-                &keepintvl, sizeof(keepintvl)) < 0 ||
-        setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_KEEPCNT, 
-                &keepcnt, sizeof(keepcnt)) < 0) {
-        // Not fatal, just continue
-    }
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(keepidle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(keepintvl));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt));
     
     // Set non-blocking if polling is enabled
-    if (sock->vma_options.use_polling) {
-        if (set_nonblocking(sock->socket_fd) < 0) {
-            close(sock->socket_fd);
-            sock->socket_fd = -1;
+    if (options->use_polling) {
+        if (set_nonblocking(fd) < 0) {
             return TCP_ERROR_SOCKET_OPTION;
         }
     }
     
-    // Set TCP nodelay (disable Nagle's algorithm)
-    int nodelay = 1;
-    if (setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_NODELAY, 
-                &nodelay, sizeof(nodelay)) < 0) {
-        // Not fatal, just continue
+    apply_latency_options(fd);
+    
+    return TCP_SUCCESS;
+}
+
+// Create a socket with every option applied
+static tcp_result_t open_socket(const vma_options_t* options, int* fd_out) {
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return TCP_ERROR_SOCKET_CREATE;
     }
     
-    // Enable TCP quickack for lower latency
-    int quickack = 1;
-    if (setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_QUICKACK,
-                &quickack, sizeof(quickack)) < 0) {
-        // Not fatal, just continue
+    tcp_result_t result = apply_socket_options(fd, options);
+    if (result != TCP_SUCCESS) {
+        close(fd);
+        return result;
     }
     
+    *fd_out = fd;
+    return TCP_SUCCESS;
+}
+
+// Forget the zero-copy state of a descriptor that is closed or replaced
+static void reset_zerocopy(tcp_zerocopy_t* zc) {
+    memset(zc, 0, sizeof(tcp_zerocopy_t));
+    zc->socket_fd = -1;
+}
+
+tcp_result_t tcp_socket_init(tcp_socket_t* sock, const vma_options_t* options) {
+    if (!sock) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    // Initialize socket structure
+    memset(sock, 0, sizeof(tcp_socket_t));
+    sock->socket_fd = -1;
+    sock->state = TCP_STATE_DISCONNECTED;
+    reset_zerocopy(&sock->zerocopy);
+    
+    // Set options
+    if (options) {
+        sock->vma_options = *options;
+    } else {
+        set_default_options(&sock->vma_options);
+    }
+    
+    // Configure the VMA environment once per process (no-op after the first socket)
+    vma_runtime_init(&sock->vma_options, NULL);
+    
+    // Calibrate the receive deadline clock up front
+    vma_clock_init();
+    vma_trace_init();
+    vma_wait_mode_init(&sock->wait_mode, &sock->vma_options);
+
+    // Create a fully configured socket
+    tcp_result_t result = open_socket(&sock->vma_options, &sock->socket_fd);
+    if (result != TCP_SUCCESS) {
+        return result;
+    }
+    
+    // Statistics live in their own cache-line-aligned block
+    sock->stats = vma_stats_create();
+    if (!sock->stats) {
+        close(sock->socket_fd);
+        sock->socket_fd = -1;
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+    sock->owns_stats = true;
+    
     return TCP_SUCCESS;
 }
 
@@ -178,6 +221,13 @@ tcp_result_t tcp_socket_close(tcp_socket_t* sock) {
     sock->socket_fd = -1;
     sock->is_bound = false;
     sock->state = TCP_STATE_DISCONNECTED;
+    reset_zerocopy(&sock->zerocopy);
+    
+    if (sock->owns_stats) {
+        vma_stats_destroy(sock->stats);
+    }
+    sock->stats = NULL;
+    sock->owns_stats = false;
     
     return TCP_SUCCESS;
 }
@@ -226,53 +276,130 @@ tcp_result_t tcp_socket_listen(tcp_socket_t* sock, int backlog) {
         return TCP_ERROR_LISTEN;
     }
     
+    // Accepts never block; waiting is done with the caller's timeout
+    if (set_nonblocking(sock->socket_fd) < 0) {
+        return TCP_ERROR_SOCKET_OPTION;
+    }
+    
     sock->state = TCP_STATE_LISTENING;
     sock->backlog = backlog;
     
     return TCP_SUCCESS;
 }
 
+// Set up an accepted client with the listener's wait policy and latency options.
+// Every accept path goes through here so clients never miss an option.
+static void apply_client_options(const tcp_socket_t* sock, tcp_client_t* client) {
+    client->rx_bytes = 0;
+    client->tx_bytes = 0;
+    client->wait_mode = sock->wait_mode;
+    memset(&client->wait_stats, 0, sizeof(client->wait_stats));
+    reset_zerocopy(&client->zerocopy);
+    
+    // Not inherited from the listener on every stack, so set them explicitly
+    apply_latency_options(client->socket_fd);
+}
+
+// Accept one pending connection without blocking; returns the accept4 result
+static int accept_client(tcp_socket_t* sock, tcp_client_t* client) {
+    // Non-blocking clients in polling mode without the extra fcntl calls
+    int flags = SOCK_CLOEXEC | (sock->vma_options.use_polling ? SOCK_NONBLOCK : 0);
+    socklen_t addr_len = sizeof(client->addr);
+    
+    client->socket_fd = accept4(sock->socket_fd, (struct sockaddr*)&client->addr, &addr_len, flags);
+    if (client->socket_fd < 0) {
+        return -1;
+    }
+    
+    apply_client_options(sock, client);
+    return 0;
+}
+
 tcp_result_t tcp_socket_accept(tcp_socket_t* sock, tcp_client_t* client, int timeout_ms) {
     if (!sock || sock->socket_fd < 0 || !client || sock->state != TCP_STATE_LISTENING) {
         return TCP_ERROR_INVALID_PARAM;
     }
     
-    // Wait for a connection with timeout
-    if (timeout_ms != 0) {
-        int select_result = wait_for_socket(sock->socket_fd, true, timeout_ms);
-        
-        if (select_result == 0) {
-            return TCP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
-            return TCP_ERROR_ACCEPT;
-        }
+    // The listener is non-blocking: try first, wait only when nothing is pending
+    if (accept_client(sock, client) == 0) {
+        return TCP_SUCCESS;
     }
     
-    // Accept connection
-    socklen_t addr_len = sizeof(client->addr);
-    client->socket_fd = accept(sock->socket_fd, (struct sockaddr*)&client->addr, &addr_len);
+    if (!would_block()) {
+        return TCP_ERROR_ACCEPT;
+    }
     
-    if (client->socket_fd < 0) {
-        if (would_block()) {
-            return TCP_ERROR_TIMEOUT;
-        }
+    if (timeout_ms == 0) {
+        return TCP_ERROR_TIMEOUT;
+    }
+    
+    int wait_result = wait_for_socket(sock->socket_fd, true, timeout_ms);
+    
+    if (wait_result == 0) {
+        return TCP_ERROR_TIMEOUT;
+    } else if (wait_result < 0) {
         return TCP_ERROR_ACCEPT;
     }
     
-    // Initialize client structure
-    client->rx_bytes = 0;
-    client->tx_bytes = 0;
+    if (accept_client(sock, client) < 0) {
+        // Another thread may have taken the connection
+        return would_block() ? TCP_ERROR_TIMEOUT : TCP_ERROR_ACCEPT;
+    }
     
-    // Set non-blocking if polling is enabled
-    if (sock->vma_options.use_polling) {
-        if (set_nonblocking(client->socket_fd) < 0) {
-            close(client->socket_fd);
-            client->socket_fd = -1;
-            return TCP_ERROR_SOCKET_OPTION;
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_accept_batch(tcp_socket_t* sock, tcp_client_t* clients, size_t max_clients,
+                                    int timeout_ms, size_t* accepted) {
+    if (!sock || sock->socket_fd < 0 || !clients || max_clients == 0 || sock->state != TCP_STATE_LISTENING) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (accepted) {
+        *accepted = 0;
+    }
+    
+    bool waited = false;
+    size_t count = 0;
+    
+    while (count < max_clients) {
+        if (accept_client(sock, &clients[count]) == 0) {
+            count++;
+            continue;
+        }
+        
+        if (errno == ECONNABORTED || errno == EINTR) {
+            // Peer gave up while queued; the rest of the queue is still good
+            continue;
+        }
+        
+        if (!would_block()) {
+            // Keep what was accepted (e.g. EMFILE); the error shows on the next call
+            if (count > 0) {
+                break;
+            }
+            return TCP_ERROR_ACCEPT;
+        }
+        
+        // Queue drained: done, or wait once for the first connection
+        if (count > 0 || waited || timeout_ms == 0) {
+            break;
         }
+        
+        int wait_result = wait_for_socket(sock->socket_fd, true, timeout_ms);
+        if (wait_result == 0) {
+            return TCP_ERROR_TIMEOUT;
+        } else if (wait_result < 0) {
+            return TCP_ERROR_ACCEPT;
+        }
+        waited = true;
     }
     
-    return TCP_SUCCESS;
+    if (accepted) {
+        *accepted = count;
+    }
+    
+    return count > 0 ? TCP_SUCCESS : TCP_ERROR_TIMEOUT;
 }
 
 tcp_result_t tcp_socket_connect(tcp_socket_t* sock, const char* ip, uint16_t port, int timeout_ms) {
@@ -317,15 +444,15 @@ tcp_result_t tcp_socket_connect(tcp_socket_t* sock, const char* ip, uint16_t por
         }
         
         // Wait for connection to complete
-        int select_result = wait_for_socket(sock->socket_fd, false, timeout_ms);
+        int wait_result = wait_for_socket(sock->socket_fd, false, timeout_ms);
         
-        if (select_result == 0) {
+        if (wait_result == 0) {
             sock->state = TCP_STATE_DISCONNECTED;
             if (!was_nonblocking) {
                 set_blocking(sock->socket_fd);
             }
             return TCP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
+        } else if (wait_result < 0) {
             sock->state = TCP_STATE_DISCONNECTED;
             if (!was_nonblocking) {
                 set_blocking(sock->socket_fd);
@@ -372,35 +499,16 @@ tcp_result_t tcp_socket_reconnect(tcp_socket_t* sock, int timeout_ms) {
         return TCP_ERROR_NOT_INITIALIZED;
     }
     
-    // Close existing socket
-    close(sock->socket_fd);
-    
-    // Create a new socket - use the socket() function directly, not via parameter name
-    sock->socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock->socket_fd < 0) {
+    // Replace the socket with one configured exactly like the original
+    int fd;
+    tcp_result_t open_result = open_socket(&sock->vma_options, &fd);
+    if (open_result != TCP_SUCCESS) {
         sock->state = TCP_STATE_DISCONNECTED;
-        return TCP_ERROR_SOCKET_CREATE;
-    }
-    
-    // Set buffer size
-    if (sock->vma_options.buffer_size > 0) {
-        int buffer_size = sock->vma_options.buffer_size;
-        setsockopt(sock->socket_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
-        setsockopt(sock->socket_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
-    }
-    
-    // Set TCP keepalive
-    int keepalive = 1;
-    setsockopt(sock->socket_fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive));
-    
-    // Set TCP nodelay
-    int nodelay = 1;
-    setsockopt(sock->socket_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
-    
-    // Set non-blocking if polling is enabled
-    if (sock->vma_options.use_polling) {
-        set_nonblocking(sock->socket_fd);
+        return open_result;
     }
+    close(sock->socket_fd);
+    sock->socket_fd = fd;
+    reset_zerocopy(&sock->zerocopy);
     
     // Try to reconnect
     char ip[INET_ADDRSTRLEN];
@@ -416,18 +524,27 @@ tcp_result_t tcp_socket_reconnect(tcp_socket_t* sock, int timeout_ms) {
     return TCP_SUCCESS;
 }
 
-bool tcp_socket_is_connected(tcp_socket_t* sock) {
-    if (!sock || sock->socket_fd < 0) {
+bool tcp_socket_is_connected(const tcp_socket_t* sock) {
+    return sock && sock->socket_fd >= 0 && sock->state == TCP_STATE_CONNECTED;
+}
+
+bool tcp_socket_probe(tcp_socket_t* sock) {
+    if (!tcp_socket_is_connected(sock)) {
         return false;
     }
     
-    // Quick check based on state
-    if (sock->state != TCP_STATE_CONNECTED) {
+    // A pending error (reset, unreachable) means the connection is gone
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(sock->socket_fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        sock->state = TCP_STATE_DISCONNECTED;
         return false;
     }
     
-    // More thorough check: try to send 0 bytes
-    if (send(sock->socket_fd, NULL, 0, MSG_NOSIGNAL) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    // End of stream shows up as a zero-length peek; queued data stays queued
+    char byte;
+    ssize_t res = recv(sock->socket_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (res == 0 || (res < 0 && !would_block())) {
         sock->state = TCP_STATE_DISCONNECTED;
         return false;
     }
@@ -435,6 +552,12 @@ bool tcp_socket_is_connected(tcp_socket_t* sock) {
     return true;
 }
 
+void tcp_socket_mark_disconnected(tcp_socket_t* sock) {
+    if (sock && sock->state == TCP_STATE_CONNECTED) {
+        sock->state = TCP_STATE_DISCONNECTED;
+    }
+}
+
 tcp_result_t tcp_socket_send(tcp_socket_t* sock, const void* data, size_t length, size_t* bytes_sent) {
     if (!sock || sock->socket_fd < 0 || !data || length == 0) {
         return TCP_ERROR_INVALID_PARAM;
@@ -444,24 +567,28 @@ tcp_result_t tcp_socket_send(tcp_socket_t* sock, const void* data, size_t length
         return TCP_ERROR_NOT_INITIALIZED;
     }
     
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
     ssize_t res = send(sock->socket_fd, data, length, MSG_NOSIGNAL);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
     
     if (res < 0) {
         if (would_block()) {
-            return TCP_ERROR_WOULD_BLOCK;
+            vma_stats_tx_miss(sock->stats, true);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, sock->socket_fd, TCP_ERROR_WOULD_BLOCK, 0);
         }
+        vma_stats_tx_miss(sock->stats, false);
         sock->state = TCP_STATE_DISCONNECTED;
-        return TCP_ERROR_SEND;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, sock->socket_fd, TCP_ERROR_SEND, 0);
     }
     
     if (bytes_sent) {
         *bytes_sent = (size_t)res;
     }
     
-    sock->tx_packets++;
-    sock->tx_bytes += res;
+    vma_stats_tx(sock->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
     
-    return TCP_SUCCESS;
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, sock->socket_fd, TCP_SUCCESS, res);
 }
 
 tcp_result_t tcp_socket_send_to_client(tcp_client_t* client, const void* data, size_t length, size_t* bytes_sent) {
@@ -469,13 +596,15 @@ tcp_result_t tcp_socket_send_to_client(tcp_client_t* client, const void* data, s
         return TCP_ERROR_INVALID_PARAM;
     }
     
+    VMA_TRACE_BEGIN(trace);
     ssize_t res = send(client->socket_fd, data, length, MSG_NOSIGNAL);
+    VMA_TRACE_SYSCALL(trace, trace.entry);
     
     if (res < 0) {
         if (would_block()) {
-            return TCP_ERROR_WOULD_BLOCK;
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_CLIENT, client->socket_fd, TCP_ERROR_WOULD_BLOCK, 0);
         }
-        return TCP_ERROR_SEND;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_CLIENT, client->socket_fd, TCP_ERROR_SEND, 0);
     }
     
     if (bytes_sent) {
@@ -484,9 +613,521 @@ tcp_result_t tcp_socket_send_to_client(tcp_client_t* client, const void* data, s
     
     client->tx_bytes += res;
     
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_CLIENT, client->socket_fd, TCP_SUCCESS, res);
+}
+
+// Wait for room in the send buffer once part of a message is written: spins in
+// polling mode, otherwise blocks in poll() for the time left until the deadline
+static tcp_result_t wait_for_room(int fd, vma_deadline_t* deadline, const vma_wait_mode_t* mode) {
+    uint64_t now = vma_clock_ns();
+    if (deadline->deadline_ns == 0) {
+        deadline->deadline_ns = now + (uint64_t)deadline->timeout_ms * 1000000ULL;
+    }
+    
+    if (now >= deadline->deadline_ns) {
+        return TCP_ERROR_TIMEOUT;
+    }
+    
+    if (mode->use_polling) {
+        deadline->spins++;
+        return TCP_SUCCESS;
+    }
+    
+    deadline->blocked = true;
+    int left_ms = (int)((deadline->deadline_ns - now + 999999ULL) / 1000000ULL);
+    if (wait_for_socket(fd, false, left_ms) < 0 && errno != EINTR) {
+        return TCP_ERROR_SEND;
+    }
+    
+    return TCP_SUCCESS;
+}
+
+// Write all buffers, resuming after partial writes; waits for room only once
+// part of the data is on the wire, for at most TCP_SEND_STALL_TIMEOUT_MS, so a
+// message is not left torn by a brief stall. bytes_sent is set on every return.
+static tcp_result_t send_all(int fd, const vma_wait_mode_t* mode, const struct iovec* iov, size_t iovcnt,
+                            size_t* bytes_sent) {
+    struct iovec pending[TCP_MAX_IOV];
+    size_t remaining = 0;
+    size_t count = 0;
+    
+    // Work on a copy so the caller's array can stay const
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > 0) {
+            pending[count++] = iov[i];
+            remaining += iov[i].iov_len;
+        }
+    }
+    
+    size_t sent = 0;
+    struct iovec* current = pending;
+    tcp_result_t result = TCP_SUCCESS;
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, TCP_SEND_STALL_TIMEOUT_MS);
+    
+    while (remaining > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = current;
+        msg.msg_iovlen = count;
+        
+        ssize_t res = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!would_block()) {
+                result = TCP_ERROR_SEND;
+                break;
+            }
+            if (sent == 0) {
+                result = TCP_ERROR_WOULD_BLOCK;
+                break;
+            }
+            result = wait_for_room(fd, &deadline, mode);
+            if (result != TCP_SUCCESS) {
+                break;
+            }
+            continue;
+        }
+        
+        sent += (size_t)res;
+        remaining -= (size_t)res;
+        
+        // Skip the buffers written completely, trim the one written partly
+        size_t advance = (size_t)res;
+        while (count > 0 && advance >= current->iov_len) {
+            advance -= current->iov_len;
+            current++;
+            count--;
+        }
+        if (count > 0) {
+            current->iov_base = (uint8_t*)current->iov_base + advance;
+            current->iov_len -= advance;
+        }
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    return result;
+}
+
+tcp_result_t tcp_socket_sendv(tcp_socket_t* sock, const struct iovec* iov, size_t iovcnt, size_t* bytes_sent) {
+    if (!sock || sock->socket_fd < 0 || !iov || iovcnt == 0 || iovcnt > TCP_MAX_IOV) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (sock->state != TCP_STATE_CONNECTED) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+    
+    size_t sent = 0;
+    uint64_t start_ticks = vma_clock_ticks();
+    tcp_result_t result = send_all(sock->socket_fd, &sock->wait_mode, iov, iovcnt, &sent);
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    // Bytes on the wire count even when the call stalled or failed partway
+    if (sent > 0) {
+        vma_stats_tx(sock->stats, 1, (uint64_t)sent, vma_clock_ticks() - start_ticks);
+    }
+    
+    if (result != TCP_SUCCESS) {
+        vma_stats_tx_miss(sock->stats, result != TCP_ERROR_SEND);
+        if (result == TCP_ERROR_SEND) {
+            sock->state = TCP_STATE_DISCONNECTED;
+        }
+        return result;
+    }
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_sendv_to_client(tcp_client_t* client, const struct iovec* iov, size_t iovcnt,
+                                    size_t* bytes_sent) {
+    if (!client || client->socket_fd < 0 || !iov || iovcnt == 0 || iovcnt > TCP_MAX_IOV) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    size_t sent = 0;
+    tcp_result_t result = send_all(client->socket_fd, &client->wait_mode, iov, iovcnt, &sent);
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    client->tx_bytes += sent;
+    
+    return result;
+}
+
+static tcp_result_t enable_zerocopy(int fd, tcp_zerocopy_t* zc) {
+    // Already enabled: keep next_seq in step with the kernel's counter
+    if (zc->socket_fd == fd) {
+        return TCP_SUCCESS;
+    }
+    
+    memset(zc, 0, sizeof(tcp_zerocopy_t));
+    zc->socket_fd = fd;
+    
+    // VMA implements the same option and error-queue completions when it offloads the socket
+    int enable = 1;
+    zc->enabled = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_enable_zerocopy(tcp_socket_t* sock) {
+    if (!sock || sock->socket_fd < 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    return enable_zerocopy(sock->socket_fd, &sock->zerocopy);
+}
+
+tcp_result_t tcp_socket_enable_client_zerocopy(tcp_client_t* client) {
+    if (!client || client->socket_fd < 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    return enable_zerocopy(client->socket_fd, &client->zerocopy);
+}
+
+// One send, with MSG_ZEROCOPY when enabled and worth it; copies when the
+// kernel runs out of notification memory (ENOBUFS) instead of failing
+static tcp_result_t send_zerocopy(int fd, tcp_zerocopy_t* zc, const void* data, size_t length,
+                                size_t* sent, tcp_zc_ticket_t* ticket) {
+    bool zerocopy = zc->enabled && length >= TCP_ZEROCOPY_MIN_BYTES;
+    ssize_t res;
+    
+    while ((res = send(fd, data, length, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0))) < 0) {
+        if (zerocopy && errno == ENOBUFS) {
+            zerocopy = false;
+        } else if (errno != EINTR) {
+            return would_block() ? TCP_ERROR_WOULD_BLOCK : TCP_ERROR_SEND;
+        }
+    }
+    
+    // Every successful MSG_ZEROCOPY send takes the next number of the socket's counter
+    ticket->seq = zc->next_seq;
+    ticket->pinned = zerocopy;
+    if (zerocopy) {
+        zc->next_seq++;
+        zc->zerocopy_sends++;
+    } else {
+        zc->copied_sends++;
+    }
+    *sent = (size_t)res;
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_send_zerocopy(tcp_socket_t* sock, const void* data, size_t length,
+                                  size_t* bytes_sent, tcp_zc_ticket_t* ticket) {
+    if (!sock || sock->socket_fd < 0 || !data || length == 0 || !ticket) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (sock->state != TCP_STATE_CONNECTED || sock->zerocopy.socket_fd != sock->socket_fd) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+    
+    size_t sent = 0;
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    tcp_result_t result = send_zerocopy(sock->socket_fd, &sock->zerocopy, data, length, &sent, ticket);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+    
+    if (result != TCP_SUCCESS) {
+        vma_stats_tx_miss(sock->stats, result == TCP_ERROR_WOULD_BLOCK);
+        if (result == TCP_ERROR_SEND) {
+            sock->state = TCP_STATE_DISCONNECTED;
+        }
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_ZEROCOPY, sock->socket_fd, result, 0);
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    vma_stats_tx(sock->stats, 1, (uint64_t)sent, vma_clock_ticks() - start_ticks);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_ZEROCOPY, sock->socket_fd, TCP_SUCCESS, sent);
+}
+
+tcp_result_t tcp_socket_send_zerocopy_to_client(tcp_client_t* client, const void* data, size_t length,
+                                            size_t* bytes_sent, tcp_zc_ticket_t* ticket) {
+    if (!client || client->socket_fd < 0 || !data || length == 0 || !ticket) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (client->zerocopy.socket_fd != client->socket_fd) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+    
+    size_t sent = 0;
+    VMA_TRACE_BEGIN(trace);
+    tcp_result_t result = send_zerocopy(client->socket_fd, &client->zerocopy, data, length, &sent, ticket);
+    VMA_TRACE_SYSCALL(trace, trace.entry);
+    
+    if (result != TCP_SUCCESS) {
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_ZEROCOPY_CLIENT, client->socket_fd, result, 0);
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    client->tx_bytes += sent;
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND_ZEROCOPY_CLIENT, client->socket_fd, TCP_SUCCESS, sent);
+}
+
+tcp_result_t tcp_zerocopy_reap(tcp_zerocopy_t* zc, tcp_zc_completion_t* completions, size_t max,
+                            int timeout_ms, size_t* count) {
+    if (count) {
+        *count = 0;
+    }
+    
+    if (!zc || zc->socket_fd < 0 || !completions || max == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    size_t n = 0;
+    bool waited = false;
+    
+    while (n < max) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        
+        if (recvmsg(zc->socket_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!would_block()) {
+                return TCP_ERROR_RECV;
+            }
+            if (n > 0 || waited || timeout_ms == 0) {
+                break;
+            }
+            
+            // A queued completion raises POLLERR, which poll reports without asking
+            struct pollfd pfd = { .fd = zc->socket_fd, .events = 0, .revents = 0 };
+            waited = true;
+            if (poll(&pfd, 1, timeout_ms) <= 0) {
+                break;
+            }
+            continue;
+        }
+        
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) || n == max) {
+                continue;
+            }
+            
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            
+            tcp_zc_completion_t* completion = &completions[n++];
+            completion->lo = err.ee_info;
+            completion->hi = err.ee_data;
+            completion->copied = (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+            
+            uint64_t sends = (uint64_t)(uint32_t)(err.ee_data - err.ee_info) + 1;
+            zc->completions += sends;
+            if (completion->copied) {
+                zc->copied_completions += sends;
+            }
+        }
+    }
+    
+    if (count) {
+        *count = n;
+    }
+    
+    return n > 0 ? TCP_SUCCESS : TCP_ERROR_TIMEOUT;
+}
+
+tcp_result_t tcp_send_batch_init(tcp_send_batch_t* batch, size_t capacity) {
+    if (!batch || capacity == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    memset(batch, 0, sizeof(tcp_send_batch_t));
+    batch->buffer = malloc(capacity);
+    if (!batch->buffer) {
+        return TCP_ERROR_SOCKET_CREATE;
+    }
+    batch->capacity = capacity;
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_send_batch_close(tcp_send_batch_t* batch) {
+    if (!batch) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    free(batch->buffer);
+    memset(batch, 0, sizeof(tcp_send_batch_t));
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_send_batch_add(tcp_send_batch_t* batch, const void* data, size_t length) {
+    if (!batch || !batch->buffer || !data || length == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (length > batch->capacity - batch->length) {
+        return TCP_ERROR_WOULD_BLOCK;
+    }
+    
+    memcpy(batch->buffer + batch->length, data, length);
+    batch->length += length;
+    batch->messages++;
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_send_batch_addv(tcp_send_batch_t* batch, const struct iovec* iov, size_t iovcnt) {
+    if (!batch || !batch->buffer || !iov || iovcnt == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    size_t length = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        length += iov[i].iov_len;
+    }
+    
+    if (length == 0) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    if (length > batch->capacity - batch->length) {
+        return TCP_ERROR_WOULD_BLOCK;
+    }
+    
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(batch->buffer + batch->length, iov[i].iov_base, iov[i].iov_len);
+        batch->length += iov[i].iov_len;
+    }
+    batch->messages++;
+    
     return TCP_SUCCESS;
 }
 
+// Drop the part of a batch already written and keep the rest for the next send
+static void keep_unsent(tcp_send_batch_t* batch, size_t sent, size_t* bytes_sent) {
+    if (sent > 0) {
+        memmove(batch->buffer, batch->buffer + sent, batch->length - sent);
+        batch->length -= sent;
+    }
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+}
+
+tcp_result_t tcp_socket_send_batch(tcp_socket_t* sock, tcp_send_batch_t* batch, size_t* bytes_sent) {
+    if (!sock || sock->socket_fd < 0 || !batch || !batch->buffer) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (sock->state != TCP_STATE_CONNECTED) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = 0;
+    }
+    
+    if (batch->length == 0) {
+        return TCP_SUCCESS;
+    }
+    
+    struct iovec iov = { .iov_base = batch->buffer, .iov_len = batch->length };
+    size_t sent = 0;
+    uint64_t start_ticks = vma_clock_ticks();
+    tcp_result_t result = send_all(sock->socket_fd, &sock->wait_mode, &iov, 1, &sent);
+    
+    if (result == TCP_ERROR_WOULD_BLOCK || result == TCP_ERROR_TIMEOUT) {
+        // Messages count once their last byte leaves; the bytes count now
+        keep_unsent(batch, sent, bytes_sent);
+        if (sent > 0) {
+            vma_stats_tx(sock->stats, 0, (uint64_t)sent, vma_clock_ticks() - start_ticks);
+        }
+        vma_stats_tx_miss(sock->stats, true);
+        return result;
+    }
+    
+    size_t messages = batch->messages;
+    batch->length = 0;
+    batch->messages = 0;
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    if (result != TCP_SUCCESS) {
+        if (sent > 0) {
+            vma_stats_tx(sock->stats, 0, (uint64_t)sent, vma_clock_ticks() - start_ticks);
+        }
+        vma_stats_tx_miss(sock->stats, false);
+        sock->state = TCP_STATE_DISCONNECTED;
+        return result;
+    }
+    
+    vma_stats_tx(sock->stats, messages, (uint64_t)sent, vma_clock_ticks() - start_ticks);
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_send_batch_to_client(tcp_client_t* client, tcp_send_batch_t* batch,
+                                            size_t* bytes_sent) {
+    if (!client || client->socket_fd < 0 || !batch || !batch->buffer) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = 0;
+    }
+    
+    if (batch->length == 0) {
+        return TCP_SUCCESS;
+    }
+    
+    struct iovec iov = { .iov_base = batch->buffer, .iov_len = batch->length };
+    size_t sent = 0;
+    tcp_result_t result = send_all(client->socket_fd, &client->wait_mode, &iov, 1, &sent);
+    
+    if (result == TCP_ERROR_WOULD_BLOCK || result == TCP_ERROR_TIMEOUT) {
+        keep_unsent(batch, sent, bytes_sent);
+        client->tx_bytes += sent;
+        return result;
+    }
+    
+    batch->length = 0;
+    batch->messages = 0;
+    
+    if (bytes_sent) {
+        *bytes_sent = sent;
+    }
+    
+    client->tx_bytes += sent;
+    
+    return result;
+}
+
 tcp_result_t tcp_socket_recv(tcp_socket_t* sock, void* buffer, size_t buffer_size, 
                             int timeout_ms, size_t* bytes_received) {
     if (!sock || sock->socket_fd < 0 || !buffer || buffer_size == 0) {
@@ -497,40 +1138,45 @@ tcp_result_t tcp_socket_recv(tcp_socket_t* sock, void* buffer, size_t buffer_siz
         return TCP_ERROR_NOT_INITIALIZED;
     }
     
-    // Handle timeout
-    if (timeout_ms != 0) {
-        int select_result = wait_for_socket(sock->socket_fd, true, timeout_ms);
-        
-        if (select_result == 0) {
-            return TCP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
-            return TCP_ERROR_RECV;
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Receive data, waiting until the deadline while nothing is queued
+    ssize_t res;
+    uint64_t start_ticks;
+    for (;;) {
+        start_ticks = vma_clock_ticks();
+        res = recv(sock->socket_fd, buffer, buffer_size, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        tcp_result_t wait_result = wait_for_data(sock->socket_fd, &deadline,
+                                                &sock->wait_mode, &sock->wait_stats, sock->stats);
+        if (wait_result != TCP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, sock->socket_fd, wait_result, 0);
         }
     }
     
-    // Receive data
-    ssize_t res = recv(sock->socket_fd, buffer, buffer_size, 0);
-    
     if (res < 0) {
-        if (would_block()) {
-            return TCP_ERROR_TIMEOUT;
-        }
+        vma_stats_rx_miss(sock->stats, false, deadline.empty_polls);
         sock->state = TCP_STATE_DISCONNECTED;
-        return TCP_ERROR_RECV;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, sock->socket_fd, TCP_ERROR_RECV, 0);
     } else if (res == 0) {
         // Connection closed by peer
         sock->state = TCP_STATE_DISCONNECTED;
-        return TCP_ERROR_CLOSED;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, sock->socket_fd, TCP_ERROR_CLOSED, 0);
     }
     
     if (bytes_received) {
         *bytes_received = (size_t)res;
     }
     
-    sock->rx_packets++;
-    sock->rx_bytes += res;
+    vma_deadline_done(&deadline, &sock->wait_mode, &sock->wait_stats);
+    vma_stats_rx(sock->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, deadline.empty_polls);
     
-    return TCP_SUCCESS;
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, sock->socket_fd, TCP_SUCCESS, res);
 }
 
 tcp_result_t tcp_socket_recv_from_client(tcp_client_t* client, void* buffer, size_t buffer_size, 
@@ -539,37 +1185,41 @@ tcp_result_t tcp_socket_recv_from_client(tcp_client_t* client, void* buffer, siz
         return TCP_ERROR_INVALID_PARAM;
     }
     
-    // Handle timeout
-    if (timeout_ms != 0) {
-        int select_result = wait_for_socket(client->socket_fd, true, timeout_ms);
-        
-        if (select_result == 0) {
-            return TCP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
-            return TCP_ERROR_RECV;
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Receive data, waiting until the deadline while nothing is queued
+    ssize_t res;
+    for (;;) {
+        VMA_TRACE_ATTEMPT(trace);
+        res = recv(client->socket_fd, buffer, buffer_size, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, trace.attempt);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        tcp_result_t wait_result = wait_for_data(client->socket_fd, &deadline,
+                                                &client->wait_mode, &client->wait_stats, NULL);
+        if (wait_result != TCP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV_CLIENT, client->socket_fd, wait_result, 0);
         }
     }
     
-    // Receive data
-    ssize_t res = recv(client->socket_fd, buffer, buffer_size, 0);
-    
     if (res < 0) {
-        if (would_block()) {
-            return TCP_ERROR_TIMEOUT;
-        }
-        return TCP_ERROR_RECV;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV_CLIENT, client->socket_fd, TCP_ERROR_RECV, 0);
     } else if (res == 0) {
         // Connection closed by peer
-        return TCP_ERROR_CLOSED;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV_CLIENT, client->socket_fd, TCP_ERROR_CLOSED, 0);
     }
     
     if (bytes_received) {
         *bytes_received = (size_t)res;
     }
     
+    vma_deadline_done(&deadline, &client->wait_mode, &client->wait_stats);
     client->rx_bytes += res;
     
-    return TCP_SUCCESS;
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV_CLIENT, client->socket_fd, TCP_SUCCESS, res);
 }
 
 tcp_result_t tcp_socket_close_client(tcp_client_t* client) {
@@ -579,6 +1229,7 @@ tcp_result_t tcp_socket_close_client(tcp_client_t* client) {
     
     close(client->socket_fd);
     client->socket_fd = -1;
+    reset_zerocopy(&client->zerocopy);
     
     return TCP_SUCCESS;
 }
@@ -603,10 +1254,88 @@ tcp_result_t tcp_socket_get_stats(tcp_socket_t* sock, uint64_t* rx_packets,
         return TCP_ERROR_INVALID_PARAM;
     }
     
-    if (rx_packets) *rx_packets = sock->rx_packets;
-    if (tx_packets) *tx_packets = sock->tx_packets;
-    if (rx_bytes) *rx_bytes = sock->rx_bytes;
-    if (tx_bytes) *tx_bytes = sock->tx_bytes;
+    vma_stats_values_t values;
+    vma_stats_snapshot(sock->stats, &values);
+    
+    if (rx_packets) *rx_packets = values.rx_packets;
+    if (tx_packets) *tx_packets = values.tx_packets;
+    if (rx_bytes) *rx_bytes = values.rx_bytes;
+    if (tx_bytes) *tx_bytes = values.tx_bytes;
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_get_stats_snapshot(const tcp_socket_t* sock, vma_stats_values_t* values) {
+    if (!sock || !values) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    vma_stats_snapshot(sock->stats, values);
+    
+    return TCP_SUCCESS;
+}
+
+// Fill extended statistics for a connected or listening descriptor
+static void query_extended_stats(int fd, tcp_extended_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    vma_socket_info_query(fd, &stats->info);
+    
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+        len >= offsetof(struct tcp_info, tcpi_total_retrans) + sizeof(info.tcpi_total_retrans)) {
+        stats->tcp_info_valid = true;
+        stats->tcp_state = info.tcpi_state;
+        stats->rtt_us = info.tcpi_rtt;
+        stats->rtt_var_us = info.tcpi_rttvar;
+        stats->snd_cwnd = info.tcpi_snd_cwnd;
+        stats->unacked = info.tcpi_unacked;
+        stats->lost = info.tcpi_lost;
+        stats->total_retrans = info.tcpi_total_retrans;
+        stats->rcv_space = info.tcpi_rcv_space;
+    }
+}
+
+tcp_result_t tcp_socket_get_extended_stats(const tcp_socket_t* sock, tcp_extended_stats_t* stats) {
+    if (!sock || sock->socket_fd < 0 || !stats) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    query_extended_stats(sock->socket_fd, stats);
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_get_client_extended_stats(const tcp_client_t* client, tcp_extended_stats_t* stats) {
+    if (!client || client->socket_fd < 0 || !stats) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    query_extended_stats(client->socket_fd, stats);
+    
+    return TCP_SUCCESS;
+}
+
+tcp_result_t tcp_socket_set_stats_block(tcp_socket_t* sock, vma_stats_t* stats) {
+    if (!sock || sock->socket_fd < 0 || !stats) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+    
+    if (stats == sock->stats) {
+        return TCP_SUCCESS;
+    }
+    
+    vma_stats_values_t values;
+    vma_stats_snapshot(sock->stats, &values);
+    
+    stats->seq = 0;
+    stats->values = values;
+    
+    if (sock->owns_stats) {
+        vma_stats_destroy(sock->stats);
+    }
+    sock->stats = stats;
+    sock->owns_stats = false;
     
     return TCP_SUCCESS;
 }
\ No newline at end of file
@@ -9,7 +9,18 @@
 #include <stdbool.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include "vma_common.h"
+#include "vma_stats.h"
+
+// Maximum number of buffers per vectored send
+#define TCP_MAX_IOV 64
+
+// How long a vectored or batch send waits for the peer to make room once part is written
+#define TCP_SEND_STALL_TIMEOUT_MS 1000
+
+// Zero-copy sends smaller than this are copied (pinning and completion cost more than the copy)
+#define TCP_ZEROCOPY_MIN_BYTES 16384
 
 // TCP connection state
 typedef enum {
@@ -19,6 +30,18 @@ typedef enum {
     TCP_STATE_LISTENING = 3
 } tcp_connection_state_t;
 
+// Zero-copy send state of one connection (tcp_socket_enable_zerocopy); lives in the
+// socket or client because the kernel numbers MSG_ZEROCOPY sends per socket
+typedef struct {
+    int socket_fd;                  // Connection the state belongs to (-1 until enabled)
+    bool enabled;                   // SO_ZEROCOPY accepted; otherwise every send is copied
+    uint32_t next_seq;              // Sequence number of the next MSG_ZEROCOPY send (kernel counter)
+    uint64_t zerocopy_sends;        // Sends issued with MSG_ZEROCOPY
+    uint64_t copied_sends;          // Sends copied instead (disabled, short, or notification memory exhausted)
+    uint64_t completions;           // Zero-copy sends reported complete
+    uint64_t copied_completions;    // Of those, completed by a kernel copy after all (loopback, no SG/csum offload)
+} tcp_zerocopy_t;
+
 // TCP socket structure
 typedef struct {
     int socket_fd;                  // Socket file descriptor
@@ -27,11 +50,12 @@ typedef struct {
     struct sockaddr_in remote_addr; // Remote address information
     bool is_bound;                  // Whether the socket is bound
     tcp_connection_state_t state;   // Connection state
-    uint64_t rx_packets;            // Number of received packets
-    uint64_t tx_packets;            // Number of transmitted packets
-    uint64_t rx_bytes;              // Number of received bytes
-    uint64_t tx_bytes;              // Number of transmitted bytes
+    vma_stats_t* stats;             // Counters and latency histograms (cache-line aligned, own block)
+    bool owns_stats;                // Whether stats is freed on close
     int backlog;                    // Listen backlog
+    vma_wait_mode_t wait_mode;      // Receive wait policy (derived from vma_options)
+    vma_wait_stats_t wait_stats;    // Spin hits vs. blocking wakeups
+    tcp_zerocopy_t zerocopy;        // Zero-copy send state (kept until the socket is closed or reconnected)
 } tcp_socket_t;
 
 // Client info structure (for accepted connections)
@@ -40,8 +64,46 @@ typedef struct {
     struct sockaddr_in addr;        // Client address
     uint64_t rx_bytes;              // Bytes received from this client
     uint64_t tx_bytes;              // Bytes sent to this client
+    vma_wait_mode_t wait_mode;      // Receive wait policy (inherited from the listening socket)
+    vma_wait_stats_t wait_stats;    // Spin hits vs. blocking wakeups
+    tcp_zerocopy_t zerocopy;        // Zero-copy send state (kept until the client is closed)
 } tcp_client_t;
 
+// Coalescing send buffer (small messages are copied in and leave in one write)
+typedef struct {
+    uint8_t* buffer;                // Pending bytes
+    size_t capacity;                // Buffer size
+    size_t length;                  // Bytes pending
+    size_t messages;                // Messages pending
+} tcp_send_batch_t;
+
+// Extended connection statistics (tcp_socket_get_extended_stats)
+typedef struct {
+    vma_socket_info_t info;         // Offload state, VMA rings, queue occupancy, kernel drops
+    bool tcp_info_valid;            // The fields below were read (TCP_INFO)
+    uint8_t tcp_state;              // Kernel TCP state (TCP_ESTABLISHED, ...)
+    uint32_t rtt_us;                // Smoothed round-trip time
+    uint32_t rtt_var_us;            // Round-trip time variance
+    uint32_t snd_cwnd;              // Congestion window (segments)
+    uint32_t unacked;               // Segments in flight
+    uint32_t lost;                  // Segments currently considered lost
+    uint32_t total_retrans;         // Retransmitted segments over the connection lifetime
+    uint32_t rcv_space;             // Receive window the stack is advertising towards
+} tcp_extended_stats_t;
+
+// Outcome of one zero-copy send
+typedef struct {
+    uint32_t seq;                   // Sequence number the send used (valid when pinned)
+    bool pinned;                    // The buffer stays in use until seq completes; false: it was copied
+} tcp_zc_ticket_t;
+
+// Completed zero-copy sends: sequence numbers lo..hi (inclusive) no longer use their buffers
+typedef struct {
+    uint32_t lo;
+    uint32_t hi;
+    bool copied;                    // The kernel copied the data (SO_EE_CODE_ZEROCOPY_COPIED)
+} tcp_zc_completion_t;
+
 // Result codes
 typedef enum {
     TCP_SUCCESS = 0,
@@ -59,7 +121,8 @@ typedef enum {
     TCP_ERROR_NOT_INITIALIZED = -12,
     TCP_ERROR_CLOSED = -13,
     TCP_ERROR_WOULD_BLOCK = -14,
-    TCP_ERROR_ALREADY_CONNECTED = -15
+    TCP_ERROR_ALREADY_CONNECTED = -15,
+    TCP_ERROR_PROTOCOL = -16
 } tcp_result_t;
 
 /**
@@ -108,6 +171,22 @@ tcp_result_t tcp_socket_listen(tcp_socket_t* socket, int backlog);
  */
 tcp_result_t tcp_socket_accept(tcp_socket_t* socket, tcp_client_t* client, int timeout_ms);
 
+/**
+ * Accept every pending connection, up to max_clients (server)
+ * 
+ * Waits up to timeout_ms only while nothing is pending. Clients get the
+ * same options as from tcp_socket_accept.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param clients Output array for the accepted clients
+ * @param max_clients Size of the clients array
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param accepted Number of clients accepted (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_socket_accept_batch(tcp_socket_t* socket, tcp_client_t* clients, size_t max_clients,
+                                    int timeout_ms, size_t* accepted);
+
 /**
  * Connect to a server (client)
  * 
@@ -129,12 +208,35 @@ tcp_result_t tcp_socket_connect(tcp_socket_t* socket, const char* ip, uint16_t p
 tcp_result_t tcp_socket_reconnect(tcp_socket_t* socket, int timeout_ms);
 
 /**
- * Check if the connection is still alive
+ * Check the tracked connection state (a memory read, no system call)
+ * 
+ * The state drops to disconnected when a send or receive fails, the peer
+ * closes, tcp_socket_mark_disconnected is called for a hangup event or a
+ * heartbeat deadline expires.
  * 
  * @param socket Pointer to the TCP socket structure
  * @return True if connected, false otherwise
  */
-bool tcp_socket_is_connected(tcp_socket_t* socket);
+bool tcp_socket_is_connected(const tcp_socket_t* socket);
+
+/**
+ * Ask the kernel whether the connection is still alive (off the hot path)
+ * 
+ * Peeks at the receive queue and the pending socket error, so an orderly
+ * close or reset that no send or receive has seen yet is detected.
+ * Queued data is left in place.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @return True if connected, false otherwise
+ */
+bool tcp_socket_probe(tcp_socket_t* socket);
+
+/**
+ * Record that the connection is gone (hangup or error event from a poller or engine)
+ * 
+ * @param socket Pointer to the TCP socket structure
+ */
+void tcp_socket_mark_disconnected(tcp_socket_t* socket);
 
 /**
  * Send data
@@ -158,6 +260,167 @@ tcp_result_t tcp_socket_send(tcp_socket_t* socket, const void* data, size_t leng
  */
 tcp_result_t tcp_socket_send_to_client(tcp_client_t* client, const void* data, size_t length, size_t* bytes_sent);
 
+/**
+ * Send several buffers as one write (scatter-gather)
+ * 
+ * Partial writes are resumed internally, waiting for room under the socket's
+ * wait mode, so either nothing is sent (TCP_ERROR_WOULD_BLOCK) or all buffers
+ * are, unless the peer stops reading for TCP_SEND_STALL_TIMEOUT_MS partway
+ * (TCP_ERROR_TIMEOUT; bytes_sent tells where to resume).
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param iov Buffers to send in order
+ * @param iovcnt Number of buffers (at most TCP_MAX_IOV)
+ * @param bytes_sent Number of bytes sent, also on error (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_socket_sendv(tcp_socket_t* socket, const struct iovec* iov, size_t iovcnt, size_t* bytes_sent);
+
+/**
+ * Send several buffers as one write on a client socket (same as tcp_socket_sendv)
+ * 
+ * @param client Pointer to the client structure
+ * @param iov Buffers to send in order
+ * @param iovcnt Number of buffers (at most TCP_MAX_IOV)
+ * @param bytes_sent Number of bytes sent, also on error (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_socket_sendv_to_client(tcp_client_t* client, const struct iovec* iov, size_t iovcnt,
+                                    size_t* bytes_sent);
+
+/**
+ * Enable zero-copy sends (SO_ZEROCOPY) on a connected socket
+ * 
+ * The state lives in socket->zerocopy. The first call initializes it; later
+ * calls keep it, so send sequence numbers stay in step with the kernel's
+ * counter across senders. Closing or reconnecting the socket resets it. A
+ * socket that refuses the option still succeeds with zerocopy.enabled false;
+ * its zero-copy sends are then plain copying sends.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @return Result code
+ */
+tcp_result_t tcp_socket_enable_zerocopy(tcp_socket_t* socket);
+
+/**
+ * Enable zero-copy sends (SO_ZEROCOPY) on a client socket
+ * 
+ * Same as tcp_socket_enable_zerocopy, with the state in client->zerocopy.
+ * 
+ * @param client Pointer to the client structure
+ * @return Result code
+ */
+tcp_result_t tcp_socket_enable_client_zerocopy(tcp_client_t* client);
+
+/**
+ * Send data without copying it into the socket buffer (MSG_ZEROCOPY)
+ * 
+ * One send call: bytes_sent may be short of length, and the caller resumes
+ * with the rest. When ticket->pinned is set, the sent bytes must not be
+ * modified or freed until tcp_zerocopy_reap reports ticket->seq complete.
+ * 
+ * @param socket Pointer to the TCP socket structure (zero-copy enabled)
+ * @param data Data to send
+ * @param length Data length
+ * @param bytes_sent Number of bytes sent (can be NULL)
+ * @param ticket Sequence number and whether the buffer is pinned (filled on success)
+ * @return Result code (TCP_ERROR_NOT_INITIALIZED before tcp_socket_enable_zerocopy)
+ */
+tcp_result_t tcp_socket_send_zerocopy(tcp_socket_t* socket, const void* data, size_t length,
+                                  size_t* bytes_sent, tcp_zc_ticket_t* ticket);
+
+/**
+ * Send data on a client socket without copying it (MSG_ZEROCOPY)
+ * 
+ * @param client Pointer to the client structure (zero-copy enabled)
+ * @param data Data to send
+ * @param length Data length
+ * @param bytes_sent Number of bytes sent (can be NULL)
+ * @param ticket Sequence number and whether the buffer is pinned (filled on success)
+ * @return Result code (TCP_ERROR_NOT_INITIALIZED before tcp_socket_enable_client_zerocopy)
+ */
+tcp_result_t tcp_socket_send_zerocopy_to_client(tcp_client_t* client, const void* data, size_t length,
+                                            size_t* bytes_sent, tcp_zc_ticket_t* ticket);
+
+/**
+ * Read zero-copy completions from the socket error queue
+ * 
+ * Completions may cover several sends and may arrive out of order.
+ * 
+ * @param zc Zero-copy state of the connection (socket->zerocopy or client->zerocopy)
+ * @param completions Array to fill
+ * @param max Size of the array
+ * @param timeout_ms Timeout in milliseconds for the first completion (0 for non-blocking, -1 for infinite wait)
+ * @param count Number of completions read (can be NULL)
+ * @return Result code (TCP_ERROR_TIMEOUT if none arrived)
+ */
+tcp_result_t tcp_zerocopy_reap(tcp_zerocopy_t* zc, tcp_zc_completion_t* completions, size_t max,
+                            int timeout_ms, size_t* count);
+
+/**
+ * Allocate a coalescing send buffer
+ * 
+ * @param batch Pointer to the batch structure to initialize
+ * @param capacity Buffer size in bytes
+ * @return Result code
+ */
+tcp_result_t tcp_send_batch_init(tcp_send_batch_t* batch, size_t capacity);
+
+/**
+ * Release a coalescing send buffer (pending bytes are dropped)
+ * 
+ * @param batch Pointer to the batch structure
+ * @return Result code
+ */
+tcp_result_t tcp_send_batch_close(tcp_send_batch_t* batch);
+
+/**
+ * Append one message to the batch
+ * 
+ * @param batch Pointer to the batch structure
+ * @param data Message data
+ * @param length Message length
+ * @return Result code (TCP_ERROR_WOULD_BLOCK if it does not fit in the space left)
+ */
+tcp_result_t tcp_send_batch_add(tcp_send_batch_t* batch, const void* data, size_t length);
+
+/**
+ * Append one message made of several buffers to the batch
+ * 
+ * @param batch Pointer to the batch structure
+ * @param iov Message parts in order
+ * @param iovcnt Number of parts
+ * @return Result code (TCP_ERROR_WOULD_BLOCK if it does not fit in the space left)
+ */
+tcp_result_t tcp_send_batch_addv(tcp_send_batch_t* batch, const struct iovec* iov, size_t iovcnt);
+
+/**
+ * Send everything in the batch as one write and empty it
+ * 
+ * The batch is kept when nothing could be sent (TCP_ERROR_WOULD_BLOCK). If
+ * the peer stops reading partway (TCP_ERROR_TIMEOUT, see tcp_socket_sendv)
+ * the bytes written are dropped from it and the rest kept for the next call.
+ * On TCP_ERROR_SEND the batch is emptied.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param batch Pointer to the batch structure
+ * @param bytes_sent Number of bytes sent, also on error (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_socket_send_batch(tcp_socket_t* socket, tcp_send_batch_t* batch, size_t* bytes_sent);
+
+/**
+ * Send everything in the batch as one write on a client socket and empty it
+ * (same as tcp_socket_send_batch)
+ * 
+ * @param client Pointer to the client structure
+ * @param batch Pointer to the batch structure
+ * @param bytes_sent Number of bytes sent (can be NULL)
+ * @return Result code
+ */
+tcp_result_t tcp_socket_send_batch_to_client(tcp_client_t* client, tcp_send_batch_t* batch,
+                                            size_t* bytes_sent);
+
 /**
  * Receive data
  * 
@@ -219,4 +482,46 @@ tcp_result_t tcp_socket_get_stats(tcp_socket_t* socket, uint64_t* rx_packets,
                                 uint64_t* tx_packets, uint64_t* rx_bytes, 
                                 uint64_t* tx_bytes);
 
+/**
+ * Take a consistent snapshot of all socket statistics
+ * 
+ * Safe to call from a monitoring thread while the owner thread sends and
+ * receives; the owner never waits for readers.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param values Destination for counters and latency histograms
+ * @return Result code
+ */
+tcp_result_t tcp_socket_get_stats_snapshot(const tcp_socket_t* socket, vma_stats_values_t* values);
+
+/**
+ * Get offload, ring and TCP_INFO statistics of the socket's connection
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param stats Destination
+ * @return Result code
+ */
+tcp_result_t tcp_socket_get_extended_stats(const tcp_socket_t* socket, tcp_extended_stats_t* stats);
+
+/**
+ * Get offload, ring and TCP_INFO statistics of an accepted connection
+ * 
+ * @param client Pointer to the client structure
+ * @param stats Destination
+ * @return Result code
+ */
+tcp_result_t tcp_socket_get_client_extended_stats(const tcp_client_t* client, tcp_extended_stats_t* stats);
+
+/**
+ * Use a caller-owned statistics block instead of the internal one
+ * 
+ * The block must outlive the socket; it is not freed on close. Counters
+ * already recorded are copied over.
+ * 
+ * @param socket Pointer to the TCP socket structure
+ * @param stats Caller-owned statistics block
+ * @return Result code
+ */
+tcp_result_t tcp_socket_set_stats_block(tcp_socket_t* socket, vma_stats_t* stats);
+
 #endif /* TCP_SOCKET_H */
\ No newline at end of file
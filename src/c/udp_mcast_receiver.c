@@ -0,0 +1,533 @@
+/**
+ * udp_mcast_receiver.c - Multicast feed receiver with A/B line arbitration
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "udp_mcast_receiver.h"
+#include <mellanox/vma_extra.h>
+
+static udp_packet_t* line_packets(udp_mcast_receiver_t* rx, size_t line) {
+    return rx->packets + line * rx->config.batch;
+}
+
+static void* line_buffers(udp_mcast_receiver_t* rx, size_t line) {
+    return (char*)rx->buffers + line * rx->config.batch * rx->config.stride;
+}
+
+// Read the sequence number at the configured offset and width
+static bool read_seq(const udp_mcast_config_t* config, const udp_packet_t* packet, uint64_t* seq) {
+    if (packet->length < config->seq_offset + config->seq_width) {
+        return false;
+    }
+
+    const uint8_t* p = (const uint8_t*)packet->data + config->seq_offset;
+    uint64_t value = 0;
+    if (config->seq_big_endian) {
+        for (size_t i = 0; i < config->seq_width; i++) {
+            value = (value << 8) | p[i];
+        }
+    } else {
+        for (size_t i = config->seq_width; i > 0; i--) {
+            value = (value << 8) | p[i - 1];
+        }
+    }
+
+    *seq = value;
+    return true;
+}
+
+// Events the pending queue holds: a datagram and a reported hole per arrival, plus the open holes
+static size_t pending_capacity(const udp_mcast_receiver_t* rx) {
+    return 2 * UDP_MCAST_MAX_LINES * rx->config.batch + UDP_MCAST_MAX_GAPS;
+}
+
+// Signed distance from b to a modulo the sequence width (serial number arithmetic)
+static int64_t seq_diff(const udp_mcast_receiver_t* rx, uint64_t a, uint64_t b) {
+    uint64_t d = (a - b) & rx->seq_mask;
+    if (rx->seq_mask == UINT64_MAX) {
+        return (int64_t)d;
+    }
+    uint64_t half = (rx->seq_mask >> 1) + 1;
+    return d >= half ? (int64_t)d - (int64_t)(rx->seq_mask + 1) : (int64_t)d;
+}
+
+static void push_event(udp_mcast_receiver_t* rx, udp_mcast_event_type_t type, uint32_t line,
+                    uint64_t seq, uint64_t count, const udp_packet_t* packet) {
+    udp_mcast_event_t* event = &rx->pending[rx->pending_head + rx->pending_count++];
+    event->type = type;
+    event->line = line;
+    event->seq = seq;
+    event->count = count;
+    if (packet) {
+        event->packet = *packet;
+    } else {
+        memset(&event->packet, 0, sizeof(event->packet));
+    }
+}
+
+static void report_gap(udp_mcast_receiver_t* rx, const udp_mcast_gap_t* gap) {
+    push_event(rx, UDP_MCAST_EVENT_GAP, 0, gap->seq, gap->count, NULL);
+    rx->stats.gaps++;
+    rx->stats.missing += gap->count;
+}
+
+static void remove_gap(udp_mcast_receiver_t* rx, size_t index) {
+    memmove(&rx->gaps[index], &rx->gaps[index + 1], (rx->gap_count - index - 1) * sizeof(udp_mcast_gap_t));
+    rx->gap_count--;
+}
+
+// Open a hole (holes open in sequence order, so the list stays oldest first)
+static void open_gap(udp_mcast_receiver_t* rx, uint64_t seq, uint64_t count, uint64_t now_ns) {
+    if (rx->gap_count == UDP_MCAST_MAX_GAPS) {
+        report_gap(rx, &rx->gaps[0]);
+        remove_gap(rx, 0);
+    }
+    udp_mcast_gap_t* gap = &rx->gaps[rx->gap_count++];
+    gap->seq = seq;
+    gap->count = count;
+    gap->expires_ns = now_ns + rx->gap_timeout_ns;
+}
+
+// Take seq out of the hole holding it, returns false if no hole does
+static bool fill_gap(udp_mcast_receiver_t* rx, uint64_t seq) {
+    for (size_t i = 0; i < rx->gap_count; i++) {
+        udp_mcast_gap_t* gap = &rx->gaps[i];
+        int64_t offset = seq_diff(rx, seq, gap->seq);
+        if (offset < 0 || (uint64_t)offset >= gap->count) {
+            continue;
+        }
+
+        if (gap->count == 1) {
+            remove_gap(rx, i);
+        } else if (offset == 0) {
+            gap->seq = (gap->seq + 1) & rx->seq_mask;
+            gap->count--;
+        } else if ((uint64_t)offset == gap->count - 1) {
+            gap->count--;
+        } else {
+            // Split in two; the tail keeps the hole's deadline
+            udp_mcast_gap_t tail = {
+                .seq = (seq + 1) & rx->seq_mask,
+                .count = gap->count - (uint64_t)offset - 1,
+                .expires_ns = gap->expires_ns,
+            };
+            gap->count = (uint64_t)offset;
+            if (rx->gap_count == UDP_MCAST_MAX_GAPS) {
+                report_gap(rx, &rx->gaps[0]);
+                remove_gap(rx, 0);
+                i--;
+            }
+            memmove(&rx->gaps[i + 2], &rx->gaps[i + 1], (rx->gap_count - i - 1) * sizeof(udp_mcast_gap_t));
+            rx->gaps[i + 1] = tail;
+            rx->gap_count++;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Whether every line that takes part has moved past the end of a hole
+static bool gap_passed(const udp_mcast_receiver_t* rx, const udp_mcast_gap_t* gap) {
+    uint64_t end = (gap->seq + gap->count) & rx->seq_mask;
+    for (size_t line = 0; line < UDP_MCAST_MAX_LINES; line++) {
+        if (line >= rx->line_count && !rx->line_seen[line]) {
+            continue;
+        }
+        if (!rx->line_seen[line] || seq_diff(rx, rx->line_next[line], end) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Report the holes no line can fill any more or that waited long enough
+static void close_gaps(udp_mcast_receiver_t* rx, uint64_t now_ns) {
+    size_t i = 0;
+    while (i < rx->gap_count) {
+        if (gap_passed(rx, &rx->gaps[i]) || now_ns >= rx->gaps[i].expires_ns) {
+            report_gap(rx, &rx->gaps[i]);
+            remove_gap(rx, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+udp_result_t udp_mcast_arbitrate(udp_mcast_receiver_t* rx, udp_mcast_arrival_t* arrivals, size_t count,
+                                 uint64_t now_ns) {
+    if (!rx || !rx->pending || (count > 0 && !arrivals)) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (arrivals[i].line >= UDP_MCAST_MAX_LINES) {
+            return UDP_ERROR_INVALID_PARAM;
+        }
+    }
+
+    // Events still queued move to the front so new ones can follow them
+    if (rx->pending_head > 0) {
+        memmove(rx->pending, rx->pending + rx->pending_head, rx->pending_count * sizeof(udp_mcast_event_t));
+        rx->pending_head = 0;
+    }
+
+    if (rx->pending_count + 2 * count + UDP_MCAST_MAX_GAPS > pending_capacity(rx)) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    // Insertion sort: the batches are short and each line is already mostly in order.
+    // Stable, so on a tie the lower line index wins. Keys are distances from
+    // the expected sequence number, which orders correctly across a wrap.
+    uint64_t base = rx->synced ? rx->next_seq : (count > 0 ? arrivals[0].seq : 0);
+    for (size_t i = 1; i < count; i++) {
+        udp_mcast_arrival_t current = arrivals[i];
+        int64_t key = seq_diff(rx, current.seq, base);
+        size_t j = i;
+        while (j > 0 && seq_diff(rx, arrivals[j - 1].seq, base) > key) {
+            arrivals[j] = arrivals[j - 1];
+            j--;
+        }
+        arrivals[j] = current;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const udp_mcast_arrival_t* arrival = &arrivals[i];
+        uint64_t seq = arrival->seq & rx->seq_mask;
+        uint32_t line = arrival->line;
+
+        if (!rx->synced) {
+            rx->next_seq = seq;
+            rx->synced = true;
+        }
+
+        uint64_t after = (seq + 1) & rx->seq_mask;
+        if (!rx->line_seen[line] || seq_diff(rx, after, rx->line_next[line]) > 0) {
+            rx->line_next[line] = after;
+            rx->line_seen[line] = true;
+        }
+
+        int64_t ahead = seq_diff(rx, seq, rx->next_seq);
+        if (ahead < 0) {
+            if (!fill_gap(rx, seq)) {
+                rx->stats.duplicates++;
+                rx->stats.lines[line].duplicates++;
+                continue;
+            }
+            rx->stats.late_fills++;
+        } else {
+            if (ahead > 0) {
+                open_gap(rx, rx->next_seq, (uint64_t)ahead, now_ns);
+            }
+            rx->next_seq = after;
+        }
+
+        push_event(rx, UDP_MCAST_EVENT_DATA, line, seq, 1, arrival->packet);
+        rx->stats.delivered++;
+        rx->stats.lines[line].won++;
+    }
+
+    close_gaps(rx, now_ns);
+
+    return UDP_SUCCESS;
+}
+
+// Drain every line once without blocking, returns the number of datagrams read
+static udp_result_t drain_lines(udp_mcast_receiver_t* rx, udp_mcast_arrival_t* arrivals, size_t* count) {
+    udp_result_t last_error = UDP_SUCCESS;
+    *count = 0;
+
+    for (size_t line = 0; line < rx->line_count; line++) {
+        udp_packet_t* packets = line_packets(rx, line);
+        size_t received = 0;
+
+        udp_result_t result = udp_socket_recv_batch(&rx->lines[line], packets, line_buffers(rx, line),
+                                                rx->config.stride, rx->config.batch, 0, &received);
+        if (result == UDP_ERROR_TIMEOUT) {
+            continue;
+        }
+        if (result != UDP_SUCCESS) {
+            last_error = result;  // Keep reading the other line
+            continue;
+        }
+
+        rx->stats.lines[line].received += received;
+        for (size_t i = 0; i < received; i++) {
+            uint64_t seq;
+            if (!read_seq(&rx->config, &packets[i], &seq)) {
+                rx->stats.malformed++;
+                continue;
+            }
+            arrivals[*count].seq = seq;
+            arrivals[*count].line = (uint32_t)line;
+            arrivals[*count].packet = &packets[i];
+            (*count)++;
+        }
+    }
+
+    // An error only surfaces when no line delivered anything
+    return *count > 0 ? UDP_SUCCESS : last_error;
+}
+
+static udp_result_t fill_pending(udp_mcast_receiver_t* rx, int timeout_ms) {
+    udp_mcast_arrival_t arrivals[UDP_MCAST_MAX_LINES * UDP_MAX_BATCH];
+    int fds[UDP_MCAST_MAX_LINES];
+    size_t count = 0;
+
+    for (size_t line = 0; line < rx->line_count; line++) {
+        fds[line] = rx->lines[line].socket_fd;
+    }
+
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+
+    for (;;) {
+        udp_result_t result = drain_lines(rx, arrivals, &count);
+        if (result != UDP_SUCCESS) {
+            return result;
+        }
+        if (count > 0 || rx->gap_count > 0) {
+            rx->pending_head = 0;
+            rx->pending_count = 0;
+            udp_mcast_arbitrate(rx, arrivals, count, vma_clock_ns());
+            if (rx->pending_count > 0) {
+                break;
+            }
+            if (count > 0) {
+                continue;  // Only duplicates: read again before waiting
+            }
+        }
+
+        // Open holes cut the wait short so they are reported when they expire
+        vma_deadline_t wait = deadline;
+        bool cut = false;
+        if (rx->gap_count > 0 && deadline.timeout_ms != 0) {
+            if (deadline.deadline_ns == 0) {
+                deadline.deadline_ns = vma_clock_ns() + (uint64_t)deadline.timeout_ms * 1000000ULL;
+            }
+            wait = deadline;
+            if (rx->gaps[0].expires_ns < wait.deadline_ns) {
+                wait.deadline_ns = rx->gaps[0].expires_ns;
+                cut = true;
+            }
+        }
+
+        int wait_result = vma_deadline_wait_fds(&wait, fds, rx->line_count,
+                                            &rx->wait_mode, &rx->wait_stats);
+        uint64_t deadline_ns = cut ? deadline.deadline_ns : wait.deadline_ns;
+        deadline = wait;
+        deadline.deadline_ns = deadline_ns;
+        if (wait_result == 0 && !cut) {
+            return UDP_ERROR_TIMEOUT;
+        } else if (wait_result < 0) {
+            return UDP_ERROR_RECV;
+        }
+    }
+
+    vma_deadline_done(&deadline, &rx->wait_mode, &rx->wait_stats);
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_init(udp_mcast_receiver_t* rx, const vma_options_t* options,
+                            const udp_mcast_config_t* config) {
+    if (!rx || !config || config->stride == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (config->seq_width != 1 && config->seq_width != 2 &&
+        config->seq_width != 4 && config->seq_width != 8) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    memset(rx, 0, sizeof(udp_mcast_receiver_t));
+
+    if (options) {
+        rx->vma_options = *options;
+    } else {
+        set_default_options(&rx->vma_options);
+    }
+
+    rx->config = *config;
+    if (rx->config.batch == 0 || rx->config.batch > UDP_MAX_BATCH) {
+        rx->config.batch = UDP_MAX_BATCH;
+    }
+    if (rx->config.gap_timeout_us == 0) {
+        rx->config.gap_timeout_us = UDP_MCAST_DEFAULT_GAP_TIMEOUT_US;
+    }
+    rx->seq_mask = config->seq_width == 8 ? UINT64_MAX : (1ULL << (8 * config->seq_width)) - 1;
+    rx->gap_timeout_ns = (uint64_t)rx->config.gap_timeout_us * 1000ULL;
+
+    vma_clock_init();
+    vma_wait_mode_init(&rx->wait_mode, &rx->vma_options);
+
+    size_t slots = UDP_MCAST_MAX_LINES * rx->config.batch;
+    rx->packets = calloc(slots, sizeof(udp_packet_t));
+    rx->buffers = malloc(slots * rx->config.stride);
+    rx->pending = calloc(pending_capacity(rx), sizeof(udp_mcast_event_t));
+
+    if (!rx->packets || !rx->buffers || !rx->pending) {
+        free(rx->packets);
+        free(rx->buffers);
+        free(rx->pending);
+        memset(rx, 0, sizeof(udp_mcast_receiver_t));
+        return UDP_ERROR_SOCKET_CREATE;
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_close(udp_mcast_receiver_t* rx) {
+    if (!rx) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    // Closing the sockets drops the group memberships
+    for (size_t line = 0; line < rx->line_count; line++) {
+        udp_socket_close(&rx->lines[line]);
+    }
+    rx->line_count = 0;
+
+    free(rx->packets);
+    free(rx->buffers);
+    free(rx->pending);
+    rx->packets = NULL;
+    rx->buffers = NULL;
+    rx->pending = NULL;
+    rx->pending_head = 0;
+    rx->pending_count = 0;
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_add_line(udp_mcast_receiver_t* rx, const char* group_ip, uint16_t port,
+                                const char* interface_ip, const char* source_ip) {
+    if (!rx || !rx->packets || !group_ip || rx->line_count >= UDP_MCAST_MAX_LINES) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    struct in_addr group, interface, source;
+    if (inet_pton(AF_INET, group_ip, &group) <= 0 || !IN_MULTICAST(ntohl(group.s_addr))) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    interface.s_addr = htonl(INADDR_ANY);
+    if (interface_ip && inet_pton(AF_INET, interface_ip, &interface) <= 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (source_ip && inet_pton(AF_INET, source_ip, &source) <= 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    udp_socket_t* sock = &rx->lines[rx->line_count];
+    udp_result_t result = udp_socket_init(sock, &rx->vma_options);
+    if (result != UDP_SUCCESS) {
+        return result;
+    }
+
+    // Both lines of a feed often share a port, and other processes may listen on it too
+    int reuse = 1;
+    result = udp_socket_setopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Lines on the same interface share one VMA ring (must be set before the ring is attached).
+    // Not fatal without VMA.
+    if (result == UDP_SUCCESS) {
+        struct vma_ring_alloc_logic_attr ring_attr;
+        memset(&ring_attr, 0, sizeof(ring_attr));
+        ring_attr.ring_alloc_logic = RING_LOGIC_PER_INTERFACE;
+        ring_attr.engress = 0;
+        ring_attr.ingress = 1;
+        ring_attr.comp_mask = VMA_RING_ALLOC_MASK_RING_INGRESS;
+        setsockopt(sock->socket_fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC, &ring_attr, sizeof(ring_attr));
+
+        // Binding to the group address filters out other groups sharing the port
+        result = udp_socket_bind(sock, group_ip, port);
+    }
+
+    if (result == UDP_SUCCESS) {
+        int rc;
+        if (source_ip) {
+            struct ip_mreq_source mreq;
+            memset(&mreq, 0, sizeof(mreq));
+            mreq.imr_multiaddr = group;
+            mreq.imr_interface = interface;
+            mreq.imr_sourceaddr = source;
+            rc = setsockopt(sock->socket_fd, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP, &mreq, sizeof(mreq));
+        } else {
+            struct ip_mreq mreq;
+            memset(&mreq, 0, sizeof(mreq));
+            mreq.imr_multiaddr = group;
+            mreq.imr_interface = interface;
+            rc = setsockopt(sock->socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+        }
+        if (rc < 0) {
+            result = UDP_ERROR_SOCKET_OPTION;
+        }
+    }
+
+    if (result != UDP_SUCCESS) {
+        udp_socket_close(sock);
+        return result;
+    }
+
+    rx->line_count++;
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_recv(udp_mcast_receiver_t* rx, udp_mcast_event_t* events, size_t max_events,
+                            int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!rx || !rx->pending || rx->line_count == 0 || !events || max_events == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    // Buffers are only refilled once every event from the previous drain was returned
+    if (rx->pending_count == 0) {
+        udp_result_t result = fill_pending(rx, timeout_ms);
+        if (result != UDP_SUCCESS) {
+            return result;
+        }
+    }
+
+    size_t count = rx->pending_count < max_events ? rx->pending_count : max_events;
+    memcpy(events, rx->pending + rx->pending_head, count * sizeof(udp_mcast_event_t));
+    rx->pending_head += count;
+    rx->pending_count -= count;
+
+    if (n) {
+        *n = count;
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_reset(udp_mcast_receiver_t* rx) {
+    if (!rx) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    rx->synced = false;
+    rx->next_seq = 0;
+    rx->gap_count = 0;
+    memset(rx->line_next, 0, sizeof(rx->line_next));
+    memset(rx->line_seen, 0, sizeof(rx->line_seen));
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_mcast_get_stats(const udp_mcast_receiver_t* rx, udp_mcast_stats_t* stats) {
+    if (!rx || !stats) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    *stats = rx->stats;
+
+    return UDP_SUCCESS;
+}
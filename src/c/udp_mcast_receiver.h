@@ -0,0 +1,193 @@
+/**
+ * udp_mcast_receiver.h - Multicast feed receiver with A/B line arbitration
+ */
+
+#ifndef UDP_MCAST_RECEIVER_H
+#define UDP_MCAST_RECEIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "vma_common.h"
+#include "udp_socket.h"
+
+// Maximum number of redundant lines per feed (A and B)
+#define UDP_MCAST_MAX_LINES 2
+
+// Holes held open for a late copy from another line (the oldest is reported when full)
+#define UDP_MCAST_MAX_GAPS 32
+
+// Default time a hole waits for the other line
+#define UDP_MCAST_DEFAULT_GAP_TIMEOUT_US 1000
+
+// Event types
+typedef enum {
+    UDP_MCAST_EVENT_DATA = 1,      // First copy of a sequence number (delivered)
+    UDP_MCAST_EVENT_GAP = 2        // Sequence numbers missing on every line
+} udp_mcast_event_type_t;
+
+// Location of the sequence number inside each datagram
+typedef struct {
+    size_t seq_offset;             // Byte offset of the sequence number
+    size_t seq_width;              // Width in bytes (1, 2, 4 or 8)
+    bool seq_big_endian;           // Network byte order (false for little endian)
+    size_t stride;                 // Buffer slot size per datagram (largest expected datagram)
+    size_t batch;                  // Datagrams drained per line and call (capped at UDP_MAX_BATCH, 0 for the maximum)
+    uint32_t gap_timeout_us;       // How long a hole waits for a late copy from another line (0 for the default)
+} udp_mcast_config_t;
+
+// Arbitrated event
+typedef struct {
+    udp_mcast_event_type_t type;   // Event type
+    uint32_t line;                 // Line the datagram won on (DATA only)
+    uint64_t seq;                  // Sequence number (first missing one for GAP)
+    uint64_t count;                // Number of missing sequence numbers (GAP only, 1 for DATA)
+    udp_packet_t packet;           // Datagram (DATA only, data valid until the next udp_mcast_recv)
+} udp_mcast_event_t;
+
+// Per-line counters
+typedef struct {
+    uint64_t received;             // Datagrams read from the line
+    uint64_t won;                  // Datagrams delivered from this line (arrived first)
+    uint64_t duplicates;           // Datagrams dropped because the other line delivered them
+} udp_mcast_line_stats_t;
+
+// Feed counters
+typedef struct {
+    uint64_t delivered;            // DATA events produced
+    uint64_t duplicates;           // Datagrams dropped as already delivered (or arriving after their gap)
+    uint64_t gaps;                 // GAP events produced
+    uint64_t missing;              // Sequence numbers reported missing
+    uint64_t malformed;            // Datagrams too short to hold the sequence number
+    uint64_t late_fills;           // Datagrams delivered into a hole after later sequence numbers
+    udp_mcast_line_stats_t lines[UDP_MCAST_MAX_LINES]; // Per-line counters
+} udp_mcast_stats_t;
+
+// Datagram read from a line (input of udp_mcast_arbitrate)
+typedef struct {
+    uint64_t seq;                  // Sequence number read from the datagram
+    uint32_t line;                 // Line it was read from
+    udp_packet_t* packet;          // Datagram
+} udp_mcast_arrival_t;
+
+// Hole waiting for a late copy
+typedef struct {
+    uint64_t seq;                  // First missing sequence number
+    uint64_t count;                // Number of missing sequence numbers
+    uint64_t expires_ns;           // vma_clock_ns time the hole is reported regardless
+} udp_mcast_gap_t;
+
+// Receiver structure
+typedef struct {
+    udp_socket_t lines[UDP_MCAST_MAX_LINES]; // One socket per line, joined to the line's group
+    size_t line_count;             // Number of lines added
+    vma_options_t vma_options;     // Options applied to every line
+    udp_mcast_config_t config;     // Sequence field and buffer layout
+    udp_packet_t* packets;         // line_count x batch packet descriptors
+    void* buffers;                 // line_count x batch x stride receive buffers
+    udp_mcast_event_t* pending;    // Arbitrated events not yet returned
+    size_t pending_head;           // First pending event
+    size_t pending_count;          // Number of pending events
+    uint64_t next_seq;             // Next expected sequence number (masked to the sequence width)
+    bool synced;                   // Whether next_seq is known (set by the first datagram)
+    uint64_t seq_mask;             // 2^(8 * seq_width) - 1: sequence numbers compare modulo this + 1
+    uint64_t gap_timeout_ns;       // How long a hole waits for a late copy
+    udp_mcast_gap_t gaps[UDP_MCAST_MAX_GAPS]; // Open holes, oldest first
+    size_t gap_count;              // Number of open holes
+    uint64_t line_next[UDP_MCAST_MAX_LINES]; // One past the highest sequence number seen per line
+    bool line_seen[UDP_MCAST_MAX_LINES];     // Whether the line delivered anything since the last sync
+    vma_wait_mode_t wait_mode;     // Wait policy (derived from vma_options)
+    vma_wait_stats_t wait_stats;   // Spin hits vs. blocking wakeups
+    udp_mcast_stats_t stats;       // Arbitration counters
+} udp_mcast_receiver_t;
+
+/**
+ * Initialize a multicast feed receiver
+ *
+ * @param rx Pointer to the receiver structure to initialize
+ * @param options VMA options used for every line (use default if NULL)
+ * @param config Sequence number location and buffer layout
+ * @return Result code
+ */
+udp_result_t udp_mcast_init(udp_mcast_receiver_t* rx, const vma_options_t* options,
+                            const udp_mcast_config_t* config);
+
+/**
+ * Close all lines and release the receiver
+ *
+ * @param rx Pointer to the receiver structure
+ * @return Result code
+ */
+udp_result_t udp_mcast_close(udp_mcast_receiver_t* rx);
+
+/**
+ * Add a line: create a socket, bind it to the group and join it
+ *
+ * The socket uses VMA's ring-per-interface allocation, so lines joined on the
+ * same interface share one receive ring.
+ *
+ * @param rx Pointer to the receiver structure
+ * @param group_ip Multicast group address
+ * @param port Group port
+ * @param interface_ip Local interface address to join on (INADDR_ANY if NULL)
+ * @param source_ip Source for a source-specific join (any-source if NULL)
+ * @return Result code
+ */
+udp_result_t udp_mcast_add_line(udp_mcast_receiver_t* rx, const char* group_ip, uint16_t port,
+                                const char* interface_ip, const char* source_ip);
+
+/**
+ * Receive arbitrated events from all lines
+ *
+ * Drains every line without blocking, orders what arrived by sequence number
+ * and keeps the first copy of each. A hole is held open until every line has
+ * moved past it or gap_timeout_us expires, and only then reported as a GAP
+ * event; a copy that fills it in the meantime is delivered late (out of
+ * order). Sequence numbers compare modulo 2^(8 * seq_width), so the feed's
+ * counter may wrap.
+ *
+ * @param rx Pointer to the receiver structure
+ * @param events Output event array
+ * @param max_events Size of the event array
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of events stored (can be NULL)
+ * @return Result code (UDP_ERROR_TIMEOUT if nothing arrived)
+ */
+udp_result_t udp_mcast_recv(udp_mcast_receiver_t* rx, udp_mcast_event_t* events, size_t max_events,
+                            int timeout_ms, size_t* n);
+
+/**
+ * Arbitrate datagrams read by the caller and report holes that are due
+ *
+ * udp_mcast_recv calls this for every drain; it is exposed for feeds that read
+ * their lines themselves. Events are queued on the receiver and returned by
+ * the next udp_mcast_recv calls. A line counts towards closing a hole once it
+ * was added or has delivered a datagram.
+ *
+ * @param rx Pointer to the receiver structure
+ * @param arrivals Datagrams read (sorted in place; data must stay valid until its event is returned)
+ * @param count Number of datagrams (at most UDP_MCAST_MAX_LINES x batch)
+ * @param now_ns Current vma_clock_ns time
+ * @return Result code (UDP_ERROR_NO_BUFFERS if the queued events leave no room)
+ */
+udp_result_t udp_mcast_arbitrate(udp_mcast_receiver_t* rx, udp_mcast_arrival_t* arrivals, size_t count,
+                                 uint64_t now_ns);
+
+/**
+ * Resynchronize on the next datagram (e.g. after a feed restart or recovery)
+ *
+ * @param rx Pointer to the receiver structure
+ * @return Result code
+ */
+udp_result_t udp_mcast_reset(udp_mcast_receiver_t* rx);
+
+/**
+ * Get arbitration counters
+ *
+ * @param rx Pointer to the receiver structure
+ * @param stats Destination
+ * @return Result code
+ */
+udp_result_t udp_mcast_get_stats(const udp_mcast_receiver_t* rx, udp_mcast_stats_t* stats);
+
+#endif /* UDP_MCAST_RECEIVER_H */
@@ -0,0 +1,542 @@
+/**
+ * udp_pacer.c - Token-bucket paced send queue for a UDP socket
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <linux/net_tstamp.h>
+#include "udp_pacer.h"
+#include "vma_trace.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PACER_HAVE_PAUSE 1
+#endif
+
+// Fallbacks for headers that predate these options (values from asm-generic/socket.h)
+#ifndef SO_MAX_PACING_RATE
+#define SO_MAX_PACING_RATE 47
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+#ifndef CLOCK_TAI
+#define CLOCK_TAI 11
+#endif
+
+#define DEFAULT_CAPACITY 1024
+#define DEFAULT_MAX_DATAGRAM 1472
+#define DEFAULT_BATCH 8
+#define DEFAULT_HORIZON_US 200
+#define SLOT_ALIGN 64
+#define MAX_DATAGRAM 65507
+
+// udp_pacer_drain sleeps through waits longer than this and spins through shorter ones
+#define DRAIN_SPIN_NS 50000ULL
+
+static uint32_t round_up_pow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Nanoseconds per unit at rate units per second, in 32.32 fixed point
+static uint64_t fixed_ns_per(uint64_t rate) {
+    uint64_t fixed = (uint64_t)(((unsigned __int128)1000000000ULL << 32) / rate);
+    return fixed > 0 ? fixed : 1;
+}
+
+static inline uint64_t cost_ns(uint64_t fixed, uint64_t units) {
+    return (uint64_t)(((unsigned __int128)fixed * units) >> 32);
+}
+
+void udp_pacer_bucket_configure(udp_pacer_bucket_t* bucket, const udp_pacer_limit_t* limit, size_t max_datagram) {
+    bucket->ns_per_byte = 0;
+    bucket->ns_per_packet = 0;
+    bucket->byte_burst_ns = 0;
+    bucket->packet_burst_ns = 0;
+    if (!limit) {
+        return;
+    }
+
+    if (limit->bytes_per_sec > 0) {
+        // A burst below one datagram would hold the largest ones forever
+        uint64_t burst = limit->burst_bytes > max_datagram ? limit->burst_bytes : max_datagram;
+        bucket->ns_per_byte = fixed_ns_per(limit->bytes_per_sec);
+        bucket->byte_burst_ns = cost_ns(bucket->ns_per_byte, burst);
+    }
+    if (limit->packets_per_sec > 0) {
+        uint64_t burst = limit->burst_packets > 0 ? limit->burst_packets : 1;
+        bucket->ns_per_packet = fixed_ns_per(limit->packets_per_sec);
+        bucket->packet_burst_ns = cost_ns(bucket->ns_per_packet, burst);
+    }
+}
+
+uint64_t udp_pacer_bucket_due(const udp_pacer_bucket_t* bucket, size_t length) {
+    uint64_t due = 0;
+    if (bucket->ns_per_byte) {
+        uint64_t full = bucket->byte_tat + cost_ns(bucket->ns_per_byte, length);
+        due = full > bucket->byte_burst_ns ? full - bucket->byte_burst_ns : 0;
+    }
+    if (bucket->ns_per_packet) {
+        uint64_t full = bucket->packet_tat + cost_ns(bucket->ns_per_packet, 1);
+        uint64_t packet_due = full > bucket->packet_burst_ns ? full - bucket->packet_burst_ns : 0;
+        if (packet_due > due) {
+            due = packet_due;
+        }
+    }
+    return due;
+}
+
+void udp_pacer_bucket_charge(udp_pacer_bucket_t* bucket, size_t length, uint64_t at) {
+    if (bucket->ns_per_byte) {
+        bucket->byte_tat = (bucket->byte_tat > at ? bucket->byte_tat : at) + cost_ns(bucket->ns_per_byte, length);
+    }
+    if (bucket->ns_per_packet) {
+        bucket->packet_tat = (bucket->packet_tat > at ? bucket->packet_tat : at) + cost_ns(bucket->ns_per_packet, 1);
+    }
+}
+
+// Time the next datagram of a non-empty lane is due under both its and the socket-wide bucket
+static inline uint64_t lane_due(const udp_pacer_t* pacer, const udp_pacer_lane_t* lane, uint64_t position) {
+    size_t length = lane->lengths[position & pacer->mask];
+    uint64_t due = udp_pacer_bucket_due(&lane->bucket, length);
+    uint64_t socket_due = udp_pacer_bucket_due(&pacer->bucket, length);
+    return due > socket_due ? due : socket_due;
+}
+
+// Set SO_MAX_PACING_RATE (bytes per second, 0 for unlimited); the u32 form is understood by the kernel and VMA
+static bool set_pacing_rate(int fd, uint64_t bytes_per_sec) {
+    uint32_t rate = UINT32_MAX;
+    if (bytes_per_sec > 0) {
+        rate = bytes_per_sec >= UINT32_MAX ? UINT32_MAX - 1 : (uint32_t)bytes_per_sec;
+    }
+    return setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0;
+}
+
+static void free_lane(udp_pacer_lane_t* lane) {
+    free(lane->payloads);
+    free(lane->lengths);
+    free(lane->enqueued_at);
+    memset(lane, 0, sizeof(udp_pacer_lane_t));
+}
+
+static udp_result_t add_lane(udp_pacer_t* pacer, const udp_endpoint_t* endpoint,
+                            const udp_pacer_limit_t* limit, uint32_t* index) {
+    if (pacer->lane_count == UDP_PACER_MAX_LANES) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    udp_pacer_lane_t* lane = &pacer->lanes[pacer->lane_count];
+    size_t payload_size = (size_t)pacer->capacity * pacer->stride;
+    bool allocated = posix_memalign((void**)&lane->payloads, SLOT_ALIGN, payload_size) == 0;
+    lane->lengths = calloc(pacer->capacity, sizeof(uint32_t));
+    lane->enqueued_at = calloc(pacer->capacity, sizeof(uint64_t));
+    if (!allocated || !lane->lengths || !lane->enqueued_at) {
+        free_lane(lane);
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    // Fault in every page now so enqueue never takes a page fault
+    memset(lane->payloads, 0, payload_size);
+
+    lane->connected = endpoint == NULL;
+    if (endpoint) {
+        lane->endpoint = *endpoint;
+    }
+    udp_pacer_bucket_configure(&lane->bucket, limit, pacer->max_datagram);
+
+    if (index) {
+        *index = pacer->lane_count;
+    }
+    pacer->lane_count++;
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_pacer_init(udp_pacer_t* pacer, udp_socket_t* socket, const udp_pacer_config_t* config) {
+    if (!pacer || !socket || socket->socket_fd < 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    udp_pacer_config_t defaults;
+    if (!config) {
+        memset(&defaults, 0, sizeof(defaults));
+        config = &defaults;
+    }
+    if (config->capacity > (1u << 31) || config->max_datagram > MAX_DATAGRAM) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    vma_clock_init();
+
+    memset(pacer, 0, sizeof(udp_pacer_t));
+    pacer->capacity = round_up_pow2(config->capacity > 0 ? config->capacity : DEFAULT_CAPACITY);
+    pacer->mask = pacer->capacity - 1;
+    pacer->batch = config->batch > 0 ? config->batch : DEFAULT_BATCH;
+    if (pacer->batch > UDP_MAX_BATCH) {
+        pacer->batch = UDP_MAX_BATCH;
+    }
+    pacer->max_datagram = config->max_datagram > 0 ? config->max_datagram : DEFAULT_MAX_DATAGRAM;
+    pacer->stride = (pacer->max_datagram + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+    pacer->socket_fd = socket->socket_fd;
+    udp_pacer_bucket_configure(&pacer->bucket, &config->limit, pacer->max_datagram);
+
+    pacer->lanes = calloc(UDP_PACER_MAX_LANES, sizeof(udp_pacer_lane_t));
+    if (!pacer->lanes || add_lane(pacer, NULL, NULL, NULL) != UDP_SUCCESS) {
+        udp_pacer_close(pacer);
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    // Optional offloads; without them the buckets alone pace the sends
+    if (config->use_txtime) {
+        struct sock_txtime txtime;
+        memset(&txtime, 0, sizeof(txtime));
+        txtime.clockid = config->txtime_tai ? CLOCK_TAI : CLOCK_MONOTONIC;
+        if (setsockopt(socket->socket_fd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == 0) {
+            uint32_t horizon_us = config->txtime_horizon_us > 0 ? config->txtime_horizon_us : DEFAULT_HORIZON_US;
+            pacer->txtime_clock = txtime.clockid;
+            pacer->horizon_ns = (uint64_t)horizon_us * 1000ULL;
+            pacer->stats.txtime_active = true;
+        }
+    }
+    if (config->use_pacing_rate && config->limit.bytes_per_sec > 0) {
+        pacer->stats.pacing_rate_active = set_pacing_rate(socket->socket_fd, config->limit.bytes_per_sec);
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_pacer_close(udp_pacer_t* pacer) {
+    if (!pacer) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (pacer->lanes) {
+        for (uint32_t i = 0; i < pacer->lane_count; i++) {
+            free_lane(&pacer->lanes[i]);
+        }
+        free(pacer->lanes);
+    }
+    memset(pacer, 0, sizeof(udp_pacer_t));
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_pacer_add_endpoint(udp_pacer_t* pacer, const udp_endpoint_t* endpoint,
+                                const udp_pacer_limit_t* limit, uint32_t* lane) {
+    if (!pacer || !pacer->lanes || !endpoint) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    return add_lane(pacer, endpoint, limit, lane);
+}
+
+udp_result_t udp_pacer_set_limit(udp_pacer_t* pacer, uint32_t lane, const udp_pacer_limit_t* limit) {
+    if (!pacer || !pacer->lanes) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (lane == UDP_PACER_SOCKET_LIMIT) {
+        udp_pacer_bucket_configure(&pacer->bucket, limit, pacer->max_datagram);
+        if (pacer->stats.pacing_rate_active &&
+            !set_pacing_rate(pacer->socket_fd, limit ? limit->bytes_per_sec : 0)) {
+            return UDP_ERROR_SOCKET_OPTION;
+        }
+        return UDP_SUCCESS;
+    }
+
+    if (lane >= pacer->lane_count) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    udp_pacer_bucket_configure(&pacer->lanes[lane].bucket, limit, pacer->max_datagram);
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_pacer_enqueue(udp_pacer_t* pacer, uint32_t lane, const void* data, size_t length) {
+    if (!pacer || !pacer->lanes || lane >= pacer->lane_count || (!data && length > 0) ||
+        length > pacer->max_datagram) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    udp_pacer_lane_t* queue = &pacer->lanes[lane];
+    if (queue->tail - queue->head == pacer->capacity) {
+        pacer->stats.dropped++;
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    uint64_t slot = queue->tail & pacer->mask;
+    if (length > 0) {
+        memcpy(queue->payloads + slot * pacer->stride, data, length);
+    }
+    queue->lengths[slot] = (uint32_t)length;
+    queue->enqueued_at[slot] = vma_clock_ns();
+    queue->tail++;
+
+    pacer->stats.enqueued++;
+    pacer->stats.depth++;
+    pacer->stats.depth_bytes += length;
+    if (pacer->stats.depth > pacer->stats.max_depth) {
+        pacer->stats.max_depth = pacer->stats.depth;
+    }
+
+    return UDP_SUCCESS;
+}
+
+// Earliest due time over the non-empty lanes, no earlier than now (0 when all are empty)
+static uint64_t next_due(const udp_pacer_t* pacer, uint64_t now) {
+    if (pacer->stats.depth == 0) {
+        return 0;
+    }
+
+    uint64_t earliest = UINT64_MAX;
+    for (uint32_t i = 0; i < pacer->lane_count; i++) {
+        const udp_pacer_lane_t* lane = &pacer->lanes[i];
+        if (lane->head != lane->tail) {
+            uint64_t due = lane_due(pacer, lane, lane->head);
+            if (due < earliest) {
+                earliest = due;
+            }
+        }
+    }
+
+    return earliest > now ? earliest : now;
+}
+
+// Remove the head datagram of a lane
+static void pop_head(udp_pacer_t* pacer, udp_pacer_lane_t* lane) {
+    pacer->stats.depth--;
+    pacer->stats.depth_bytes -= lane->lengths[lane->head & pacer->mask];
+    lane->head++;
+}
+
+udp_result_t udp_pacer_flush(udp_pacer_t* pacer, udp_socket_t* socket, size_t* sent, uint64_t* next_due_ns) {
+    return udp_pacer_flush_at(pacer, socket, vma_clock_ns(), sent, next_due_ns);
+}
+
+udp_result_t udp_pacer_flush_at(udp_pacer_t* pacer, udp_socket_t* socket, uint64_t now, size_t* sent,
+                                uint64_t* next_due_ns) {
+    if (sent) {
+        *sent = 0;
+    }
+    if (next_due_ns) {
+        *next_due_ns = 0;
+    }
+
+    if (!pacer || !pacer->lanes || !socket || socket->socket_fd < 0 || socket->socket_fd != pacer->socket_fd) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    if (pacer->stats.depth == 0) {
+        return UDP_SUCCESS;
+    }
+
+    struct mmsghdr hdrs[UDP_MAX_BATCH];
+    struct iovec iovs[UDP_MAX_BATCH];
+    union {
+        char buf[CMSG_SPACE(sizeof(uint64_t))];
+        struct cmsghdr align;
+    } control[UDP_MAX_BATCH];
+    uint32_t lane_of[UDP_MAX_BATCH];
+    uint64_t leave_at[UDP_MAX_BATCH];
+    uint32_t taken[UDP_PACER_MAX_LANES] = {0};
+    bool held[UDP_PACER_MAX_LANES] = {false};
+    udp_pacer_bucket_t saved_lanes[UDP_PACER_MAX_LANES];
+    udp_pacer_bucket_t saved_socket = pacer->bucket;
+    VMA_TRACE_BEGIN(trace);
+
+    uint64_t release_until = now + pacer->horizon_ns;
+    uint64_t txtime_now = 0;
+    if (pacer->horizon_ns > 0) {
+        struct timespec ts;
+        clock_gettime(pacer->txtime_clock, &ts);
+        txtime_now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    // Lanes take turns, one datagram each per pass, until the batch is full or nothing is due
+    size_t count = 0;
+    bool progress = true;
+    while (count < pacer->batch && progress) {
+        progress = false;
+        for (uint32_t i = 0; i < pacer->lane_count && count < pacer->batch; i++) {
+            uint32_t index = (pacer->next_lane + i) % pacer->lane_count;
+            udp_pacer_lane_t* lane = &pacer->lanes[index];
+            uint64_t position = lane->head + taken[index];
+            if (held[index] || position == lane->tail) {
+                continue;
+            }
+
+            uint64_t due = lane_due(pacer, lane, position);
+            if (due > release_until) {
+                held[index] = true;
+                pacer->stats.throttled++;
+                continue;
+            }
+
+            uint64_t at = due > now ? due : now;
+            uint64_t slot = position & pacer->mask;
+            size_t length = lane->lengths[slot];
+            if (taken[index] == 0) {
+                saved_lanes[index] = lane->bucket;
+            }
+            udp_pacer_bucket_charge(&lane->bucket, length, at);
+            udp_pacer_bucket_charge(&pacer->bucket, length, at);
+
+            iovs[count].iov_base = lane->payloads + slot * pacer->stride;
+            iovs[count].iov_len = length;
+
+            struct msghdr* msg = &hdrs[count].msg_hdr;
+            memset(msg, 0, sizeof(*msg));
+            if (!lane->connected) {
+                msg->msg_name = &lane->endpoint.addr;
+                msg->msg_namelen = sizeof(lane->endpoint.addr);
+            }
+            msg->msg_iov = &iovs[count];
+            msg->msg_iovlen = 1;
+
+            if (pacer->horizon_ns > 0) {
+                uint64_t departure = txtime_now + (at - now);
+                msg->msg_control = control[count].buf;
+                msg->msg_controllen = sizeof(control[count].buf);
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_TXTIME;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+                memcpy(CMSG_DATA(cmsg), &departure, sizeof(departure));
+            }
+
+            lane_of[count] = index;
+            leave_at[count] = at;
+            taken[index]++;
+            count++;
+            progress = true;
+        }
+    }
+    pacer->next_lane = (pacer->next_lane + 1) % pacer->lane_count;
+
+    if (count == 0) {
+        if (next_due_ns) {
+            *next_due_ns = next_due(pacer, now);
+        }
+        return UDP_SUCCESS;
+    }
+
+    uint64_t start_ticks = vma_clock_ticks();
+    int res = sendmmsg(socket->socket_fd, hdrs, (unsigned int)count, 0);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+    int last_errno = res < 0 ? errno : 0;
+    size_t done = res > 0 ? (size_t)res : 0;
+
+    // Refund the datagrams the socket did not take
+    if (done < count) {
+        pacer->bucket = saved_socket;
+        for (uint32_t i = 0; i < pacer->lane_count; i++) {
+            if (taken[i] > 0) {
+                pacer->lanes[i].bucket = saved_lanes[i];
+            }
+        }
+        for (size_t i = 0; i < done; i++) {
+            udp_pacer_bucket_charge(&pacer->lanes[lane_of[i]].bucket, iovs[i].iov_len, leave_at[i]);
+            udp_pacer_bucket_charge(&pacer->bucket, iovs[i].iov_len, leave_at[i]);
+        }
+    }
+
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < done; i++) {
+        udp_pacer_lane_t* lane = &pacer->lanes[lane_of[i]];
+        uint64_t queued_at = lane->enqueued_at[lane->head & pacer->mask];
+        uint64_t delay = now > queued_at ? now - queued_at : 0;
+        pacer->stats.total_delay_ns += delay;
+        if (delay > pacer->stats.max_delay_ns) {
+            pacer->stats.max_delay_ns = delay;
+        }
+        total_bytes += iovs[i].iov_len;
+        pop_head(pacer, lane);
+    }
+    pacer->stats.sent += done;
+    pacer->stats.sent_bytes += total_bytes;
+
+    if (sent) {
+        *sent = done;
+    }
+
+    udp_result_t result = UDP_SUCCESS;
+    if (done > 0) {
+        vma_stats_tx(socket->stats, done, total_bytes, vma_clock_ticks() - start_ticks);
+    } else {
+        bool blocked = (last_errno == EAGAIN || last_errno == EWOULDBLOCK);
+        vma_stats_tx_miss(socket->stats, blocked);
+        if (blocked) {
+            result = UDP_ERROR_TIMEOUT;
+        } else {
+            // Discard the refused datagram so its lane does not stall the others
+            pop_head(pacer, &pacer->lanes[lane_of[0]]);
+            pacer->stats.send_errors++;
+            result = UDP_ERROR_SEND;
+        }
+    }
+
+    if (next_due_ns) {
+        *next_due_ns = next_due(pacer, now);
+    }
+
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_PACER_FLUSH, socket->socket_fd, result, done);
+}
+
+udp_result_t udp_pacer_drain(udp_pacer_t* pacer, udp_socket_t* socket, int timeout_ms) {
+    if (!pacer || !pacer->lanes || !socket) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t deadline = timeout_ms >= 0 ? vma_clock_ns() + (uint64_t)timeout_ms * 1000000ULL : UINT64_MAX;
+
+    while (pacer->stats.depth > 0) {
+        uint64_t due = 0;
+        udp_result_t result = udp_pacer_flush(pacer, socket, NULL, &due);
+        if (result != UDP_SUCCESS && result != UDP_ERROR_TIMEOUT) {
+            return result;
+        }
+        if (pacer->stats.depth == 0) {
+            break;
+        }
+
+        uint64_t now = vma_clock_ns();
+        if (now >= deadline) {
+            return UDP_ERROR_TIMEOUT;
+        }
+
+        if (result == UDP_ERROR_TIMEOUT) {
+            // Socket buffer full
+            sched_yield();
+        } else if (due > now + DRAIN_SPIN_NS) {
+            uint64_t wait = due - now - DRAIN_SPIN_NS / 2;
+            if (wait > deadline - now) {
+                wait = deadline - now;
+            }
+            struct timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+            nanosleep(&ts, NULL);
+        } else {
+#ifdef PACER_HAVE_PAUSE
+            _mm_pause();
+#endif
+        }
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_pacer_get_stats(const udp_pacer_t* pacer, udp_pacer_stats_t* stats) {
+    if (!pacer || !stats) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    *stats = pacer->stats;
+
+    return UDP_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/**
+ * udp_pacer.h - Token-bucket paced send queue for a UDP socket
+ *
+ * Publishers that produce in bursts (a whole book update, a snapshot) can
+ * overrun a receiver's NIC ring or socket buffer even when their average rate
+ * is low. The pacer queues datagrams per destination ("lane") and releases
+ * them in small sendmmsg batches no faster than a byte and/or datagram rate,
+ * allowing at most a configured burst back to back. Rates apply per lane and
+ * socket-wide; the buckets run on the TSC clock (vma_clock_ns).
+ *
+ * With use_txtime, datagrams are handed to the socket up to a short horizon
+ * early, each stamped with its departure time (SO_TXTIME), so an fq or etf
+ * qdisc spaces them instead of the sending thread. With use_pacing_rate the
+ * socket-wide byte rate is also set as SO_MAX_PACING_RATE, which VMA maps to
+ * NIC packet pacing where the adapter supports it. Both fall back to software
+ * pacing when refused.
+ *
+ * A pacer and its socket belong to one thread: enqueue, flush and stats are
+ * not synchronized.
+ */
+
+#ifndef UDP_PACER_H
+#define UDP_PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "udp_socket.h"
+
+// Number of lanes (lane 0 is the socket's connected destination)
+#define UDP_PACER_MAX_LANES 16
+
+// Lane argument to udp_pacer_set_limit for the socket-wide limit
+#define UDP_PACER_SOCKET_LIMIT UINT32_MAX
+
+// Rate limit (a zero rate leaves that dimension unlimited)
+typedef struct {
+    uint64_t bytes_per_sec;        // Payload byte rate
+    uint64_t packets_per_sec;      // Datagram rate
+    uint32_t burst_bytes;          // Bytes that may leave back to back (at least max_datagram; 0 for max_datagram)
+    uint32_t burst_packets;        // Datagrams that may leave back to back (0 for 1)
+} udp_pacer_limit_t;
+
+// Token bucket as generic cell rate algorithm state (vma_clock_ns nanoseconds)
+typedef struct {
+    uint64_t ns_per_byte;          // Cost of a byte in 32.32 fixed point (0 when unlimited)
+    uint64_t ns_per_packet;        // Cost of a datagram in 32.32 fixed point (0 when unlimited)
+    uint64_t byte_burst_ns;        // Byte debt allowed ahead of the clock
+    uint64_t packet_burst_ns;      // Datagram debt allowed ahead of the clock
+    uint64_t byte_tat;             // Time the byte bucket is full again
+    uint64_t packet_tat;           // Time the datagram bucket is full again
+} udp_pacer_bucket_t;
+
+// Per-destination queue
+typedef struct {
+    udp_endpoint_t endpoint;       // Destination (unused by lane 0)
+    bool connected;                // Send to the socket's connected address
+    udp_pacer_bucket_t bucket;     // Lane limit
+    uint8_t* payloads;             // capacity * stride bytes of queued payloads
+    uint32_t* lengths;             // Payload length per slot
+    uint64_t* enqueued_at;         // vma_clock_ns time each slot was queued
+    uint64_t head;                 // Next slot to send
+    uint64_t tail;                 // Next slot to fill
+} udp_pacer_lane_t;
+
+// Pacer configuration
+typedef struct {
+    udp_pacer_limit_t limit;       // Socket-wide limit, applied on top of each lane's own
+    uint32_t capacity;             // Datagrams queued per lane (rounded up to a power of two; 0 for 1024)
+    size_t max_datagram;           // Largest payload accepted (0 for 1472)
+    uint32_t batch;                // Datagrams per sendmmsg (0 for 8; capped at UDP_MAX_BATCH)
+    bool use_txtime;               // Hand datagrams over early with an SO_TXTIME departure time
+    bool txtime_tai;               // Departure times on CLOCK_TAI (etf qdisc) instead of CLOCK_MONOTONIC (fq)
+    uint32_t txtime_horizon_us;    // How early a stamped datagram may be handed over (0 for 200)
+    bool use_pacing_rate;          // Also set SO_MAX_PACING_RATE to the socket-wide byte rate
+} udp_pacer_config_t;
+
+// Pacer counters and queue depth
+typedef struct {
+    uint64_t enqueued;             // Datagrams accepted
+    uint64_t dropped;              // Datagrams refused because their lane was full
+    uint64_t sent;                 // Datagrams handed to the socket
+    uint64_t sent_bytes;           // Payload bytes handed to the socket
+    uint64_t send_errors;          // Datagrams discarded after the socket refused them
+    uint64_t throttled;            // Times a due lane was held back by a bucket
+    uint64_t depth;                // Datagrams queued now
+    uint64_t depth_bytes;          // Payload bytes queued now
+    uint64_t max_depth;            // Highest depth seen
+    uint64_t total_delay_ns;       // Sum of queueing delays of the datagrams sent
+    uint64_t max_delay_ns;         // Longest queueing delay of a datagram sent
+    bool txtime_active;            // SO_TXTIME accepted
+    bool pacing_rate_active;       // SO_MAX_PACING_RATE accepted
+} udp_pacer_stats_t;
+
+// Pacer structure
+typedef struct {
+    udp_pacer_lane_t* lanes;       // UDP_PACER_MAX_LANES lanes, lane_count in use
+    uint32_t lane_count;           // Lanes added so far (lane 0 always exists)
+    uint32_t capacity;             // Slots per lane (power of two)
+    uint32_t mask;                 // capacity - 1
+    uint32_t batch;                // Datagrams per sendmmsg
+    size_t stride;                 // Payload bytes per slot
+    size_t max_datagram;           // Largest payload accepted
+    uint32_t next_lane;            // Lane the next flush starts from (round robin)
+    int socket_fd;                 // Socket the pacer was set up on
+    udp_pacer_bucket_t bucket;     // Socket-wide limit
+    uint64_t horizon_ns;           // SO_TXTIME hand-over horizon (0 without SO_TXTIME)
+    int txtime_clock;              // Clock of the SO_TXTIME departure times
+    udp_pacer_stats_t stats;       // Counters (depth fields kept current)
+} udp_pacer_t;
+
+/**
+ * Create a pacer for a socket and preallocate its queues
+ *
+ * Lane 0 sends to the socket's connected address under the socket-wide limit
+ * only; add lanes for other destinations with udp_pacer_add_endpoint.
+ *
+ * @param pacer Pointer to the pacer structure to initialize
+ * @param socket Socket the pacer sends through (SO_TXTIME/SO_MAX_PACING_RATE are set on it)
+ * @param config Configuration (NULL for unlimited software pacing with defaults)
+ * @return Result code
+ */
+udp_result_t udp_pacer_init(udp_pacer_t* pacer, udp_socket_t* socket, const udp_pacer_config_t* config);
+
+/**
+ * Release a pacer (queued datagrams are discarded)
+ *
+ * @param pacer Pointer to the pacer structure
+ * @return Result code
+ */
+udp_result_t udp_pacer_close(udp_pacer_t* pacer);
+
+/**
+ * Add a lane for a destination
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param endpoint Destination resolved with udp_endpoint_init
+ * @param limit Lane limit (NULL for the socket-wide limit only)
+ * @param lane Index of the new lane (filled on return)
+ * @return Result code (UDP_ERROR_NO_BUFFERS when all lanes are in use)
+ */
+udp_result_t udp_pacer_add_endpoint(udp_pacer_t* pacer, const udp_endpoint_t* endpoint,
+                                const udp_pacer_limit_t* limit, uint32_t* lane);
+
+/**
+ * Change a lane's or the socket-wide limit (queued datagrams keep their place)
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param lane Lane index, or UDP_PACER_SOCKET_LIMIT for the socket-wide limit
+ * @param limit New limit (NULL for unlimited)
+ * @return Result code
+ */
+udp_result_t udp_pacer_set_limit(udp_pacer_t* pacer, uint32_t lane, const udp_pacer_limit_t* limit);
+
+/**
+ * Queue a copy of a datagram on a lane
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param lane Lane index
+ * @param data Data to send
+ * @param length Data length (at most max_datagram)
+ * @return Result code (UDP_ERROR_NO_BUFFERS if the lane is full; the datagram is counted as dropped)
+ */
+udp_result_t udp_pacer_enqueue(udp_pacer_t* pacer, uint32_t lane, const void* data, size_t length);
+
+/**
+ * Send the datagrams that are due, lanes taking turns, one sendmmsg per batch
+ *
+ * Never waits for a bucket: call it again at next_due_ns (or from the
+ * sending thread's loop). A datagram the socket refuses with an error other
+ * than would-block is discarded so one destination cannot stall the rest.
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param socket Socket the pacer was created for
+ * @param sent Number of datagrams sent (can be NULL)
+ * @param next_due_ns vma_clock_ns time the next queued datagram is due, 0 when none is queued (can be NULL)
+ * @return Result code (UDP_SUCCESS also when nothing was due,
+ *         UDP_ERROR_TIMEOUT if the socket buffer was full, UDP_ERROR_SEND on other errors)
+ */
+udp_result_t udp_pacer_flush(udp_pacer_t* pacer, udp_socket_t* socket, size_t* sent, uint64_t* next_due_ns);
+
+/**
+ * Flush at a given time (udp_pacer_flush with an explicit clock)
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param socket Socket the pacer was created for
+ * @param now_ns Current vma_clock_ns time
+ * @param sent Number of datagrams sent (can be NULL)
+ * @param next_due_ns vma_clock_ns time the next queued datagram is due, 0 when none is queued (can be NULL)
+ * @return Result code (as udp_pacer_flush)
+ */
+udp_result_t udp_pacer_flush_at(udp_pacer_t* pacer, udp_socket_t* socket, uint64_t now_ns, size_t* sent,
+                                uint64_t* next_due_ns);
+
+/**
+ * Flush until every queued datagram is sent, waiting for the buckets in between
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param socket Socket the pacer was created for
+ * @param timeout_ms Timeout in milliseconds (-1 for infinite wait)
+ * @return Result code (UDP_ERROR_TIMEOUT if datagrams are still queued at the timeout)
+ */
+udp_result_t udp_pacer_drain(udp_pacer_t* pacer, udp_socket_t* socket, int timeout_ms);
+
+/**
+ * Set the rates of a bucket from a limit, keeping its fill level
+ *
+ * The bucket functions are the pacer's generic cell rate algorithm, exposed
+ * for callers that pace their own sends.
+ *
+ * @param bucket Pointer to the bucket
+ * @param limit Rate limit (NULL for unlimited)
+ * @param max_datagram Largest payload (the smallest byte burst allowed)
+ */
+void udp_pacer_bucket_configure(udp_pacer_bucket_t* bucket, const udp_pacer_limit_t* limit, size_t max_datagram);
+
+/**
+ * Earliest time a datagram conforms to a bucket
+ *
+ * @param bucket Pointer to the bucket
+ * @param length Payload length
+ * @return vma_clock_ns time (0 when the bucket has room at any time)
+ */
+uint64_t udp_pacer_bucket_due(const udp_pacer_bucket_t* bucket, size_t length);
+
+/**
+ * Take a datagram out of a bucket
+ *
+ * @param bucket Pointer to the bucket
+ * @param length Payload length
+ * @param at vma_clock_ns time the datagram leaves
+ */
+void udp_pacer_bucket_charge(udp_pacer_bucket_t* bucket, size_t length, uint64_t at);
+
+/**
+ * Read the counters and queue depth
+ *
+ * @param pacer Pointer to the pacer structure
+ * @param stats Pointer to the structure to fill
+ * @return Result code
+ */
+udp_result_t udp_pacer_get_stats(const udp_pacer_t* pacer, udp_pacer_stats_t* stats);
+
+#endif /* UDP_PACER_H */
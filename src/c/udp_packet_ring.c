@@ -0,0 +1,343 @@
+/**
+ * udp_packet_ring.c - Lock-free SPSC/MPSC datagram handoff ring
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "udp_packet_ring.h"
+
+#define DEFAULT_STRIDE 2048
+#define RING_ALIGN 64
+
+static uint32_t round_up_pow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+udp_result_t udp_packet_ring_init(udp_packet_ring_t* ring, uint32_t capacity, size_t stride, udp_ring_mode_t mode) {
+    if (!ring || capacity == 0 || capacity > (1u << 31) ||
+        (mode != UDP_RING_SPSC && mode != UDP_RING_MPSC)) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    memset(ring, 0, sizeof(udp_packet_ring_t));
+    ring->capacity = round_up_pow2(capacity);
+    ring->mask = ring->capacity - 1;
+    ring->stride = ((stride > 0 ? stride : DEFAULT_STRIDE) + RING_ALIGN - 1) & ~(size_t)(RING_ALIGN - 1);
+    ring->mode = mode;
+
+    size_t payload_size = (size_t)ring->capacity * ring->stride;
+    bool allocated = posix_memalign((void**)&ring->payloads, RING_ALIGN, payload_size) == 0 &&
+                    posix_memalign((void**)&ring->packets, RING_ALIGN, ring->capacity * sizeof(udp_packet_t)) == 0;
+    if (allocated && mode == UDP_RING_MPSC) {
+        ring->sequences = calloc(ring->capacity, sizeof(uint64_t));
+        allocated = ring->sequences != NULL;
+    }
+    if (allocated && mode == UDP_RING_SPSC) {
+        ring->packet_ids = calloc(ring->capacity, sizeof(void*));
+        allocated = ring->packet_ids != NULL;
+    }
+    if (!allocated) {
+        udp_packet_ring_close(ring);
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    // Fault in every page now so the receive thread never takes a page fault
+    memset(ring->payloads, 0, payload_size);
+    memset(ring->packets, 0, ring->capacity * sizeof(udp_packet_t));
+
+    return UDP_SUCCESS;
+}
+
+// Return the VMA buffers of zero-copy slots below position end
+static udp_result_t reclaim_until(udp_packet_ring_t* ring, uint64_t end) {
+    if (!ring->zcopy_socket) {
+        ring->reclaimed = end;
+        return UDP_SUCCESS;
+    }
+
+    udp_zcopy_packet_t release[UDP_MAX_BATCH];
+    size_t pending = 0;
+    udp_result_t result = UDP_SUCCESS;
+
+    for (; ring->reclaimed < end; ring->reclaimed++) {
+        void** id = &ring->packet_ids[ring->reclaimed & ring->mask];
+        if (!*id) {
+            continue;
+        }
+        release[pending++].packet_id = *id;
+        *id = NULL;
+
+        if (pending == UDP_MAX_BATCH) {
+            if (udp_socket_release_packets(ring->zcopy_socket, release, pending) != UDP_SUCCESS) {
+                result = UDP_ERROR_RECV;
+            }
+            pending = 0;
+        }
+    }
+
+    if (pending > 0 && udp_socket_release_packets(ring->zcopy_socket, release, pending) != UDP_SUCCESS) {
+        result = UDP_ERROR_RECV;
+    }
+
+    return result;
+}
+
+udp_result_t udp_packet_ring_close(udp_packet_ring_t* ring) {
+    if (!ring) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    // Hand back everything still held, consumed or not
+    if (ring->packet_ids) {
+        reclaim_until(ring, ring->tail);
+    }
+
+    free(ring->payloads);
+    free(ring->packets);
+    free(ring->sequences);
+    free(ring->packet_ids);
+    memset(ring, 0, sizeof(udp_packet_ring_t));
+
+    return UDP_SUCCESS;
+}
+
+// Claim up to want contiguous free slots; returns the count and the first position
+static size_t claim(udp_packet_ring_t* ring, size_t want, uint64_t* start) {
+    if (ring->mode == UDP_RING_SPSC) {
+        uint64_t pos = ring->tail;
+        if (ring->capacity - (pos - ring->head_cache) < want) {
+            ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            reclaim_until(ring, ring->head_cache);
+        }
+        size_t free_slots = ring->capacity - (pos - ring->head_cache);
+        size_t contiguous = ring->capacity - (pos & ring->mask);
+        size_t count = want < free_slots ? want : free_slots;
+        *start = pos;
+        return count < contiguous ? count : contiguous;
+    }
+
+    uint64_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        size_t free_slots = ring->capacity - (pos - head);
+        size_t contiguous = ring->capacity - (pos & ring->mask);
+        size_t count = want < free_slots ? want : free_slots;
+        count = count < contiguous ? count : contiguous;
+        if (count == 0) {
+            *start = pos;
+            return 0;
+        }
+        if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + count, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *start = pos;
+            return count;
+        }
+    }
+}
+
+// Make the first filled of claimed slots readable; MPSC publishes the rest as skip slots
+// unless no other producer has claimed after them
+static void publish(udp_packet_ring_t* ring, uint64_t start, size_t claimed, size_t filled) {
+    if (ring->mode == UDP_RING_SPSC) {
+        __atomic_store_n(&ring->tail, start + filled, __ATOMIC_RELEASE);
+        return;
+    }
+
+    uint64_t end = start + claimed;
+    if (filled < claimed && __atomic_compare_exchange_n(&ring->tail, &end, start + filled, false,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        claimed = filled;
+    }
+
+    for (size_t i = 0; i < claimed; i++) {
+        uint32_t slot = (start + i) & ring->mask;
+        if (i >= filled) {
+            ring->packets[slot].data = NULL;
+            ring->packets[slot].length = 0;
+        }
+        __atomic_store_n(&ring->sequences[slot], start + i + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static size_t claim_or_count_full(udp_packet_ring_t* ring, size_t want, uint64_t* start) {
+    size_t claimed = claim(ring, want, start);
+    if (claimed == 0) {
+        __atomic_fetch_add(&ring->full, 1, __ATOMIC_RELAXED);
+    }
+    return claimed;
+}
+
+udp_result_t udp_packet_ring_fill(udp_packet_ring_t* ring, udp_socket_t* socket, size_t max,
+                                int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!ring || !ring->packets || !socket || max == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t start;
+    size_t claimed = claim_or_count_full(ring, max < UDP_MAX_BATCH ? max : UDP_MAX_BATCH, &start);
+    if (claimed == 0) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    // Claimed slots hold no VMA buffer: anything they held was reclaimed before the claim
+    uint32_t first = start & ring->mask;
+    size_t received = 0;
+    udp_result_t result = udp_socket_recv_batch(socket, &ring->packets[first],
+                                                ring->payloads + (size_t)first * ring->stride,
+                                                ring->stride, claimed, timeout_ms, &received);
+
+    publish(ring, start, claimed, received);
+
+    if (n) {
+        *n = received;
+    }
+
+    return result;
+}
+
+udp_result_t udp_packet_ring_fill_zcopy(udp_packet_ring_t* ring, udp_socket_t* socket, size_t max,
+                                    int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!ring || !ring->packets || !socket || max == 0 || ring->mode != UDP_RING_SPSC ||
+        (ring->zcopy_socket && ring->zcopy_socket != socket)) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    // Hand consumed VMA buffers back first so VMA's receive ring is not starved
+    ring->zcopy_socket = socket;
+    udp_packet_ring_reclaim(ring);
+
+    uint64_t start;
+    size_t claimed = claim_or_count_full(ring, max < UDP_MAX_BATCH ? max : UDP_MAX_BATCH, &start);
+    if (claimed == 0) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    udp_result_t result = UDP_SUCCESS;
+    size_t received = 0;
+    while (received < claimed) {
+        uint32_t slot = (start + received) & ring->mask;
+        udp_zcopy_packet_t zpkt;
+        result = udp_socket_recv_zcopy(socket, &zpkt, ring->payloads + (size_t)slot * ring->stride,
+                                    ring->stride, received == 0 ? timeout_ms : 0);
+        if (result != UDP_SUCCESS) {
+            break;
+        }
+        ring->packets[slot] = zpkt.packet;
+        ring->packet_ids[slot] = zpkt.packet_id;
+        received++;
+    }
+
+    // A drained socket after the first datagram is not an error
+    if (received > 0 && result == UDP_ERROR_TIMEOUT) {
+        result = UDP_SUCCESS;
+    }
+
+    publish(ring, start, claimed, received);
+
+    if (n) {
+        *n = received;
+    }
+
+    return result;
+}
+
+udp_result_t udp_packet_ring_push(udp_packet_ring_t* ring, const void* data, size_t length,
+                                const struct sockaddr_in* src_addr, uint64_t timestamp,
+                                udp_timestamp_source_t source) {
+    if (!ring || !ring->packets || (!data && length > 0) || length > ring->stride) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t start;
+    if (claim_or_count_full(ring, 1, &start) == 0) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+
+    uint32_t slot = start & ring->mask;
+    udp_packet_t* packet = &ring->packets[slot];
+    packet->data = ring->payloads + (size_t)slot * ring->stride;
+    packet->length = length;
+    if (length > 0) {
+        memcpy(packet->data, data, length);
+    }
+    if (src_addr) {
+        packet->src_addr = *src_addr;
+    } else {
+        memset(&packet->src_addr, 0, sizeof(packet->src_addr));
+    }
+    packet->timestamp = timestamp;
+    packet->timestamp_source = source;
+    if (ring->packet_ids) {
+        ring->packet_ids[slot] = NULL;
+    }
+
+    publish(ring, start, 1, 1);
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_packet_ring_reclaim(udp_packet_ring_t* ring) {
+    if (!ring || ring->mode != UDP_RING_SPSC) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return reclaim_until(ring, ring->head_cache);
+}
+
+size_t udp_packet_ring_peek(udp_packet_ring_t* ring, size_t max, const udp_packet_t** packets) {
+    if (!ring || !ring->packets || !packets) {
+        return 0;
+    }
+
+    uint64_t pos = ring->head;
+    size_t contiguous = ring->capacity - (pos & ring->mask);
+    if (max > contiguous) {
+        max = contiguous;
+    }
+
+    size_t ready = 0;
+    if (ring->mode == UDP_RING_SPSC) {
+        ready = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - pos;
+        if (ready > max) {
+            ready = max;
+        }
+    } else {
+        while (ready < max &&
+            __atomic_load_n(&ring->sequences[(pos + ready) & ring->mask], __ATOMIC_ACQUIRE) == pos + ready + 1) {
+            ready++;
+        }
+    }
+
+    *packets = &ring->packets[pos & ring->mask];
+    return ready;
+}
+
+void udp_packet_ring_release(udp_packet_ring_t* ring, size_t count) {
+    if (!ring || count == 0) {
+        return;
+    }
+
+    __atomic_store_n(&ring->head, ring->head + count, __ATOMIC_RELEASE);
+}
+
+size_t udp_packet_ring_size(const udp_packet_ring_t* ring) {
+    if (!ring) {
+        return 0;
+    }
+
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return tail > head ? (size_t)(tail - head) : 0;
+}
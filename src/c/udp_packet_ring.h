@@ -0,0 +1,152 @@
+/**
+ * udp_packet_ring.h - Lock-free SPSC/MPSC datagram handoff ring
+ *
+ * A receive thread fills ring slots straight from the socket (recvmmsg or
+ * VMA zero-copy) and a consumer thread reads them in place, releasing whole
+ * batches with a single store. Slot descriptors are udp_packet_t, so a batch
+ * of ready slots is a plain contiguous packet array.
+ */
+
+#ifndef UDP_PACKET_RING_H
+#define UDP_PACKET_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "udp_socket.h"
+
+// Padding between the producer and consumer fields (at least one cache line)
+#define UDP_RING_PAD 64
+
+// Producer model
+typedef enum {
+    UDP_RING_SPSC = 0,             // One producer thread (supports zero-copy fills)
+    UDP_RING_MPSC = 1              // Any number of producer threads
+} udp_ring_mode_t;
+
+// Ring structure (one consumer thread; producers as selected by mode)
+typedef struct {
+    udp_packet_t* packets;         // Slot descriptors (data is NULL for a slot to skip)
+    uint8_t* payloads;             // capacity * stride bytes of slot payload storage
+    uint64_t* sequences;           // Per-slot publish sequence (MPSC only)
+    void** packet_ids;             // VMA packet id held by each zero-copy slot (SPSC only)
+    uint32_t capacity;             // Number of slots (power of two)
+    uint32_t mask;                 // capacity - 1
+    size_t stride;                 // Payload bytes per slot (maximum datagram size)
+    udp_ring_mode_t mode;          // Producer model
+    uint8_t pad0[UDP_RING_PAD];
+    uint64_t tail;                 // Next position to claim; SPSC: also the publish point (atomic)
+    uint64_t head_cache;           // SPSC producer's last view of head
+    uint64_t reclaimed;            // Zero-copy slots returned to VMA below this position (SPSC)
+    uint64_t full;                 // Fills and pushes that found the ring full (atomic)
+    udp_socket_t* zcopy_socket;    // Socket the zero-copy slots came from
+    uint8_t pad1[UDP_RING_PAD];
+    uint64_t head;                 // Slots below this position are free (written by the consumer, atomic)
+    uint8_t pad2[UDP_RING_PAD];
+} udp_packet_ring_t;
+
+/**
+ * Create a ring and fault in its memory
+ *
+ * @param ring Pointer to the ring structure to initialize
+ * @param capacity Number of slots (rounded up to a power of two)
+ * @param stride Payload bytes per slot (0 for 2048)
+ * @param mode Producer model
+ * @return Result code
+ */
+udp_result_t udp_packet_ring_init(udp_packet_ring_t* ring, uint32_t capacity, size_t stride, udp_ring_mode_t mode);
+
+/**
+ * Release a ring
+ *
+ * Zero-copy slots still held are returned to VMA, so the socket they came
+ * from must still be open.
+ *
+ * @param ring Pointer to the ring structure
+ * @return Result code
+ */
+udp_result_t udp_packet_ring_close(udp_packet_ring_t* ring);
+
+/**
+ * Receive up to max datagrams from a socket straight into free slots (recvmmsg)
+ *
+ * @param ring Pointer to the ring structure
+ * @param socket Socket to receive from
+ * @param max Maximum number of datagrams (capped at UDP_MAX_BATCH)
+ * @param timeout_ms Timeout in milliseconds for the first datagram (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of datagrams published (can be NULL)
+ * @return Result code (UDP_ERROR_NO_BUFFERS if the ring is full; nothing is read from the socket)
+ */
+udp_result_t udp_packet_ring_fill(udp_packet_ring_t* ring, udp_socket_t* socket, size_t max,
+                                int timeout_ms, size_t* n);
+
+/**
+ * Receive up to max datagrams without copying them out of VMA's receive ring (SPSC only)
+ *
+ * Slots point into VMA buffers, which are returned to VMA by the producer
+ * once the consumer has released the slots. Datagrams VMA cannot deliver
+ * zero-copy are copied into the slot payload. Always fill from the same socket.
+ *
+ * @param ring Pointer to the ring structure
+ * @param socket Socket to receive from
+ * @param max Maximum number of datagrams (capped at UDP_MAX_BATCH)
+ * @param timeout_ms Timeout in milliseconds for the first datagram (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of datagrams published (can be NULL)
+ * @return Result code
+ */
+udp_result_t udp_packet_ring_fill_zcopy(udp_packet_ring_t* ring, udp_socket_t* socket, size_t max,
+                                    int timeout_ms, size_t* n);
+
+/**
+ * Copy one datagram into a free slot
+ *
+ * @param ring Pointer to the ring structure
+ * @param data Datagram payload
+ * @param length Payload length (at most stride)
+ * @param src_addr Source address (can be NULL)
+ * @param timestamp Receive timestamp in nanoseconds
+ * @param source Clock that produced the timestamp
+ * @return Result code (UDP_ERROR_NO_BUFFERS if the ring is full)
+ */
+udp_result_t udp_packet_ring_push(udp_packet_ring_t* ring, const void* data, size_t length,
+                                const struct sockaddr_in* src_addr, uint64_t timestamp,
+                                udp_timestamp_source_t source);
+
+/**
+ * Return released zero-copy slots to VMA (done by every fill; call when idle)
+ *
+ * @param ring Pointer to the ring structure
+ * @return Result code
+ */
+udp_result_t udp_packet_ring_reclaim(udp_packet_ring_t* ring);
+
+/**
+ * Consumer: find published slots at the read position without taking them
+ *
+ * The returned slots are contiguous and stay valid until released; a batch
+ * stops at the end of the ring, so call again after releasing it.
+ *
+ * @param ring Pointer to the ring structure
+ * @param max Maximum number of slots
+ * @param packets First slot descriptor
+ * @return Number of ready slots (slots with NULL data carry no datagram)
+ */
+size_t udp_packet_ring_peek(udp_packet_ring_t* ring, size_t max, const udp_packet_t** packets);
+
+/**
+ * Consumer: free the first count slots at the read position
+ *
+ * @param ring Pointer to the ring structure
+ * @param count Number of slots (at most what the last peek returned)
+ */
+void udp_packet_ring_release(udp_packet_ring_t* ring, size_t count);
+
+/**
+ * Number of slots published or being filled (approximate from other threads)
+ *
+ * @param ring Pointer to the ring structure
+ * @return Occupied slots
+ */
+size_t udp_packet_ring_size(const udp_packet_ring_t* ring);
+
+#endif /* UDP_PACKET_RING_H */
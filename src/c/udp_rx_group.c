@@ -0,0 +1,256 @@
+/**
+ * udp_rx_group.c - SO_REUSEPORT sharded UDP receiver group
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include "udp_rx_group.h"
+#include <mellanox/vma_extra.h>
+
+// Defaults for zero-valued configuration fields
+#define UDP_RX_GROUP_DEFAULT_STRIDE 2048
+#define UDP_RX_GROUP_DEFAULT_POLL_MS 100
+
+// Attach a classic BPF program selecting the reuseport socket index
+static udp_result_t attach_steering(udp_rx_group_t* group) {
+    if (group->config.steering == UDP_RX_STEER_KERNEL || group->shard_count < 2) {
+        return UDP_SUCCESS;
+    }
+
+    struct sock_filter code[2 * UDP_RX_GROUP_MAX_SHARDS + 3];
+    unsigned short len = 0;
+
+    if (group->config.steering == UDP_RX_STEER_CPU) {
+        // A = cpu; return the shard pinned to that cpu
+        code[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU));
+        for (uint32_t i = 0; i < group->shard_count; i++) {
+            if (group->shards[i].cpu >= 0) {
+                code[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)group->shards[i].cpu, 0, 1);
+                code[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, i);
+            }
+        }
+    } else {
+        // A = rxhash
+        code[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_RXHASH));
+    }
+
+    // return A % shard_count (unpinned CPUs, or the flow hash)
+    code[len++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, group->shard_count);
+    code[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_A, 0);
+
+    struct sock_fprog prog = {
+        .len = len,
+        .filter = code,
+    };
+
+    // The program applies to the whole reuseport group
+    if (setsockopt(group->shards[0].socket.socket_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                &prog, sizeof(prog)) < 0) {
+        return UDP_ERROR_SOCKET_OPTION;
+    }
+
+    return UDP_SUCCESS;
+}
+
+static udp_result_t open_shard(udp_rx_group_t* group, udp_rx_shard_t* shard, const vma_options_t* options,
+                            const char* ip, uint16_t port) {
+    udp_result_t result = udp_socket_init(&shard->socket, options);
+    if (result != UDP_SUCCESS) {
+        return result;
+    }
+
+    int reuse = 1;
+    result = udp_socket_setopt(&shard->socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+
+    if (result == UDP_SUCCESS) {
+        // Give every shard its own VMA ring so the shards never contend on one.
+        // Not fatal without VMA.
+        struct vma_ring_alloc_logic_attr ring_attr;
+        memset(&ring_attr, 0, sizeof(ring_attr));
+        ring_attr.ring_alloc_logic = RING_LOGIC_PER_SOCKET;
+        ring_attr.ingress = 1;
+        ring_attr.comp_mask = VMA_RING_ALLOC_MASK_RING_INGRESS;
+        setsockopt(shard->socket.socket_fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC,
+                &ring_attr, sizeof(ring_attr));
+
+        // Bind order defines the shard's index in the reuseport group
+        result = udp_socket_bind(&shard->socket, ip, port);
+    }
+
+    if (result != UDP_SUCCESS) {
+        udp_socket_close(&shard->socket);
+        return result;
+    }
+
+    shard->group = group;
+    shard->cpu = options->cpu_cores_count > 0 ?
+                options->cpu_cores[shard->index % (uint32_t)options->cpu_cores_count] : -1;
+
+    return UDP_SUCCESS;
+}
+
+static void* shard_main(void* arg) {
+    udp_rx_shard_t* shard = (udp_rx_shard_t*)arg;
+    udp_rx_group_t* group = shard->group;
+
+    if (shard->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    // Allocated after pinning so the pages are local to the shard's core
+    size_t batch = group->config.batch;
+    size_t stride = group->config.stride;
+    udp_packet_t* packets = calloc(batch, sizeof(udp_packet_t));
+    void* buffers = malloc(batch * stride);
+
+    while (packets && buffers && __atomic_load_n(&group->running, __ATOMIC_ACQUIRE)) {
+        size_t received = 0;
+        udp_result_t result = udp_socket_recv_batch(&shard->socket, packets, buffers, stride, batch,
+                                                group->config.poll_timeout_ms, &received);
+        if (result == UDP_SUCCESS && received > 0) {
+            group->callback(shard->index, packets, received, group->context);
+        }
+        // Timeouts just re-check the stop flag; errors are counted in the socket stats
+    }
+
+    free(packets);
+    free(buffers);
+    return NULL;
+}
+
+udp_result_t udp_rx_group_init(udp_rx_group_t* group, const vma_options_t* options,
+                            const udp_rx_group_config_t* config, const char* ip, uint16_t port,
+                            udp_rx_group_callback_t callback, void* context) {
+    if (!group || !config || !callback) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    memset(group, 0, sizeof(udp_rx_group_t));
+
+    vma_options_t shard_options;
+    if (options) {
+        shard_options = *options;
+    } else {
+        set_default_options(&shard_options);
+    }
+
+    group->config = *config;
+    if (group->config.shard_count == 0) {
+        group->config.shard_count = shard_options.cpu_cores_count > 0 ? (uint32_t)shard_options.cpu_cores_count : 1;
+    }
+    if (group->config.shard_count > UDP_RX_GROUP_MAX_SHARDS) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    if (group->config.stride == 0) {
+        group->config.stride = UDP_RX_GROUP_DEFAULT_STRIDE;
+    }
+    if (group->config.batch == 0 || group->config.batch > UDP_MAX_BATCH) {
+        group->config.batch = UDP_MAX_BATCH;
+    }
+    if (group->config.poll_timeout_ms <= 0) {
+        group->config.poll_timeout_ms = UDP_RX_GROUP_DEFAULT_POLL_MS;
+    }
+
+    group->shards = calloc(group->config.shard_count, sizeof(udp_rx_shard_t));
+    if (!group->shards) {
+        return UDP_ERROR_SOCKET_CREATE;
+    }
+
+    group->callback = callback;
+    group->context = context;
+
+    for (uint32_t i = 0; i < group->config.shard_count; i++) {
+        udp_rx_shard_t* shard = &group->shards[i];
+        shard->index = i;
+
+        udp_result_t result = open_shard(group, shard, &shard_options, ip, port);
+        if (result != UDP_SUCCESS) {
+            udp_rx_group_close(group);
+            return result;
+        }
+        group->shard_count++;
+    }
+
+    udp_result_t result = attach_steering(group);
+    if (result != UDP_SUCCESS) {
+        udp_rx_group_close(group);
+        return result;
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_rx_group_start(udp_rx_group_t* group) {
+    if (!group || !group->shards || group->shard_count == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (__atomic_load_n(&group->running, __ATOMIC_ACQUIRE)) {
+        return UDP_SUCCESS;
+    }
+
+    __atomic_store_n(&group->running, 1, __ATOMIC_RELEASE);
+
+    for (uint32_t i = 0; i < group->shard_count; i++) {
+        udp_rx_shard_t* shard = &group->shards[i];
+        if (pthread_create(&shard->thread, NULL, shard_main, shard) != 0) {
+            udp_rx_group_stop(group);
+            return UDP_ERROR_SOCKET_CREATE;
+        }
+        shard->thread_started = true;
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_rx_group_stop(udp_rx_group_t* group) {
+    if (!group) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    __atomic_store_n(&group->running, 0, __ATOMIC_RELEASE);
+
+    for (uint32_t i = 0; i < group->shard_count; i++) {
+        udp_rx_shard_t* shard = &group->shards[i];
+        if (shard->thread_started) {
+            pthread_join(shard->thread, NULL);
+            shard->thread_started = false;
+        }
+    }
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_rx_group_close(udp_rx_group_t* group) {
+    if (!group) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    udp_rx_group_stop(group);
+
+    for (uint32_t i = 0; i < group->shard_count; i++) {
+        udp_socket_close(&group->shards[i].socket);
+    }
+
+    free(group->shards);
+    group->shards = NULL;
+    group->shard_count = 0;
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_rx_group_get_shard_stats(const udp_rx_group_t* group, uint32_t shard,
+                                        vma_stats_values_t* values) {
+    if (!group || !values || shard >= group->shard_count) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    return udp_socket_get_stats_snapshot(&group->shards[shard].socket, values);
+}
@@ -0,0 +1,115 @@
+/**
+ * udp_rx_group.h - SO_REUSEPORT sharded UDP receiver group
+ */
+
+#ifndef UDP_RX_GROUP_H
+#define UDP_RX_GROUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "vma_common.h"
+#include "vma_stats.h"
+#include "udp_socket.h"
+
+// Maximum number of shards in a group
+#define UDP_RX_GROUP_MAX_SHARDS MAX_CPU_CORES
+
+// How datagrams are spread across the shards (kernel receive path)
+typedef enum {
+    UDP_RX_STEER_KERNEL = 0,       // Kernel SO_REUSEPORT hash of the 4-tuple
+    UDP_RX_STEER_FLOW_HASH = 1,    // NIC/kernel flow hash (skb rxhash) modulo shard count
+    UDP_RX_STEER_CPU = 2           // Shard of the CPU that processed the packet
+} udp_rx_steering_t;
+
+// Group configuration
+typedef struct {
+    uint32_t shard_count;          // Number of sockets (0 for one per cpu_cores entry, at least 1)
+    udp_rx_steering_t steering;    // Shard selection policy
+    size_t stride;                 // Buffer slot size per datagram (0 for 2048)
+    size_t batch;                  // Datagrams per receive batch (capped at UDP_MAX_BATCH, 0 for the maximum)
+    int poll_timeout_ms;           // Receive timeout between stop checks (0 for 100)
+} udp_rx_group_config_t;
+
+// Batch callback, invoked on the shard's worker thread (data valid until it returns)
+typedef void (*udp_rx_group_callback_t)(uint32_t shard, const udp_packet_t* packets, size_t count,
+                                        void* context);
+
+struct udp_rx_group;
+
+// Shard: one socket and its worker thread
+typedef struct {
+    udp_socket_t socket;           // SO_REUSEPORT socket with its own VMA ring
+    struct udp_rx_group* group;    // Owning group
+    uint32_t index;                // Shard index (reuseport group order)
+    int cpu;                       // CPU the worker is pinned to (-1 for unpinned)
+    pthread_t thread;              // Worker thread
+    bool thread_started;           // Whether thread is joinable
+} udp_rx_shard_t;
+
+// Receiver group structure
+typedef struct udp_rx_group {
+    udp_rx_shard_t* shards;        // shard_count shards
+    uint32_t shard_count;          // Number of shards
+    udp_rx_group_config_t config;  // Effective configuration
+    udp_rx_group_callback_t callback; // Batch callback
+    void* context;                 // Callback context
+    int running;                   // Workers keep receiving while set (atomic)
+} udp_rx_group_t;
+
+/**
+ * Open the shard sockets and bind them all to the same address
+ *
+ * Worker threads are not started until udp_rx_group_start. Shard i is pinned
+ * to options->cpu_cores[i % cpu_cores_count] when cores are given.
+ *
+ * @param group Pointer to the group structure to initialize
+ * @param options VMA options used for every shard (use default if NULL)
+ * @param config Group configuration
+ * @param ip IP address to bind to (use INADDR_ANY if NULL)
+ * @param port Port to bind to
+ * @param callback Batch callback
+ * @param context Value passed to the callback
+ * @return Result code
+ */
+udp_result_t udp_rx_group_init(udp_rx_group_t* group, const vma_options_t* options,
+                            const udp_rx_group_config_t* config, const char* ip, uint16_t port,
+                            udp_rx_group_callback_t callback, void* context);
+
+/**
+ * Start one worker thread per shard
+ *
+ * @param group Pointer to the group structure
+ * @return Result code
+ */
+udp_result_t udp_rx_group_start(udp_rx_group_t* group);
+
+/**
+ * Stop and join the worker threads (returns within about poll_timeout_ms)
+ *
+ * @param group Pointer to the group structure
+ * @return Result code
+ */
+udp_result_t udp_rx_group_stop(udp_rx_group_t* group);
+
+/**
+ * Stop the workers, close every shard socket and release the group
+ *
+ * @param group Pointer to the group structure
+ * @return Result code
+ */
+udp_result_t udp_rx_group_close(udp_rx_group_t* group);
+
+/**
+ * Take a consistent snapshot of one shard's statistics (any thread)
+ *
+ * @param group Pointer to the group structure
+ * @param shard Shard index
+ * @param values Destination for counters and latency histograms
+ * @return Result code
+ */
+udp_result_t udp_rx_group_get_shard_stats(const udp_rx_group_t* group, uint32_t shard,
+                                        vma_stats_values_t* values);
+
+#endif /* UDP_RX_GROUP_H */
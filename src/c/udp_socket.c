@@ -16,13 +16,178 @@
 #include <signal.h>
 #include <errno.h>
 #include <arpa/inet.h>  // Include for inet_pton
+#include <linux/net_tstamp.h>
+#include <netinet/udp.h>
 #include "udp_socket.h"
 #include "vma_common.h"
+#include "vma_trace.h"
 #include <mellanox/vma_extra.h>
 
-// Fix this function to use the pointer correctly
+// Payload of an SCM_TIMESTAMPING control message (software, legacy, raw hardware)
+typedef struct {
+    struct timespec ts[3];
+} udp_scm_timestamping_t;
+
+// Receive control buffer large enough for SCM_TIMESTAMPING or SCM_TIMESTAMPNS
+// plus the SO_RXQ_OVFL drop count
+typedef union {
+    char buf[CMSG_SPACE(sizeof(udp_scm_timestamping_t)) + CMSG_SPACE(sizeof(uint32_t))];
+    struct cmsghdr align;
+} udp_ts_control_t;
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// Receive control buffer for a coalesced receive: timestamps, drop count and UDP_GRO segment size
+typedef union {
+    char buf[CMSG_SPACE(sizeof(udp_scm_timestamping_t)) + CMSG_SPACE(sizeof(uint32_t)) +
+             CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+} udp_gro_control_t;
+
+// Maximum number of IP fragments gathered for a single zero-copy datagram
+#define UDP_ZCOPY_MAX_FRAGS 64
+
+// Layout of the entries passed to vma_api_t::free_packets (vma_packet_t without iovs)
+typedef struct {
+    void* packet_id;
+    size_t sz_iov;
+} zcopy_release_t;
+
+// Configure the VMA environment once per process (no-op after the first socket)
 static void setup_vma_env(const vma_options_t* udp_options) {
-    vma_setup_environment(udp_options);
+    vma_runtime_init(udp_options, NULL);
+}
+
+static uint64_t timespec_ns(const struct timespec* ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+// Set the packet timestamp from the receive control messages, preferring the
+// NIC hardware stamp, then the kernel stamp, then the post-receive clock
+static void set_rx_timestamp(udp_packet_t* packet, const struct msghdr* msg, uint64_t fallback_ns) {
+    packet->timestamp = fallback_ns;
+    packet->timestamp_source = UDP_TS_SOURCE_USER;
+    
+    if (msg->msg_controllen == 0) {
+        return;
+    }
+    
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR((struct msghdr*)msg); cmsg;
+         cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            udp_scm_timestamping_t stamps;
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            if (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec) {
+                packet->timestamp = timespec_ns(&stamps.ts[2]);
+                packet->timestamp_source = UDP_TS_SOURCE_HARDWARE;
+            } else if (stamps.ts[0].tv_sec || stamps.ts[0].tv_nsec) {
+                packet->timestamp = timespec_ns(&stamps.ts[0]);
+                packet->timestamp_source = UDP_TS_SOURCE_KERNEL;
+            }
+            return;
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec stamp;
+            memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            packet->timestamp = timespec_ns(&stamp);
+            packet->timestamp_source = UDP_TS_SOURCE_KERNEL;
+            return;
+        }
+    }
+}
+
+// Whether receives should pass a control buffer
+static bool wants_control(const udp_socket_t* socket) {
+    return socket->vma_options.enable_timestamps ||
+           __atomic_load_n(&socket->rxq_ovfl_enabled, __ATOMIC_RELAXED);
+}
+
+// Keep the SO_RXQ_OVFL drop count of a received datagram (absent until the first drop)
+static void note_rx_drops(udp_socket_t* socket, const struct msghdr* msg) {
+    if (msg->msg_controllen == 0) {
+        return;
+    }
+    
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR((struct msghdr*)msg); cmsg;
+         cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+            __atomic_store_n(&socket->rxq_drops, drops, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+// Datagram size within a received buffer: the UDP_GRO segment size when the
+// kernel coalesced several datagrams, otherwise the whole length
+static size_t rx_segment_size(const struct msghdr* msg, size_t length) {
+    if (msg->msg_controllen == 0) {
+        return length;
+    }
+    
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR((struct msghdr*)msg); cmsg;
+         cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int gso_size;
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            return gso_size > 0 && (size_t)gso_size < length ? (size_t)gso_size : length;
+        }
+    }
+    
+    return length;
+}
+
+// Whether VMA carries the socket's traffic itself (it does not implement UDP_SEGMENT)
+static bool vma_offloaded(int fd) {
+    struct vma_api_t* api = vma_common_get_api();
+    return api && api->get_socket_rings_num && api->get_socket_rings_num(fd) > 0;
+}
+
+// Errors meaning the kernel or device cannot segment for this socket. EINVAL is
+// not one of them: it rejects this call's sizes (segment larger than the path
+// MTU allows, too many segments), not segmentation itself
+static bool gso_refused(int err) {
+    return err == EIO || err == ENOPROTOOPT || err == EOPNOTSUPP;
+}
+
+// Wait after a receive found nothing queued: spins until the deadline in polling
+// mode, otherwise blocks in poll() for the time left
+static udp_result_t wait_for_data(udp_socket_t* socket, vma_deadline_t* deadline) {
+    int wait_result = vma_deadline_wait(deadline, socket->socket_fd,
+                                        &socket->wait_mode, &socket->wait_stats);
+    
+    if (wait_result == 0) {
+        vma_stats_rx_miss(socket->stats, true, deadline->empty_polls);
+        return UDP_ERROR_TIMEOUT;
+    } else if (wait_result < 0) {
+        vma_stats_rx_miss(socket->stats, false, deadline->empty_polls);
+        return UDP_ERROR_RECV;
+    }
+    
+    return UDP_SUCCESS;
+}
+
+// Check if a receive failed only because nothing was queued
+static bool would_block(void) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Current CLOCK_REALTIME in nanoseconds (0 on failure)
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
 // Enhanced UDP socket initialization with additional optimizations
@@ -44,6 +209,11 @@ udp_result_t udp_socket_init(udp_socket_t* udp_socket, const vma_options_t* opti
     // Set VMA environment variables
     setup_vma_env(&udp_socket->vma_options);
     
+    // Calibrate the receive deadline clock up front
+    vma_clock_init();
+    vma_wait_mode_init(&udp_socket->wait_mode, &udp_socket->vma_options);
+    vma_trace_init();
+    
     // Create socket
     udp_socket->socket_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (udp_socket->socket_fd < 0) {
@@ -77,17 +247,33 @@ udp_result_t udp_socket_init(udp_socket_t* udp_socket, const vma_options_t* opti
     
     // Enable timestamps if requested
     if (udp_socket->vma_options.enable_timestamps) {
-        int optval = 1;
-        // Use more precise hardware timestamps when available
-        setsockopt(udp_socket->socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &optval, sizeof(optval));
+        // Hardware receive stamps when the NIC provides them (VMA converts ConnectX
+        // clocks per VMA_HW_TS_CONVERSION), software stamps otherwise
+        int ts_flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                       SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(udp_socket->socket_fd, SOL_SOCKET, SO_TIMESTAMPING,
+                    &ts_flags, sizeof(ts_flags)) < 0) {
+            int optval = 1;
+            setsockopt(udp_socket->socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &optval, sizeof(optval));
+        }
     }
     
-    // Optimize VMA ring allocation when using SocketXtreme
-    if (udp_socket->vma_options.use_socketxtreme) {
-        int optval = 1;
-        setsockopt(udp_socket->socket_fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC, &optval, sizeof(optval));
+    // Place the socket on its VMA ring (before bind attaches one)
+    if (vma_ring_placement_apply(udp_socket->socket_fd, &udp_socket->vma_options) < 0) {
+        close(udp_socket->socket_fd);
+        udp_socket->socket_fd = -1;
+        return UDP_ERROR_SOCKET_OPTION;
     }
     
+    // Statistics live in their own cache-line-aligned block
+    udp_socket->stats = vma_stats_create();
+    if (!udp_socket->stats) {
+        close(udp_socket->socket_fd);
+        udp_socket->socket_fd = -1;
+        return UDP_ERROR_SOCKET_CREATE;
+    }
+    udp_socket->owns_stats = true;
+    
     return UDP_SUCCESS;
 }
 
@@ -101,6 +287,12 @@ udp_result_t udp_socket_close(udp_socket_t* socket) {
     socket->is_bound = false;
     socket->is_connected = false;
     
+    if (socket->owns_stats) {
+        vma_stats_destroy(socket->stats);
+    }
+    socket->stats = NULL;
+    socket->owns_stats = false;
+    
     return UDP_SUCCESS;
 }
 
@@ -165,21 +357,39 @@ udp_result_t udp_socket_send(udp_socket_t* socket, const void* data, size_t leng
         return UDP_ERROR_NOT_INITIALIZED;
     }
     
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
     ssize_t res = send(socket->socket_fd, data, length, 0);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
     
     if (res < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return UDP_ERROR_TIMEOUT;
-        }
-        return UDP_ERROR_SEND;
+        bool blocked = (errno == EAGAIN || errno == EWOULDBLOCK);
+        vma_stats_tx_miss(socket->stats, blocked);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND, socket->socket_fd,
+                                blocked ? UDP_ERROR_TIMEOUT : UDP_ERROR_SEND, 0);
     }
     
     if (bytes_sent) {
         *bytes_sent = (size_t)res;
     }
     
-    socket->tx_packets++;
-    socket->tx_bytes += res;
+    vma_stats_tx(socket->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND, socket->socket_fd, UDP_SUCCESS, res);
+}
+
+udp_result_t udp_endpoint_init(udp_endpoint_t* endpoint, const char* ip, uint16_t port) {
+    if (!endpoint || !ip) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    memset(&endpoint->addr, 0, sizeof(endpoint->addr));
+    endpoint->addr.sin_family = AF_INET;
+    endpoint->addr.sin_port = htons(port);
+    
+    if (inet_pton(AF_INET, ip, &endpoint->addr.sin_addr) <= 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
     
     return UDP_SUCCESS;
 }
@@ -190,131 +400,352 @@ udp_result_t udp_socket_sendto(udp_socket_t* socket, const void* data, size_t le
         return UDP_ERROR_INVALID_PARAM;
     }
     
-    struct sockaddr_in dest_addr;
-    memset(&dest_addr, 0, sizeof(dest_addr));
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(port);
+    udp_endpoint_t endpoint;
+    if (udp_endpoint_init(&endpoint, ip, port) != UDP_SUCCESS) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
     
-    if (inet_pton(AF_INET, ip, &dest_addr.sin_addr) <= 0) {
+    return udp_socket_sendto_endpoint(socket, data, length, &endpoint, bytes_sent);
+}
+
+udp_result_t udp_socket_sendto_endpoint(udp_socket_t* socket, const void* data, size_t length,
+                                    const udp_endpoint_t* endpoint, size_t* bytes_sent) {
+    if (!socket || socket->socket_fd < 0 || !data || length == 0 || !endpoint) {
         return UDP_ERROR_INVALID_PARAM;
     }
     
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
     ssize_t res = sendto(socket->socket_fd, data, length, 0, 
-                    (struct sockaddr*)&dest_addr, sizeof(dest_addr));
+                    (const struct sockaddr*)&endpoint->addr, sizeof(endpoint->addr));
+    VMA_TRACE_SYSCALL(trace, start_ticks);
     
     if (res < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return UDP_ERROR_TIMEOUT;
-        }
-        return UDP_ERROR_SEND;
+        bool blocked = (errno == EAGAIN || errno == EWOULDBLOCK);
+        vma_stats_tx_miss(socket->stats, blocked);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SENDTO, socket->socket_fd,
+                                blocked ? UDP_ERROR_TIMEOUT : UDP_ERROR_SEND, 0);
     }
     
     if (bytes_sent) {
         *bytes_sent = (size_t)res;
     }
     
-    socket->tx_packets++;
-    socket->tx_bytes += res;
+    vma_stats_tx(socket->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
     
-    return UDP_SUCCESS;
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SENDTO, socket->socket_fd, UDP_SUCCESS, res);
 }
 
-udp_result_t udp_socket_recv(udp_socket_t* socket, void* buffer, size_t buffer_size, 
-                            int timeout_ms, size_t* bytes_received) {
-    if (!socket || socket->socket_fd < 0 || !buffer || buffer_size == 0) {
+udp_result_t udp_socket_send_batch(udp_socket_t* socket, udp_send_msg_t* msgs, size_t count,
+                                size_t* sent_count) {
+    if (sent_count) {
+        *sent_count = 0;
+    }
+    
+    if (!socket || socket->socket_fd < 0 || !msgs || count == 0) {
         return UDP_ERROR_INVALID_PARAM;
     }
     
-    // Handle timeout based on socket mode
-    if (!socket->vma_options.use_polling && timeout_ms != -1) {
-        // For non-polling mode with timeout, use select
-        fd_set readfds;
-        struct timeval tv;
+    struct mmsghdr hdrs[UDP_MAX_BATCH];
+    struct iovec iovs[UDP_MAX_BATCH];
+    size_t sent = 0;
+    uint64_t total_bytes = 0;
+    int last_errno = 0;
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    
+    for (size_t i = 0; i < count; i++) {
+        msgs[i].bytes_sent = 0;
+    }
+    
+    while (sent < count) {
+        size_t chunk = count - sent;
+        if (chunk > UDP_MAX_BATCH) {
+            chunk = UDP_MAX_BATCH;
+        }
         
-        FD_ZERO(&readfds);
-        FD_SET(socket->socket_fd, &readfds);
+        for (size_t i = 0; i < chunk; i++) {
+            udp_send_msg_t* msg = &msgs[sent + i];
+            iovs[i].iov_base = (void*)msg->data;
+            iovs[i].iov_len = msg->length;
+            
+            memset(&hdrs[i].msg_hdr, 0, sizeof(hdrs[i].msg_hdr));
+            hdrs[i].msg_hdr.msg_name = &msg->dest_addr;
+            hdrs[i].msg_hdr.msg_namelen = sizeof(msg->dest_addr);
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
         
-        if (timeout_ms >= 0) {
-            tv.tv_sec = timeout_ms / 1000;
-            tv.tv_usec = (timeout_ms % 1000) * 1000;
+        int res = sendmmsg(socket->socket_fd, hdrs, (unsigned int)chunk, 0);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res <= 0) {
+            last_errno = errno;
+            break;
         }
         
-        int select_result = select(socket->socket_fd + 1, &readfds, NULL, NULL, 
-                                timeout_ms >= 0 ? &tv : NULL);
+        for (int i = 0; i < res; i++) {
+            msgs[sent + i].bytes_sent = hdrs[i].msg_len;
+            total_bytes += hdrs[i].msg_len;
+        }
+        sent += res;
         
-        if (select_result == 0) {
-            return UDP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
-            return UDP_ERROR_RECV;
+        // Short count: the next message would block or failed
+        if ((size_t)res < chunk) {
+            break;
         }
     }
     
-    // Receive data
-    ssize_t res = recv(socket->socket_fd, buffer, buffer_size, 0);
-    
-    if (res < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            // For polling mode or immediate timeout
-            return UDP_ERROR_TIMEOUT;
-        }
-        return UDP_ERROR_RECV;
-    } else if (res == 0) {
-        return UDP_ERROR_CLOSED;
+    if (sent_count) {
+        *sent_count = sent;
     }
     
-    if (bytes_received) {
-        *bytes_received = (size_t)res;
+    if (sent == 0) {
+        bool blocked = (last_errno == EAGAIN || last_errno == EWOULDBLOCK);
+        vma_stats_tx_miss(socket->stats, blocked);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND_BATCH, socket->socket_fd,
+                                blocked ? UDP_ERROR_TIMEOUT : UDP_ERROR_SEND, 0);
     }
     
-    socket->rx_packets++;
-    socket->rx_bytes += res;
+    vma_stats_tx(socket->stats, sent, total_bytes, vma_clock_ticks() - start_ticks);
     
-    return UDP_SUCCESS;
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND_BATCH, socket->socket_fd, UDP_SUCCESS, sent);
 }
 
-udp_result_t udp_socket_recvfrom(udp_socket_t* socket, udp_packet_t* packet,
-                            void* buffer, size_t buffer_size, int timeout_ms) {
-    if (!socket || socket->socket_fd < 0 || !packet || !buffer || buffer_size == 0) {
-        return UDP_ERROR_INVALID_PARAM;
-    }
+// Send data[offset, length) in segment_size datagrams with sendmmsg; returns the new offset
+static size_t send_segments_mmsg(udp_socket_t* socket, const uint8_t* data, size_t offset,
+                                size_t length, size_t segment_size, const struct sockaddr_in* dest,
+                                size_t* datagrams, int* last_errno) {
+    struct mmsghdr hdrs[UDP_MAX_BATCH];
+    struct iovec iovs[UDP_MAX_BATCH];
     
-    // Handle timeout based on socket mode
-    if (!socket->vma_options.use_polling && timeout_ms != -1) {
-        // For non-polling mode with timeout, use select
-        fd_set readfds;
-        struct timeval tv;
+    while (offset < length) {
+        size_t chunk = 0;
+        size_t start = offset;
+        while (chunk < UDP_MAX_BATCH && start < length) {
+            size_t len = length - start < segment_size ? length - start : segment_size;
+            iovs[chunk].iov_base = (void*)(data + start);
+            iovs[chunk].iov_len = len;
+            
+            memset(&hdrs[chunk].msg_hdr, 0, sizeof(hdrs[chunk].msg_hdr));
+            hdrs[chunk].msg_hdr.msg_name = (void*)dest;
+            hdrs[chunk].msg_hdr.msg_namelen = dest ? sizeof(*dest) : 0;
+            hdrs[chunk].msg_hdr.msg_iov = &iovs[chunk];
+            hdrs[chunk].msg_hdr.msg_iovlen = 1;
+            
+            start += len;
+            chunk++;
+        }
+        
+        int res = sendmmsg(socket->socket_fd, hdrs, (unsigned int)chunk, 0);
+        if (res <= 0) {
+            *last_errno = errno;
+            break;
+        }
         
-        FD_ZERO(&readfds);
-        FD_SET(socket->socket_fd, &readfds);
+        for (int i = 0; i < res; i++) {
+            offset += iovs[i].iov_len;
+        }
+        *datagrams += (size_t)res;
         
-        if (timeout_ms >= 0) {
-            tv.tv_sec = timeout_ms / 1000;
-            tv.tv_usec = (timeout_ms % 1000) * 1000;
+        // Short count: the next datagram would block or failed
+        if ((size_t)res < chunk) {
+            *last_errno = EAGAIN;
+            break;
+        }
+    }
+    
+    return offset;
+}
+
+udp_result_t udp_socket_send_segmented(udp_socket_t* socket, const void* data, size_t length,
+                                    size_t segment_size, const udp_endpoint_t* endpoint,
+                                    size_t* bytes_sent) {
+    if (bytes_sent) {
+        *bytes_sent = 0;
+    }
+    
+    if (!socket || socket->socket_fd < 0 || !data || length == 0 ||
+        segment_size == 0 || segment_size > UDP_GSO_MAX_BYTES) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    if (!endpoint && !socket->is_connected) {
+        return UDP_ERROR_NOT_INITIALIZED;
+    }
+    
+    const uint8_t* bytes = data;
+    const struct sockaddr_in* dest = endpoint ? &endpoint->addr : NULL;
+    size_t offset = 0;
+    size_t datagrams = 0;
+    int last_errno = 0;
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    
+    // Kernel path: one super-buffer per sendmsg, segmented by the kernel or the NIC
+    if (socket->gso_state != UDP_GSO_UNSUPPORTED && !vma_offloaded(socket->socket_fd)) {
+        size_t per_send = UDP_GSO_MAX_BYTES / segment_size;
+        if (per_send > UDP_GSO_MAX_SEGMENTS) {
+            per_send = UDP_GSO_MAX_SEGMENTS;
         }
+        per_send *= segment_size;
         
-        int select_result = select(socket->socket_fd + 1, &readfds, NULL, NULL, 
-                                timeout_ms >= 0 ? &tv : NULL);
+        union {
+            char buf[CMSG_SPACE(sizeof(uint16_t))];
+            struct cmsghdr align;
+        } control;
+        uint16_t gso_size = (uint16_t)segment_size;
         
-        if (select_result == 0) {
-            return UDP_ERROR_TIMEOUT;
-        } else if (select_result < 0) {
-            return UDP_ERROR_RECV;
+        while (offset < length) {
+            size_t len = length - offset < per_send ? length - offset : per_send;
+            struct iovec iov = { (void*)(bytes + offset), len };
+            
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = (void*)dest;
+            msg.msg_namelen = dest ? sizeof(*dest) : 0;
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.buf;
+            msg.msg_controllen = sizeof(control.buf);
+            
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(gso_size));
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            
+            ssize_t res = sendmsg(socket->socket_fd, &msg, 0);
+            VMA_TRACE_SYSCALL(trace, start_ticks);
+            if (res < 0) {
+                last_errno = errno;
+                if (gso_refused(last_errno)) {
+                    socket->gso_state = UDP_GSO_UNSUPPORTED;
+                    last_errno = 0;
+                }
+                break;
+            }
+            
+            socket->gso_state = UDP_GSO_KERNEL;
+            offset += (size_t)res;
+            datagrams += ((size_t)res + segment_size - 1) / segment_size;
         }
     }
     
-    // Receive data and address
-    socklen_t addr_len = sizeof(packet->src_addr);
-    ssize_t res = recvfrom(socket->socket_fd, buffer, buffer_size, 0,
-                        (struct sockaddr*)&packet->src_addr, &addr_len);
+    // Offloaded or refused: the same datagrams one by one
+    if (offset < length && last_errno == 0) {
+        offset = send_segments_mmsg(socket, bytes, offset, length, segment_size, dest,
+                                    &datagrams, &last_errno);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+    }
+    
+    if (bytes_sent) {
+        *bytes_sent = offset;
+    }
+    
+    if (offset == 0) {
+        bool blocked = (last_errno == EAGAIN || last_errno == EWOULDBLOCK);
+        vma_stats_tx_miss(socket->stats, blocked);
+        udp_result_t result = blocked ? UDP_ERROR_TIMEOUT :
+                              last_errno == EINVAL ? UDP_ERROR_INVALID_PARAM : UDP_ERROR_SEND;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND_SEGMENTED, socket->socket_fd, result, 0);
+    }
+    
+    vma_stats_tx(socket->stats, datagrams, offset, vma_clock_ticks() - start_ticks);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND_SEGMENTED, socket->socket_fd, UDP_SUCCESS, offset);
+}
+
+udp_result_t udp_socket_recv(udp_socket_t* socket, void* buffer, size_t buffer_size, 
+                            int timeout_ms, size_t* bytes_received) {
+    if (!socket || socket->socket_fd < 0 || !buffer || buffer_size == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Receive data, waiting until the deadline while nothing is queued
+    ssize_t res;
+    uint64_t start_ticks;
+    for (;;) {
+        start_ticks = vma_clock_ticks();
+        res = recv(socket->socket_fd, buffer, buffer_size, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        udp_result_t wait_result = wait_for_data(socket, &deadline);
+        if (wait_result != UDP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, socket->socket_fd, wait_result, 0);
+        }
+    }
     
     if (res < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            // For polling mode or immediate timeout
-            return UDP_ERROR_TIMEOUT;
+        vma_stats_rx_miss(socket->stats, false, deadline.empty_polls);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, socket->socket_fd, UDP_ERROR_RECV, 0);
+    } else if (res == 0) {
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, socket->socket_fd, UDP_ERROR_CLOSED, 0);
+    }
+    
+    if (bytes_received) {
+        *bytes_received = (size_t)res;
+    }
+    
+    vma_deadline_done(&deadline, &socket->wait_mode, &socket->wait_stats);
+    vma_stats_rx(socket->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, deadline.empty_polls);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, socket->socket_fd, UDP_SUCCESS, res);
+}
+
+// Receive one datagram (or one GRO-coalesced buffer) with its source address
+// and control messages (shared by udp_socket_recvfrom and udp_socket_recv_gro)
+static udp_result_t recv_msg(udp_socket_t* socket, udp_packet_t* packet, void* buffer,
+                            size_t buffer_size, int timeout_ms, vma_trace_op_t op,
+                            size_t* segment_size) {
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = buffer_size;
+    
+    udp_gro_control_t control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    bool want_control = segment_size || wants_control(socket);
+    (void)op;  // Recorded only when tracing is built in
+    
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Receive data and address, waiting until the deadline while nothing is queued
+    ssize_t res;
+    uint64_t start_ticks;
+    for (;;) {
+        start_ticks = vma_clock_ticks();
+        msg.msg_name = &packet->src_addr;
+        msg.msg_namelen = sizeof(packet->src_addr);
+        if (want_control) {
+            msg.msg_control = control.buf;
+            msg.msg_controllen = sizeof(control.buf);
         }
-        return UDP_ERROR_RECV;
+        res = recvmsg(socket->socket_fd, &msg, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        udp_result_t wait_result = wait_for_data(socket, &deadline);
+        if (wait_result != UDP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, op, socket->socket_fd, wait_result, 0);
+        }
+    }
+    
+    if (res < 0) {
+        vma_stats_rx_miss(socket->stats, false, deadline.empty_polls);
+        return VMA_TRACE_RETURN(trace, op, socket->socket_fd, UDP_ERROR_RECV, 0);
     } else if (res == 0) {
-        return UDP_ERROR_CLOSED;
+        return VMA_TRACE_RETURN(trace, op, socket->socket_fd, UDP_ERROR_CLOSED, 0);
     }
     
     // Set packet structure
@@ -322,19 +753,336 @@ udp_result_t udp_socket_recvfrom(udp_socket_t* socket, udp_packet_t* packet,
     packet->length = (size_t)res;
     
     // Set timestamp
-    struct timespec ts;
-    if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
-        packet->timestamp = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-    } else {
-        packet->timestamp = 0;
+    set_rx_timestamp(packet, &msg, realtime_ns());
+    if (want_control) {
+        note_rx_drops(socket, &msg);
+    }
+    if (segment_size) {
+        *segment_size = rx_segment_size(&msg, packet->length);
+    }
+    
+    vma_deadline_done(&deadline, &socket->wait_mode, &socket->wait_stats);
+    vma_stats_rx(socket->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, deadline.empty_polls);
+    
+    return VMA_TRACE_RETURN(trace, op, socket->socket_fd, UDP_SUCCESS, res);
+}
+
+udp_result_t udp_socket_recvfrom(udp_socket_t* socket, udp_packet_t* packet,
+                            void* buffer, size_t buffer_size, int timeout_ms) {
+    if (!socket || socket->socket_fd < 0 || !packet || !buffer || buffer_size == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    return recv_msg(socket, packet, buffer, buffer_size, timeout_ms, VMA_TRACE_UDP_RECVFROM, NULL);
+}
+
+udp_result_t udp_socket_set_gro(udp_socket_t* socket, bool enable) {
+    if (!socket || socket->socket_fd < 0) {
+        return UDP_ERROR_INVALID_PARAM;
     }
     
-    socket->rx_packets++;
-    socket->rx_bytes += res;
+    // Not fatal: without GRO every receive returns a single datagram
+    int optval = enable ? 1 : 0;
+    bool accepted = setsockopt(socket->socket_fd, SOL_UDP, UDP_GRO, &optval, sizeof(optval)) == 0;
+    socket->gro_enabled = enable && accepted;
     
     return UDP_SUCCESS;
 }
 
+udp_result_t udp_socket_recv_gro(udp_socket_t* socket, udp_packet_t* packet, void* buffer,
+                                size_t buffer_size, int timeout_ms, size_t* segment_size) {
+    if (!socket || socket->socket_fd < 0 || !packet || !buffer || buffer_size == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    size_t size = 0;
+    udp_result_t result = recv_msg(socket, packet, buffer, buffer_size, timeout_ms,
+                                VMA_TRACE_UDP_RECV_GRO, &size);
+    if (segment_size) {
+        *segment_size = size;
+    }
+    
+    return result;
+}
+
+// Receive up to max datagrams into the given buffers (shared by the batch receive variants)
+static udp_result_t recv_batch_iov(udp_socket_t* socket, udp_packet_t* pkts, struct iovec* iovs,
+                                size_t max, int timeout_ms, size_t* n) {
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    udp_ts_control_t controls[UDP_MAX_BATCH];
+    bool want_control = wants_control(socket);
+    
+    for (size_t i = 0; i < max; i++) {
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_name = &pkts[i].src_addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(pkts[i].src_addr);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (want_control) {
+            msgs[i].msg_hdr.msg_control = controls[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+        }
+    }
+    
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Drain whatever is queued without blocking, waiting until the deadline while nothing is queued
+    int res;
+    uint64_t start_ticks;
+    for (;;) {
+        start_ticks = vma_clock_ticks();
+        res = recvmmsg(socket->socket_fd, msgs, (unsigned int)max, MSG_DONTWAIT, NULL);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        udp_result_t wait_result = wait_for_data(socket, &deadline);
+        if (wait_result != UDP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_BATCH, socket->socket_fd, wait_result, 0);
+        }
+    }
+    
+    if (res < 0) {
+        vma_stats_rx_miss(socket->stats, false, deadline.empty_polls);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_BATCH, socket->socket_fd, UDP_ERROR_RECV, 0);
+    } else if (res == 0) {
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_BATCH, socket->socket_fd, UDP_ERROR_TIMEOUT, 0);
+    }
+    
+    // One fallback timestamp for the whole batch; kernel/NIC stamps are per datagram
+    uint64_t timestamp = realtime_ns();
+    uint64_t total_bytes = 0;
+    
+    for (int i = 0; i < res; i++) {
+        pkts[i].data = iovs[i].iov_base;
+        pkts[i].length = msgs[i].msg_len;
+        set_rx_timestamp(&pkts[i], &msgs[i].msg_hdr, timestamp);
+        total_bytes += msgs[i].msg_len;
+    }
+    if (want_control) {
+        note_rx_drops(socket, &msgs[res - 1].msg_hdr);
+    }
+    
+    if (n) {
+        *n = (size_t)res;
+    }
+    
+    vma_deadline_done(&deadline, &socket->wait_mode, &socket->wait_stats);
+    vma_stats_rx(socket->stats, (uint64_t)res, total_bytes, vma_clock_ticks() - start_ticks,
+                deadline.empty_polls);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_BATCH, socket->socket_fd, UDP_SUCCESS, res);
+}
+
+udp_result_t udp_socket_recv_batch(udp_socket_t* socket, udp_packet_t* pkts, void* bufs,
+                                size_t stride, size_t max, int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+    
+    if (!socket || socket->socket_fd < 0 || !pkts || !bufs || stride == 0 || max == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    if (max > UDP_MAX_BATCH) {
+        max = UDP_MAX_BATCH;
+    }
+    
+    struct iovec iovs[UDP_MAX_BATCH];
+    for (size_t i = 0; i < max; i++) {
+        iovs[i].iov_base = (char*)bufs + i * stride;
+        iovs[i].iov_len = stride;
+    }
+    
+    return recv_batch_iov(socket, pkts, iovs, max, timeout_ms, n);
+}
+
+udp_result_t udp_socket_recv_batch_pooled(udp_socket_t* socket, vma_buffer_pool_t* pool, udp_packet_t* pkts,
+                                        size_t max, int timeout_ms, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+    
+    if (!socket || socket->socket_fd < 0 || !pool || !pkts || max == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    if (max > UDP_MAX_BATCH) {
+        max = UDP_MAX_BATCH;
+    }
+    
+    // Take as many buffers as the pool can spare right now
+    struct iovec iovs[UDP_MAX_BATCH];
+    size_t buffers = 0;
+    while (buffers < max) {
+        void* buffer = vma_buffer_pool_alloc(pool);
+        if (!buffer) {
+            break;
+        }
+        iovs[buffers].iov_base = buffer;
+        iovs[buffers].iov_len = pool->buffer_size;
+        buffers++;
+    }
+    
+    if (buffers == 0) {
+        return UDP_ERROR_NO_BUFFERS;
+    }
+    
+    size_t received = 0;
+    udp_result_t result = recv_batch_iov(socket, pkts, iovs, buffers, timeout_ms, &received);
+    
+    // Unused buffers go straight back
+    for (size_t i = received; i < buffers; i++) {
+        vma_buffer_pool_free(pool, iovs[i].iov_base);
+    }
+    
+    if (n) {
+        *n = received;
+    }
+    
+    return result;
+}
+
+udp_result_t udp_socket_recv_zcopy(udp_socket_t* socket, udp_zcopy_packet_t* zpkt,
+                                void* buffer, size_t buffer_size, int timeout_ms) {
+    if (!socket || socket->socket_fd < 0 || !zpkt || !buffer || buffer_size == 0) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    zpkt->packet_id = NULL;
+    
+    struct vma_api_t* api = vma_common_get_api();
+    if (!api || !api->recvfrom_zcopy || !api->free_packets) {
+        // VMA not loaded: regular copying receive
+        return udp_socket_recvfrom(socket, &zpkt->packet, buffer, buffer_size, timeout_ms);
+    }
+    
+    VMA_TRACE_BEGIN(trace);
+    vma_deadline_t deadline;
+    vma_deadline_start(&deadline, timeout_ms);
+    
+    // Receive the datagram, waiting until the deadline while nothing is queued
+    int flags;
+    socklen_t addr_len;
+    int res;
+    uint64_t start_ticks;
+    for (;;) {
+        start_ticks = vma_clock_ticks();
+        flags = MSG_DONTWAIT;
+        addr_len = sizeof(zpkt->packet.src_addr);
+        res = api->recvfrom_zcopy(socket->socket_fd, buffer, buffer_size, &flags,
+                                (struct sockaddr*)&zpkt->packet.src_addr, &addr_len);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+        if (res >= 0 || !would_block()) {
+            break;
+        }
+        udp_result_t wait_result = wait_for_data(socket, &deadline);
+        if (wait_result != UDP_SUCCESS) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_ZCOPY, socket->socket_fd, wait_result, 0);
+        }
+    }
+    
+    if (res < 0) {
+        vma_stats_rx_miss(socket->stats, false, deadline.empty_polls);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_ZCOPY, socket->socket_fd, UDP_ERROR_RECV, 0);
+    } else if (res == 0) {
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_ZCOPY, socket->socket_fd, UDP_ERROR_CLOSED, 0);
+    }
+    
+    if (!(flags & MSG_VMA_ZCOPY)) {
+        // VMA copied the datagram into the buffer (it came through the kernel)
+        zpkt->packet.data = buffer;
+        zpkt->packet.length = (size_t)res;
+        __atomic_fetch_add(&socket->zcopy_os_packets, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&socket->zcopy_vma_packets, 1, __ATOMIC_RELAXED);
+        struct vma_packets_t* vma_pkts = (struct vma_packets_t*)buffer;
+        struct vma_packet_t* vma_pkt = &vma_pkts->pkts[0];
+        
+        if (vma_pkt->sz_iov == 1) {
+            zpkt->packet.data = vma_pkt->iov[0].iov_base;
+            zpkt->packet.length = vma_pkt->iov[0].iov_len;
+            zpkt->packet_id = vma_pkt->packet_id;
+        } else {
+            // Fragmented datagram: gather into the buffer and release at once
+            struct iovec frags[UDP_ZCOPY_MAX_FRAGS];
+            size_t frag_count = vma_pkt->sz_iov;
+            zcopy_release_t release = { vma_pkt->packet_id, 0 };
+            
+            if (frag_count > UDP_ZCOPY_MAX_FRAGS) {
+                api->free_packets(socket->socket_fd, (struct vma_packet_t*)&release, 1);
+                return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_ZCOPY, socket->socket_fd, UDP_ERROR_RECV, 0);
+            }
+            memcpy(frags, vma_pkt->iov, frag_count * sizeof(struct iovec));
+            
+            size_t offset = 0;
+            for (size_t i = 0; i < frag_count && offset < buffer_size; i++) {
+                size_t chunk = frags[i].iov_len;
+                if (chunk > buffer_size - offset) {
+                    chunk = buffer_size - offset;
+                }
+                memcpy((char*)buffer + offset, frags[i].iov_base, chunk);
+                offset += chunk;
+            }
+            api->free_packets(socket->socket_fd, (struct vma_packet_t*)&release, 1);
+            
+            zpkt->packet.data = buffer;
+            zpkt->packet.length = offset;
+        }
+    }
+    
+    // User timestamp only: recvfrom_zcopy returns no control messages
+    zpkt->packet.timestamp = realtime_ns();
+    zpkt->packet.timestamp_source = UDP_TS_SOURCE_USER;
+    
+    vma_deadline_done(&deadline, &socket->wait_mode, &socket->wait_stats);
+    vma_stats_rx(socket->stats, 1, zpkt->packet.length, vma_clock_ticks() - start_ticks,
+                deadline.empty_polls);
+    
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV_ZCOPY, socket->socket_fd, UDP_SUCCESS, zpkt->packet.length);
+}
+
+udp_result_t udp_socket_release_packets(udp_socket_t* socket, udp_zcopy_packet_t* zpkts, size_t count) {
+    if (!socket || socket->socket_fd < 0 || (!zpkts && count > 0)) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    struct vma_api_t* api = vma_common_get_api();
+    zcopy_release_t release[UDP_MAX_BATCH];
+    size_t pending = 0;
+    udp_result_t result = UDP_SUCCESS;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (!zpkts[i].packet_id) {
+            continue;
+        }
+        
+        release[pending].packet_id = zpkts[i].packet_id;
+        release[pending].sz_iov = 0;
+        pending++;
+        zpkts[i].packet_id = NULL;
+        
+        if (pending == UDP_MAX_BATCH) {
+            if (!api || !api->free_packets ||
+                api->free_packets(socket->socket_fd, (struct vma_packet_t*)release, pending) < 0) {
+                result = UDP_ERROR_RECV;
+            }
+            pending = 0;
+        }
+    }
+    
+    if (pending > 0) {
+        if (!api || !api->free_packets ||
+            api->free_packets(socket->socket_fd, (struct vma_packet_t*)release, pending) < 0) {
+            result = UDP_ERROR_RECV;
+        }
+    }
+    
+    return result;
+}
+
 udp_result_t udp_socket_setopt(udp_socket_t* socket, int level, int optname, 
                             const void* optval, socklen_t optlen) {
     if (!socket || socket->socket_fd < 0 || !optval) {
@@ -355,10 +1103,69 @@ udp_result_t udp_socket_get_stats(udp_socket_t* socket, uint64_t* rx_packets,
         return UDP_ERROR_INVALID_PARAM;
     }
     
-    if (rx_packets) *rx_packets = socket->rx_packets;
-    if (tx_packets) *tx_packets = socket->tx_packets;
-    if (rx_bytes) *rx_bytes = socket->rx_bytes;
-    if (tx_bytes) *tx_bytes = socket->tx_bytes;
+    vma_stats_values_t values;
+    vma_stats_snapshot(socket->stats, &values);
+    
+    if (rx_packets) *rx_packets = values.rx_packets;
+    if (tx_packets) *tx_packets = values.tx_packets;
+    if (rx_bytes) *rx_bytes = values.rx_bytes;
+    if (tx_bytes) *tx_bytes = values.tx_bytes;
+    
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_socket_get_stats_snapshot(const udp_socket_t* socket, vma_stats_values_t* values) {
+    if (!socket || !values) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    vma_stats_snapshot(socket->stats, values);
+    
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_socket_get_extended_stats(udp_socket_t* socket, udp_extended_stats_t* stats) {
+    if (!socket || socket->socket_fd < 0 || !stats) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    // The kernel reports the drop count only to sockets that asked for it
+    if (!__atomic_load_n(&socket->rxq_ovfl_enabled, __ATOMIC_RELAXED)) {
+        int optval = 1;
+        if (setsockopt(socket->socket_fd, SOL_SOCKET, SO_RXQ_OVFL, &optval, sizeof(optval)) == 0) {
+            __atomic_store_n(&socket->rxq_ovfl_enabled, true, __ATOMIC_RELAXED);
+        }
+    }
+    
+    vma_socket_info_query(socket->socket_fd, &stats->info);
+    stats->rxq_ovfl_enabled = __atomic_load_n(&socket->rxq_ovfl_enabled, __ATOMIC_RELAXED);
+    stats->rxq_drops = __atomic_load_n(&socket->rxq_drops, __ATOMIC_RELAXED);
+    stats->zcopy_vma_packets = __atomic_load_n(&socket->zcopy_vma_packets, __ATOMIC_RELAXED);
+    stats->zcopy_os_packets = __atomic_load_n(&socket->zcopy_os_packets, __ATOMIC_RELAXED);
+    
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_socket_set_stats_block(udp_socket_t* socket, vma_stats_t* stats) {
+    if (!socket || socket->socket_fd < 0 || !stats) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+    
+    if (stats == socket->stats) {
+        return UDP_SUCCESS;
+    }
+    
+    vma_stats_values_t values;
+    vma_stats_snapshot(socket->stats, &values);
+    
+    stats->seq = 0;
+    stats->values = values;
+    
+    if (socket->owns_stats) {
+        vma_stats_destroy(socket->stats);
+    }
+    socket->stats = stats;
+    socket->owns_stats = false;
     
     return UDP_SUCCESS;
 }
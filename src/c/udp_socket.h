@@ -10,6 +10,25 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include "vma_common.h"
+#include "vma_stats.h"
+#include "vma_buffer_pool.h"
+
+// Maximum number of datagrams handled by a single batch call
+#define UDP_MAX_BATCH 64
+
+// Segmentation offload limits per super-buffer (kernel UDP_MAX_SEGMENTS, IPv4 datagram size)
+#define UDP_GSO_MAX_SEGMENTS 64
+#define UDP_GSO_MAX_BYTES 65000
+
+// Receive buffer size that holds any GRO-coalesced buffer (smaller buffers truncate it)
+#define UDP_GRO_BUFFER_SIZE 65536
+
+// Segmentation offload support of a socket's path
+typedef enum {
+    UDP_GSO_UNKNOWN = 0,           // Not tried yet
+    UDP_GSO_KERNEL = 1,            // Kernel accepted UDP_SEGMENT
+    UDP_GSO_UNSUPPORTED = 2        // Kernel or device refused it; datagrams go out via sendmmsg
+} udp_gso_state_t;
 
 // UDP socket structure
 typedef struct {
@@ -19,20 +38,63 @@ typedef struct {
     struct sockaddr_in remote_addr; // Remote address information
     bool is_bound;                 // Whether the socket is bound
     bool is_connected;             // Whether the socket is connected (default target set)
-    uint64_t rx_packets;           // Number of received packets
-    uint64_t tx_packets;           // Number of transmitted packets
-    uint64_t rx_bytes;             // Number of received bytes
-    uint64_t tx_bytes;             // Number of transmitted bytes
+    vma_stats_t* stats;            // Counters and latency histograms (cache-line aligned, own block)
+    bool owns_stats;               // Whether stats is freed on close
+    vma_wait_mode_t wait_mode;     // Receive wait policy (derived from vma_options)
+    vma_wait_stats_t wait_stats;   // Spin hits vs. blocking wakeups
+    bool rxq_ovfl_enabled;         // SO_RXQ_OVFL on: receives with a msghdr read the drop count (atomic)
+    uint32_t rxq_drops;            // Drop count carried by the last datagram received (atomic)
+    uint64_t zcopy_vma_packets;    // Zero-copy receives served from VMA buffers (atomic)
+    uint64_t zcopy_os_packets;     // Zero-copy receives VMA copied from the kernel path (atomic)
+    udp_gso_state_t gso_state;     // Segmentation offload support seen so far
+    bool gro_enabled;              // Kernel accepted UDP_GRO (coalesced receives)
 } udp_socket_t;
 
+// Clock source of a receive timestamp
+typedef enum {
+    UDP_TS_SOURCE_NONE = 0,       // No timestamp
+    UDP_TS_SOURCE_USER = 1,       // CLOCK_REALTIME read after the receive call returned
+    UDP_TS_SOURCE_KERNEL = 2,     // Kernel software receive timestamp (SO_TIMESTAMPING / SO_TIMESTAMPNS)
+    UDP_TS_SOURCE_HARDWARE = 3    // NIC hardware receive timestamp (SOF_TIMESTAMPING_RAW_HARDWARE)
+} udp_timestamp_source_t;
+
 // Packet structure
 typedef struct {
     void* data;                   // Packet data
     size_t length;                // Data length
     struct sockaddr_in src_addr;  // Source address (on receive)
-    uint64_t timestamp;           // Timestamp
+    uint64_t timestamp;           // Receive timestamp in nanoseconds
+    udp_timestamp_source_t timestamp_source; // Clock that produced the timestamp
 } udp_packet_t;
 
+// Zero-copy packet (data points into a VMA-owned buffer until released)
+typedef struct {
+    udp_packet_t packet;          // Packet data, length, source address and timestamp
+    void* packet_id;              // VMA packet id (NULL when the data was copied into the caller buffer)
+} udp_zcopy_packet_t;
+
+// Pre-resolved destination endpoint (initialize with udp_endpoint_init and treat as opaque)
+typedef struct {
+    struct sockaddr_in addr;       // Resolved destination address
+} udp_endpoint_t;
+
+// Batched send entry
+typedef struct {
+    const void* data;              // Data to send
+    size_t length;                 // Data length
+    struct sockaddr_in dest_addr;  // Destination address
+    size_t bytes_sent;             // Number of bytes sent (filled on return)
+} udp_send_msg_t;
+
+// Extended socket statistics (udp_socket_get_extended_stats)
+typedef struct {
+    vma_socket_info_t info;        // Offload state, VMA rings, queue occupancy, kernel drops
+    bool rxq_ovfl_enabled;         // Drop counting via SO_RXQ_OVFL is on
+    uint32_t rxq_drops;            // Cumulative drops when the last received datagram was queued (SO_RXQ_OVFL)
+    uint64_t zcopy_vma_packets;    // Zero-copy receives served from VMA buffers
+    uint64_t zcopy_os_packets;     // Zero-copy receives VMA copied from the kernel path
+} udp_extended_stats_t;
+
 // Result codes
 typedef enum {
     UDP_SUCCESS = 0,
@@ -45,7 +107,8 @@ typedef enum {
     UDP_ERROR_TIMEOUT = -7,
     UDP_ERROR_INVALID_PARAM = -8,
     UDP_ERROR_NOT_INITIALIZED = -9,
-    UDP_ERROR_CLOSED = -10
+    UDP_ERROR_CLOSED = -10,
+    UDP_ERROR_NO_BUFFERS = -11         // No free receive buffer (pool exhausted or ring full)
 } udp_result_t;
 
 /**
@@ -110,6 +173,67 @@ udp_result_t udp_socket_send(udp_socket_t* socket, const void* data, size_t leng
 udp_result_t udp_socket_sendto(udp_socket_t* socket, const void* data, size_t length, 
                             const char* ip, uint16_t port, size_t* bytes_sent);
 
+/**
+ * Resolve a destination once for repeated sends
+ * 
+ * @param endpoint Pointer to the endpoint structure to initialize
+ * @param ip Target IP address
+ * @param port Target port
+ * @return Result code
+ */
+udp_result_t udp_endpoint_init(udp_endpoint_t* endpoint, const char* ip, uint16_t port);
+
+/**
+ * Send data to a pre-resolved endpoint
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param data Data to send
+ * @param length Data length
+ * @param endpoint Destination resolved with udp_endpoint_init
+ * @param bytes_sent Number of bytes sent (can be NULL)
+ * @return Result code
+ */
+udp_result_t udp_socket_sendto_endpoint(udp_socket_t* socket, const void* data, size_t length,
+                                    const udp_endpoint_t* endpoint, size_t* bytes_sent);
+
+/**
+ * Send multiple datagrams, each to its own destination, in a single call (sendmmsg)
+ * 
+ * msgs[i].bytes_sent is set for every entry (0 for entries that were not sent).
+ * Batches larger than UDP_MAX_BATCH are sent in UDP_MAX_BATCH-sized chunks.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param msgs Array of send entries
+ * @param count Number of entries
+ * @param sent_count Number of datagrams sent (can be NULL)
+ * @return Result code (UDP_SUCCESS if at least one datagram was sent)
+ */
+udp_result_t udp_socket_send_batch(udp_socket_t* socket, udp_send_msg_t* msgs, size_t count,
+                                size_t* sent_count);
+
+/**
+ * Send a buffer as consecutive datagrams of segment_size bytes (the last one may be shorter)
+ * 
+ * On the kernel path each super-buffer of up to UDP_GSO_MAX_SEGMENTS datagrams
+ * (UDP_GSO_MAX_BYTES) leaves in one sendmsg with UDP_SEGMENT. When VMA
+ * offloads the socket, or the kernel or device refuses segmentation, the
+ * datagrams are sent with sendmmsg instead; the receiver sees the same
+ * datagrams either way. Sizes the kernel rejects (EINVAL, e.g. a segment
+ * larger than the path MTU allows) fail only this call with
+ * UDP_ERROR_INVALID_PARAM and leave segmentation enabled.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param data Data to send
+ * @param length Data length
+ * @param segment_size Payload bytes per datagram
+ * @param endpoint Destination (NULL for the connected address)
+ * @param bytes_sent Number of bytes sent, a multiple of segment_size unless all were sent (can be NULL)
+ * @return Result code (UDP_SUCCESS if at least one datagram was sent)
+ */
+udp_result_t udp_socket_send_segmented(udp_socket_t* socket, const void* data, size_t length,
+                                    size_t segment_size, const udp_endpoint_t* endpoint,
+                                    size_t* bytes_sent);
+
 /**
  * Receive data
  * 
@@ -136,6 +260,107 @@ udp_result_t udp_socket_recv(udp_socket_t* socket, void* buffer, size_t buffer_s
 udp_result_t udp_socket_recvfrom(udp_socket_t* socket, udp_packet_t* packet,
                                 void* buffer, size_t buffer_size, int timeout_ms);
 
+/**
+ * Receive multiple datagrams in a single call (recvmmsg)
+ * 
+ * Datagram i is stored at bufs + i * stride and described by pkts[i]
+ * (data, length, source address and timestamp).
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param pkts Array of at least max packet structures
+ * @param bufs Receive buffer area of at least max * stride bytes
+ * @param stride Size of each per-datagram buffer slot
+ * @param max Maximum number of datagrams to receive (capped at UDP_MAX_BATCH)
+ * @param timeout_ms Timeout in milliseconds for the first datagram (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of datagrams received (can be NULL)
+ * @return Result code
+ */
+udp_result_t udp_socket_recv_batch(udp_socket_t* socket, udp_packet_t* pkts, void* bufs,
+                                size_t stride, size_t max, int timeout_ms, size_t* n);
+
+/**
+ * Receive multiple datagrams into buffers taken from a pool
+ * 
+ * pkts[i].data points at a pool buffer for every datagram received; return
+ * each with vma_buffer_pool_free once processed. Buffers left unused are
+ * returned before the call completes.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param pool Buffer pool (datagrams longer than pool->buffer_size are truncated)
+ * @param pkts Array of at least max packet structures
+ * @param max Maximum number of datagrams to receive (capped at UDP_MAX_BATCH)
+ * @param timeout_ms Timeout in milliseconds for the first datagram (0 for non-blocking, -1 for infinite wait)
+ * @param n Number of datagrams received (can be NULL)
+ * @return Result code (UDP_ERROR_NO_BUFFERS if the pool is empty)
+ */
+udp_result_t udp_socket_recv_batch_pooled(udp_socket_t* socket, vma_buffer_pool_t* pool, udp_packet_t* pkts,
+                                        size_t max, int timeout_ms, size_t* n);
+
+/**
+ * Turn coalesced receives (UDP_GRO) on or off
+ * 
+ * Not fatal when the kernel or VMA does not support it: udp_socket_recv_gro
+ * then returns one datagram at a time. While on, the other receive calls can
+ * also return coalesced buffers, so receive with udp_socket_recv_gro only.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param enable Whether to coalesce
+ * @return Result code
+ */
+udp_result_t udp_socket_set_gro(udp_socket_t* socket, bool enable);
+
+/**
+ * Receive a buffer of coalesced datagrams from one source
+ * 
+ * The buffer holds consecutive datagrams of segment_size bytes (the last one
+ * may be shorter). Without GRO it holds one datagram and segment_size equals
+ * its length. Use a buffer of UDP_GRO_BUFFER_SIZE bytes.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param packet Packet structure to fill (data, total length, source, timestamp)
+ * @param buffer Receive buffer
+ * @param buffer_size Buffer size
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param segment_size Datagram size within the buffer (can be NULL)
+ * @return Result code
+ */
+udp_result_t udp_socket_recv_gro(udp_socket_t* socket, udp_packet_t* packet, void* buffer,
+                                size_t buffer_size, int timeout_ms, size_t* segment_size);
+
+/**
+ * Receive a datagram without copying it out of VMA's receive ring (recvfrom_zcopy)
+ * 
+ * On success zpkt->packet.data points into a VMA-owned buffer that must be returned
+ * with udp_socket_release_packets. If the datagram could not be delivered zero-copy
+ * (socket not offloaded, VMA not loaded, or a fragmented datagram), it is copied
+ * into buffer instead and zpkt->packet_id is NULL.
+ * 
+ * Timestamps are user timestamps only (UDP_TS_SOURCE_USER, read after the call
+ * returns) even when receive timestamping is enabled: VMA's zero-copy packet
+ * descriptor carries no hardware or kernel timestamp.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param zpkt Received packet structure
+ * @param buffer Scratch buffer for the VMA packet descriptor or copied data
+ * @param buffer_size Buffer size
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @return Result code
+ */
+udp_result_t udp_socket_recv_zcopy(udp_socket_t* socket, udp_zcopy_packet_t* zpkt,
+                                void* buffer, size_t buffer_size, int timeout_ms);
+
+/**
+ * Return zero-copy packets to VMA
+ * 
+ * Entries whose packet_id is NULL are skipped; packet_id is cleared on return.
+ * 
+ * @param socket Pointer to the UDP socket structure the packets were received on
+ * @param zpkts Array of packets received with udp_socket_recv_zcopy
+ * @param count Number of packets
+ * @return Result code
+ */
+udp_result_t udp_socket_release_packets(udp_socket_t* socket, udp_zcopy_packet_t* zpkts, size_t count);
+
 /**
  * Set socket options
  * 
@@ -163,4 +388,42 @@ udp_result_t udp_socket_get_stats(udp_socket_t* socket, uint64_t* rx_packets,
                                 uint64_t* tx_packets, uint64_t* rx_bytes, 
                                 uint64_t* tx_bytes);
 
+/**
+ * Take a consistent snapshot of all socket statistics
+ * 
+ * Safe to call from a monitoring thread while the owner thread sends and
+ * receives; the owner never waits for readers.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param values Destination for counters and latency histograms
+ * @return Result code
+ */
+udp_result_t udp_socket_get_stats_snapshot(const udp_socket_t* socket, vma_stats_values_t* values);
+
+/**
+ * Get offload, ring and drop statistics
+ * 
+ * The first call turns on SO_RXQ_OVFL, after which udp_socket_recvfrom and
+ * the batch receives read the drop count the stack attaches to each datagram
+ * (udp_socket_recv and zero-copy receives carry no control messages). The
+ * counters are written by the receiving thread and read without locking.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param stats Destination
+ * @return Result code
+ */
+udp_result_t udp_socket_get_extended_stats(udp_socket_t* socket, udp_extended_stats_t* stats);
+
+/**
+ * Use a caller-owned statistics block instead of the internal one
+ * 
+ * The block must outlive the socket; it is not freed on close. Counters
+ * already recorded are copied over.
+ * 
+ * @param socket Pointer to the UDP socket structure
+ * @param stats Caller-owned statistics block
+ * @return Result code
+ */
+udp_result_t udp_socket_set_stats_block(udp_socket_t* socket, vma_stats_t* stats);
+
 #endif /* UDP_SOCKET_H */
\ No newline at end of file
@@ -0,0 +1,366 @@
+/**
+ * vma_buffer_pool.c - Hugepage-backed, NUMA-aware fixed-size receive buffer pool
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "vma_buffer_pool.h"
+
+#define DEFAULT_BUFFER_SIZE 2048
+#define DEFAULT_BUFFER_COUNT 4096
+#define HUGEPAGE_SIZE (2UL * 1024 * 1024)
+
+// mbind policy (linux/mempolicy.h); preferred so a full node degrades instead of failing
+#define POOL_MPOL_PREFERRED 1
+#define POOL_MAX_NUMA_NODES 1024
+
+// Cache slot of the calling thread (-1 until assigned, VMA_POOL_MAX_THREADS when none is left)
+static __thread int thread_slot = -1;
+
+// Live pools and used cache slots; only touched when a thread first uses a pool or exits
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static vma_buffer_pool_t* registry_head = NULL;
+static uint64_t used_slots = 0;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slot_key;
+
+static void shared_push(vma_buffer_pool_t* pool, uint32_t index);
+
+// Thread exit: hand the thread's cached buffers back to every pool and free its slot
+static void release_thread_slot(void* value) {
+    int slot = (int)(intptr_t)value - 1;
+
+    pthread_mutex_lock(&registry_lock);
+    for (vma_buffer_pool_t* pool = registry_head; pool; pool = pool->registry_next) {
+        vma_pool_cache_t* cache = &pool->caches[slot];
+        while (cache->count > 0) {
+            shared_push(pool, cache->items[--cache->count]);
+        }
+    }
+    used_slots &= ~(1ULL << slot);
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void create_slot_key(void) {
+    pthread_key_create(&slot_key, release_thread_slot);
+}
+
+static int assign_thread_slot(void) {
+    pthread_once(&slot_key_once, create_slot_key);
+
+    int slot = VMA_POOL_MAX_THREADS;
+    pthread_mutex_lock(&registry_lock);
+    if (~used_slots != 0) {
+        slot = __builtin_ctzll(~used_slots);
+        used_slots |= 1ULL << slot;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (slot < VMA_POOL_MAX_THREADS) {
+        pthread_setspecific(slot_key, (void*)(intptr_t)(slot + 1));
+    }
+    return slot;
+}
+
+static vma_pool_cache_t* thread_cache(vma_buffer_pool_t* pool) {
+    if (thread_slot < 0) {
+        thread_slot = assign_thread_slot();
+    }
+    return thread_slot < VMA_POOL_MAX_THREADS ? &pool->caches[thread_slot] : NULL;
+}
+
+static void shared_push(vma_buffer_pool_t* pool, uint32_t index) {
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint64_t replacement;
+    do {
+        __atomic_store_n(&pool->next[index], (uint32_t)head, __ATOMIC_RELAXED);
+        replacement = ((head >> 32) + 1) << 32 | index;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, replacement, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+// Pop from the shared list; the tag in the upper half defeats ABA
+static uint32_t shared_pop(vma_buffer_pool_t* pool) {
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint64_t replacement;
+    do {
+        uint32_t index = (uint32_t)head;
+        if (index == VMA_POOL_NONE) {
+            return VMA_POOL_NONE;
+        }
+        uint32_t next = __atomic_load_n(&pool->next[index], __ATOMIC_RELAXED);
+        replacement = ((head >> 32) + 1) << 32 | next;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, replacement, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return (uint32_t)head;
+}
+
+// Map the region, preferring explicit hugepages, then transparent hugepages
+static void* map_region(size_t* size, bool hugepages, vma_pool_backing_t* backing) {
+    void* region = MAP_FAILED;
+
+    if (hugepages) {
+        size_t huge_size = (*size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+        region = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED) {
+            *size = huge_size;
+            *backing = VMA_POOL_BACKING_HUGETLB;
+            return region;
+        }
+    }
+
+    region = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+
+    *backing = VMA_POOL_BACKING_NORMAL;
+    if (hugepages && madvise(region, *size, MADV_HUGEPAGE) == 0) {
+        *backing = VMA_POOL_BACKING_THP;
+    }
+
+    return region;
+}
+
+// Prefer a NUMA node for the region (before its pages are touched); not fatal
+static bool bind_region(void* region, size_t size, int node) {
+    if (node < 0 || node >= POOL_MAX_NUMA_NODES) {
+        return false;
+    }
+
+    unsigned long mask[POOL_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+
+    return syscall(SYS_mbind, region, size, POOL_MPOL_PREFERRED, mask, POOL_MAX_NUMA_NODES + 1, 0) == 0;
+}
+
+vma_pool_result_t vma_buffer_pool_init(vma_buffer_pool_t* pool, const vma_buffer_pool_config_t* config) {
+    if (!pool) {
+        return VMA_POOL_ERROR_INVALID_PARAM;
+    }
+
+    memset(pool, 0, sizeof(vma_buffer_pool_t));
+    pool->numa_node = -1;
+
+    vma_buffer_pool_config_t effective;
+    memset(&effective, 0, sizeof(effective));
+    if (config) {
+        effective = *config;
+    }
+
+    uint32_t buffer_size = effective.buffer_size > 0 ? effective.buffer_size : DEFAULT_BUFFER_SIZE;
+    uint32_t buffer_count = effective.buffer_count > 0 ? effective.buffer_count : DEFAULT_BUFFER_COUNT;
+    if (buffer_count == VMA_POOL_NONE || buffer_size > UINT32_MAX - VMA_POOL_ALIGN) {
+        return VMA_POOL_ERROR_INVALID_PARAM;
+    }
+
+    pool->buffer_size = buffer_size;
+    pool->stride = (buffer_size + VMA_POOL_ALIGN - 1) & ~(uint32_t)(VMA_POOL_ALIGN - 1);
+    pool->buffer_count = buffer_count;
+    pool->cache_limit = buffer_count / VMA_POOL_MAX_THREADS;
+    if (pool->cache_limit > VMA_POOL_CACHE_SIZE) {
+        pool->cache_limit = VMA_POOL_CACHE_SIZE;
+    }
+
+    size_t size = (size_t)pool->stride * buffer_count;
+    pool->base = map_region(&size, effective.use_hugepages, &pool->backing);
+    if (!pool->base) {
+        return VMA_POOL_ERROR_NO_MEMORY;
+    }
+    pool->region_size = size;
+
+    if (effective.bind_numa && bind_region(pool->base, size, effective.numa_node)) {
+        pool->numa_node = effective.numa_node;
+    }
+
+    pool->next = malloc((size_t)buffer_count * sizeof(uint32_t));
+    if (posix_memalign((void**)&pool->caches, VMA_POOL_ALIGN, VMA_POOL_MAX_THREADS * sizeof(vma_pool_cache_t)) != 0) {
+        pool->caches = NULL;
+    }
+    if (!pool->next || !pool->caches) {
+        vma_buffer_pool_close(pool);
+        return VMA_POOL_ERROR_NO_MEMORY;
+    }
+    memset(pool->caches, 0, VMA_POOL_MAX_THREADS * sizeof(vma_pool_cache_t));
+
+    // Fault every page in now so steady-state receive never takes a page fault
+    memset(pool->base, 0, size);
+
+    // Lowest index on top so early allocations stay in the first pages
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        pool->next[i] = i + 1 < buffer_count ? i + 1 : VMA_POOL_NONE;
+    }
+    pool->head = 0;
+
+    pthread_mutex_lock(&registry_lock);
+    pool->registry_next = registry_head;
+    registry_head = pool;
+    pthread_mutex_unlock(&registry_lock);
+
+    return VMA_POOL_SUCCESS;
+}
+
+vma_pool_result_t vma_buffer_pool_close(vma_buffer_pool_t* pool) {
+    if (!pool) {
+        return VMA_POOL_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    for (vma_buffer_pool_t** link = &registry_head; *link; link = &(*link)->registry_next) {
+        if (*link == pool) {
+            *link = pool->registry_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (pool->base) {
+        munmap(pool->base, pool->region_size);
+    }
+    free(pool->next);
+    free(pool->caches);
+    memset(pool, 0, sizeof(vma_buffer_pool_t));
+    pool->numa_node = -1;
+
+    return VMA_POOL_SUCCESS;
+}
+
+// Count into the thread's own cache line, or the shared counters without a cache
+static void count_event(vma_buffer_pool_t* pool, vma_pool_cache_t* cache, size_t field) {
+    uint64_t* counter = (uint64_t*)((uint8_t*)(cache ? &cache->stats : &pool->stats) + field);
+    if (cache) {
+        __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void* vma_buffer_pool_alloc(vma_buffer_pool_t* pool) {
+    vma_pool_cache_t* cache = thread_cache(pool);
+    uint32_t index = VMA_POOL_NONE;
+
+    if (cache) {
+        // Refill half the cache from the shared list when it runs dry
+        if (cache->count == 0) {
+            uint32_t batch = pool->cache_limit > 1 ? pool->cache_limit / 2 : 1;
+            while (cache->count < batch) {
+                uint32_t refill = shared_pop(pool);
+                if (refill == VMA_POOL_NONE) {
+                    break;
+                }
+                cache->items[cache->count++] = refill;
+            }
+        }
+        if (cache->count > 0) {
+            index = cache->items[--cache->count];
+        }
+    } else {
+        index = shared_pop(pool);
+    }
+
+    if (index == VMA_POOL_NONE) {
+        count_event(pool, cache, offsetof(vma_pool_stats_t, exhausted));
+        return NULL;
+    }
+
+    count_event(pool, cache, offsetof(vma_pool_stats_t, allocs));
+    return pool->base + (size_t)index * pool->stride;
+}
+
+void vma_buffer_pool_free(vma_buffer_pool_t* pool, void* buffer) {
+    if (!pool || !buffer) {
+        return;
+    }
+
+    uint32_t index = (uint32_t)(((uint8_t*)buffer - pool->base) / pool->stride);
+    vma_pool_cache_t* cache = thread_cache(pool);
+
+    count_event(pool, cache, offsetof(vma_pool_stats_t, frees));
+
+    if (!cache || pool->cache_limit == 0) {
+        shared_push(pool, index);
+        return;
+    }
+
+    // Spill half the cache so buffers freed on another thread flow back
+    if (cache->count >= pool->cache_limit) {
+        while (cache->count > pool->cache_limit / 2) {
+            shared_push(pool, cache->items[--cache->count]);
+        }
+    }
+    cache->items[cache->count++] = index;
+}
+
+vma_pool_result_t vma_buffer_pool_get_stats(const vma_buffer_pool_t* pool, vma_pool_stats_t* stats) {
+    if (!pool || !stats || !pool->caches) {
+        return VMA_POOL_ERROR_INVALID_PARAM;
+    }
+
+    stats->allocs = __atomic_load_n(&pool->stats.allocs, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&pool->stats.frees, __ATOMIC_RELAXED);
+    stats->exhausted = __atomic_load_n(&pool->stats.exhausted, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < VMA_POOL_MAX_THREADS; i++) {
+        const vma_pool_stats_t* local = &pool->caches[i].stats;
+        stats->allocs += __atomic_load_n(&local->allocs, __ATOMIC_RELAXED);
+        stats->frees += __atomic_load_n(&local->frees, __ATOMIC_RELAXED);
+        stats->exhausted += __atomic_load_n(&local->exhausted, __ATOMIC_RELAXED);
+    }
+
+    return VMA_POOL_SUCCESS;
+}
+
+uint32_t vma_buffer_pool_available(const vma_buffer_pool_t* pool) {
+    vma_pool_stats_t stats;
+    if (vma_buffer_pool_get_stats(pool, &stats) != VMA_POOL_SUCCESS) {
+        return 0;
+    }
+
+    uint64_t out = stats.allocs > stats.frees ? stats.allocs - stats.frees : 0;
+    return out >= pool->buffer_count ? 0 : pool->buffer_count - (uint32_t)out;
+}
+
+int vma_numa_node_for_ip(const char* ip) {
+    struct in_addr addr;
+    if (!ip || inet_pton(AF_INET, ip, &addr) <= 0) {
+        return -1;
+    }
+
+    struct ifaddrs* interfaces;
+    if (getifaddrs(&interfaces) < 0) {
+        return -1;
+    }
+
+    int node = -1;
+    for (struct ifaddrs* entry = interfaces; entry; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || entry->ifa_addr->sa_family != AF_INET ||
+            ((struct sockaddr_in*)entry->ifa_addr)->sin_addr.s_addr != addr.s_addr) {
+            continue;
+        }
+
+        // Virtual devices (lo, bridges) have no device link and report nothing
+        char path[256];
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", entry->ifa_name);
+        FILE* file = fopen(path, "r");
+        if (file) {
+            if (fscanf(file, "%d", &node) != 1) {
+                node = -1;
+            }
+            fclose(file);
+        }
+        break;
+    }
+
+    freeifaddrs(interfaces);
+    return node;
+}
@@ -0,0 +1,137 @@
+/**
+ * vma_buffer_pool.h - Hugepage-backed, NUMA-aware fixed-size receive buffer pool
+ */
+
+#ifndef VMA_BUFFER_POOL_H
+#define VMA_BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Maximum number of live threads with a private free-list cache (others use the shared list)
+#define VMA_POOL_MAX_THREADS 64
+
+// Buffers held by one thread's cache (half is exchanged with the shared list at a time;
+// small pools use less so the caches together cannot hold every buffer)
+#define VMA_POOL_CACHE_SIZE 64
+
+// Buffer slot alignment (one cache line)
+#define VMA_POOL_ALIGN 64
+
+// Invalid buffer index (empty list)
+#define VMA_POOL_NONE UINT32_MAX
+
+// Memory backing the buffers
+typedef enum {
+    VMA_POOL_BACKING_NORMAL = 0,       // Regular pages
+    VMA_POOL_BACKING_THP = 1,          // Regular mapping with transparent hugepages requested
+    VMA_POOL_BACKING_HUGETLB = 2       // Explicit hugepages (MAP_HUGETLB)
+} vma_pool_backing_t;
+
+// Result codes
+typedef enum {
+    VMA_POOL_SUCCESS = 0,
+    VMA_POOL_ERROR_INVALID_PARAM = -1,
+    VMA_POOL_ERROR_NO_MEMORY = -2
+} vma_pool_result_t;
+
+// Pool configuration (zero fields select the defaults)
+typedef struct {
+    uint32_t buffer_size;          // Bytes per buffer (rounded up to VMA_POOL_ALIGN, 0 for 2048)
+    uint32_t buffer_count;         // Number of buffers (0 for 4096)
+    bool use_hugepages;            // Back the pool with hugepages (MAP_HUGETLB, falling back to THP)
+    bool bind_numa;                // Place the memory on numa_node
+    int numa_node;                 // NUMA node (see vma_numa_node_for_ip), used when bind_numa is set
+} vma_buffer_pool_config_t;
+
+// Pool counters
+typedef struct {
+    uint64_t allocs;               // Buffers handed out
+    uint64_t frees;                // Buffers returned
+    uint64_t exhausted;            // Allocations that found the pool empty
+} vma_pool_stats_t;
+
+// Per-thread free-list cache (written by its owner thread only)
+typedef struct {
+    uint32_t count;                // Number of cached buffer indices
+    uint32_t items[VMA_POOL_CACHE_SIZE]; // Cached buffer indices
+    vma_pool_stats_t stats;        // This thread's counters (read with relaxed atomic loads)
+} __attribute__((aligned(VMA_POOL_ALIGN))) vma_pool_cache_t;
+
+// Pool structure (allocation and release are lock-free and thread-safe)
+typedef struct vma_buffer_pool {
+    uint8_t* base;                 // First buffer
+    size_t region_size;            // Mapped bytes
+    uint32_t buffer_size;          // Effective bytes per buffer requested
+    uint32_t stride;               // Distance between buffers
+    uint32_t buffer_count;         // Number of buffers
+    uint32_t cache_limit;          // Buffers one thread may cache (bounds what idle threads hold)
+    vma_pool_backing_t backing;    // Memory backing in effect
+    int numa_node;                 // Node the memory was bound to (-1 if not bound)
+    uint32_t* next;                // Shared free-list links (one per buffer)
+    uint64_t head;                 // Shared free-list head: ABA tag << 32 | index (atomic)
+    vma_pool_cache_t* caches;      // VMA_POOL_MAX_THREADS per-thread caches
+    vma_pool_stats_t stats;        // Counters of threads without a cache (atomic)
+    struct vma_buffer_pool* registry_next; // Next live pool (caches of exiting threads are flushed)
+} vma_buffer_pool_t;
+
+/**
+ * Create a pool and fault in its memory
+ *
+ * @param pool Pointer to the pool structure to initialize
+ * @param config Pool configuration (use defaults if NULL)
+ * @return Result code
+ */
+vma_pool_result_t vma_buffer_pool_init(vma_buffer_pool_t* pool, const vma_buffer_pool_config_t* config);
+
+/**
+ * Release a pool (every buffer must have been returned)
+ *
+ * @param pool Pointer to the pool structure
+ * @return Result code
+ */
+vma_pool_result_t vma_buffer_pool_close(vma_buffer_pool_t* pool);
+
+/**
+ * Take a buffer
+ *
+ * @param pool Pointer to the pool structure
+ * @return Buffer of pool->buffer_size bytes, or NULL if the pool is empty
+ */
+void* vma_buffer_pool_alloc(vma_buffer_pool_t* pool);
+
+/**
+ * Return a buffer (from any thread)
+ *
+ * @param pool Pointer to the pool structure
+ * @param buffer Buffer obtained from vma_buffer_pool_alloc
+ */
+void vma_buffer_pool_free(vma_buffer_pool_t* pool, void* buffer);
+
+/**
+ * Number of buffers not handed out (approximate while other threads allocate)
+ *
+ * @param pool Pointer to the pool structure
+ * @return Free buffers
+ */
+uint32_t vma_buffer_pool_available(const vma_buffer_pool_t* pool);
+
+/**
+ * Read the pool counters
+ *
+ * @param pool Pointer to the pool structure
+ * @param stats Destination for the counters
+ * @return Result code
+ */
+vma_pool_result_t vma_buffer_pool_get_stats(const vma_buffer_pool_t* pool, vma_pool_stats_t* stats);
+
+/**
+ * NUMA node of the network device that owns a local IPv4 address
+ *
+ * @param ip Local IPv4 address (for example the address a socket binds to)
+ * @return NUMA node, or -1 if unknown (no such interface, virtual device, or non-NUMA system)
+ */
+int vma_numa_node_for_ip(const char* ip);
+
+#endif /* VMA_BUFFER_POOL_H */
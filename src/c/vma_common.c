@@ -6,116 +6,515 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <sys/socket.h>
 #include "vma_common.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define VMA_HAVE_TSC 1
+#endif
+#include <mellanox/vma_extra.h>
 
-// Set up VMA environment variables based on options
-void vma_setup_environment(const vma_options_t* options) {
-    if (!options) {
+static pthread_once_t vma_api_once = PTHREAD_ONCE_INIT;
+static struct vma_api_t* vma_api = NULL;
+
+static void vma_api_lookup(void) {
+    vma_api = vma_get_api();
+}
+
+struct vma_api_t* vma_common_get_api(void) {
+    pthread_once(&vma_api_once, vma_api_lookup);
+    return vma_api;
+}
+
+// One packet ring profile per process for dedicated_ring_profile (-1 when unavailable)
+static pthread_once_t ring_profile_once = PTHREAD_ONCE_INIT;
+static int ring_profile_key = -1;
+
+static void ring_profile_create(void) {
+    struct vma_api_t* api = vma_common_get_api();
+    if (!api || !api->vma_add_ring_profile) {
         return;
     }
     
-    // Core VMA settings
-    if (options->use_socketxtreme) {
-        setenv("VMA_SOCKETXTREME", "1", 1);
+    struct vma_ring_type_attr profile;
+    memset(&profile, 0, sizeof(profile));
+    profile.ring_type = VMA_RING_PACKET;
+    
+    vma_ring_profile_key key;
+    if (api->vma_add_ring_profile(&profile, &key) == 0) {
+        ring_profile_key = key;
+    }
+}
+
+int vma_ring_placement_apply(int fd, const vma_options_t* options) {
+    if (!options || options->ring_placement == VMA_RING_PLACEMENT_DEFAULT || !vma_common_get_api()) {
+        return 0;
     }
     
-    if (options->optimize_for_latency) {
-        setenv("VMA_SPEC", "latency", 1);
-    } else {
-        // Optimize for throughput
-        setenv("VMA_SPEC", "throughput", 1);
+    struct vma_ring_alloc_logic_attr ring_attr;
+    memset(&ring_attr, 0, sizeof(ring_attr));
+    switch (options->ring_placement) {
+        case VMA_RING_PLACEMENT_INTERFACE:
+            ring_attr.ring_alloc_logic = RING_LOGIC_PER_INTERFACE;
+            break;
+        case VMA_RING_PLACEMENT_SOCKET:
+            ring_attr.ring_alloc_logic = RING_LOGIC_PER_SOCKET;
+            break;
+        case VMA_RING_PLACEMENT_THREAD:
+            ring_attr.ring_alloc_logic = RING_LOGIC_PER_THREAD;
+            break;
+        case VMA_RING_PLACEMENT_CORE:
+            ring_attr.ring_alloc_logic = RING_LOGIC_PER_CORE;
+            break;
+        case VMA_RING_PLACEMENT_USER_KEY:
+            ring_attr.ring_alloc_logic = RING_LOGIC_PER_USER_ID;
+            ring_attr.user_id = options->ring_key;
+            ring_attr.comp_mask |= VMA_RING_ALLOC_MASK_RING_USER_ID;
+            break;
+        default:
+            return -1;
+    }
+    
+    // Both directions, so requests and their replies share the ring
+    ring_attr.ingress = 1;
+    ring_attr.engress = 1;
+    ring_attr.comp_mask |= VMA_RING_ALLOC_MASK_RING_INGRESS | VMA_RING_ALLOC_MASK_RING_ENGRESS;
+    
+    if (options->dedicated_ring_profile) {
+        pthread_once(&ring_profile_once, ring_profile_create);
+        if (ring_profile_key < 0) {
+            return -1;
+        }
+        ring_attr.ring_profile_key = (uint32_t)ring_profile_key;
+        ring_attr.comp_mask |= VMA_RING_ALLOC_MASK_RING_PROFILE_KEY;
+    }
+    
+    return setsockopt(fd, SOL_SOCKET, SO_VMA_RING_ALLOC_LOGIC, &ring_attr, sizeof(ring_attr)) < 0 ? -1 : 0;
+}
+
+// Maximum number of descriptors in one vma_wait_fds call
+#define VMA_WAIT_MAX_FDS 16
+
+// Number of empty spins between sched_yield() hints
+#define VMA_SPIN_YIELD_INTERVAL 1024
+
+// Duration of the TSC calibration window
+#define VMA_CLOCK_CALIBRATION_NS 2000000ULL
+
+static pthread_once_t vma_clock_once = PTHREAD_ONCE_INIT;
+static uint64_t clock_base_ticks = 0;   // TSC value at calibration
+static uint64_t clock_base_ns = 0;      // CLOCK_MONOTONIC at calibration
+static uint64_t clock_mult = 0;         // Nanoseconds per tick in 32.32 fixed point (0 when TSC is unused)
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#ifdef VMA_HAVE_TSC
+// Whether the TSC ticks at a constant rate across P-, C- and T-states
+// (CPUID 0x80000007 EDX bit 8); without it TSC intervals are not time
+static bool tsc_invariant(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+}
+#endif
+
+static void vma_clock_calibrate(void) {
+#ifdef VMA_HAVE_TSC
+    // Stay on CLOCK_MONOTONIC (clock_mult = 0)
+    if (!tsc_invariant()) {
+        return;
+    }
+    
+    uint64_t start_ns = monotonic_ns();
+    uint64_t start_ticks = __rdtsc();
+    uint64_t end_ns;
+    do {
+        end_ns = monotonic_ns();
+    } while (end_ns - start_ns < VMA_CLOCK_CALIBRATION_NS);
+    uint64_t end_ticks = __rdtsc();
+    
+    if (end_ticks > start_ticks) {
+        clock_mult = (uint64_t)((((unsigned __int128)(end_ns - start_ns)) << 32) / (end_ticks - start_ticks));
+        clock_base_ticks = end_ticks;
+        clock_base_ns = end_ns;
+    }
+#endif
+}
+
+void vma_clock_init(void) {
+    pthread_once(&vma_clock_once, vma_clock_calibrate);
+}
+
+uint64_t vma_clock_ns(void) {
+#ifdef VMA_HAVE_TSC
+    if (clock_mult != 0) {
+        uint64_t ticks = __rdtsc() - clock_base_ticks;
+        return clock_base_ns + (uint64_t)(((unsigned __int128)ticks * clock_mult) >> 32);
+    }
+#endif
+    return monotonic_ns();
+}
+
+uint64_t vma_clock_ticks(void) {
+#ifdef VMA_HAVE_TSC
+    if (clock_mult != 0) {
+        return __rdtsc();
+    }
+#endif
+    return monotonic_ns();
+}
+
+uint64_t vma_clock_ticks_to_ns(uint64_t ticks) {
+    if (clock_mult != 0) {
+        return (uint64_t)(((unsigned __int128)ticks * clock_mult) >> 32);
+    }
+    return ticks;
+}
+
+void vma_wait_mode_init(vma_wait_mode_t* mode, const vma_options_t* options) {
+    mode->adaptive = options->adaptive_polling && options->spin_budget_us > 0;
+    mode->use_polling = options->use_polling && !mode->adaptive;
+    mode->allow_yield = !options->disable_poll_yield;
+    mode->spin_budget_ns = (uint64_t)options->spin_budget_us * 1000ULL;
+}
+
+void vma_deadline_start(vma_deadline_t* deadline, int timeout_ms) {
+    deadline->timeout_ms = timeout_ms;
+    deadline->spins = 0;
+    deadline->empty_polls = 0;
+    deadline->blocked = false;
+    
+    // Finite deadlines are armed on the first wait, so receives that find data
+    // queued never read the clock
+    deadline->deadline_ns = timeout_ms < 0 ? UINT64_MAX : 0;
+}
+
+int vma_deadline_wait(vma_deadline_t* deadline, int fd, const vma_wait_mode_t* mode,
+                    const vma_wait_stats_t* stats) {
+    return vma_deadline_wait_fds(deadline, &fd, 1, mode, stats);
+}
+
+int vma_deadline_wait_fds(vma_deadline_t* deadline, const int* fds, size_t count,
+                        const vma_wait_mode_t* mode, const vma_wait_stats_t* stats) {
+    deadline->empty_polls++;
+    
+    if (deadline->timeout_ms == 0) {
+        return 0;
+    }
+    
+    uint64_t now = vma_clock_ns();
+    if (deadline->deadline_ns == 0) {
+        deadline->deadline_ns = now + (uint64_t)deadline->timeout_ms * 1000000ULL;
+    }
+    
+    if (now >= deadline->deadline_ns) {
+        return 0;
+    }
+    
+    // Adaptive mode keeps spinning while the feed is active
+    bool spin = mode->use_polling ||
+                (mode->adaptive && stats->last_rx_ns != 0 &&
+                 now - stats->last_rx_ns < mode->spin_budget_ns);
+    
+    if (spin) {
+        deadline->spins++;
+        if (mode->allow_yield) {
+#ifdef VMA_HAVE_TSC
+            _mm_pause();
+#endif
+            if (deadline->spins % VMA_SPIN_YIELD_INTERVAL == 0) {
+                sched_yield();
+            }
+        }
+        return 1;
+    }
+    
+    deadline->blocked = true;
+    
+    if (deadline->deadline_ns == UINT64_MAX) {
+        return vma_wait_fds(fds, count, -1);
+    }
+    
+    // Round up so the wait never ends before the deadline
+    int remaining_ms = (int)((deadline->deadline_ns - now + 999999ULL) / 1000000ULL);
+    int res = vma_wait_fds(fds, count, remaining_ms);
+    if (res < 0 && errno == EINTR) {
+        return 1;  // Interrupted: let the caller retry against the same deadline
+    }
+    return res;
+}
+
+void vma_deadline_done(const vma_deadline_t* deadline, const vma_wait_mode_t* mode,
+                    vma_wait_stats_t* stats) {
+    if (deadline->blocked) {
+        stats->blocking_wakeups++;
+    } else if (deadline->spins > 0) {
+        stats->spin_hits++;
+    }
+    
+    if (mode->adaptive) {
+        stats->last_rx_ns = vma_clock_ns();
+    }
+}
+
+int vma_wait_fd(int fd, bool for_read, int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = for_read ? POLLIN : POLLOUT;
+    pfd.revents = 0;
+    
+    int res;
+    do {
+        res = poll(&pfd, 1, timeout_ms < 0 ? -1 : timeout_ms);
+    } while (res < 0 && errno == EINTR && timeout_ms < 0);
+    
+    return res;
+}
+
+int vma_wait_fds(const int* fds, size_t count, int timeout_ms) {
+    struct pollfd pfds[VMA_WAIT_MAX_FDS];
+    if (count > VMA_WAIT_MAX_FDS) {
+        count = VMA_WAIT_MAX_FDS;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        pfds[i].fd = fds[i];
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
     }
     
+    int res;
+    do {
+        res = poll(pfds, (nfds_t)count, timeout_ms < 0 ? -1 : timeout_ms);
+    } while (res < 0 && errno == EINTR && timeout_ms < 0);
+    
+    return res;
+}
+
+// Set up VMA environment variables based on options
+static pthread_mutex_t runtime_lock = PTHREAD_MUTEX_INITIALIZER;
+static int runtime_initialized = 0;    // Set once the report is complete (atomic)
+static vma_runtime_report_t runtime_report;
+
+static void runtime_warn(vma_runtime_report_t* report, const char* format, ...) {
+    if (report->warning_count >= VMA_RUNTIME_MAX_WARNINGS) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(report->warnings[report->warning_count++], sizeof(report->warnings[0]), format, args);
+    va_end(args);
+}
+
+// Record a setting and apply it unless libvma already runs or the environment already has it
+static void runtime_set(vma_runtime_report_t* report, const char* name, const char* value) {
+    if (report->setting_count >= VMA_RUNTIME_MAX_SETTINGS) {
+        return;
+    }
+
+    vma_runtime_setting_t* setting = &report->settings[report->setting_count++];
+    snprintf(setting->name, sizeof(setting->name), "%s", name);
+    snprintf(setting->requested, sizeof(setting->requested), "%s", value);
+
+    const char* existing = getenv(name);
+    if (existing) {
+        snprintf(setting->effective, sizeof(setting->effective), "%s", existing);
+        setting->source = VMA_SETTING_ENVIRONMENT;
+    } else if (report->vma_loaded) {
+        // libvma parsed its environment at load time; setting it now changes nothing
+        setting->effective[0] = '\0';
+        setting->source = VMA_SETTING_IGNORED;
+    } else {
+        setenv(name, value, 0);
+        snprintf(setting->effective, sizeof(setting->effective), "%s", value);
+        setting->source = VMA_SETTING_APPLIED;
+    }
+
+    if (strcmp(setting->effective, setting->requested) != 0) {
+        runtime_warn(report, "%s: requested %s but %s is in effect", name, value,
+                    setting->effective[0] ? setting->effective : "the libvma default");
+    }
+}
+
+static const char* runtime_effective(const vma_runtime_report_t* report, const char* name) {
+    for (int i = 0; i < report->setting_count; i++) {
+        if (strcmp(report->settings[i].name, name) == 0) {
+            return report->settings[i].effective;
+        }
+    }
+    const char* value = getenv(name);
+    return value ? value : "";
+}
+
+static void runtime_configure(const vma_options_t* options, vma_runtime_report_t* report) {
+    char value[256];
+
+    // Core VMA settings
+    if (options->use_socketxtreme) {
+        runtime_set(report, "VMA_SOCKETXTREME", "1");
+    }
+
+    runtime_set(report, "VMA_SPEC", options->optimize_for_latency ? "latency" : "throughput");
+
     if (options->use_polling) {
-        setenv("VMA_RX_POLL", "1", 1);
-        setenv("VMA_SELECT_POLL", "1", 1);
-        
+        runtime_set(report, "VMA_RX_POLL", "1");
+        runtime_set(report, "VMA_SELECT_POLL", "1");
+
         // Polling optimizations
         if (options->disable_poll_yield) {
-            setenv("VMA_RX_POLL_YIELD", "0", 1);
+            runtime_set(report, "VMA_RX_POLL_YIELD", "0");
         }
-        
         if (options->skip_os_select) {
-            setenv("VMA_SELECT_SKIP_OS", "1", 1);
+            runtime_set(report, "VMA_SELECT_SKIP_OS", "1");
         }
     }
-    
+
     if (options->ring_count > 0) {
-        char ring_count[16];
-        snprintf(ring_count, sizeof(ring_count), "%d", options->ring_count);
-        setenv("VMA_RING_ALLOCATION_LOGIC_RX", ring_count, 1);
+        snprintf(value, sizeof(value), "%d", options->ring_count);
+        runtime_set(report, "VMA_RING_ALLOCATION_LOGIC_RX", value);
     }
-    
-    // SocketXtreme optimizations
+
+    // SocketXtreme needs single-threaded rings; otherwise multi-threaded mode
     if (options->use_socketxtreme) {
-        setenv("VMA_RING_ALLOCATION_LOGIC_TX", "0", 1);
-        setenv("VMA_THREAD_MODE", "1", 1);
-        
+        runtime_set(report, "VMA_RING_ALLOCATION_LOGIC_TX", "0");
+        runtime_set(report, "VMA_THREAD_MODE", "1");
         if (options->keep_qp_full) {
-            setenv("VMA_CQ_KEEP_QP_FULL", "1", 1);
+            runtime_set(report, "VMA_CQ_KEEP_QP_FULL", "1");
         }
     } else {
-        // Multi-threaded mode when not using SocketXtreme
-        setenv("VMA_THREAD_MODE", "3", 1);
+        runtime_set(report, "VMA_THREAD_MODE", "3");
     }
-    
+
     // Memory optimizations
     if (options->use_hugepages) {
-        setenv("VMA_MEMORY_ALLOCATION_TYPE", "2", 1);
+        runtime_set(report, "VMA_MEMORY_ALLOCATION_TYPE", "2");
     }
-    
+
     // Buffer counts
     if (options->tx_bufs > 0) {
-        char tx_bufs[16];
-        snprintf(tx_bufs, sizeof(tx_bufs), "%u", options->tx_bufs);
-        setenv("VMA_TX_BUFS", tx_bufs, 1);
+        snprintf(value, sizeof(value), "%u", options->tx_bufs);
+        runtime_set(report, "VMA_TX_BUFS", value);
     }
-    
     if (options->rx_bufs > 0) {
-        char rx_bufs[16];
-        snprintf(rx_bufs, sizeof(rx_bufs), "%u", options->rx_bufs);
-        setenv("VMA_RX_BUFS", rx_bufs, 1);
+        snprintf(value, sizeof(value), "%u", options->rx_bufs);
+        runtime_set(report, "VMA_RX_BUFS", value);
     }
-    
-    // CPU affinity settings - now using fixed array instead of pointer
+
+    // CPU affinity as a list like "0,1,2,3"
     if (options->cpu_cores_count > 0) {
-        setenv("VMA_THREAD_AFFINITY", "1", 1);
-        
-        // Create a string like "0,1,2,3"
-        size_t str_size = options->cpu_cores_count * 4; // Allow up to 3 digits per core plus comma
-        char* cores_str = malloc(str_size);
-        if (cores_str) {
-            cores_str[0] = '\0';
-            int offset = 0;
-            
-            for (int i = 0; i < options->cpu_cores_count; i++) {
-                int written;
-                if (i == 0) {
-                    written = snprintf(cores_str + offset, str_size - offset, "%d", options->cpu_cores[i]);
-                } else {
-                    written = snprintf(cores_str + offset, str_size - offset, ",%d", options->cpu_cores[i]);
-                }
-                
-                if (written > 0) {
-                    offset += written;
-                }
+        runtime_set(report, "VMA_THREAD_AFFINITY", "1");
+
+        size_t offset = 0;
+        value[0] = '\0';
+        for (int i = 0; i < options->cpu_cores_count && i < MAX_CPU_CORES && offset < sizeof(value); i++) {
+            int written = snprintf(value + offset, sizeof(value) - offset, i == 0 ? "%d" : ",%d",
+                                options->cpu_cores[i]);
+            if (written > 0) {
+                offset += (size_t)written;
             }
-            
-            setenv("VMA_THREAD_AFFINITY_ID", cores_str, 1);
-            free(cores_str);
         }
+        runtime_set(report, "VMA_THREAD_AFFINITY_ID", value);
     }
-    
-    // TCP-specific optimizations (always set these as they don't hurt UDP)
-    setenv("VMA_TCP_STREAM_RX_SIZE", "16777216", 1); // 16MB
-    setenv("VMA_TCP_RX_ZERO_COPY", "1", 1);
-    
-    // Additional settings from the suggested code change
+
+    // TCP receive zero copy (the stream receive size stays at libvma's default)
+    runtime_set(report, "VMA_TCP_RX_ZERO_COPY", "1");
+
     if (options->enable_timestamps) {
-        setenv("VMA_TIMESTAMP", "1", 1);
+        runtime_set(report, "VMA_TIMESTAMP", "1");
+    }
+}
+
+static void runtime_validate(const vma_options_t* options, vma_runtime_report_t* report) {
+    if (options->use_socketxtreme) {
+        if (strcmp(runtime_effective(report, "VMA_THREAD_MODE"), "3") == 0) {
+            runtime_warn(report, "conflict: SocketXtreme needs single-threaded rings, VMA_THREAD_MODE is 3");
+            report->conflict = true;
+        }
+        if (report->vma_loaded && (!report->socketxtreme_available ||
+                                strcmp(runtime_effective(report, "VMA_SOCKETXTREME"), "1") != 0)) {
+            runtime_warn(report, "conflict: SocketXtreme requested but libvma was started without VMA_SOCKETXTREME=1");
+            report->conflict = true;
+        }
+    }
+
+    if (options->adaptive_polling && options->use_polling) {
+        runtime_warn(report, "note: adaptive_polling overrides use_polling for receive waits");
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < options->cpu_cores_count && i < MAX_CPU_CORES; i++) {
+        if (options->cpu_cores[i] < 0 || (cpus > 0 && options->cpu_cores[i] >= cpus)) {
+            runtime_warn(report, "conflict: cpu_cores lists core %d, which is not online", options->cpu_cores[i]);
+            report->conflict = true;
+            break;
+        }
+    }
+
+    if (!report->vma_loaded) {
+        runtime_warn(report, "note: libvma is not loaded, sockets use the kernel stack");
     }
 }
 
+vma_runtime_result_t vma_runtime_init(const vma_options_t* options, vma_runtime_report_t* report) {
+    // Fast path for every socket after the first
+    if (__atomic_load_n(&runtime_initialized, __ATOMIC_ACQUIRE)) {
+        if (report) {
+            *report = runtime_report;
+        }
+        return VMA_RUNTIME_ALREADY_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&runtime_lock);
+
+    vma_runtime_result_t result = VMA_RUNTIME_ALREADY_INITIALIZED;
+    if (!runtime_initialized) {
+        vma_runtime_report_t* current = &runtime_report;
+        memset(current, 0, sizeof(*current));
+
+        if (options) {
+            current->options = *options;
+        } else {
+            set_default_options(&current->options);
+        }
+
+        struct vma_api_t* api = vma_common_get_api();
+        current->vma_loaded = api != NULL;
+        current->socketxtreme_available = api && api->socketxtreme_poll;
+
+        runtime_configure(&current->options, current);
+        runtime_validate(&current->options, current);
+
+        result = current->conflict ? VMA_RUNTIME_ERROR_CONFLICT : VMA_RUNTIME_OK;
+        __atomic_store_n(&runtime_initialized, 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&runtime_lock);
+
+    if (report) {
+        *report = runtime_report;
+    }
+
+    return result;
+}
+
+void vma_setup_environment(const vma_options_t* options) {
+    vma_runtime_init(options, NULL);
+}
+
 // Implementation of set_default_options
 void set_default_options(vma_options_t* options) {
     if (!options) return;
@@ -136,4 +535,10 @@ void set_default_options(vma_options_t* options) {
     // Initialize CPU cores array to zero
     memset(options->cpu_cores, 0, sizeof(options->cpu_cores));
     options->cpu_cores_count = 0;
+    
+    options->adaptive_polling = false;
+    options->spin_budget_us = 0;
+    options->ring_placement = VMA_RING_PLACEMENT_DEFAULT;
+    options->ring_key = 0;
+    options->dedicated_ring_profile = false;
 }
\ No newline at end of file
@@ -14,6 +14,16 @@
 // Maximum number of CPU cores that can be specified
 #define MAX_CPU_CORES 64
 
+// VMA ring a socket's traffic is placed on (vma_options_t::ring_placement)
+typedef enum {
+    VMA_RING_PLACEMENT_DEFAULT = 0,   // Process-wide VMA_RING_ALLOCATION_LOGIC_RX/TX
+    VMA_RING_PLACEMENT_INTERFACE = 1, // Ring shared by every socket on the interface
+    VMA_RING_PLACEMENT_SOCKET = 2,    // Ring of its own
+    VMA_RING_PLACEMENT_THREAD = 3,    // Ring of the thread that first sends or receives on it
+    VMA_RING_PLACEMENT_CORE = 4,      // Ring of the core that first sends or receives on it
+    VMA_RING_PLACEMENT_USER_KEY = 5   // Ring shared by the sockets with the same ring_key
+} vma_ring_placement_t;
+
 // VMA options structure to be shared between TCP and UDP
 typedef struct {
     bool use_socketxtreme;       // Whether to use SocketXtreme mode
@@ -31,11 +41,230 @@ typedef struct {
     bool keep_qp_full;           // Keep queue pairs full for better throughput
     int cpu_cores[MAX_CPU_CORES]; // Array of CPU cores to use for affinity (fixed size for thread safety)
     int cpu_cores_count;         // Number of CPU cores in the array
+    bool adaptive_polling;       // Busy-poll for spin_budget_us after each packet, then block (overrides use_polling)
+    uint32_t spin_budget_us;     // Adaptive busy-poll window in microseconds
+    vma_ring_placement_t ring_placement; // VMA ring the socket is placed on (applied at socket init)
+    uint64_t ring_key;           // Ring id for VMA_RING_PLACEMENT_USER_KEY
+    bool dedicated_ring_profile; // Allocate the ring from a separate VMA ring profile (vma_add_ring_profile)
 } vma_options_t;
 
+// Receive wait policy derived from vma_options_t
+typedef struct {
+    bool use_polling;            // Busy-poll until the deadline
+    bool allow_yield;            // Issue pause/yield hints while spinning
+    bool adaptive;               // Busy-poll for spin_budget_ns after the last packet, then block
+    uint64_t spin_budget_ns;     // Adaptive busy-poll window in nanoseconds
+} vma_wait_mode_t;
+
+// Receive wait counters
+typedef struct {
+    uint64_t last_rx_ns;         // Clock time of the last successful receive (adaptive mode)
+    uint64_t spin_hits;          // Receives that found data while busy-polling
+    uint64_t blocking_wakeups;   // Receives that found data after a blocking wait
+} vma_wait_stats_t;
+
+// Receive deadline state shared by the polling and blocking wait paths
+typedef struct {
+    uint64_t deadline_ns;        // Absolute deadline on the vma_clock_ns() timeline (0 until armed, UINT64_MAX for infinite)
+    int timeout_ms;              // Requested timeout (0 for non-blocking, -1 for infinite wait)
+    uint32_t spins;              // Number of busy-poll iterations so far
+    uint32_t empty_polls;        // Number of receive attempts that found nothing queued
+    bool blocked;                // Whether a blocking wait was issued
+} vma_deadline_t;
+
+struct vma_api_t;
+
+/**
+ * Get the VMA extra API
+ * 
+ * The lookup is done once per process and cached.
+ * 
+ * @return Pointer to the VMA extra API, or NULL when VMA is not loaded
+ */
+struct vma_api_t* vma_common_get_api(void);
+
+/**
+ * Place a socket on the VMA ring selected by options->ring_placement
+ * 
+ * Call before the socket is bound or connected: VMA attaches the ring then.
+ * Does nothing for VMA_RING_PLACEMENT_DEFAULT or when VMA is not loaded.
+ * 
+ * @param fd Socket descriptor
+ * @param options Options holding the placement
+ * @return 0 on success or when nothing was requested, -1 when VMA rejected it
+ */
+int vma_ring_placement_apply(int fd, const vma_options_t* options);
+
+/**
+ * Wait for a single descriptor to become readable or writable (poll-based)
+ * 
+ * @param fd File descriptor
+ * @param for_read Wait for readability (true) or writability (false)
+ * @param timeout_ms Timeout in milliseconds (0 to check without waiting, -1 for infinite wait)
+ * @return Positive if ready, 0 on timeout, negative on error
+ */
+int vma_wait_fd(int fd, bool for_read, int timeout_ms);
+
+/**
+ * Wait for any of several descriptors to become readable (poll-based)
+ * 
+ * @param fds File descriptors
+ * @param count Number of descriptors
+ * @param timeout_ms Timeout in milliseconds (0 to check without waiting, -1 for infinite wait)
+ * @return Number of ready descriptors, 0 on timeout, negative on error
+ */
+int vma_wait_fds(const int* fds, size_t count, int timeout_ms);
+
+/**
+ * Calibrate the monotonic clock used for receive deadlines
+ * 
+ * Runs once per process (about 2 ms on first use); socket init calls it so the
+ * first receive does not pay for calibration. The TSC is used only when CPUID
+ * reports it invariant; otherwise the clock stays on CLOCK_MONOTONIC.
+ */
+void vma_clock_init(void);
+
+/**
+ * Read the monotonic clock (invariant TSC when available, CLOCK_MONOTONIC otherwise)
+ * 
+ * @return Monotonic time in nanoseconds
+ */
+uint64_t vma_clock_ns(void);
+
+/**
+ * Derive the receive wait policy from socket options
+ * 
+ * @param mode Wait policy to initialize
+ * @param options VMA options structure
+ */
+void vma_wait_mode_init(vma_wait_mode_t* mode, const vma_options_t* options);
+
+/**
+ * Read the raw clock counter (TSC ticks, or nanoseconds when the TSC is unused)
+ * 
+ * @return Clock ticks
+ */
+uint64_t vma_clock_ticks(void);
+
+/**
+ * Convert a clock tick interval to nanoseconds
+ * 
+ * @param ticks Interval in clock ticks
+ * @return Interval in nanoseconds
+ */
+uint64_t vma_clock_ticks_to_ns(uint64_t ticks);
+
+/**
+ * Start tracking a receive deadline
+ * 
+ * @param deadline Deadline state to initialize
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ */
+void vma_deadline_start(vma_deadline_t* deadline, int timeout_ms);
+
+/**
+ * Wait after a receive found nothing queued
+ * 
+ * In polling mode this spins on the clock (with pause and sched_yield hints
+ * unless disabled) and returns immediately so the caller can retry the
+ * receive. In blocking mode it waits on the fd with poll() for the time left
+ * until the deadline. In adaptive mode it spins while the last packet is
+ * within the spin budget and blocks afterwards.
+ * 
+ * @param deadline Deadline state
+ * @param fd File descriptor to wait on
+ * @param mode Wait policy
+ * @param stats Wait counters (last receive time is read in adaptive mode)
+ * @return Positive to retry the receive, 0 if the deadline passed, negative on error
+ */
+int vma_deadline_wait(vma_deadline_t* deadline, int fd, const vma_wait_mode_t* mode,
+                    const vma_wait_stats_t* stats);
+
+/**
+ * Wait after receives on several descriptors found nothing queued
+ * 
+ * Same policy as vma_deadline_wait; blocking waits return as soon as any
+ * descriptor is readable.
+ * 
+ * @param deadline Deadline state
+ * @param fds File descriptors to wait on
+ * @param count Number of descriptors
+ * @param mode Wait policy
+ * @param stats Wait counters (last receive time is read in adaptive mode)
+ * @return Positive to retry the receives, 0 if the deadline passed, negative on error
+ */
+int vma_deadline_wait_fds(vma_deadline_t* deadline, const int* fds, size_t count,
+                        const vma_wait_mode_t* mode, const vma_wait_stats_t* stats);
+
+/**
+ * Record a successful receive in the wait counters
+ * 
+ * @param deadline Deadline state used for the receive
+ * @param mode Wait policy
+ * @param stats Wait counters to update
+ */
+void vma_deadline_done(const vma_deadline_t* deadline, const vma_wait_mode_t* mode,
+                    vma_wait_stats_t* stats);
+
+// Maximum number of VMA settings and warnings in a runtime report
+#define VMA_RUNTIME_MAX_SETTINGS 24
+#define VMA_RUNTIME_MAX_WARNINGS 8
+
+// Where the value of a VMA setting in effect came from
+typedef enum {
+    VMA_SETTING_APPLIED = 0,       // Set from the options before libvma read its environment
+    VMA_SETTING_ENVIRONMENT = 1,   // Already in the environment (the launch environment wins)
+    VMA_SETTING_IGNORED = 2        // Requested, but libvma was already running with another value
+} vma_setting_source_t;
+
+// One VMA environment setting
+typedef struct {
+    char name[32];                 // Variable name (VMA_SPEC, VMA_RX_POLL, ...)
+    char requested[256];           // Value derived from the options
+    char effective[256];           // Value libvma uses ("" for libvma's default)
+    vma_setting_source_t source;   // Where the effective value came from
+} vma_runtime_setting_t;
+
+// Result of vma_runtime_init
+typedef enum {
+    VMA_RUNTIME_OK = 0,                    // Configured by this call without conflicts
+    VMA_RUNTIME_ALREADY_INITIALIZED = 1,   // An earlier call configured the process (its report is returned)
+    VMA_RUNTIME_ERROR_INVALID_PARAM = -1,
+    VMA_RUNTIME_ERROR_CONFLICT = -2        // Settings conflict; see the report warnings
+} vma_runtime_result_t;
+
+// Process-wide VMA configuration report
+typedef struct {
+    vma_options_t options;                  // Options of the call that configured the process
+    bool vma_loaded;                        // libvma is loaded (vma_get_api() succeeded)
+    bool socketxtreme_available;            // libvma exposes socketxtreme_poll
+    bool conflict;                          // A conflict was found (see warnings)
+    int setting_count;                      // Number of settings
+    vma_runtime_setting_t settings[VMA_RUNTIME_MAX_SETTINGS]; // Settings derived from the options
+    int warning_count;                      // Number of warnings
+    char warnings[VMA_RUNTIME_MAX_WARNINGS][160]; // Human-readable findings
+} vma_runtime_report_t;
+
+/**
+ * Configure the VMA environment once per process and report the settings in effect
+ * 
+ * Call before creating the first socket (socket creation calls it with the
+ * socket's options otherwise; the first call wins). When libvma is already
+ * loaded (LD_PRELOAD) it has read its environment and nothing is changed;
+ * requested values that differ from what it uses are reported. Values set in
+ * the launch environment are never overwritten.
+ * 
+ * @param options VMA options (use default if NULL)
+ * @param report Report of the settings in effect (can be NULL)
+ * @return Result code
+ */
+vma_runtime_result_t vma_runtime_init(const vma_options_t* options, vma_runtime_report_t* report);
+
 /**
  * Set up VMA environment variables based on options
  * 
+ * Superseded by vma_runtime_init, which it calls; kept for existing callers.
+ * 
  * @param options VMA options structure
  */
 void vma_setup_environment(const vma_options_t* options);
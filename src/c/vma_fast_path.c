@@ -0,0 +1,96 @@
+/**
+ * vma_fast_path.c - Handle preparation and out-of-line copies of the inline variants
+ *
+ * C callers include vma_fast_path.h and get the variants inlined. The *_ffi
+ * functions below are the same code as real symbols for the Rust bindings;
+ * built with the crate's "lto" feature they are inlined across the language
+ * boundary as well.
+ */
+
+#include <string.h>
+#include "vma_fast_path.h"
+
+udp_result_t udp_fast_tx_prepare(udp_socket_t* socket, const udp_endpoint_t* endpoint, udp_fast_tx_t* tx) {
+    if (!socket || socket->socket_fd < 0 || !tx) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    if (!endpoint && !socket->is_connected) {
+        return UDP_ERROR_NOT_INITIALIZED;
+    }
+
+    memset(tx, 0, sizeof(*tx));
+    tx->fd = socket->socket_fd;
+    tx->stats = socket->stats;
+    tx->dest = endpoint ? endpoint->addr : socket->remote_addr;
+
+    return UDP_SUCCESS;
+}
+
+udp_result_t udp_fast_rx_prepare(udp_socket_t* socket, udp_fast_rx_t* rx) {
+    if (!socket || socket->socket_fd < 0 || !rx) {
+        return UDP_ERROR_INVALID_PARAM;
+    }
+
+    memset(rx, 0, sizeof(*rx));
+    rx->fd = socket->socket_fd;
+    rx->stats = socket->stats;
+    rx->polling = socket->wait_mode.use_polling;
+    rx->adaptive = socket->wait_mode.adaptive;
+    rx->socket = socket;
+
+    return UDP_SUCCESS;
+}
+
+tcp_result_t tcp_fast_prepare(tcp_socket_t* sock, tcp_fast_t* fast) {
+    if (!sock || sock->socket_fd < 0 || !fast) {
+        return TCP_ERROR_INVALID_PARAM;
+    }
+
+    if (sock->state != TCP_STATE_CONNECTED) {
+        return TCP_ERROR_NOT_INITIALIZED;
+    }
+
+    memset(fast, 0, sizeof(*fast));
+    fast->fd = sock->socket_fd;
+    fast->stats = sock->stats;
+    fast->polling = sock->wait_mode.use_polling;
+    fast->adaptive = sock->wait_mode.adaptive;
+    fast->socket = sock;
+
+    return TCP_SUCCESS;
+}
+
+udp_result_t udp_fast_send_connected_ffi(const udp_fast_tx_t* tx, const void* data, size_t length,
+                                     size_t* bytes_sent) {
+    return udp_fast_send_connected(tx, data, length, bytes_sent);
+}
+
+udp_result_t udp_fast_send_to_ffi(const udp_fast_tx_t* tx, const void* data, size_t length,
+                              size_t* bytes_sent) {
+    return udp_fast_send_to(tx, data, length, bytes_sent);
+}
+
+udp_result_t udp_fast_recv_ffi(udp_fast_rx_t* rx, void* buffer, size_t buffer_size, int timeout_ms,
+                           size_t* bytes_received) {
+    return udp_fast_recv(rx, buffer, buffer_size, timeout_ms, bytes_received);
+}
+
+udp_result_t udp_fast_recv_poll_ffi(udp_fast_rx_t* rx, void* buffer, size_t buffer_size, int timeout_ms,
+                                size_t* bytes_received) {
+    return udp_fast_recv_poll(rx, buffer, buffer_size, timeout_ms, bytes_received);
+}
+
+tcp_result_t tcp_fast_send_ffi(tcp_fast_t* fast, const void* data, size_t length, size_t* bytes_sent) {
+    return tcp_fast_send(fast, data, length, bytes_sent);
+}
+
+tcp_result_t tcp_fast_recv_ffi(tcp_fast_t* fast, void* buffer, size_t buffer_size, int timeout_ms,
+                           size_t* bytes_received) {
+    return tcp_fast_recv(fast, buffer, buffer_size, timeout_ms, bytes_received);
+}
+
+tcp_result_t tcp_fast_recv_poll_ffi(tcp_fast_t* fast, void* buffer, size_t buffer_size, int timeout_ms,
+                                size_t* bytes_received) {
+    return tcp_fast_recv_poll(fast, buffer, buffer_size, timeout_ms, bytes_received);
+}
@@ -0,0 +1,379 @@
+/**
+ * vma_fast_path.h - Inline send/receive variants for a prepared socket
+ *
+ * The regular socket calls check their arguments and the socket state and
+ * branch on the wait policy on every call. A hot loop that sends to one
+ * destination or receives from one socket can validate that once: prepare a
+ * handle (udp_fast_tx_prepare, udp_fast_rx_prepare, tcp_fast_prepare), then
+ * call the static inline variant that matches the socket's setup. The
+ * variants do no argument checks, go straight to the syscall and keep the
+ * socket's counters and trace records like the regular calls. Receive
+ * buffers must not be empty: a zero-length TCP read reports the connection
+ * closed (the Rust handles check this).
+ *
+ *   udp_fast_send_connected / udp_fast_send_to   connected / per-endpoint send
+ *   udp_fast_recv / tcp_fast_recv                 one inline attempt, waits out of line
+ *   udp_fast_recv_poll / tcp_fast_recv_poll       inline busy-poll until the deadline
+ *
+ * A handle copies the descriptor: prepare it again after the socket is
+ * reconnected or closed. Like the socket, it belongs to one thread.
+ */
+
+#ifndef VMA_FAST_PATH_H
+#define VMA_FAST_PATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "udp_socket.h"
+#include "tcp_socket.h"
+#include "vma_stats.h"
+#include "vma_trace.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VMA_FAST_PAUSE() _mm_pause()
+#else
+#define VMA_FAST_PAUSE() do {} while (0)
+#endif
+
+// Prepared UDP send path
+typedef struct {
+    int fd;                        // Socket descriptor
+    vma_stats_t* stats;            // Counters of the socket
+    struct sockaddr_in dest;       // Destination of udp_fast_send_to
+} udp_fast_tx_t;
+
+// Prepared UDP receive path
+typedef struct {
+    int fd;                        // Socket descriptor
+    vma_stats_t* stats;            // Counters of the socket
+    bool polling;                  // The socket busy-polls (use udp_fast_recv_poll)
+    bool adaptive;                 // The socket's adaptive wait needs the last receive time
+    udp_socket_t* socket;          // Socket the out-of-line wait goes through
+} udp_fast_rx_t;
+
+// Prepared path of a connected TCP socket
+typedef struct {
+    int fd;                        // Socket descriptor
+    vma_stats_t* stats;            // Counters of the socket
+    bool polling;                  // The socket busy-polls (use tcp_fast_recv_poll)
+    bool adaptive;                 // The socket's adaptive wait needs the last receive time
+    tcp_socket_t* socket;          // Socket the out-of-line wait and state changes go through
+} tcp_fast_t;
+
+/**
+ * Prepare the send path of a UDP socket
+ *
+ * @param socket Socket to send through
+ * @param endpoint Destination of udp_fast_send_to (NULL for the connected address; the socket must be connected)
+ * @param tx Handle to fill
+ * @return Result code
+ */
+udp_result_t udp_fast_tx_prepare(udp_socket_t* socket, const udp_endpoint_t* endpoint, udp_fast_tx_t* tx);
+
+/**
+ * Prepare the receive path of a UDP socket
+ *
+ * @param socket Socket to receive from
+ * @param rx Handle to fill
+ * @return Result code
+ */
+udp_result_t udp_fast_rx_prepare(udp_socket_t* socket, udp_fast_rx_t* rx);
+
+/**
+ * Prepare the send and receive path of a connected TCP socket
+ *
+ * @param sock Connected socket
+ * @param fast Handle to fill
+ * @return Result code (TCP_ERROR_NOT_INITIALIZED if not connected)
+ */
+tcp_result_t tcp_fast_prepare(tcp_socket_t* sock, tcp_fast_t* fast);
+
+static inline bool vma_fast_would_block(void) {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+/**
+ * Send a datagram to the connected address
+ *
+ * @param tx Handle prepared without an endpoint
+ * @param data Data to send
+ * @param length Data length (nonzero)
+ * @param bytes_sent Number of bytes sent
+ * @return Result code (UDP_ERROR_TIMEOUT if the socket buffer is full)
+ */
+static inline udp_result_t udp_fast_send_connected(const udp_fast_tx_t* tx, const void* data,
+                                               size_t length, size_t* bytes_sent) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    ssize_t res = send(tx->fd, data, length, 0);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+
+    if (__builtin_expect(res < 0, 0)) {
+        bool blocked = vma_fast_would_block();
+        vma_stats_tx_miss(tx->stats, blocked);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND, tx->fd,
+                                blocked ? UDP_ERROR_TIMEOUT : UDP_ERROR_SEND, 0);
+    }
+
+    *bytes_sent = (size_t)res;
+    vma_stats_tx(tx->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
+
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SEND, tx->fd, UDP_SUCCESS, res);
+}
+
+/**
+ * Send a datagram to the prepared endpoint
+ *
+ * @param tx Handle prepared with an endpoint
+ * @param data Data to send
+ * @param length Data length (nonzero)
+ * @param bytes_sent Number of bytes sent
+ * @return Result code (UDP_ERROR_TIMEOUT if the socket buffer is full)
+ */
+static inline udp_result_t udp_fast_send_to(const udp_fast_tx_t* tx, const void* data,
+                                        size_t length, size_t* bytes_sent) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    ssize_t res = sendto(tx->fd, data, length, 0, (const struct sockaddr*)&tx->dest, sizeof(tx->dest));
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+
+    if (__builtin_expect(res < 0, 0)) {
+        bool blocked = vma_fast_would_block();
+        vma_stats_tx_miss(tx->stats, blocked);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SENDTO, tx->fd,
+                                blocked ? UDP_ERROR_TIMEOUT : UDP_ERROR_SEND, 0);
+    }
+
+    *bytes_sent = (size_t)res;
+    vma_stats_tx(tx->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
+
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_SENDTO, tx->fd, UDP_SUCCESS, res);
+}
+
+/**
+ * Receive a datagram, trying once inline and waiting through udp_socket_recv
+ * when nothing is queued
+ *
+ * @param rx Prepared handle
+ * @param buffer Buffer to store received data
+ * @param buffer_size Buffer size (nonzero)
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param bytes_received Number of bytes received
+ * @return Result code (same as udp_socket_recv)
+ */
+static inline udp_result_t udp_fast_recv(udp_fast_rx_t* rx, void* buffer, size_t buffer_size,
+                                     int timeout_ms, size_t* bytes_received) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    ssize_t res = recv(rx->fd, buffer, buffer_size, MSG_DONTWAIT);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+
+    if (__builtin_expect(res > 0, 1)) {
+        *bytes_received = (size_t)res;
+        if (rx->adaptive) {
+            rx->socket->wait_stats.last_rx_ns = vma_clock_ns();
+        }
+        vma_stats_rx(rx->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, 0);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_SUCCESS, res);
+    }
+
+    if (res < 0 && !vma_fast_would_block()) {
+        vma_stats_rx_miss(rx->stats, false, 0);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_ERROR_RECV, 0);
+    } else if (res == 0) {
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_ERROR_CLOSED, 0);
+    }
+
+    // Nothing queued: the regular call waits under the socket's policy
+    return udp_socket_recv(rx->socket, buffer, buffer_size, timeout_ms, bytes_received);
+}
+
+/**
+ * Receive a datagram, busy-polling inline until the deadline
+ *
+ * @param rx Prepared handle
+ * @param buffer Buffer to store received data
+ * @param buffer_size Buffer size (nonzero)
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param bytes_received Number of bytes received
+ * @return Result code (same as udp_socket_recv)
+ */
+static inline udp_result_t udp_fast_recv_poll(udp_fast_rx_t* rx, void* buffer, size_t buffer_size,
+                                          int timeout_ms, size_t* bytes_received) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t deadline_ns = 0;
+    uint64_t empty_polls = 0;
+
+    for (;;) {
+        uint64_t start_ticks = vma_clock_ticks();
+        ssize_t res = recv(rx->fd, buffer, buffer_size, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+
+        if (__builtin_expect(res > 0, 1)) {
+            *bytes_received = (size_t)res;
+            rx->socket->wait_stats.spin_hits++;
+            vma_stats_rx(rx->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, empty_polls);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_SUCCESS, res);
+        }
+
+        if (res < 0 && !vma_fast_would_block()) {
+            vma_stats_rx_miss(rx->stats, false, empty_polls);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_ERROR_RECV, 0);
+        } else if (res == 0) {
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_ERROR_CLOSED, 0);
+        }
+
+        // The deadline is armed on the first miss so a hit never reads the clock for it
+        empty_polls++;
+        if (deadline_ns == 0) {
+            deadline_ns = timeout_ms < 0 ? UINT64_MAX : vma_clock_ns() + (uint64_t)timeout_ms * 1000000ull;
+        }
+        if (timeout_ms == 0 || (deadline_ns != UINT64_MAX && vma_clock_ns() >= deadline_ns)) {
+            vma_stats_rx_miss(rx->stats, true, empty_polls);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_UDP_RECV, rx->fd, UDP_ERROR_TIMEOUT, 0);
+        }
+        VMA_FAST_PAUSE();
+    }
+}
+
+/**
+ * Send data on the connection (may send less than length)
+ *
+ * @param fast Prepared handle
+ * @param data Data to send
+ * @param length Data length (nonzero)
+ * @param bytes_sent Number of bytes sent
+ * @return Result code (same as tcp_socket_send; a send error marks the socket disconnected)
+ */
+static inline tcp_result_t tcp_fast_send(tcp_fast_t* fast, const void* data, size_t length,
+                                     size_t* bytes_sent) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    ssize_t res = send(fast->fd, data, length, MSG_NOSIGNAL);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+
+    if (__builtin_expect(res < 0, 0)) {
+        if (vma_fast_would_block()) {
+            vma_stats_tx_miss(fast->stats, true);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, fast->fd, TCP_ERROR_WOULD_BLOCK, 0);
+        }
+        vma_stats_tx_miss(fast->stats, false);
+        fast->socket->state = TCP_STATE_DISCONNECTED;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, fast->fd, TCP_ERROR_SEND, 0);
+    }
+
+    *bytes_sent = (size_t)res;
+    vma_stats_tx(fast->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks);
+
+    return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_SEND, fast->fd, TCP_SUCCESS, res);
+}
+
+/**
+ * Receive data, trying once inline and waiting through tcp_socket_recv when
+ * nothing is queued
+ *
+ * @param fast Prepared handle
+ * @param buffer Buffer to store received data
+ * @param buffer_size Buffer size (nonzero)
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param bytes_received Number of bytes received
+ * @return Result code (same as tcp_socket_recv)
+ */
+static inline tcp_result_t tcp_fast_recv(tcp_fast_t* fast, void* buffer, size_t buffer_size,
+                                     int timeout_ms, size_t* bytes_received) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t start_ticks = vma_clock_ticks();
+    ssize_t res = recv(fast->fd, buffer, buffer_size, MSG_DONTWAIT);
+    VMA_TRACE_SYSCALL(trace, start_ticks);
+
+    if (__builtin_expect(res > 0, 1)) {
+        *bytes_received = (size_t)res;
+        if (fast->adaptive) {
+            fast->socket->wait_stats.last_rx_ns = vma_clock_ns();
+        }
+        vma_stats_rx(fast->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, 0);
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_SUCCESS, res);
+    }
+
+    if (res < 0 && !vma_fast_would_block()) {
+        vma_stats_rx_miss(fast->stats, false, 0);
+        fast->socket->state = TCP_STATE_DISCONNECTED;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_ERROR_RECV, 0);
+    } else if (res == 0) {
+        // Connection closed by peer
+        fast->socket->state = TCP_STATE_DISCONNECTED;
+        return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_ERROR_CLOSED, 0);
+    }
+
+    // Nothing queued: the regular call waits under the socket's policy
+    return tcp_socket_recv(fast->socket, buffer, buffer_size, timeout_ms, bytes_received);
+}
+
+/**
+ * Receive data, busy-polling inline until the deadline
+ *
+ * @param fast Prepared handle
+ * @param buffer Buffer to store received data
+ * @param buffer_size Buffer size (nonzero)
+ * @param timeout_ms Timeout in milliseconds (0 for non-blocking, -1 for infinite wait)
+ * @param bytes_received Number of bytes received
+ * @return Result code (same as tcp_socket_recv)
+ */
+static inline tcp_result_t tcp_fast_recv_poll(tcp_fast_t* fast, void* buffer, size_t buffer_size,
+                                          int timeout_ms, size_t* bytes_received) {
+    VMA_TRACE_BEGIN(trace);
+    uint64_t deadline_ns = 0;
+    uint64_t empty_polls = 0;
+
+    for (;;) {
+        uint64_t start_ticks = vma_clock_ticks();
+        ssize_t res = recv(fast->fd, buffer, buffer_size, MSG_DONTWAIT);
+        VMA_TRACE_SYSCALL(trace, start_ticks);
+
+        if (__builtin_expect(res > 0, 1)) {
+            *bytes_received = (size_t)res;
+            fast->socket->wait_stats.spin_hits++;
+            vma_stats_rx(fast->stats, 1, (uint64_t)res, vma_clock_ticks() - start_ticks, empty_polls);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_SUCCESS, res);
+        }
+
+        if (res < 0 && !vma_fast_would_block()) {
+            vma_stats_rx_miss(fast->stats, false, empty_polls);
+            fast->socket->state = TCP_STATE_DISCONNECTED;
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_ERROR_RECV, 0);
+        } else if (res == 0) {
+            fast->socket->state = TCP_STATE_DISCONNECTED;
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_ERROR_CLOSED, 0);
+        }
+
+        empty_polls++;
+        if (deadline_ns == 0) {
+            deadline_ns = timeout_ms < 0 ? UINT64_MAX : vma_clock_ns() + (uint64_t)timeout_ms * 1000000ull;
+        }
+        if (timeout_ms == 0 || (deadline_ns != UINT64_MAX && vma_clock_ns() >= deadline_ns)) {
+            vma_stats_rx_miss(fast->stats, true, empty_polls);
+            return VMA_TRACE_RETURN(trace, VMA_TRACE_TCP_RECV, fast->fd, TCP_ERROR_TIMEOUT, 0);
+        }
+        VMA_FAST_PAUSE();
+    }
+}
+
+// Out-of-line copies of the variants above (for the Rust bindings)
+udp_result_t udp_fast_send_connected_ffi(const udp_fast_tx_t* tx, const void* data, size_t length,
+                                     size_t* bytes_sent);
+udp_result_t udp_fast_send_to_ffi(const udp_fast_tx_t* tx, const void* data, size_t length,
+                              size_t* bytes_sent);
+udp_result_t udp_fast_recv_ffi(udp_fast_rx_t* rx, void* buffer, size_t buffer_size, int timeout_ms,
+                           size_t* bytes_received);
+udp_result_t udp_fast_recv_poll_ffi(udp_fast_rx_t* rx, void* buffer, size_t buffer_size, int timeout_ms,
+                                size_t* bytes_received);
+tcp_result_t tcp_fast_send_ffi(tcp_fast_t* fast, const void* data, size_t length, size_t* bytes_sent);
+tcp_result_t tcp_fast_recv_ffi(tcp_fast_t* fast, void* buffer, size_t buffer_size, int timeout_ms,
+                           size_t* bytes_received);
+tcp_result_t tcp_fast_recv_poll_ffi(tcp_fast_t* fast, void* buffer, size_t buffer_size, int timeout_ms,
+                                size_t* bytes_received);
+
+#endif /* VMA_FAST_PATH_H */
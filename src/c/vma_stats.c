@@ -0,0 +1,188 @@
+/**
+ * vma_stats.c - Per-socket statistics block with latency histograms
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+#include <linux/sock_diag.h>
+#include "vma_stats.h"
+#include "vma_common.h"
+#include <mellanox/vma_extra.h>
+
+#define HIST_SUB_COUNT (1u << VMA_STATS_HIST_SUB_BITS)
+
+// Open an update: readers seeing an odd sequence retry
+static void write_begin(vma_stats_t* stats) {
+    __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Publish an update
+static void write_end(vma_stats_t* stats) {
+    __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELEASE);
+}
+
+vma_stats_t* vma_stats_create(void) {
+    vma_stats_t* stats = aligned_alloc(VMA_STATS_CACHE_LINE, sizeof(vma_stats_t));
+    if (stats) {
+        memset(stats, 0, sizeof(vma_stats_t));
+    }
+    return stats;
+}
+
+void vma_stats_destroy(vma_stats_t* stats) {
+    free(stats);
+}
+
+void vma_stats_reset(vma_stats_t* stats) {
+    if (!stats) {
+        return;
+    }
+
+    write_begin(stats);
+    memset(&stats->values, 0, sizeof(stats->values));
+    write_end(stats);
+}
+
+int vma_stats_bucket(uint64_t ticks) {
+    if (ticks < HIST_SUB_COUNT) {
+        return (int)ticks;
+    }
+
+    // Power-of-two group, then linear sub-bucket from the bits below the top one
+    int msb = 63 - __builtin_clzll(ticks);
+    int bucket = ((msb - VMA_STATS_HIST_SUB_BITS + 1) << VMA_STATS_HIST_SUB_BITS) +
+                 (int)((ticks >> (msb - VMA_STATS_HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+
+    return bucket < VMA_STATS_HIST_BUCKETS ? bucket : VMA_STATS_HIST_BUCKETS - 1;
+}
+
+uint64_t vma_stats_bucket_floor(int bucket) {
+    if (bucket < (int)HIST_SUB_COUNT) {
+        return bucket < 0 ? 0 : (uint64_t)bucket;
+    }
+
+    int group = bucket >> VMA_STATS_HIST_SUB_BITS;
+    uint64_t sub = (uint64_t)(bucket & (HIST_SUB_COUNT - 1));
+    return (HIST_SUB_COUNT | sub) << (group - 1);
+}
+
+void vma_stats_rx(vma_stats_t* stats, uint64_t packets, uint64_t bytes, uint64_t ticks,
+                uint64_t empty_polls) {
+    if (!stats) {
+        return;
+    }
+
+    write_begin(stats);
+    stats->values.rx_packets += packets;
+    stats->values.rx_bytes += bytes;
+    stats->values.rx_would_block += empty_polls;
+    stats->values.recv_latency[vma_stats_bucket(ticks)]++;
+    write_end(stats);
+}
+
+void vma_stats_rx_miss(vma_stats_t* stats, bool timed_out, uint64_t empty_polls) {
+    if (!stats) {
+        return;
+    }
+
+    write_begin(stats);
+    stats->values.rx_would_block += empty_polls;
+    if (timed_out) {
+        stats->values.rx_timeouts++;
+    } else {
+        stats->values.rx_errors++;
+    }
+    write_end(stats);
+}
+
+void vma_stats_tx(vma_stats_t* stats, uint64_t packets, uint64_t bytes, uint64_t ticks) {
+    if (!stats) {
+        return;
+    }
+
+    write_begin(stats);
+    stats->values.tx_packets += packets;
+    stats->values.tx_bytes += bytes;
+    stats->values.send_latency[vma_stats_bucket(ticks)]++;
+    write_end(stats);
+}
+
+void vma_stats_tx_miss(vma_stats_t* stats, bool would_block) {
+    if (!stats) {
+        return;
+    }
+
+    write_begin(stats);
+    if (would_block) {
+        stats->values.tx_would_block++;
+    } else {
+        stats->values.tx_errors++;
+    }
+    write_end(stats);
+}
+
+void vma_stats_snapshot(const vma_stats_t* stats, vma_stats_values_t* out) {
+    if (!out) {
+        return;
+    }
+
+    if (!stats) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    uint64_t before, after = 0;
+    do {
+        before = __atomic_load_n(&stats->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;  // Update in progress
+        }
+        memcpy(out, &stats->values, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&stats->seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
+
+void vma_socket_info_query(int fd, vma_socket_info_t* out) {
+    if (!out) {
+        return;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->rx_ready_bytes = -1;
+    out->tx_queued_bytes = -1;
+
+    struct vma_api_t* api = vma_common_get_api();
+    out->vma_loaded = api != NULL;
+    if (api && api->get_socket_rings_fds) {
+        int rings = api->get_socket_rings_fds(fd, out->ring_fds, VMA_SOCKET_MAX_RINGS);
+        if (rings > 0) {
+            out->ring_count = rings;
+            out->offloaded = true;
+        }
+    }
+
+    int queued;
+    if (ioctl(fd, FIONREAD, &queued) == 0) {
+        out->rx_ready_bytes = queued;
+    }
+    if (ioctl(fd, SIOCOUTQ, &queued) == 0) {
+        out->tx_queued_bytes = queued;
+    }
+
+#ifdef SO_MEMINFO
+    // Under VMA this reaches the kernel socket, which sees only the OS-path traffic
+    uint32_t meminfo[SK_MEMINFO_VARS];
+    socklen_t len = sizeof(meminfo);
+    if (getsockopt(fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == 0 && len > SK_MEMINFO_DROPS * sizeof(uint32_t)) {
+        out->meminfo_valid = true;
+        out->kernel_rx_drops = meminfo[SK_MEMINFO_DROPS];
+        out->kernel_rmem_alloc = meminfo[SK_MEMINFO_RMEM_ALLOC];
+        out->kernel_rcvbuf = meminfo[SK_MEMINFO_RCVBUF];
+    }
+#endif
+}
@@ -0,0 +1,157 @@
+/**
+ * vma_stats.h - Per-socket statistics block with latency histograms
+ */
+
+#ifndef VMA_STATS_H
+#define VMA_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Sub-buckets per power of two in the latency histograms (2^bits)
+#define VMA_STATS_HIST_SUB_BITS 2
+
+// Number of latency histogram buckets (covers up to 2^33 ticks, larger values land in the last bucket)
+#define VMA_STATS_HIST_BUCKETS 128
+
+// Cache line size used to align the statistics block
+#define VMA_STATS_CACHE_LINE 64
+
+// Statistics values (plain copy returned by vma_stats_snapshot)
+typedef struct {
+    uint64_t rx_packets;            // Number of received packets
+    uint64_t tx_packets;            // Number of transmitted packets
+    uint64_t rx_bytes;              // Number of received bytes
+    uint64_t tx_bytes;              // Number of transmitted bytes
+    uint64_t rx_would_block;        // Receive attempts that found nothing queued (EAGAIN)
+    uint64_t rx_timeouts;           // Receive calls that returned a timeout
+    uint64_t rx_errors;             // Receive calls that failed
+    uint64_t tx_would_block;        // Send calls that would have blocked
+    uint64_t tx_errors;             // Send calls that failed
+    uint64_t recv_latency[VMA_STATS_HIST_BUCKETS]; // Successful receive syscall duration (clock ticks)
+    uint64_t send_latency[VMA_STATS_HIST_BUCKETS]; // Successful send syscall duration (clock ticks)
+} vma_stats_values_t;
+
+// Statistics block (single writer, lock-free readers via a sequence counter)
+typedef struct {
+    uint64_t seq;                   // Sequence counter (odd while an update is in progress)
+    vma_stats_values_t values;      // Counters and histograms
+} __attribute__((aligned(VMA_STATS_CACHE_LINE))) vma_stats_t;
+
+// Maximum number of VMA ring descriptors reported per socket
+#define VMA_SOCKET_MAX_RINGS 8
+
+// Offload and queue state of one socket (filled by vma_socket_info_query)
+typedef struct {
+    bool vma_loaded;                // libvma is loaded
+    bool offloaded;                 // VMA serves the socket from its own rings (false: kernel path)
+    int32_t ring_count;             // VMA rings serving the socket (0 when not offloaded)
+    int32_t ring_fds[VMA_SOCKET_MAX_RINGS]; // Ring channel descriptors, stable ring ids (first ring_count, up to the max)
+    int32_t rx_ready_bytes;         // Bytes ready to read (FIONREAD: VMA's ready queue when offloaded; -1 if unknown)
+    int32_t tx_queued_bytes;        // Bytes queued for sending or awaiting ACK (SIOCOUTQ; -1 if unknown)
+    bool meminfo_valid;             // The kernel_* fields were read (SO_MEMINFO)
+    uint32_t kernel_rx_drops;       // Packets the kernel socket dropped on a full receive queue
+    uint32_t kernel_rmem_alloc;     // Bytes on the kernel socket's receive queue
+    uint32_t kernel_rcvbuf;         // Kernel socket receive buffer limit
+} vma_socket_info_t;
+
+/**
+ * Allocate a cache-line-aligned statistics block
+ *
+ * @return Zeroed statistics block, or NULL on allocation failure
+ */
+vma_stats_t* vma_stats_create(void);
+
+/**
+ * Free a statistics block allocated with vma_stats_create
+ *
+ * @param stats Statistics block (can be NULL)
+ */
+void vma_stats_destroy(vma_stats_t* stats);
+
+/**
+ * Reset all counters and histograms (owner thread only)
+ *
+ * @param stats Statistics block
+ */
+void vma_stats_reset(vma_stats_t* stats);
+
+/**
+ * Record a successful receive (owner thread only)
+ *
+ * @param stats Statistics block (can be NULL)
+ * @param packets Number of packets received
+ * @param bytes Number of bytes received
+ * @param ticks Duration of the receive syscall in clock ticks
+ * @param empty_polls Attempts that found nothing queued before data arrived
+ */
+void vma_stats_rx(vma_stats_t* stats, uint64_t packets, uint64_t bytes, uint64_t ticks,
+                uint64_t empty_polls);
+
+/**
+ * Record a receive that timed out or failed (owner thread only)
+ *
+ * @param stats Statistics block (can be NULL)
+ * @param timed_out Whether the call timed out (false for an error)
+ * @param empty_polls Attempts that found nothing queued
+ */
+void vma_stats_rx_miss(vma_stats_t* stats, bool timed_out, uint64_t empty_polls);
+
+/**
+ * Record a successful send (owner thread only)
+ *
+ * @param stats Statistics block (can be NULL)
+ * @param packets Number of packets sent
+ * @param bytes Number of bytes sent
+ * @param ticks Duration of the send syscall in clock ticks
+ */
+void vma_stats_tx(vma_stats_t* stats, uint64_t packets, uint64_t bytes, uint64_t ticks);
+
+/**
+ * Record a send that would block or failed (owner thread only)
+ *
+ * @param stats Statistics block (can be NULL)
+ * @param would_block Whether the send would have blocked (false for an error)
+ */
+void vma_stats_tx_miss(vma_stats_t* stats, bool would_block);
+
+/**
+ * Take a consistent copy of the statistics from any thread
+ *
+ * Retries while the owner is updating; never blocks the owner.
+ *
+ * @param stats Statistics block (can be NULL, yielding zeros)
+ * @param out Destination
+ */
+void vma_stats_snapshot(const vma_stats_t* stats, vma_stats_values_t* out);
+
+/**
+ * Histogram bucket of a latency value
+ *
+ * @param ticks Latency in clock ticks
+ * @return Bucket index
+ */
+int vma_stats_bucket(uint64_t ticks);
+
+/**
+ * Smallest latency counted in a histogram bucket
+ *
+ * @param bucket Bucket index
+ * @return Lower bound in clock ticks
+ */
+uint64_t vma_stats_bucket_floor(int bucket);
+
+/**
+ * Query the offload and queue state of a socket
+ *
+ * Reads the VMA rings serving the socket (vma_api_t::get_socket_rings_fds),
+ * the ready and queued byte counts and the kernel socket's memory counters.
+ * Fields that cannot be read are left at their "unknown" values.
+ *
+ * @param fd Socket descriptor
+ * @param out Destination
+ */
+void vma_socket_info_query(int fd, vma_socket_info_t* out);
+
+#endif /* VMA_STATS_H */
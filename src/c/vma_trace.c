@@ -0,0 +1,152 @@
+/**
+ * vma_trace.c - Per-call hot-path tracing into shared memory
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "vma_trace.h"
+
+bool vma_trace_compiled(void) {
+#ifdef VMA_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifndef VMA_TRACE
+
+void vma_trace_init(void) {
+}
+
+#else
+
+// Read before the segment exists, so the hot-path check never sees NULL
+static const uint32_t trace_off = 0;
+const volatile uint32_t* vma_trace_enabled = &trace_off;
+
+static vma_trace_header_t* trace_header = NULL;
+static char trace_name[64];
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+
+// Ring of the calling thread (NULL until claimed, trace_none when none was free)
+static __thread vma_trace_ring_t* thread_ring = NULL;
+static vma_trace_ring_t trace_none;
+
+static vma_trace_ring_t* ring_at(uint32_t index) {
+    return (vma_trace_ring_t*)(trace_header + 1) + index;
+}
+
+static void remove_segment(void) {
+    shm_unlink(trace_name);
+}
+
+// Thread exit: free the ring for the next thread (the records stay readable)
+static void release_ring(void* value) {
+    vma_trace_ring_t* ring = value;
+    __atomic_store_n(&ring->tid, 0, __ATOMIC_RELEASE);
+}
+
+static void create_segment(void) {
+    vma_clock_init();
+
+    snprintf(trace_name, sizeof(trace_name), "/vma_trace.%d", (int)getpid());
+    size_t size = sizeof(vma_trace_header_t) + VMA_TRACE_MAX_THREADS * sizeof(vma_trace_ring_t);
+
+    int fd = shm_open(trace_name, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if (fd < 0) {
+        return;
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        shm_unlink(trace_name);
+        return;
+    }
+
+    // Pages of rings no thread claims are never touched
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(trace_name);
+        return;
+    }
+
+    pthread_key_create(&ring_key, release_ring);
+
+    trace_header = base;
+    trace_header->version = VMA_TRACE_VERSION;
+    trace_header->pid = (uint32_t)getpid();
+    trace_header->clock_mult = vma_clock_ticks_to_ns(1ULL << 32);
+    trace_header->ring_count = VMA_TRACE_MAX_THREADS;
+    trace_header->ring_size = VMA_TRACE_RING_SIZE;
+    trace_header->record_size = sizeof(vma_trace_record_t);
+
+    const char* env = getenv("VMA_TRACE");
+    trace_header->enabled = (env && strcmp(env, "1") == 0) ? 1 : 0;
+
+    // Readers check the magic last
+    __atomic_store_n(&trace_header->magic, VMA_TRACE_MAGIC, __ATOMIC_RELEASE);
+    vma_trace_enabled = &trace_header->enabled;
+    atexit(remove_segment);
+}
+
+void vma_trace_init(void) {
+    pthread_once(&trace_once, create_segment);
+}
+
+static vma_trace_ring_t* claim_ring(void) {
+    uint32_t tid = (uint32_t)syscall(SYS_gettid);
+
+    for (uint32_t i = 0; i < VMA_TRACE_MAX_THREADS; i++) {
+        vma_trace_ring_t* ring = ring_at(i);
+        uint32_t expected = 0;
+        if (__atomic_load_n(&ring->tid, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&ring->tid, &expected, tid, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            // head keeps counting across owners, so reader cursors stay valid
+            __atomic_store_n(&ring->generation, ring->generation + 1, __ATOMIC_RELEASE);
+            pthread_setspecific(ring_key, ring);
+            return ring;
+        }
+    }
+
+    __atomic_fetch_add(&trace_header->unclaimed, 1, __ATOMIC_RELAXED);
+    return &trace_none;
+}
+
+void vma_trace_record(const vma_trace_span_t* span, vma_trace_op_t op, int fd, int result,
+                    uint64_t bytes) {
+    uint64_t exit_ticks = vma_clock_ticks();
+
+    vma_trace_ring_t* ring = thread_ring;
+    if (!ring) {
+        ring = thread_ring = claim_ring();
+    }
+    if (ring == &trace_none) {
+        return;
+    }
+
+    uint64_t head = ring->head;
+    vma_trace_record_t* record = &ring->records[head & (VMA_TRACE_RING_SIZE - 1)];
+    record->entry = span->entry;
+    record->attempt = span->attempt;
+    record->syscall_end = span->syscall_end;
+    record->exit = exit_ticks;
+    record->fd = fd;
+    record->op = (int16_t)op;
+    record->result = (int16_t)result;
+    record->bytes = bytes > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes;
+    record->reserved = 0;
+
+    // Publish; a reader copying the slot this overwrites sees head move past it
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* VMA_TRACE */
@@ -0,0 +1,170 @@
+/**
+ * vma_trace.h - Per-call hot-path tracing into shared memory
+ *
+ * Built only with VMA_TRACE defined (the crate's "trace" feature); otherwise
+ * every macro below expands to nothing. When built in, the socket calls stamp
+ * the clock at entry, before the syscall that returned (after any waiting),
+ * after it and at exit, and append the stamps to a per-thread ring in a
+ * shared memory segment (/dev/shm/vma_trace.<pid>). Recording starts switched
+ * off unless VMA_TRACE=1 is in the environment; a reader in another process
+ * switches it on and off through the segment header, so a disabled build
+ * costs one load and branch per call.
+ */
+
+#ifndef VMA_TRACE_H
+#define VMA_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vma_common.h"
+
+// Segment layout version (bumped on any change to the structures below)
+#define VMA_TRACE_VERSION 1
+#define VMA_TRACE_MAGIC 0x43525456u    // "VTRC"
+
+// Number of per-thread rings and records per ring (power of two)
+#define VMA_TRACE_MAX_THREADS 64
+#define VMA_TRACE_RING_SIZE 4096
+
+// Traced operations
+typedef enum {
+    VMA_TRACE_UDP_SEND = 1,
+    VMA_TRACE_UDP_SENDTO = 2,
+    VMA_TRACE_UDP_SEND_BATCH = 3,
+    VMA_TRACE_UDP_RECV = 4,
+    VMA_TRACE_UDP_RECVFROM = 5,
+    VMA_TRACE_UDP_RECV_BATCH = 6,
+    VMA_TRACE_UDP_RECV_ZCOPY = 7,
+    VMA_TRACE_TCP_SEND = 8,
+    VMA_TRACE_TCP_SEND_CLIENT = 9,
+    VMA_TRACE_TCP_RECV = 10,
+    VMA_TRACE_TCP_RECV_CLIENT = 11,
+    VMA_TRACE_UDP_SEND_SEGMENTED = 12,
+    VMA_TRACE_UDP_RECV_GRO = 13,
+    VMA_TRACE_UDP_PACER_FLUSH = 14,
+    VMA_TRACE_TCP_SEND_ZEROCOPY = 15,
+    VMA_TRACE_TCP_SEND_ZEROCOPY_CLIENT = 16
+} vma_trace_op_t;
+
+// One traced call (clock ticks, see vma_trace_header_t::clock_mult)
+typedef struct {
+    uint64_t entry;                // Call entry
+    uint64_t attempt;              // Start of the last syscall (entry + time spent waiting)
+    uint64_t syscall_end;          // Return of the last syscall
+    uint64_t exit;                 // Call exit
+    int32_t fd;                    // Socket descriptor
+    int16_t op;                    // vma_trace_op_t
+    int16_t result;                // Result code returned by the call
+    uint32_t bytes;                // Bytes (or datagrams, for batch calls) transferred
+    uint32_t reserved;
+} vma_trace_record_t;
+
+// Per-thread ring (single writer; readers use head to tell which records are intact)
+typedef struct {
+    uint32_t tid;                  // Owning thread (0 while free)
+    uint32_t generation;           // Bumped each time a thread claims the ring
+    uint64_t head;                 // Records written so far (atomic, release)
+    uint8_t pad[48];
+    vma_trace_record_t records[VMA_TRACE_RING_SIZE];
+} vma_trace_ring_t;
+
+// Segment header, followed by VMA_TRACE_MAX_THREADS rings
+typedef struct {
+    uint32_t magic;                // VMA_TRACE_MAGIC
+    uint32_t version;              // VMA_TRACE_VERSION
+    uint32_t pid;                  // Traced process
+    uint32_t enabled;              // Nonzero while recording (written by readers, atomic)
+    uint64_t clock_mult;           // Nanoseconds per tick in 32.32 fixed point
+    uint32_t ring_count;           // VMA_TRACE_MAX_THREADS
+    uint32_t ring_size;            // VMA_TRACE_RING_SIZE
+    uint32_t record_size;          // sizeof(vma_trace_record_t)
+    uint32_t unclaimed;            // Threads that found no free ring (not traced, atomic)
+    uint8_t pad[24];
+} vma_trace_header_t;
+
+/**
+ * Create the trace segment (once per process; socket init calls it)
+ *
+ * Does nothing unless built with VMA_TRACE.
+ */
+void vma_trace_init(void);
+
+/**
+ * Whether the library was built with tracing
+ *
+ * @return true when built with VMA_TRACE
+ */
+bool vma_trace_compiled(void);
+
+#ifdef VMA_TRACE
+
+// Stamps of the call in progress (entry is 0 when recording is off)
+typedef struct {
+    uint64_t entry;
+    uint64_t attempt;
+    uint64_t syscall_end;
+} vma_trace_span_t;
+
+// Points at the segment's enabled word (a constant 0 until the segment exists)
+extern const volatile uint32_t* vma_trace_enabled;
+
+/**
+ * Append a finished call to the calling thread's ring
+ *
+ * @param span Stamps of the call
+ * @param op Operation
+ * @param fd Socket descriptor
+ * @param result Result code
+ * @param bytes Bytes or datagrams transferred
+ */
+void vma_trace_record(const vma_trace_span_t* span, vma_trace_op_t op, int fd, int result,
+                    uint64_t bytes);
+
+static inline void vma_trace_begin(vma_trace_span_t* span) {
+    span->entry = __builtin_expect(__atomic_load_n(vma_trace_enabled, __ATOMIC_RELAXED), 0)
+                  ? vma_clock_ticks() : 0;
+    span->attempt = span->entry;
+    span->syscall_end = span->entry;
+}
+
+static inline int vma_trace_end(const vma_trace_span_t* span, vma_trace_op_t op, int fd, int result,
+                            uint64_t bytes) {
+    if (__builtin_expect(span->entry != 0, 0)) {
+        vma_trace_record(span, op, fd, result, bytes);
+    }
+    return result;
+}
+
+// Start tracing a call
+#define VMA_TRACE_BEGIN(span) vma_trace_span_t span; vma_trace_begin(&span)
+
+// Stamp the start of a syscall, for calls that do not read the clock themselves
+#define VMA_TRACE_ATTEMPT(span) \
+    do { \
+        if (__builtin_expect((span).entry != 0, 0)) { \
+            (span).attempt = vma_clock_ticks(); \
+        } \
+    } while (0)
+
+// Stamp the return of a syscall that started at start_ticks (vma_clock_ticks)
+#define VMA_TRACE_SYSCALL(span, start_ticks) \
+    do { \
+        if (__builtin_expect((span).entry != 0, 0)) { \
+            (span).attempt = (start_ticks); \
+            (span).syscall_end = vma_clock_ticks(); \
+        } \
+    } while (0)
+
+// Record the call and evaluate to result
+#define VMA_TRACE_RETURN(span, op, fd, result, bytes) vma_trace_end(&(span), (op), (fd), (result), (bytes))
+
+#else
+
+#define VMA_TRACE_BEGIN(span) do {} while (0)
+#define VMA_TRACE_ATTEMPT(span) do {} while (0)
+#define VMA_TRACE_SYSCALL(span, start_ticks) do {} while (0)
+#define VMA_TRACE_RETURN(span, op, fd, result, bytes) (result)
+
+#endif /* VMA_TRACE */
+
+#endif /* VMA_TRACE_H */
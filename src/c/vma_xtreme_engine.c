@@ -0,0 +1,419 @@
+/**
+ * vma_xtreme_engine.c - SocketXtreme completion engine implementation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "vma_xtreme_engine.h"
+#include <mellanox/vma_extra.h>
+
+#define ENTRY_EMPTY   -1
+#define ENTRY_REMOVED -2
+
+// Hash slot for a file descriptor
+static size_t entry_slot(int fd) {
+    return ((uint32_t)fd * 2654435761u) & (VMA_XTREME_MAX_SOCKETS - 1);
+}
+
+// Find the entry of a registered fd (NULL if not registered)
+static vma_xtreme_entry_t* find_entry(vma_xtreme_engine_t* engine, int fd) {
+    size_t slot = entry_slot(fd);
+
+    for (size_t i = 0; i < VMA_XTREME_MAX_SOCKETS; i++) {
+        vma_xtreme_entry_t* entry = &engine->entries[(slot + i) & (VMA_XTREME_MAX_SOCKETS - 1)];
+        if (entry->fd == fd) {
+            return entry;
+        }
+        if (entry->fd == ENTRY_EMPTY) {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+// Insert or update an fd (NULL if the table is full)
+static vma_xtreme_entry_t* insert_entry(vma_xtreme_engine_t* engine, int fd, uint64_t user_data) {
+    vma_xtreme_entry_t* entry = find_entry(engine, fd);
+    if (entry) {
+        entry->user_data = user_data;
+        return entry;
+    }
+
+    size_t slot = entry_slot(fd);
+    for (size_t i = 0; i < VMA_XTREME_MAX_SOCKETS; i++) {
+        entry = &engine->entries[(slot + i) & (VMA_XTREME_MAX_SOCKETS - 1)];
+        if (entry->fd == ENTRY_EMPTY || entry->fd == ENTRY_REMOVED) {
+            entry->fd = fd;
+            entry->user_data = user_data;
+            engine->socket_count++;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+// Add the rings of a socket to the engine's ring list
+static vma_xtreme_result_t add_socket_rings(vma_xtreme_engine_t* engine, int fd) {
+    if (!engine->api) {
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+    
+    int rings[VMA_XTREME_MAX_RINGS];
+    int count = engine->api->get_socket_rings_fds(fd, rings, VMA_XTREME_MAX_RINGS);
+
+    if (count <= 0) {
+        return VMA_XTREME_ERROR_NO_RINGS;
+    }
+
+    for (int i = 0; i < count; i++) {
+        bool known = false;
+        for (int j = 0; j < engine->ring_count; j++) {
+            if (engine->ring_fds[j] == rings[i]) {
+                known = true;
+                break;
+            }
+        }
+
+        if (!known) {
+            if (engine->ring_count >= VMA_XTREME_MAX_RINGS) {
+                return VMA_XTREME_ERROR_FULL;
+            }
+            engine->ring_fds[engine->ring_count++] = rings[i];
+        }
+    }
+
+    return VMA_XTREME_SUCCESS;
+}
+
+// Fill an event with the fields common to every type
+static void init_event(vma_xtreme_engine_t* engine, vma_xtreme_event_t* event,
+                    vma_xtreme_event_type_t type, int fd) {
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    event->fd = fd;
+    event->listen_fd = -1;
+
+    vma_xtreme_entry_t* entry = find_entry(engine, fd);
+    event->user_data = entry ? entry->user_data : 0;
+}
+
+size_t vma_xtreme_engine_translate(vma_xtreme_engine_t* engine, const struct vma_completion_t* completion,
+                                vma_xtreme_event_t* out) {
+    // Sockets are registered with their own fd as VMA user data
+    int fd = (int)completion->user_data;
+    size_t count = 0;
+
+    if (completion->events & VMA_SOCKETXTREME_NEW_CONNECTION_ACCEPTED) {
+        // The new connection inherits the listener's user data
+        vma_xtreme_entry_t* listener = find_entry(engine, completion->listen_fd);
+        uint64_t user_data = listener ? listener->user_data : 0;
+
+        if (insert_entry(engine, fd, user_data)) {
+            add_socket_rings(engine, fd);
+        }
+
+        init_event(engine, &out[count], VMA_XTREME_EVENT_ACCEPTED, fd);
+        out[count].listen_fd = completion->listen_fd;
+        out[count].src_addr = completion->src;
+        count++;
+    }
+
+    if (completion->events & VMA_SOCKETXTREME_PACKET) {
+        const struct vma_packet_desc_t* packet = &completion->packet;
+        vma_xtreme_event_t* event = &out[count++];
+
+        init_event(engine, event, VMA_XTREME_EVENT_PACKET, fd);
+        event->total_length = packet->total_len;
+        event->num_bufs = packet->num_bufs;
+        event->src_addr = completion->src;
+        event->hw_timestamp = (uint64_t)packet->hw_timestamp.tv_sec * 1000000000ULL +
+                            (uint64_t)packet->hw_timestamp.tv_nsec;
+        event->vma_buffers = packet->buff_lst;
+
+        if (packet->buff_lst) {
+            event->data = packet->buff_lst->payload;
+            event->length = packet->buff_lst->len;
+        }
+    }
+
+    if (completion->events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        init_event(engine, &out[count], (completion->events & EPOLLERR) ?
+                VMA_XTREME_EVENT_ERROR : VMA_XTREME_EVENT_CLOSED, fd);
+        count++;
+
+        // A closed socket produces no further completions
+        vma_xtreme_engine_remove_fd(engine, fd);
+    }
+
+    return count;
+}
+
+// Poll one ring, returns the number of events stored or -1 on error
+static int poll_ring(vma_xtreme_engine_t* engine, int ring_fd, vma_xtreme_event_t* events, size_t max_events) {
+    struct vma_completion_t completions[VMA_XTREME_MAX_COMPLETIONS];
+
+    // Every completion can produce up to VMA_XTREME_EVENTS_PER_COMPLETION events
+    size_t want = max_events / VMA_XTREME_EVENTS_PER_COMPLETION;
+    if (want > VMA_XTREME_MAX_COMPLETIONS) {
+        want = VMA_XTREME_MAX_COMPLETIONS;
+    }
+    if (want == 0) {
+        return 0;
+    }
+
+    int res = engine->api->socketxtreme_poll(ring_fd, completions, (unsigned int)want, 0);
+    if (res < 0) {
+        return -1;
+    }
+
+    size_t stored = 0;
+    for (int i = 0; i < res; i++) {
+        stored += vma_xtreme_engine_translate(engine, &completions[i], &events[stored]);
+    }
+
+    return (int)stored;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_init(vma_xtreme_engine_t* engine) {
+    if (!engine) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    memset(engine, 0, sizeof(vma_xtreme_engine_t));
+    for (size_t i = 0; i < VMA_XTREME_MAX_SOCKETS; i++) {
+        engine->entries[i].fd = ENTRY_EMPTY;
+    }
+
+    engine->api = vma_common_get_api();
+    if (!engine->api || !engine->api->socketxtreme_poll || !engine->api->get_socket_rings_fds ||
+        !engine->api->socketxtreme_free_vma_packets) {
+        engine->api = NULL;
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+
+    return VMA_XTREME_SUCCESS;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_close(vma_xtreme_engine_t* engine) {
+    if (!engine) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    engine->api = NULL;
+    engine->ring_count = 0;
+    engine->socket_count = 0;
+    for (size_t i = 0; i < VMA_XTREME_MAX_SOCKETS; i++) {
+        engine->entries[i].fd = ENTRY_EMPTY;
+    }
+
+    return VMA_XTREME_SUCCESS;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_add_fd(vma_xtreme_engine_t* engine, int fd, uint64_t user_data) {
+    if (!engine || fd < 0) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    if (!engine->api) {
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+
+    if (!insert_entry(engine, fd, user_data)) {
+        return VMA_XTREME_ERROR_FULL;
+    }
+
+    // Completions carry the fd so events can be mapped back to the entry
+    void* context = (void*)(uintptr_t)fd;
+    setsockopt(fd, SOL_SOCKET, SO_VMA_USER_DATA, &context, sizeof(context));
+
+    vma_xtreme_result_t result = add_socket_rings(engine, fd);
+    if (result != VMA_XTREME_SUCCESS) {
+        vma_xtreme_engine_remove_fd(engine, fd);
+        return result;
+    }
+
+    return VMA_XTREME_SUCCESS;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_add_udp(vma_xtreme_engine_t* engine, udp_socket_t* socket, uint64_t user_data) {
+    if (!socket || socket->socket_fd < 0) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    return vma_xtreme_engine_add_fd(engine, socket->socket_fd, user_data);
+}
+
+vma_xtreme_result_t vma_xtreme_engine_add_tcp(vma_xtreme_engine_t* engine, tcp_socket_t* socket, uint64_t user_data) {
+    if (!socket || socket->socket_fd < 0) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    return vma_xtreme_engine_add_fd(engine, socket->socket_fd, user_data);
+}
+
+vma_xtreme_result_t vma_xtreme_engine_remove_fd(vma_xtreme_engine_t* engine, int fd) {
+    if (!engine || fd < 0) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    vma_xtreme_entry_t* entry = find_entry(engine, fd);
+    if (!entry) {
+        return VMA_XTREME_ERROR_NOT_FOUND;
+    }
+
+    // Rings are shared between sockets and stay in the ring list
+    entry->fd = ENTRY_REMOVED;
+    entry->user_data = 0;
+    engine->socket_count--;
+
+    return VMA_XTREME_SUCCESS;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_poll(vma_xtreme_engine_t* engine, vma_xtreme_event_t* events,
+                                        size_t max_events, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!engine || !events || max_events < VMA_XTREME_EVENTS_PER_COMPLETION) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    if (!engine->api) {
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+
+    size_t stored = 0;
+    for (int i = 0; i < engine->ring_count && stored + VMA_XTREME_EVENTS_PER_COMPLETION <= max_events; i++) {
+        int res = poll_ring(engine, engine->ring_fds[i], &events[stored], max_events - stored);
+        if (res < 0) {
+            if (n) {
+                *n = stored;
+            }
+            return VMA_XTREME_ERROR_POLL;
+        }
+        stored += (size_t)res;
+    }
+
+    engine->events_polled += stored;
+
+    if (n) {
+        *n = stored;
+    }
+
+    return VMA_XTREME_SUCCESS;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_dispatch(vma_xtreme_engine_t* engine, vma_xtreme_callback_t callback,
+                                            void* context, size_t* n) {
+    if (n) {
+        *n = 0;
+    }
+
+    if (!engine || !callback) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    if (!engine->api) {
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+
+    vma_xtreme_event_t events[VMA_XTREME_EVENTS_PER_COMPLETION * VMA_XTREME_MAX_COMPLETIONS];
+    vma_xtreme_result_t result = VMA_XTREME_SUCCESS;
+    size_t delivered = 0;
+
+    for (int i = 0; i < engine->ring_count; i++) {
+        int res = poll_ring(engine, engine->ring_fds[i], events,
+                            VMA_XTREME_EVENTS_PER_COMPLETION * VMA_XTREME_MAX_COMPLETIONS);
+        if (res < 0) {
+            result = VMA_XTREME_ERROR_POLL;
+            continue;
+        }
+
+        for (int j = 0; j < res; j++) {
+            callback(&events[j], context);
+        }
+
+        vma_xtreme_engine_release(engine, events, (size_t)res);
+        delivered += (size_t)res;
+    }
+
+    engine->events_polled += delivered;
+
+    if (n) {
+        *n = delivered;
+    }
+
+    return result;
+}
+
+vma_xtreme_result_t vma_xtreme_engine_release(vma_xtreme_engine_t* engine, vma_xtreme_event_t* events, size_t count) {
+    if (!engine || (!events && count > 0)) {
+        return VMA_XTREME_ERROR_INVALID_PARAM;
+    }
+
+    if (!engine->api) {
+        return VMA_XTREME_ERROR_NOT_AVAILABLE;
+    }
+
+    struct vma_packet_desc_t packets[VMA_XTREME_MAX_COMPLETIONS];
+    int pending = 0;
+    vma_xtreme_result_t result = VMA_XTREME_SUCCESS;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!events[i].vma_buffers) {
+            continue;
+        }
+
+        memset(&packets[pending], 0, sizeof(packets[pending]));
+        packets[pending].num_bufs = events[i].num_bufs;
+        packets[pending].total_len = (uint16_t)events[i].total_length;
+        packets[pending].buff_lst = (struct vma_buff_t*)events[i].vma_buffers;
+        pending++;
+
+        events[i].vma_buffers = NULL;
+        events[i].data = NULL;
+
+        if (pending == VMA_XTREME_MAX_COMPLETIONS) {
+            if (engine->api->socketxtreme_free_vma_packets(packets, pending) < 0) {
+                result = VMA_XTREME_ERROR_POLL;
+            }
+            pending = 0;
+        }
+    }
+
+    if (pending > 0) {
+        if (engine->api->socketxtreme_free_vma_packets(packets, pending) < 0) {
+            result = VMA_XTREME_ERROR_POLL;
+        }
+    }
+
+    return result;
+}
+
+size_t vma_xtreme_event_copy(const vma_xtreme_event_t* event, void* buffer, size_t buffer_size) {
+    if (!event || !buffer || !event->vma_buffers) {
+        return 0;
+    }
+
+    size_t offset = 0;
+    for (struct vma_buff_t* buff = (struct vma_buff_t*)event->vma_buffers;
+        buff && offset < buffer_size; buff = buff->next) {
+        size_t chunk = buff->len;
+        if (chunk > buffer_size - offset) {
+            chunk = buffer_size - offset;
+        }
+        memcpy((char*)buffer + offset, buff->payload, chunk);
+        offset += chunk;
+    }
+
+    return offset;
+}
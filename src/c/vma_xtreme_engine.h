@@ -0,0 +1,207 @@
+/**
+ * vma_xtreme_engine.h - SocketXtreme completion engine for many UDP/TCP sockets
+ */
+
+#ifndef VMA_XTREME_ENGINE_H
+#define VMA_XTREME_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "vma_common.h"
+#include "udp_socket.h"
+#include "tcp_socket.h"
+
+// Maximum number of sockets registered with one engine (power of two)
+#define VMA_XTREME_MAX_SOCKETS 1024
+
+// Maximum number of distinct VMA rings driven by one engine
+#define VMA_XTREME_MAX_RINGS 64
+
+// Maximum number of completions drained from a ring per poll
+#define VMA_XTREME_MAX_COMPLETIONS 64
+
+// Most events one completion produces (ACCEPTED, PACKET and CLOSED or ERROR)
+#define VMA_XTREME_EVENTS_PER_COMPLETION 3
+
+struct vma_completion_t;
+
+// Completion event types
+typedef enum {
+    VMA_XTREME_EVENT_PACKET = 1,       // Data received on a registered socket
+    VMA_XTREME_EVENT_ACCEPTED = 2,     // New connection accepted on a registered listener
+    VMA_XTREME_EVENT_CLOSED = 3,       // Peer closed the connection (EPOLLRDHUP / EPOLLHUP)
+    VMA_XTREME_EVENT_ERROR = 4         // Socket error (EPOLLERR)
+} vma_xtreme_event_type_t;
+
+// Completion event
+typedef struct {
+    vma_xtreme_event_type_t type;  // Event type
+    int fd;                        // Socket the event belongs to (the new connection for ACCEPTED)
+    int listen_fd;                 // Listening socket (ACCEPTED only, -1 otherwise)
+    uint64_t user_data;            // Value given at registration (the listener's for ACCEPTED)
+    const void* data;              // First receive buffer (PACKET only, VMA-owned)
+    size_t length;                 // Length of the first receive buffer
+    size_t total_length;           // Total packet length across all chained buffers
+    size_t num_bufs;               // Number of chained VMA buffers
+    struct sockaddr_in src_addr;   // Source address (PACKET on UDP, peer address for ACCEPTED)
+    uint64_t hw_timestamp;         // Hardware receive timestamp in nanoseconds (0 if unavailable)
+    void* vma_buffers;             // Internal: VMA buffer chain to release (NULL when nothing to release)
+} vma_xtreme_event_t;
+
+// Registered socket entry
+typedef struct {
+    int fd;                        // Socket file descriptor (-1 empty, -2 removed)
+    uint64_t user_data;            // Application value reported with every event
+} vma_xtreme_entry_t;
+
+// Engine structure
+typedef struct {
+    struct vma_api_t* api;                              // VMA extra API
+    int ring_fds[VMA_XTREME_MAX_RINGS];                 // Distinct ring fds of all registered sockets
+    int ring_count;                                     // Number of ring fds
+    vma_xtreme_entry_t entries[VMA_XTREME_MAX_SOCKETS]; // fd -> user data (open addressing)
+    int socket_count;                                   // Number of registered sockets
+    uint64_t events_polled;                             // Total number of events produced
+} vma_xtreme_engine_t;
+
+// Event callback (packet buffers are released after the callback returns)
+typedef void (*vma_xtreme_callback_t)(const vma_xtreme_event_t* event, void* context);
+
+// Result codes
+typedef enum {
+    VMA_XTREME_SUCCESS = 0,
+    VMA_XTREME_ERROR_NOT_AVAILABLE = -1,   // VMA is not loaded or SocketXtreme is not supported
+    VMA_XTREME_ERROR_INVALID_PARAM = -2,
+    VMA_XTREME_ERROR_FULL = -3,            // Socket or ring table is full
+    VMA_XTREME_ERROR_NOT_FOUND = -4,
+    VMA_XTREME_ERROR_POLL = -5,
+    VMA_XTREME_ERROR_NO_RINGS = -6         // Socket has no VMA ring (not offloaded, or not bound yet)
+} vma_xtreme_result_t;
+
+/**
+ * Initialize a SocketXtreme engine
+ *
+ * Requires VMA to be loaded with VMA_SOCKETXTREME=1 (vma_options_t.use_socketxtreme).
+ *
+ * @param engine Pointer to the engine structure to initialize
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_init(vma_xtreme_engine_t* engine);
+
+/**
+ * Release an engine (registered sockets are not closed)
+ *
+ * @param engine Pointer to the engine structure
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_close(vma_xtreme_engine_t* engine);
+
+/**
+ * Register a socket by file descriptor
+ *
+ * The socket must already own its VMA rings (bound UDP socket, listening or
+ * connected TCP socket).
+ *
+ * @param engine Pointer to the engine structure
+ * @param fd Socket file descriptor
+ * @param user_data Value reported with every event of this socket
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_add_fd(vma_xtreme_engine_t* engine, int fd, uint64_t user_data);
+
+/**
+ * Register a UDP socket
+ *
+ * @param engine Pointer to the engine structure
+ * @param socket Bound UDP socket
+ * @param user_data Value reported with every event of this socket
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_add_udp(vma_xtreme_engine_t* engine, udp_socket_t* socket, uint64_t user_data);
+
+/**
+ * Register a TCP socket (listening or connected)
+ *
+ * Connections accepted on a registered listener are registered automatically
+ * with the listener's user data.
+ *
+ * @param engine Pointer to the engine structure
+ * @param socket TCP socket
+ * @param user_data Value reported with every event of this socket
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_add_tcp(vma_xtreme_engine_t* engine, tcp_socket_t* socket, uint64_t user_data);
+
+/**
+ * Unregister a socket
+ *
+ * @param engine Pointer to the engine structure
+ * @param fd Socket file descriptor
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_remove_fd(vma_xtreme_engine_t* engine, int fd);
+
+/**
+ * Poll all rings once and store completions in an array
+ *
+ * PACKET events reference VMA buffers that must be returned with
+ * vma_xtreme_engine_release once processed.
+ *
+ * @param engine Pointer to the engine structure
+ * @param events Output event array
+ * @param max_events Size of the event array (at least VMA_XTREME_EVENTS_PER_COMPLETION)
+ * @param n Number of events stored (can be NULL)
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_poll(vma_xtreme_engine_t* engine, vma_xtreme_event_t* events,
+                                        size_t max_events, size_t* n);
+
+/**
+ * Poll all rings once and deliver completions to a callback
+ *
+ * @param engine Pointer to the engine structure
+ * @param callback Function called for every event
+ * @param context Value passed to the callback
+ * @param n Number of events delivered (can be NULL)
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_dispatch(vma_xtreme_engine_t* engine, vma_xtreme_callback_t callback,
+                                            void* context, size_t* n);
+
+/**
+ * Translate one SocketXtreme completion into events
+ *
+ * The poll and dispatch paths run every completion through this; it registers
+ * connections accepted on a registered listener and unregisters closed sockets.
+ *
+ * @param engine Pointer to the engine structure
+ * @param completion Completion read with socketxtreme_poll
+ * @param out Destination for up to VMA_XTREME_EVENTS_PER_COMPLETION events
+ * @return Number of events stored
+ */
+size_t vma_xtreme_engine_translate(vma_xtreme_engine_t* engine, const struct vma_completion_t* completion,
+                                vma_xtreme_event_t* out);
+
+/**
+ * Return the VMA buffers referenced by polled events
+ *
+ * @param engine Pointer to the engine structure
+ * @param events Events returned by vma_xtreme_engine_poll
+ * @param count Number of events
+ * @return Result code
+ */
+vma_xtreme_result_t vma_xtreme_engine_release(vma_xtreme_engine_t* engine, vma_xtreme_event_t* events, size_t count);
+
+/**
+ * Copy the full payload of a PACKET event (all chained buffers)
+ *
+ * @param event PACKET event
+ * @param buffer Destination buffer
+ * @param buffer_size Destination buffer size
+ * @return Number of bytes copied
+ */
+size_t vma_xtreme_event_copy(const vma_xtreme_event_t* event, void* buffer, size_t buffer_size);
+
+#endif /* VMA_XTREME_ENGINE_H */
@@ -1,12 +1,32 @@
 //! Common types and utilities for VMA socket implementations.
 
-use std::net::{IpAddr, Ipv4Addr, SocketAddr};
-use std::os::raw::c_int;
+use std::net::{IpAddr, Ipv4Addr, SocketAddr, SocketAddrV4};
+use std::os::raw::{c_char, c_int};
 use serde::{Serialize, Deserialize, Serializer, Deserializer};
 use serde::de::{self, Visitor};
 
-/// Maximum number of CPU cores that can be specified
-const MAX_CPU_CORES: usize = 128;
+/// Maximum number of CPU cores that can be specified (matches `MAX_CPU_CORES` in vma_common.h)
+const MAX_CPU_CORES: usize = 64;
+
+/// VMA ring a socket's traffic is placed on (matches `vma_ring_placement_t`).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum RingPlacement {
+    /// Process-wide `VMA_RING_ALLOCATION_LOGIC_RX`/`_TX`
+    #[default]
+    Default = 0,
+    /// Ring shared by every socket on the interface
+    Interface = 1,
+    /// Ring of its own (isolates a latency-critical socket from bulk traffic)
+    Socket = 2,
+    /// Ring of the thread that first sends or receives on the socket
+    Thread = 3,
+    /// Ring of the core that first sends or receives on the socket
+    Core = 4,
+    /// Ring shared by the sockets with the same `ring_key` (one ring per traffic class)
+    UserKey = 5,
+}
 
 /// C-compatible VMA options structure that directly matches the C definition.
 /// This version is thread-safe by using a fixed-size array instead of raw pointers.
@@ -41,6 +61,16 @@ pub struct VmaOptions {
     pub cpu_cores: [c_int; MAX_CPU_CORES],
     /// Number of CPU cores in the array
     pub cpu_cores_count: c_int,
+    /// Busy-poll for `spin_budget_us` after each packet, then block (overrides `use_polling`)
+    pub adaptive_polling: bool,
+    /// Adaptive busy-poll window in microseconds
+    pub spin_budget_us: u32,
+    /// VMA ring the socket is placed on (applied when the socket is created)
+    pub ring_placement: RingPlacement,
+    /// Ring id for `RingPlacement::UserKey`
+    pub ring_key: u64,
+    /// Allocate the ring from a separate VMA ring profile (`vma_add_ring_profile`)
+    pub dedicated_ring_profile: bool,
 }
 
 impl Serialize for VmaOptions {
@@ -50,7 +80,7 @@ impl Serialize for VmaOptions {
     {
         use serde::ser::SerializeStruct;
         
-        let mut state = serializer.serialize_struct("VmaOptions", 14)?;
+        let mut state = serializer.serialize_struct("VmaOptions", 19)?;
         state.serialize_field("use_socketxtreme", &self.use_socketxtreme)?;
         state.serialize_field("optimize_for_latency", &self.optimize_for_latency)?;
         state.serialize_field("use_polling", &self.use_polling)?;
@@ -68,6 +98,11 @@ impl Serialize for VmaOptions {
         let active_cores = &self.cpu_cores[0..self.cpu_cores_count as usize];
         state.serialize_field("cpu_cores", active_cores)?;
         state.serialize_field("cpu_cores_count", &self.cpu_cores_count)?;
+        state.serialize_field("adaptive_polling", &self.adaptive_polling)?;
+        state.serialize_field("spin_budget_us", &self.spin_budget_us)?;
+        state.serialize_field("ring_placement", &self.ring_placement)?;
+        state.serialize_field("ring_key", &self.ring_key)?;
+        state.serialize_field("dedicated_ring_profile", &self.dedicated_ring_profile)?;
         
         state.end()
     }
@@ -95,6 +130,11 @@ impl<'de> Deserialize<'de> for VmaOptions {
             KeepQpFull,
             CpuCores,
             CpuCoresCount,
+            AdaptivePolling,
+            SpinBudgetUs,
+            RingPlacement,
+            RingKey,
+            DedicatedRingProfile,
         }
 
         struct VmaOptionsVisitor;
@@ -157,6 +197,21 @@ impl<'de> Deserialize<'de> for VmaOptions {
                         Field::CpuCoresCount => {
                             options.cpu_cores_count = map.next_value()?;
                         }
+                        Field::AdaptivePolling => {
+                            options.adaptive_polling = map.next_value()?;
+                        }
+                        Field::SpinBudgetUs => {
+                            options.spin_budget_us = map.next_value()?;
+                        }
+                        Field::RingPlacement => {
+                            options.ring_placement = map.next_value()?;
+                        }
+                        Field::RingKey => {
+                            options.ring_key = map.next_value()?;
+                        }
+                        Field::DedicatedRingProfile => {
+                            options.dedicated_ring_profile = map.next_value()?;
+                        }
                     }
                 }
 
@@ -183,7 +238,8 @@ impl<'de> Deserialize<'de> for VmaOptions {
         const FIELDS: &[&str] = &[
             "use_socketxtreme", "optimize_for_latency", "use_polling", "ring_count",
             "buffer_size", "enable_timestamps", "use_hugepages", "tx_bufs", "rx_bufs",
-            "disable_poll_yield", "skip_os_select", "keep_qp_full", "cpu_cores", "cpu_cores_count"
+            "disable_poll_yield", "skip_os_select", "keep_qp_full", "cpu_cores", "cpu_cores_count",
+            "adaptive_polling", "spin_budget_us", "ring_placement", "ring_key", "dedicated_ring_profile"
         ];
 
         deserializer.deserialize_struct("VmaOptions", FIELDS, VmaOptionsVisitor)
@@ -207,6 +263,11 @@ impl Default for VmaOptions {
             keep_qp_full: true,
             cpu_cores: [0; MAX_CPU_CORES],
             cpu_cores_count: 0,
+            adaptive_polling: false,
+            spin_budget_us: 0,
+            ring_placement: RingPlacement::Default,
+            ring_key: 0,
+            dedicated_ring_profile: false,
         }
     }
 }
@@ -265,6 +326,39 @@ impl VmaOptions {
             keep_qp_full: true,
             cpu_cores: [0; MAX_CPU_CORES],
             cpu_cores_count: 0,
+            adaptive_polling: false,
+            spin_budget_us: 0,
+            ring_placement: RingPlacement::Default,
+            ring_key: 0,
+            dedicated_ring_profile: false,
+        }
+    }
+    
+    /// Create options for bursty feeds: busy-poll for `spin_budget_us` after each
+    /// packet, then block until the next burst.
+    pub fn adaptive(spin_budget_us: u32) -> Self {
+        VmaOptions {
+            use_polling: false,
+            adaptive_polling: true,
+            spin_budget_us,
+            ..VmaOptions::low_latency()
+        }
+    }
+    
+    /// Place sockets created with these options on their own VMA ring, or on the
+    /// ring shared by one traffic class (`RingPlacement::UserKey` with `key`).
+    ///
+    /// ```rust,no_run
+    /// use vma_socket::common::{RingPlacement, VmaOptions};
+    ///
+    /// let orders = VmaOptions::low_latency().with_ring(RingPlacement::Socket, 0);
+    /// let feeds = VmaOptions::high_throughput().with_ring(RingPlacement::UserKey, 7);
+    /// ```
+    pub fn with_ring(self, placement: RingPlacement, key: u64) -> Self {
+        VmaOptions {
+            ring_placement: placement,
+            ring_key: key,
+            ..self
         }
     }
     
@@ -285,10 +379,37 @@ impl VmaOptions {
             keep_qp_full: true,
             cpu_cores: [0; MAX_CPU_CORES],
             cpu_cores_count: 0,
+            adaptive_polling: false,
+            spin_budget_us: 0,
+            ring_placement: RingPlacement::Default,
+            ring_key: 0,
+            dedicated_ring_profile: false,
         }
     }
 }
 
+/// C representation of the receive wait policy derived from `VmaOptions`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct WaitMode {
+    pub use_polling: bool,
+    pub allow_yield: bool,
+    pub adaptive: bool,
+    pub spin_budget_ns: u64,
+}
+
+/// Receive wait counters, used to tune `spin_budget_us`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct WaitStats {
+    /// Clock time of the last successful receive (adaptive mode only)
+    pub last_rx_ns: u64,
+    /// Receives that found data while busy-polling
+    pub spin_hits: u64,
+    /// Receives that found data after a blocking wait
+    pub blocking_wakeups: u64,
+}
+
 /// Internal representation of socket address in C format.
 #[repr(C)]
 #[derive(Debug, Clone)]
@@ -314,6 +435,145 @@ pub fn sockaddr_to_rust(sockaddr: &SockAddrIn) -> SocketAddr {
     SocketAddr::new(IpAddr::V4(ip), port)
 }
 
+/// Convert a Rust IPv4 socket address to the C socket address structure.
+pub fn sockaddr_from_rust(addr: &SocketAddrV4) -> SockAddrIn {
+    SockAddrIn {
+        sin_family: libc::AF_INET as u16,
+        sin_port: addr.port().to_be(),
+        sin_addr: u32::from(*addr.ip()).to_be(),
+        sin_zero: [0; 8],
+    }
+}
+
+/// Where the value of a VMA setting in effect came from.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SettingSource {
+    /// Set from the options before libvma read its environment
+    Applied,
+    /// Already in the environment (the launch environment wins)
+    Environment,
+    /// Requested, but libvma was already running with another value
+    Ignored,
+}
+
+/// One VMA environment setting.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct RuntimeSetting {
+    /// Variable name (`VMA_SPEC`, `VMA_RX_POLL`, ...)
+    pub name: String,
+    /// Value derived from the options
+    pub requested: String,
+    /// Value libvma uses (empty for libvma's default)
+    pub effective: String,
+    /// Where the effective value came from
+    pub source: SettingSource,
+}
+
+/// Process-wide VMA configuration report returned by [`vma_runtime_init`].
+#[derive(Debug, Clone)]
+pub struct RuntimeReport {
+    /// Options of the call that configured the process
+    pub options: VmaOptions,
+    /// Whether this call configured the process (false if an earlier call or socket did)
+    pub first_call: bool,
+    /// libvma is loaded
+    pub vma_loaded: bool,
+    /// libvma exposes the SocketXtreme API
+    pub socketxtreme_available: bool,
+    /// A conflicting setting was found (see `warnings`)
+    pub conflict: bool,
+    /// Settings derived from the options
+    pub settings: Vec<RuntimeSetting>,
+    /// Human-readable findings
+    pub warnings: Vec<String>,
+}
+
+const VMA_RUNTIME_MAX_SETTINGS: usize = 24;
+const VMA_RUNTIME_MAX_WARNINGS: usize = 8;
+
+// Result codes (match `vma_runtime_result_t`)
+const VMA_RUNTIME_OK: c_int = 0;
+const VMA_RUNTIME_ALREADY_INITIALIZED: c_int = 1;
+
+// Setting sources (match `vma_setting_source_t`)
+const VMA_SETTING_ENVIRONMENT: c_int = 1;
+const VMA_SETTING_IGNORED: c_int = 2;
+
+#[repr(C)]
+struct RuntimeSettingRaw {
+    name: [c_char; 32],
+    requested: [c_char; 256],
+    effective: [c_char; 256],
+    source: c_int,
+}
+
+#[repr(C)]
+struct RuntimeReportRaw {
+    options: VmaOptions,
+    vma_loaded: bool,
+    socketxtreme_available: bool,
+    conflict: bool,
+    setting_count: c_int,
+    settings: [RuntimeSettingRaw; VMA_RUNTIME_MAX_SETTINGS],
+    warning_count: c_int,
+    warnings: [[c_char; 160]; VMA_RUNTIME_MAX_WARNINGS],
+}
+
+extern "C" {
+    #[link_name = "vma_runtime_init"]
+    fn ffi_runtime_init(options: *const VmaOptions, report: *mut RuntimeReportRaw) -> c_int;
+}
+
+fn c_text(text: &[c_char]) -> String {
+    let bytes: Vec<u8> = text.iter().take_while(|&&c| c != 0).map(|&c| c as u8).collect();
+    String::from_utf8_lossy(&bytes).into_owned()
+}
+
+/// Configure the VMA environment once per process and report the settings in effect.
+///
+/// Call before creating the first socket; otherwise the first socket does it
+/// with its own options (the first call wins). When libvma is preloaded it has
+/// already read its environment, so nothing changes and requested values that
+/// differ from the ones in effect show up in the warnings. Values from the
+/// launch environment are never overwritten.
+///
+/// Returns the report as an error when a conflict was found (for example
+/// SocketXtreme with `VMA_THREAD_MODE=3`).
+pub fn vma_runtime_init(options: &VmaOptions) -> Result<RuntimeReport, RuntimeReport> {
+    let mut raw: Box<RuntimeReportRaw> = Box::new(unsafe { std::mem::zeroed() });
+    let result = unsafe { ffi_runtime_init(options, &mut *raw) };
+
+    let setting_count = (raw.setting_count.max(0) as usize).min(VMA_RUNTIME_MAX_SETTINGS);
+    let warning_count = (raw.warning_count.max(0) as usize).min(VMA_RUNTIME_MAX_WARNINGS);
+    let report = RuntimeReport {
+        options: raw.options,
+        first_call: result != VMA_RUNTIME_ALREADY_INITIALIZED,
+        vma_loaded: raw.vma_loaded,
+        socketxtreme_available: raw.socketxtreme_available,
+        conflict: raw.conflict,
+        settings: raw.settings[..setting_count]
+            .iter()
+            .map(|s| RuntimeSetting {
+                name: c_text(&s.name),
+                requested: c_text(&s.requested),
+                effective: c_text(&s.effective),
+                source: match s.source {
+                    VMA_SETTING_ENVIRONMENT => SettingSource::Environment,
+                    VMA_SETTING_IGNORED => SettingSource::Ignored,
+                    _ => SettingSource::Applied,
+                },
+            })
+            .collect(),
+        warnings: raw.warnings[..warning_count].iter().map(|w| c_text(w)).collect(),
+    };
+
+    if result == VMA_RUNTIME_OK || (result == VMA_RUNTIME_ALREADY_INITIALIZED && !report.conflict) {
+        Ok(report)
+    } else {
+        Err(report)
+    }
+}
+
 #[cfg(test)]
 mod test {
     use super::*;
@@ -331,6 +591,26 @@ mod test {
         assert_eq!(options, deserialized);
     }
 
+    #[test]
+    fn test_ring_placement_serialization() {
+        let options = VmaOptions::low_latency().with_ring(RingPlacement::UserKey, 7);
+        let serialized = serde_json::to_string(&options).unwrap();
+        assert!(serialized.contains("\"ring_placement\":\"user_key\""));
+        let deserialized: VmaOptions = serde_json::from_str(&serialized).unwrap();
+        assert_eq!(options, deserialized);
+
+        // Files written before ring placement existed keep the default
+        let legacy: VmaOptions = serde_json::from_str(r#"{"ring_count": 2}"#).unwrap();
+        assert_eq!(legacy.ring_placement, RingPlacement::Default);
+    }
+
+    #[test]
+    fn test_sockaddr_round_trip() {
+        let addr = SocketAddrV4::new(Ipv4Addr::new(192, 168, 1, 100), 5001);
+        let c_addr = sockaddr_from_rust(&addr);
+        assert_eq!(sockaddr_to_rust(&c_addr), SocketAddr::V4(addr));
+    }
+
     #[test]
     fn test_add_core() {
         let mut options = VmaOptions::default();
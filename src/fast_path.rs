@@ -0,0 +1,287 @@
+//! Prepared fast-path handles for hot send/receive loops.
+//!
+//! The regular socket calls check their arguments and the socket state and
+//! branch on the wait policy every time. A loop that sends to one destination
+//! or receives from one socket can do that once: a handle borrows the socket,
+//! validates it when created and then goes straight to the syscall, keeping
+//! the socket's counters and trace records. Each variant is its own method
+//! (connected vs. per-endpoint send, one attempt vs. busy-poll receive), so
+//! nothing is decided per call.
+//!
+//! The C side is in `vma_fast_path.h` as `static inline` functions. Build with
+//! the crate's `lto` feature (and `-Clinker-plugin-lto`, see the README) to
+//! have them inlined into the Rust caller as well.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::fast_path::{UdpFastReceiver, UdpFastSender};
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! let mut tx = VmaUdpSocket::new().unwrap();
+//! tx.connect("192.168.1.102", 5003).unwrap();
+//! let mut sender = UdpFastSender::new(&mut tx).unwrap();
+//! for _ in 0..1000 {
+//!     sender.send(&[0u8; 64]).unwrap();
+//! }
+//!
+//! let mut rx = VmaUdpSocket::new().unwrap();
+//! rx.bind("0.0.0.0", 5003).unwrap();
+//! let mut receiver = UdpFastReceiver::new(&mut rx).unwrap();
+//! let mut buffer = [0u8; 2048];
+//! let n = receiver.recv_spin(&mut buffer, Some(1_000_000)).unwrap();
+//! println!("{} bytes", n);
+//! ```
+
+use std::ffi::c_void;
+use std::io::Error;
+use std::marker::PhantomData;
+use std::mem;
+use std::os::raw::c_int;
+use std::ptr;
+use crate::common::{unixnano_to_ms, SockAddrIn};
+use crate::tcp::{TcpResult, TcpSocket, VmaTcpSocket};
+use crate::udp::{UdpEndpoint, UdpResult, UdpSocket, VmaUdpSocket};
+
+/// C representation of `udp_fast_tx_t`.
+#[repr(C)]
+struct UdpFastTx {
+    fd: c_int,
+    stats: *mut c_void,
+    dest: SockAddrIn,
+}
+
+/// C representation of `udp_fast_rx_t`.
+#[repr(C)]
+struct UdpFastRx {
+    fd: c_int,
+    stats: *mut c_void,
+    polling: bool,
+    adaptive: bool,
+    socket: *mut UdpSocket,
+}
+
+/// C representation of `tcp_fast_t`.
+#[repr(C)]
+struct TcpFast {
+    fd: c_int,
+    stats: *mut c_void,
+    polling: bool,
+    adaptive: bool,
+    socket: *mut TcpSocket,
+}
+
+extern "C" {
+    fn udp_fast_tx_prepare(socket: *mut UdpSocket, endpoint: *const UdpEndpoint, tx: *mut UdpFastTx) -> c_int;
+    fn udp_fast_rx_prepare(socket: *mut UdpSocket, rx: *mut UdpFastRx) -> c_int;
+    fn tcp_fast_prepare(sock: *mut TcpSocket, fast: *mut TcpFast) -> c_int;
+    fn udp_fast_send_connected_ffi(tx: *const UdpFastTx, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
+    fn udp_fast_send_to_ffi(tx: *const UdpFastTx, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
+    fn udp_fast_recv_ffi(rx: *mut UdpFastRx, buffer: *mut c_void, buffer_size: usize, timeout_ms: c_int, bytes_received: *mut usize) -> c_int;
+    fn udp_fast_recv_poll_ffi(rx: *mut UdpFastRx, buffer: *mut c_void, buffer_size: usize, timeout_ms: c_int, bytes_received: *mut usize) -> c_int;
+    fn tcp_fast_send_ffi(fast: *mut TcpFast, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
+    fn tcp_fast_recv_ffi(fast: *mut TcpFast, buffer: *mut c_void, buffer_size: usize, timeout_ms: c_int, bytes_received: *mut usize) -> c_int;
+    fn tcp_fast_recv_poll_ffi(fast: *mut TcpFast, buffer: *mut c_void, buffer_size: usize, timeout_ms: c_int, bytes_received: *mut usize) -> c_int;
+}
+
+#[inline]
+fn udp_check(result: c_int) -> Result<(), UdpResult> {
+    if result != UdpResult::UdpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+    }
+    Ok(())
+}
+
+#[inline]
+fn tcp_check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+#[inline]
+fn udp_received(result: c_int, bytes: usize) -> Result<usize, Error> {
+    match udp_check(result) {
+        Ok(()) => Ok(bytes),
+        Err(UdpResult::UdpErrorTimeout) => Ok(0), // timeout is not an error
+        Err(e) => Err(e.into()),
+    }
+}
+
+#[inline]
+fn tcp_received(result: c_int, bytes: usize) -> Result<usize, Error> {
+    match tcp_check(result) {
+        Ok(()) => Ok(bytes),
+        Err(TcpResult::TcpErrorTimeout) => Ok(0), // timeout is not an error
+        Err(e) => Err(e.into()),
+    }
+}
+
+/// Send path to a UDP socket's connected address.
+pub struct UdpFastSender<'a> {
+    tx: UdpFastTx,
+    _socket: PhantomData<&'a mut VmaUdpSocket>,
+}
+
+impl<'a> UdpFastSender<'a> {
+    /// Prepare sends to the connected address (fails with `NotConnected` if the socket is not connected).
+    pub fn new(socket: &'a mut VmaUdpSocket) -> Result<Self, Error> {
+        let mut tx: UdpFastTx = unsafe { mem::zeroed() };
+        udp_check(unsafe { udp_fast_tx_prepare(socket.raw_mut(), ptr::null(), &mut tx) })?;
+        Ok(UdpFastSender { tx, _socket: PhantomData })
+    }
+
+    /// Send a datagram (fails with `TimedOut` if the socket buffer is full).
+    #[inline]
+    pub fn send(&mut self, data: &[u8]) -> Result<usize, Error> {
+        let mut bytes_sent = 0usize;
+        udp_check(unsafe {
+            udp_fast_send_connected_ffi(&self.tx, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent)
+        })?;
+        Ok(bytes_sent)
+    }
+}
+
+/// Send path to one UDP endpoint.
+pub struct UdpFastSenderTo<'a> {
+    tx: UdpFastTx,
+    _socket: PhantomData<&'a mut VmaUdpSocket>,
+}
+
+impl<'a> UdpFastSenderTo<'a> {
+    /// Prepare sends to `endpoint`.
+    pub fn new(socket: &'a mut VmaUdpSocket, endpoint: &UdpEndpoint) -> Result<Self, Error> {
+        let mut tx: UdpFastTx = unsafe { mem::zeroed() };
+        udp_check(unsafe { udp_fast_tx_prepare(socket.raw_mut(), endpoint, &mut tx) })?;
+        Ok(UdpFastSenderTo { tx, _socket: PhantomData })
+    }
+
+    /// Send a datagram (fails with `TimedOut` if the socket buffer is full).
+    #[inline]
+    pub fn send(&mut self, data: &[u8]) -> Result<usize, Error> {
+        let mut bytes_sent = 0usize;
+        udp_check(unsafe {
+            udp_fast_send_to_ffi(&self.tx, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent)
+        })?;
+        Ok(bytes_sent)
+    }
+}
+
+/// Receive path of a UDP socket.
+pub struct UdpFastReceiver<'a> {
+    rx: UdpFastRx,
+    _socket: PhantomData<&'a mut VmaUdpSocket>,
+}
+
+impl<'a> UdpFastReceiver<'a> {
+    /// Prepare receives on `socket`.
+    pub fn new(socket: &'a mut VmaUdpSocket) -> Result<Self, Error> {
+        let mut rx: UdpFastRx = unsafe { mem::zeroed() };
+        udp_check(unsafe { udp_fast_rx_prepare(socket.raw_mut(), &mut rx) })?;
+        Ok(UdpFastReceiver { rx, _socket: PhantomData })
+    }
+
+    /// Whether the socket's options ask for busy-polling ([`recv_spin`](Self::recv_spin)).
+    pub fn is_polling(&self) -> bool {
+        self.rx.polling
+    }
+
+    /// Receive a datagram: one attempt inline, then the socket's regular wait (0 on timeout).
+    ///
+    /// Fails with `InvalidInput` if `buffer` is empty.
+    #[inline]
+    pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, Error> {
+        if buffer.is_empty() {
+            return Err(UdpResult::UdpErrorInvalidParam.into());
+        }
+        let mut bytes_received = 0usize;
+        let result = unsafe {
+            udp_fast_recv_ffi(&mut self.rx, buffer.as_mut_ptr() as *mut c_void, buffer.len(),
+                              unixnano_to_ms(timeout_nano), &mut bytes_received)
+        };
+        udp_received(result, bytes_received)
+    }
+
+    /// Receive a datagram, busy-polling until the timeout (0 on timeout).
+    ///
+    /// Fails with `InvalidInput` if `buffer` is empty.
+    #[inline]
+    pub fn recv_spin(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, Error> {
+        if buffer.is_empty() {
+            return Err(UdpResult::UdpErrorInvalidParam.into());
+        }
+        let mut bytes_received = 0usize;
+        let result = unsafe {
+            udp_fast_recv_poll_ffi(&mut self.rx, buffer.as_mut_ptr() as *mut c_void, buffer.len(),
+                                   unixnano_to_ms(timeout_nano), &mut bytes_received)
+        };
+        udp_received(result, bytes_received)
+    }
+}
+
+/// Send and receive path of a connected TCP socket.
+pub struct TcpFastPath<'a> {
+    fast: TcpFast,
+    _socket: PhantomData<&'a mut VmaTcpSocket>,
+}
+
+impl<'a> TcpFastPath<'a> {
+    /// Prepare the connection (fails with `NotConnected` if the socket is not connected).
+    pub fn new(socket: &'a mut VmaTcpSocket) -> Result<Self, Error> {
+        let mut fast: TcpFast = unsafe { mem::zeroed() };
+        tcp_check(unsafe { tcp_fast_prepare(socket.raw_mut(), &mut fast) })?;
+        Ok(TcpFastPath { fast, _socket: PhantomData })
+    }
+
+    /// Whether the socket's options ask for busy-polling ([`recv_spin`](Self::recv_spin)).
+    pub fn is_polling(&self) -> bool {
+        self.fast.polling
+    }
+
+    /// Send data (may send less than `data.len()`; 0 if it would block).
+    #[inline]
+    pub fn send(&mut self, data: &[u8]) -> Result<usize, Error> {
+        let mut bytes_sent = 0usize;
+        let result = unsafe {
+            tcp_fast_send_ffi(&mut self.fast, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent)
+        };
+        match tcp_check(result) {
+            Ok(()) => Ok(bytes_sent),
+            Err(TcpResult::TcpErrorWouldBlock) => Ok(0), // would block is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Receive data: one attempt inline, then the socket's regular wait (0 on timeout).
+    ///
+    /// Fails with `InvalidInput` if `buffer` is empty.
+    #[inline]
+    pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, Error> {
+        if buffer.is_empty() {
+            return Err(TcpResult::TcpErrorInvalidParam.into());
+        }
+        let mut bytes_received = 0usize;
+        let result = unsafe {
+            tcp_fast_recv_ffi(&mut self.fast, buffer.as_mut_ptr() as *mut c_void, buffer.len(),
+                              unixnano_to_ms(timeout_nano), &mut bytes_received)
+        };
+        tcp_received(result, bytes_received)
+    }
+
+    /// Receive data, busy-polling until the timeout (0 on timeout).
+    ///
+    /// Fails with `InvalidInput` if `buffer` is empty.
+    #[inline]
+    pub fn recv_spin(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, Error> {
+        if buffer.is_empty() {
+            return Err(TcpResult::TcpErrorInvalidParam.into());
+        }
+        let mut bytes_received = 0usize;
+        let result = unsafe {
+            tcp_fast_recv_poll_ffi(&mut self.fast, buffer.as_mut_ptr() as *mut c_void, buffer.len(),
+                                   unixnano_to_ms(timeout_nano), &mut bytes_received)
+        };
+        tcp_received(result, bytes_received)
+    }
+}
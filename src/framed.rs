@@ -0,0 +1,432 @@
+//! Length-prefixed message framing over a TCP connection.
+//!
+//! [`Framed`] gives a connection its own receive ring, reads as much as the
+//! socket has queued in one call and returns every complete message as a
+//! slice into the ring. Messages that straddle two reads are completed by the
+//! next read without being copied out first; with a mirrored ring (the same
+//! pages mapped twice back to back) a message crossing the end of the ring is
+//! still one contiguous slice.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::framed::{FrameFormat, Framed};
+//! use vma_socket::tcp::VmaTcpSocket;
+//!
+//! let mut socket = VmaTcpSocket::new().unwrap();
+//! socket.connect("10.0.0.2", 9000, Some(1_000_000_000)).unwrap();
+//!
+//! // 2-byte big-endian payload length at offset 0
+//! let mut framed = Framed::new(socket, FrameFormat::new(0, 2)).unwrap();
+//! loop {
+//!     framed.recv(Some(100_000_000)).unwrap();
+//!     for message in framed.messages() {
+//!         println!("{} byte payload", message.payload().len());
+//!     }
+//! }
+//! ```
+
+use std::ffi::c_void;
+use std::mem::{self, ManuallyDrop};
+use std::os::raw::c_int;
+use std::ptr;
+use crate::common::{unixnano_to_ms, WaitMode, WaitStats};
+use crate::stats::StatsBlock;
+use crate::tcp::{Client, TcpClient, TcpResult, TcpSocket, VmaTcpSocket};
+
+/// Default receive ring capacity (matches `TCP_FRAMER_DEFAULT_CAPACITY`).
+pub const FRAMER_DEFAULT_CAPACITY: usize = 256 * 1024;
+
+/// Message header layout.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct FrameFormat {
+    /// Byte offset of the length field within the header
+    pub length_offset: usize,
+    /// Width of the length field in bytes (2 or 4)
+    pub length_width: usize,
+    /// Network byte order (false for little endian)
+    pub big_endian: bool,
+    /// Total header size (0 for `length_offset + length_width`)
+    pub header_size: usize,
+    /// Whether the length counts the header as well as the payload
+    pub length_includes_header: bool,
+    /// Largest accepted message including the header (0 for the ring capacity)
+    pub max_message: usize,
+}
+
+impl FrameFormat {
+    /// Big-endian payload length of `length_width` bytes at `length_offset`, ending the header.
+    pub fn new(length_offset: usize, length_width: usize) -> Self {
+        FrameFormat {
+            length_offset,
+            length_width,
+            big_endian: true,
+            header_size: 0,
+            length_includes_header: false,
+            max_message: 0,
+        }
+    }
+}
+
+/// C representation of a complete message.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+struct FrameRaw {
+    data: *const c_void,
+    length: usize,
+    payload_offset: usize,
+}
+
+/// C representation of the framer structure.
+#[repr(C)]
+struct TcpFramerRaw {
+    socket_fd: c_int,
+    socket: *mut TcpSocket,
+    format: FrameFormat,
+    ring: *mut u8,
+    capacity: usize,
+    mirrored: bool,
+    mask: usize,
+    head: u64,
+    tail: u64,
+    wait_mode: WaitMode,
+    wait_stats: WaitStats,
+    stats: *mut StatsBlock,
+    rx_messages: u64,
+    rx_bytes: u64,
+}
+
+extern "C" {
+    fn tcp_framer_init_socket(
+        framer: *mut TcpFramerRaw,
+        socket: *mut TcpSocket,
+        format: *const FrameFormat,
+        capacity: usize,
+        mirrored: bool,
+    ) -> c_int;
+    fn tcp_framer_init_client(
+        framer: *mut TcpFramerRaw,
+        client: *const TcpClient,
+        format: *const FrameFormat,
+        capacity: usize,
+        mirrored: bool,
+    ) -> c_int;
+    fn tcp_framer_close(framer: *mut TcpFramerRaw) -> c_int;
+    fn tcp_recv_messages(
+        framer: *mut TcpFramerRaw,
+        frames: *mut FrameRaw,
+        max_frames: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+mod sealed {
+    pub trait Sealed {}
+}
+
+/// Connection types a [`Framed`] can be layered on.
+pub trait FramedConnection: sealed::Sealed {
+    #[doc(hidden)]
+    fn init_framer(&mut self, framer: *mut c_void, format: &FrameFormat, capacity: usize, mirrored: bool) -> c_int;
+    #[doc(hidden)]
+    fn socket_ptr(&mut self) -> *mut c_void;
+}
+
+impl sealed::Sealed for VmaTcpSocket {}
+
+impl FramedConnection for VmaTcpSocket {
+    fn init_framer(&mut self, framer: *mut c_void, format: &FrameFormat, capacity: usize, mirrored: bool) -> c_int {
+        unsafe { tcp_framer_init_socket(framer as *mut TcpFramerRaw, self.raw_mut(), format, capacity, mirrored) }
+    }
+
+    fn socket_ptr(&mut self) -> *mut c_void {
+        self.raw_mut() as *mut TcpSocket as *mut c_void
+    }
+}
+
+impl sealed::Sealed for Client {}
+
+impl FramedConnection for Client {
+    fn init_framer(&mut self, framer: *mut c_void, format: &FrameFormat, capacity: usize, mirrored: bool) -> c_int {
+        unsafe { tcp_framer_init_client(framer as *mut TcpFramerRaw, self.raw(), format, capacity, mirrored) }
+    }
+
+    fn socket_ptr(&mut self) -> *mut c_void {
+        ptr::null_mut()
+    }
+}
+
+/// Complete message, borrowed from the receive ring.
+#[derive(Debug, Clone, Copy)]
+pub struct Message<'a> {
+    bytes: &'a [u8],
+    header_size: usize,
+}
+
+impl<'a> Message<'a> {
+    /// Whole message, header included.
+    pub fn bytes(&self) -> &'a [u8] {
+        self.bytes
+    }
+
+    /// Message header.
+    pub fn header(&self) -> &'a [u8] {
+        &self.bytes[..self.header_size]
+    }
+
+    /// Message payload (after the header).
+    pub fn payload(&self) -> &'a [u8] {
+        &self.bytes[self.header_size..]
+    }
+}
+
+/// Messages returned per call.
+const FRAMES_PER_RECV: usize = 64;
+
+/// A TCP connection read as a stream of length-prefixed messages.
+pub struct Framed<S: FramedConnection> {
+    connection: S,
+    framer: Box<TcpFramerRaw>,
+    frames: Vec<FrameRaw>,
+    len: usize,
+}
+
+// The framer owns its ring exclusively; message slices borrow the Framed.
+unsafe impl<S: FramedConnection + Send> Send for Framed<S> {}
+
+impl<S: FramedConnection> Framed<S> {
+    /// Frame a connected socket or accepted client with a mirrored ring of the default capacity.
+    pub fn new(connection: S, format: FrameFormat) -> Result<Self, std::io::Error> {
+        Self::with_capacity(connection, format, FRAMER_DEFAULT_CAPACITY, true)
+    }
+
+    /// Frame a connection with a ring of at least `capacity` bytes.
+    ///
+    /// Without `mirrored` (or when the double mapping is unavailable), the
+    /// partial message at the end of the ring is moved to the front before
+    /// the next read.
+    pub fn with_capacity(
+        mut connection: S,
+        format: FrameFormat,
+        capacity: usize,
+        mirrored: bool,
+    ) -> Result<Self, std::io::Error> {
+        let mut framer: Box<TcpFramerRaw> = Box::new(unsafe { mem::zeroed() });
+        check(connection.init_framer(&mut *framer as *mut TcpFramerRaw as *mut c_void, &format, capacity, mirrored))?;
+
+        Ok(Framed {
+            connection,
+            framer,
+            frames: vec![FrameRaw { data: ptr::null(), length: 0, payload_offset: 0 }; FRAMES_PER_RECV],
+            len: 0,
+        })
+    }
+
+    /// Receive complete messages, returns how many (0 on timeout).
+    ///
+    /// Messages already buffered are returned without a system call. Fails
+    /// with `ConnectionAborted` when the peer closes the connection and with
+    /// `InvalidData` when a length is outside the accepted range.
+    pub fn recv(&mut self, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        self.len = 0;
+        let mut stored: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        // The connection moves with the Framed; close and errors mark it disconnected
+        self.framer.socket = self.connection.socket_ptr() as *mut TcpSocket;
+        let result = unsafe {
+            tcp_recv_messages(&mut *self.framer, self.frames.as_mut_ptr(), self.frames.len(), timeout_ms, &mut stored)
+        };
+
+        match check(result) {
+            Ok(()) => {
+                self.len = stored;
+                Ok(stored)
+            },
+            Err(TcpResult::TcpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Iterate over the messages returned by the last call to [`recv`](Self::recv).
+    pub fn messages(&self) -> impl Iterator<Item = Message<'_>> {
+        self.frames[..self.len].iter().map(|frame| Message {
+            bytes: unsafe { std::slice::from_raw_parts(frame.data as *const u8, frame.length) },
+            header_size: frame.payload_offset,
+        })
+    }
+
+    /// Bytes received but not yet returned (a partial message or messages beyond the last batch).
+    pub fn buffered(&self) -> usize {
+        (self.framer.tail - self.framer.head) as usize
+    }
+
+    /// Ring capacity in bytes (rounded up to a power of two).
+    pub fn capacity(&self) -> usize {
+        self.framer.capacity
+    }
+
+    /// Whether the ring is a mirrored double mapping.
+    pub fn is_mirrored(&self) -> bool {
+        self.framer.mirrored
+    }
+
+    /// Number of messages returned so far.
+    pub fn rx_messages(&self) -> u64 {
+        self.framer.rx_messages
+    }
+
+    /// Receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.framer.wait_stats
+    }
+
+    /// The underlying connection.
+    pub fn get_ref(&self) -> &S {
+        &self.connection
+    }
+
+    /// The underlying connection (for sending; reading from it directly breaks the framing).
+    pub fn get_mut(&mut self) -> &mut S {
+        &mut self.connection
+    }
+
+    /// Release the ring and return the connection; buffered bytes are discarded.
+    pub fn into_inner(self) -> S {
+        let mut this = ManuallyDrop::new(self);
+        unsafe {
+            tcp_framer_close(&mut *this.framer);
+            ptr::drop_in_place(&mut this.framer);
+            ptr::drop_in_place(&mut this.frames);
+            ptr::read(&this.connection)
+        }
+    }
+}
+
+impl<S: FramedConnection> Drop for Framed<S> {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_framer_close(&mut *self.framer);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::io::Write;
+    use std::os::fd::IntoRawFd;
+    use std::os::unix::net::UnixStream;
+
+    // Framer over one end of a socket pair; the other end is the writer
+    fn framed(format: FrameFormat, capacity: usize, mirrored: bool) -> (UnixStream, Framed<Client>) {
+        let (writer, reader) = UnixStream::pair().unwrap();
+        let mut raw: TcpClient = unsafe { mem::zeroed() };
+        raw.socket_fd = reader.into_raw_fd();
+        let framed = Framed::with_capacity(Client::new(raw), format, capacity, mirrored).unwrap();
+        (writer, framed)
+    }
+
+    // 2-byte big-endian payload length, payload bytes derived from the index
+    fn message(i: usize) -> Vec<u8> {
+        let n = i * 37 % 1500;
+        let mut bytes = vec![(n >> 8) as u8, n as u8];
+        bytes.extend((0..n).map(|k| (i + k) as u8));
+        bytes
+    }
+
+    #[test]
+    fn test_split_header() {
+        let format = FrameFormat { length_offset: 4, length_width: 4, header_size: 8, ..FrameFormat::new(0, 4) };
+        let (mut writer, mut framed) = framed(format, 4096, true);
+        let mut bytes = vec![0u8, 0, 0, 0, 0, 0, 0, 5];
+        bytes.extend(b"hello");
+
+        // Header delivered one byte at a time, then the payload
+        for i in 0..7 {
+            writer.write_all(&bytes[i..i + 1]).unwrap();
+            assert_eq!(framed.recv(Some(0)).unwrap(), 0);
+            assert_eq!(framed.buffered(), i + 1);
+        }
+        writer.write_all(&bytes[7..10]).unwrap();
+        assert_eq!(framed.recv(Some(0)).unwrap(), 0);
+        writer.write_all(&bytes[10..]).unwrap();
+
+        assert_eq!(framed.recv(Some(1_000_000_000)).unwrap(), 1);
+        let message = framed.messages().next().unwrap();
+        assert_eq!(message.header(), &bytes[..8]);
+        assert_eq!(message.payload(), b"hello");
+        assert_eq!(framed.buffered(), 0);
+    }
+
+    #[test]
+    fn test_messages_across_ring_end() {
+        for mirrored in [true, false] {
+            let (mut writer, mut framed) = framed(FrameFormat::new(0, 2), 4096, mirrored);
+            let count = 500;
+            let writes = std::thread::spawn(move || {
+                let stream: Vec<u8> = (0..count).flat_map(message).collect();
+                // Odd-size writes split headers and payloads at every offset
+                for chunk in stream.chunks(777) {
+                    writer.write_all(chunk).unwrap();
+                }
+                writer
+            });
+
+            let ring = framed.framer.ring as usize;
+            let capacity = framed.capacity();
+            let mut received = 0;
+            let mut crossed = 0;
+            while received < count {
+                assert!(framed.recv(Some(1_000_000_000)).unwrap() > 0, "timeout at message {}", received);
+                for message in framed.messages() {
+                    assert_eq!(message.bytes(), &self::message(received)[..], "message {}", received);
+                    let start = message.bytes().as_ptr() as usize - ring;
+                    if start + message.bytes().len() > capacity {
+                        crossed += 1;
+                    }
+                    received += 1;
+                }
+            }
+
+            // Only the mirrored ring hands out messages that run past its end
+            assert_eq!(crossed > 0, framed.is_mirrored());
+            assert_eq!(framed.rx_messages(), count as u64);
+            drop(writes.join().unwrap());
+            assert_eq!(framed.recv(Some(1_000_000_000)).unwrap_err().kind(), std::io::ErrorKind::ConnectionAborted);
+        }
+    }
+
+    #[test]
+    fn test_oversize_length_rejected() {
+        let format = FrameFormat { max_message: 64, ..FrameFormat::new(0, 2) };
+        let (mut writer, mut framed) = framed(format, 4096, true);
+
+        // A good message ahead of the bad header is still delivered
+        writer.write_all(&[0, 3, b'a', b'b', b'c', 0, 63]).unwrap();
+        assert_eq!(framed.recv(Some(1_000_000_000)).unwrap(), 1);
+        assert_eq!(framed.messages().next().unwrap().payload(), b"abc");
+
+        // 63 + 2 header bytes is one past max_message; the header stays queued
+        let err = framed.recv(Some(1_000_000_000)).unwrap_err();
+        assert_eq!(err.kind(), std::io::ErrorKind::InvalidData);
+        assert_eq!(framed.buffered(), 2);
+        assert_eq!(framed.recv(Some(0)).unwrap_err().kind(), std::io::ErrorKind::InvalidData);
+    }
+
+    #[test]
+    fn test_length_below_header_rejected() {
+        let format = FrameFormat { length_includes_header: true, ..FrameFormat::new(0, 4) };
+        let (mut writer, mut framed) = framed(format, 4096, false);
+        writer.write_all(&[0, 0, 0, 3]).unwrap();
+        assert_eq!(framed.recv(Some(1_000_000_000)).unwrap_err().kind(), std::io::ErrorKind::InvalidData);
+    }
+}
@@ -0,0 +1,354 @@
+//! Application heartbeats with per-connection deadlines in a timer wheel.
+//!
+//! A dead peer that never sends a FIN or RST is invisible to the socket
+//! until the next write fails, which can be much later. [`Heartbeat`] tracks
+//! when each connection last sent and received: when nothing was sent for the
+//! interval it reports [`HeartbeatKind::Due`] (send an application heartbeat),
+//! and when nothing was received for the timeout it reports
+//! [`HeartbeatKind::Timeout`] and stops tracking the connection.
+//!
+//! Touching a connection on the hot path is a clock read and a store;
+//! deadlines are only re-evaluated when their wheel slot comes round in
+//! [`advance`](Heartbeat::advance).
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::heartbeat::{Heartbeat, HeartbeatKind};
+//! use vma_socket::tcp::VmaTcpSocket;
+//!
+//! let mut socket = VmaTcpSocket::new().unwrap();
+//! socket.connect("10.0.0.2", 9000, Some(1_000_000_000)).unwrap();
+//!
+//! let mut heartbeat = Heartbeat::new(64, 0, 0).unwrap();
+//! let id = heartbeat.add(0, 1_000_000_000, 3_000_000_000).unwrap();
+//!
+//! let mut buffer = [0u8; 4096];
+//! while socket.is_connected() {
+//!     if let Ok(n) = socket.recv(&mut buffer, Some(0)) {
+//!         if n > 0 {
+//!             heartbeat.touch_rx(id);
+//!         }
+//!     }
+//!     let mut due = false;
+//!     let mut dead = false;
+//!     heartbeat.advance(|event| match event.kind {
+//!         HeartbeatKind::Due => due = true,
+//!         HeartbeatKind::Timeout => dead = true,
+//!     }).unwrap();
+//!     if due {
+//!         let _ = socket.send(b"HB");
+//!     }
+//!     if dead {
+//!         socket.mark_disconnected();
+//!     }
+//! }
+//! ```
+
+use std::ffi::c_void;
+use std::mem;
+use std::os::raw::c_int;
+use std::ptr;
+use crate::tcp::{TcpResult, TcpSocket};
+
+/// Kind of heartbeat event.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum HeartbeatKind {
+    /// Nothing was sent for the interval: send a heartbeat
+    Due,
+    /// Nothing was received for the timeout: the connection is no longer tracked
+    Timeout,
+}
+
+// Event types (match `tcp_heartbeat_event_type_t`)
+const HEARTBEAT_DUE: c_int = 1;
+const HEARTBEAT_TIMEOUT: c_int = 2;
+
+/// C representation of a heartbeat event.
+#[repr(C)]
+struct HeartbeatEventRaw {
+    kind: c_int,
+    id: u32,
+    user_data: u64,
+    idle_ns: u64,
+}
+
+/// Heartbeat event.
+#[derive(Debug, Clone, Copy)]
+pub struct HeartbeatEvent {
+    /// Event kind
+    pub kind: HeartbeatKind,
+    /// Entry the event belongs to
+    pub id: u32,
+    /// Value given at registration
+    pub user_data: u64,
+    /// Time since the last send (`Due`) or receive (`Timeout`) in nanoseconds
+    pub idle_nano: u64,
+}
+
+/// C representation of the scheduler structure.
+#[repr(C)]
+struct HeartbeatRaw {
+    entries: *mut c_void,
+    capacity: u32,
+    free_head: u32,
+    slots: *mut u32,
+    slot_count: u32,
+    slot_mask: u32,
+    tick_ns: u64,
+    current_tick: u64,
+    walking: u32,
+    count: u32,
+}
+
+type RawCallback = unsafe extern "C" fn(event: *const HeartbeatEventRaw, context: *mut c_void);
+
+extern "C" {
+    fn tcp_heartbeat_init(hb: *mut HeartbeatRaw, capacity: u32, tick_ms: u32, slot_count: u32) -> c_int;
+    fn tcp_heartbeat_close(hb: *mut HeartbeatRaw) -> c_int;
+    fn tcp_heartbeat_add(
+        hb: *mut HeartbeatRaw,
+        socket: *mut TcpSocket,
+        user_data: u64,
+        interval_ms: u32,
+        timeout_ms: u32,
+        id: *mut u32,
+    ) -> c_int;
+    fn tcp_heartbeat_remove(hb: *mut HeartbeatRaw, id: u32) -> c_int;
+    fn tcp_heartbeat_touch_rx(hb: *mut HeartbeatRaw, id: u32);
+    fn tcp_heartbeat_touch_tx(hb: *mut HeartbeatRaw, id: u32);
+    fn tcp_heartbeat_advance(hb: *mut HeartbeatRaw, callback: RawCallback, context: *mut c_void, n: *mut usize) -> c_int;
+    #[cfg(test)]
+    fn tcp_heartbeat_advance_at(
+        hb: *mut HeartbeatRaw,
+        now_ns: u64,
+        callback: RawCallback,
+        context: *mut c_void,
+        n: *mut usize,
+    ) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+fn nano_to_ms(nano: u64) -> u32 {
+    (nano / 1_000_000).min(u32::MAX as u64) as u32
+}
+
+unsafe extern "C" fn dispatch_trampoline<F: FnMut(&HeartbeatEvent)>(event: *const HeartbeatEventRaw, context: *mut c_void) {
+    let callback = &mut *(context as *mut F);
+    let event = &*event;
+    let kind = match event.kind {
+        HEARTBEAT_DUE => HeartbeatKind::Due,
+        HEARTBEAT_TIMEOUT => HeartbeatKind::Timeout,
+        _ => return,
+    };
+    callback(&HeartbeatEvent { kind, id: event.id, user_data: event.user_data, idle_nano: event.idle_ns });
+}
+
+/// Heartbeat scheduler (use from the thread that owns the connections).
+pub struct Heartbeat {
+    hb: Box<HeartbeatRaw>,
+}
+
+// The scheduler owns its tables exclusively.
+unsafe impl Send for Heartbeat {}
+
+impl Heartbeat {
+    /// Create a scheduler for up to `capacity` connections.
+    ///
+    /// `tick_nano` is the wheel resolution (0 for 1 ms) and `slots` the wheel
+    /// size (rounded to a power of two, 0 for 1024).
+    pub fn new(capacity: usize, tick_nano: u64, slots: usize) -> Result<Self, std::io::Error> {
+        let mut hb: Box<HeartbeatRaw> = Box::new(unsafe { mem::zeroed() });
+        check(unsafe { tcp_heartbeat_init(&mut *hb, capacity as u32, nano_to_ms(tick_nano), slots as u32) })?;
+        Ok(Heartbeat { hb })
+    }
+
+    /// Start tracking a connection, returns its id.
+    ///
+    /// `interval_nano` is the send idle time before a `Due` event and
+    /// `timeout_nano` the receive idle time before a `Timeout` (0 disables either).
+    pub fn add(&mut self, user_data: u64, interval_nano: u64, timeout_nano: u64) -> Result<u32, std::io::Error> {
+        let mut id: u32 = 0;
+        check(unsafe {
+            tcp_heartbeat_add(
+                &mut *self.hb,
+                ptr::null_mut(),
+                user_data,
+                nano_to_ms(interval_nano),
+                nano_to_ms(timeout_nano),
+                &mut id,
+            )
+        })?;
+        Ok(id)
+    }
+
+    /// Stop tracking a connection.
+    pub fn remove(&mut self, id: u32) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_heartbeat_remove(&mut *self.hb, id) })?;
+        Ok(())
+    }
+
+    /// Record that data was received (restarts the timeout).
+    #[inline]
+    pub fn touch_rx(&mut self, id: u32) {
+        unsafe { tcp_heartbeat_touch_rx(&mut *self.hb, id) }
+    }
+
+    /// Record that data was sent (restarts the heartbeat interval).
+    #[inline]
+    pub fn touch_tx(&mut self, id: u32) {
+        unsafe { tcp_heartbeat_touch_tx(&mut *self.hb, id) }
+    }
+
+    /// Process the wheel up to now and deliver expired deadlines to `callback`.
+    pub fn advance<F: FnMut(&HeartbeatEvent)>(&mut self, mut callback: F) -> Result<usize, std::io::Error> {
+        let mut delivered: usize = 0;
+        check(unsafe {
+            tcp_heartbeat_advance(
+                &mut *self.hb,
+                dispatch_trampoline::<F>,
+                &mut callback as *mut F as *mut c_void,
+                &mut delivered,
+            )
+        })?;
+        Ok(delivered)
+    }
+
+    /// Number of tracked connections.
+    pub fn len(&self) -> usize {
+        self.hb.count as usize
+    }
+
+    /// Whether no connection is tracked.
+    pub fn is_empty(&self) -> bool {
+        self.hb.count == 0
+    }
+}
+
+impl Drop for Heartbeat {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_heartbeat_close(&mut *self.hb);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::tcp::TcpConnectionState;
+
+    const MS: u64 = 1_000_000;
+
+    /// Mirror of `tcp_heartbeat_entry_t` (touch is a store, so tests set the times directly).
+    #[repr(C)]
+    struct EntryRaw {
+        socket: *mut TcpSocket,
+        user_data: u64,
+        last_rx_ns: u64,
+        last_tx_ns: u64,
+        interval_ns: u64,
+        timeout_ns: u64,
+        prev: u32,
+        next: u32,
+        slot: u32,
+        active: bool,
+    }
+
+    fn entry(hb: &mut Heartbeat, id: u32) -> &mut EntryRaw {
+        unsafe { &mut *(hb.hb.entries as *mut EntryRaw).add(id as usize) }
+    }
+
+    // Time of the add; both idle timers start there
+    fn base(hb: &mut Heartbeat, id: u32) -> u64 {
+        let entry = entry(hb, id);
+        assert_eq!(entry.last_rx_ns, entry.last_tx_ns);
+        entry.last_rx_ns
+    }
+
+    fn advance_at(hb: &mut Heartbeat, now: u64) -> Vec<(HeartbeatKind, u32, u64, u64)> {
+        fn run<F: FnMut(&HeartbeatEvent)>(hb: &mut Heartbeat, now: u64, mut callback: F) -> usize {
+            let mut n: usize = 0;
+            check(unsafe {
+                tcp_heartbeat_advance_at(&mut *hb.hb, now, dispatch_trampoline::<F>, &mut callback as *mut F as *mut c_void, &mut n)
+            })
+            .unwrap();
+            n
+        }
+
+        let mut events = Vec::new();
+        let n = run(hb, now, |event| events.push((event.kind, event.id, event.user_data, event.idle_nano)));
+        assert_eq!(n, events.len());
+        events
+    }
+
+    #[test]
+    fn test_timeout_after_slot_rollover() {
+        // 8 one-millisecond slots: a 20 ms deadline goes round the wheel twice first
+        let mut hb = Heartbeat::new(4, MS, 8).unwrap();
+        let mut socket: TcpSocket = unsafe { mem::zeroed() };
+        socket.state = TcpConnectionState::Connected;
+        let mut id: u32 = 0;
+        check(unsafe { tcp_heartbeat_add(&mut *hb.hb, &mut socket, 7, 0, 20, &mut id) }).unwrap();
+        let start = base(&mut hb, id);
+
+        for step in 0..40 {
+            assert!(advance_at(&mut hb, start + step * MS / 2).is_empty(), "early event at {} us", step * 500);
+        }
+        assert_eq!(advance_at(&mut hb, start + 20 * MS), vec![(HeartbeatKind::Timeout, id, 7, 20 * MS)]);
+        assert_eq!(socket.state, TcpConnectionState::Disconnected);
+        assert!(hb.is_empty());
+        assert!(advance_at(&mut hb, start + 40 * MS).is_empty());
+    }
+
+    #[test]
+    fn test_due_reschedules_from_last_send() {
+        let mut hb = Heartbeat::new(4, MS, 8).unwrap();
+        let id = hb.add(1, 5 * MS, 0).unwrap();
+        let start = base(&mut hb, id);
+        let due = vec![(HeartbeatKind::Due, id, 1, 5 * MS)];
+
+        assert!(advance_at(&mut hb, start + 5 * MS - 1).is_empty());
+        assert_eq!(advance_at(&mut hb, start + 5 * MS), due);
+        assert!(advance_at(&mut hb, start + 10 * MS - 1).is_empty());
+        assert_eq!(advance_at(&mut hb, start + 10 * MS), due);
+
+        // A send at 12 ms moves the next heartbeat to 17 ms; the entry is relinked when 15 ms comes round
+        entry(&mut hb, id).last_tx_ns = start + 12 * MS;
+        assert!(advance_at(&mut hb, start + 15 * MS).is_empty());
+        assert!(advance_at(&mut hb, start + 17 * MS - 1).is_empty());
+        assert_eq!(advance_at(&mut hb, start + 17 * MS), due);
+        assert_eq!(hb.len(), 1);
+    }
+
+    #[test]
+    fn test_receive_postpones_timeout() {
+        let mut hb = Heartbeat::new(4, MS, 8).unwrap();
+        let id = hb.add(2, 0, 10 * MS).unwrap();
+        let start = base(&mut hb, id);
+
+        entry(&mut hb, id).last_rx_ns = start + 8 * MS;
+        assert!(advance_at(&mut hb, start + 10 * MS).is_empty());
+        assert!(advance_at(&mut hb, start + 18 * MS - 1).is_empty());
+        assert_eq!(advance_at(&mut hb, start + 18 * MS), vec![(HeartbeatKind::Timeout, id, 2, 10 * MS)]);
+        assert_eq!(hb.add(3, 0, 10 * MS).unwrap(), id); // the entry went back to the free list
+    }
+
+    #[test]
+    fn test_long_gap_reports_once() {
+        let mut hb = Heartbeat::new(4, MS, 8).unwrap();
+        let id = hb.add(3, 2 * MS, 0).unwrap();
+        let start = base(&mut hb, id);
+
+        // Many rotations later every slot is visited once: one heartbeat, not one per missed interval
+        assert_eq!(advance_at(&mut hb, start + 1000 * MS), vec![(HeartbeatKind::Due, id, 3, 1000 * MS)]);
+        assert!(advance_at(&mut hb, start + 1002 * MS - 1).is_empty());
+        assert_eq!(advance_at(&mut hb, start + 1002 * MS), vec![(HeartbeatKind::Due, id, 3, 2 * MS)]);
+    }
+}
@@ -79,11 +79,39 @@
 //! LD_PRELOAD=/usr/lib64/libvma.so.x.x.x ./your_application
 //! ```
 //!
+//! A preloaded libvma reads its `VMA_*` environment at startup, so export the
+//! settings in the launch environment. [`common::vma_runtime_init`] reports
+//! which of the settings derived from your options are actually in effect:
+//!
+//! ```rust,no_run
+//! use vma_socket::common::{vma_runtime_init, VmaOptions};
+//!
+//! match vma_runtime_init(&VmaOptions::low_latency()) {
+//!     Ok(report) => for warning in &report.warnings { eprintln!("{}", warning) },
+//!     Err(report) => panic!("conflicting VMA settings: {:?}", report.warnings),
+//! }
+//! ```
+//!
 //! ## Module Structure
 //!
 //! - [`udp`]: UDP socket implementation
 //! - [`tcp`]: TCP socket implementation
 //! - [`common`]: Shared types and configuration options
+//! - [`xtreme`]: SocketXtreme completion engine for many sockets
+//! - [`poller`]: epoll-based readiness multiplexer for TCP servers
+//! - [`stats`]: Per-socket counters and latency histograms
+//! - [`mcast`]: Multicast feed receiver with A/B line arbitration
+//! - [`rx_group`]: SO_REUSEPORT sharded UDP receiver group
+//! - [`framed`]: Length-prefixed TCP message framing
+//! - [`server`]: Multi-threaded TCP server with per-core connection ownership
+//! - [`pool`]: Pre-warmed TCP connection pool for fast failover
+//! - [`heartbeat`]: Application heartbeats with per-connection deadlines
+//! - [`buffer_pool`]: Hugepage-backed, NUMA-aware receive buffer pool
+//! - [`packet_ring`]: Lock-free SPSC/MPSC datagram handoff ring
+//! - [`reactor`]: Async sockets driven by a dedicated epoll reactor thread
+//! - [`trace`]: Per-call hot-path tracing read through shared memory
+//! - [`pacer`]: Token-bucket paced UDP send queue
+//! - [`fast_path`]: Prepared send/receive handles for hot loops
 
 /// UDP socket implementation
 pub mod udp;
@@ -91,5 +119,50 @@ pub mod udp;
 /// TCP socket implementation
 pub mod tcp;
 
+/// SocketXtreme completion engine
+pub mod xtreme;
+
+/// epoll-based TCP server poller
+pub mod poller;
+
+/// Per-socket statistics
+pub mod stats;
+
+/// Multicast feed receiver
+pub mod mcast;
+
+/// SO_REUSEPORT receiver group
+pub mod rx_group;
+
+/// Length-prefixed TCP message framing
+pub mod framed;
+
+/// Multi-threaded TCP server runtime
+pub mod server;
+
+/// Pre-warmed TCP connection pool
+pub mod pool;
+
+/// Heartbeat scheduler
+pub mod heartbeat;
+
+/// Receive buffer pool
+pub mod buffer_pool;
+
+/// Datagram handoff ring
+pub mod packet_ring;
+
+/// Async socket reactor
+pub mod reactor;
+
+/// Hot-path tracing
+pub mod trace;
+
+/// Paced UDP sends
+pub mod pacer;
+
+/// Prepared fast-path handles
+pub mod fast_path;
+
 /// Common types and utilities
 pub mod common;
\ No newline at end of file
@@ -0,0 +1,488 @@
+//! Multicast feed receiver with A/B line arbitration and gap detection.
+//!
+//! [`McastReceiver`] joins the redundant lines of a market-data feed, drains
+//! them with batched receives and keeps the first copy of every sequence
+//! number. Arbitration runs in C next to the receive loop, so each datagram is
+//! read once into the receiver's buffers and handed out by reference.
+//!
+//! A hole stays open until every line has moved past it or
+//! [`McastConfig::gap_timeout_us`] expires; a copy that arrives on the other
+//! line in the meantime is delivered late (out of order) instead of being
+//! dropped. Sequence numbers compare modulo their width, so a 16- or 32-bit
+//! feed counter may wrap.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::mcast::{McastConfig, McastEvent, McastReceiver};
+//!
+//! // 32-bit big-endian sequence number at offset 0
+//! let mut feed = McastReceiver::new(None, McastConfig::new(0, 4)).unwrap();
+//! feed.add_line("239.1.1.1", 30001, Some("10.0.0.5"), None).unwrap(); // line A
+//! feed.add_line("239.1.1.2", 30001, Some("10.0.0.5"), None).unwrap(); // line B
+//!
+//! loop {
+//!     feed.recv(Some(100_000_000)).unwrap();
+//!     for event in feed.events() {
+//!         match event {
+//!             McastEvent::Data { seq, data, .. } => println!("{}: {} bytes", seq, data.len()),
+//!             McastEvent::Gap { seq, count } => println!("lost {} from {}", count, seq),
+//!         }
+//!     }
+//! }
+//! ```
+
+use std::ffi::{c_void, CString};
+use std::mem;
+use std::os::raw::{c_char, c_int};
+use std::ptr;
+use crate::common::{unixnano_to_ms, VmaOptions, WaitMode, WaitStats};
+use crate::udp::{TimestampSource, UdpPacket, UdpResult, UdpSocket, UDP_MAX_BATCH};
+
+/// Maximum number of redundant lines per feed (matches `UDP_MCAST_MAX_LINES`).
+pub const MCAST_MAX_LINES: usize = 2;
+
+/// Holes held open for a late copy at once (matches `UDP_MCAST_MAX_GAPS`).
+pub const MCAST_MAX_GAPS: usize = 32;
+
+/// Sequence number location and buffer layout.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct McastConfig {
+    /// Byte offset of the sequence number
+    pub seq_offset: usize,
+    /// Width in bytes (1, 2, 4 or 8)
+    pub seq_width: usize,
+    /// Network byte order (false for little endian)
+    pub seq_big_endian: bool,
+    /// Buffer slot size per datagram (largest expected datagram)
+    pub stride: usize,
+    /// Datagrams drained per line and call (0 for `UDP_MAX_BATCH`)
+    pub batch: usize,
+    /// How long a hole waits for a late copy from another line, in microseconds (0 for 1000)
+    pub gap_timeout_us: u32,
+}
+
+impl McastConfig {
+    /// Big-endian sequence number of `seq_width` bytes at `seq_offset`, 2KB slots, full batches.
+    pub fn new(seq_offset: usize, seq_width: usize) -> Self {
+        McastConfig {
+            seq_offset,
+            seq_width,
+            seq_big_endian: true,
+            stride: 2048,
+            batch: 0,
+            gap_timeout_us: 0,
+        }
+    }
+}
+
+/// Per-line counters.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct McastLineStats {
+    /// Datagrams read from the line
+    pub received: u64,
+    /// Datagrams delivered from this line (arrived first)
+    pub won: u64,
+    /// Datagrams dropped because the other line delivered them
+    pub duplicates: u64,
+}
+
+/// Feed counters.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct McastStats {
+    /// Data events produced
+    pub delivered: u64,
+    /// Datagrams dropped as already delivered (or arriving after their gap)
+    pub duplicates: u64,
+    /// Gap events produced
+    pub gaps: u64,
+    /// Sequence numbers reported missing
+    pub missing: u64,
+    /// Datagrams too short to hold the sequence number
+    pub malformed: u64,
+    /// Datagrams delivered into a hole after later sequence numbers
+    pub late_fills: u64,
+    /// Per-line counters
+    pub lines: [McastLineStats; MCAST_MAX_LINES],
+}
+
+// Event types (match `udp_mcast_event_type_t`)
+const MCAST_EVENT_DATA: c_int = 1;
+const MCAST_EVENT_GAP: c_int = 2;
+
+/// C representation of an arbitrated event.
+#[repr(C)]
+#[derive(Debug, Clone)]
+struct McastEventRaw {
+    event_type: c_int,
+    line: u32,
+    seq: u64,
+    count: u64,
+    packet: UdpPacket,
+}
+
+/// C representation of a datagram handed to `udp_mcast_arbitrate`.
+#[repr(C)]
+#[allow(dead_code)]
+struct McastArrivalRaw {
+    seq: u64,
+    line: u32,
+    packet: *mut UdpPacket,
+}
+
+/// C representation of an open hole.
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct McastGapRaw {
+    seq: u64,
+    count: u64,
+    expires_ns: u64,
+}
+
+/// C representation of the receiver structure.
+#[repr(C)]
+struct McastReceiverRaw {
+    lines: [UdpSocket; MCAST_MAX_LINES],
+    line_count: usize,
+    vma_options: VmaOptions,
+    config: McastConfig,
+    packets: *mut c_void,
+    buffers: *mut c_void,
+    pending: *mut c_void,
+    pending_head: usize,
+    pending_count: usize,
+    next_seq: u64,
+    synced: bool,
+    seq_mask: u64,
+    gap_timeout_ns: u64,
+    gaps: [McastGapRaw; MCAST_MAX_GAPS],
+    gap_count: usize,
+    line_next: [u64; MCAST_MAX_LINES],
+    line_seen: [bool; MCAST_MAX_LINES],
+    wait_mode: WaitMode,
+    wait_stats: WaitStats,
+    stats: McastStats,
+}
+
+extern "C" {
+    fn udp_mcast_init(rx: *mut McastReceiverRaw, options: *const VmaOptions, config: *const McastConfig) -> c_int;
+    fn udp_mcast_close(rx: *mut McastReceiverRaw) -> c_int;
+    fn udp_mcast_add_line(
+        rx: *mut McastReceiverRaw,
+        group_ip: *const c_char,
+        port: u16,
+        interface_ip: *const c_char,
+        source_ip: *const c_char,
+    ) -> c_int;
+    fn udp_mcast_recv(
+        rx: *mut McastReceiverRaw,
+        events: *mut McastEventRaw,
+        max_events: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+    fn udp_mcast_reset(rx: *mut McastReceiverRaw) -> c_int;
+    #[allow(dead_code)]
+    fn udp_mcast_arbitrate(rx: *mut McastReceiverRaw, arrivals: *mut McastArrivalRaw, count: usize, now_ns: u64) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), UdpResult> {
+    if result != UdpResult::UdpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+    }
+    Ok(())
+}
+
+fn optional_cstring(value: Option<&str>) -> Result<Option<CString>, std::io::Error> {
+    value
+        .map(|s| CString::new(s).map_err(|_| std::io::Error::from(UdpResult::UdpErrorInvalidParam)))
+        .transpose()
+}
+
+/// Event produced by the arbitration.
+#[derive(Debug)]
+pub enum McastEvent<'a> {
+    /// First copy of a sequence number (after later ones when it fills a hole).
+    Data {
+        /// Line the datagram won on (order of `add_line` calls)
+        line: usize,
+        /// Sequence number
+        seq: u64,
+        /// Payload, borrowed from the receiver's buffers
+        data: &'a [u8],
+        /// Receive timestamp in nanoseconds since the epoch
+        timestamp: u64,
+        /// Clock that produced `timestamp`
+        timestamp_source: TimestampSource,
+    },
+    /// Sequence numbers `seq..seq + count` were missing on every line (reported once
+    /// every line has moved past them or the gap timeout expired).
+    Gap {
+        /// First missing sequence number
+        seq: u64,
+        /// Number of missing sequence numbers
+        count: u64,
+    },
+}
+
+/// Multicast feed receiver for up to [`MCAST_MAX_LINES`] redundant lines.
+pub struct McastReceiver {
+    rx: Box<McastReceiverRaw>,
+    events: Vec<McastEventRaw>,
+    len: usize,
+}
+
+// The receiver owns its sockets and buffers exclusively; event data points into those buffers.
+unsafe impl Send for McastReceiver {}
+
+impl McastReceiver {
+    /// Create a receiver; `options` apply to every line.
+    pub fn new(options: Option<VmaOptions>, config: McastConfig) -> Result<Self, std::io::Error> {
+        let mut rx: Box<McastReceiverRaw> = Box::new(unsafe { mem::zeroed() });
+        let options_ptr = options.as_ref().map_or(ptr::null(), |o| o as *const VmaOptions);
+        check(unsafe { udp_mcast_init(&mut *rx, options_ptr, &config) })?;
+
+        let capacity = 2 * MCAST_MAX_LINES * UDP_MAX_BATCH + MCAST_MAX_GAPS;
+        Ok(McastReceiver {
+            rx,
+            events: vec![unsafe { mem::zeroed::<McastEventRaw>() }; capacity],
+            len: 0,
+        })
+    }
+
+    /// Join `group:port` on `interface` (any interface if `None`) as the next line.
+    ///
+    /// `source` restricts the line to one sender (source-specific multicast).
+    pub fn add_line(
+        &mut self,
+        group: &str,
+        port: u16,
+        interface: Option<&str>,
+        source: Option<&str>,
+    ) -> Result<(), std::io::Error> {
+        let c_group = CString::new(group).map_err(|_| std::io::Error::from(UdpResult::UdpErrorInvalidParam))?;
+        let c_interface = optional_cstring(interface)?;
+        let c_source = optional_cstring(source)?;
+
+        check(unsafe {
+            udp_mcast_add_line(
+                &mut *self.rx,
+                c_group.as_ptr(),
+                port,
+                c_interface.as_ref().map_or(ptr::null(), |s| s.as_ptr()),
+                c_source.as_ref().map_or(ptr::null(), |s| s.as_ptr()),
+            )
+        })?;
+        Ok(())
+    }
+
+    /// Number of lines joined.
+    pub fn line_count(&self) -> usize {
+        self.rx.line_count
+    }
+
+    /// Receive and arbitrate, returns the number of events (0 on timeout).
+    pub fn recv(&mut self, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        self.len = 0;
+        let mut stored: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        let result = unsafe {
+            udp_mcast_recv(&mut *self.rx, self.events.as_mut_ptr(), self.events.len(), timeout_ms, &mut stored)
+        };
+
+        match check(result) {
+            Ok(()) => {
+                self.len = stored;
+                Ok(stored)
+            },
+            Err(UdpResult::UdpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Iterate over the events produced by the last call to [`recv`](Self::recv).
+    pub fn events(&self) -> impl Iterator<Item = McastEvent<'_>> {
+        self.events[..self.len].iter().filter_map(|event| match event.event_type {
+            MCAST_EVENT_DATA => Some(McastEvent::Data {
+                line: event.line as usize,
+                seq: event.seq,
+                data: unsafe { std::slice::from_raw_parts(event.packet.data as *const u8, event.packet.length) },
+                timestamp: event.packet.timestamp,
+                timestamp_source: event.packet.timestamp_source,
+            }),
+            MCAST_EVENT_GAP => Some(McastEvent::Gap {
+                seq: event.seq,
+                count: event.count,
+            }),
+            _ => None,
+        })
+    }
+
+    /// Resynchronize on the next datagram (e.g. after a feed restart).
+    pub fn reset(&mut self) {
+        unsafe {
+            udp_mcast_reset(&mut *self.rx);
+        }
+    }
+
+    /// Next expected sequence number, if synchronized.
+    pub fn next_seq(&self) -> Option<u64> {
+        self.rx.synced.then_some(self.rx.next_seq)
+    }
+
+    /// Arbitration counters.
+    pub fn stats(&self) -> McastStats {
+        self.rx.stats
+    }
+
+    /// Receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.rx.wait_stats
+    }
+}
+
+impl Drop for McastReceiver {
+    fn drop(&mut self) {
+        unsafe {
+            udp_mcast_close(&mut *self.rx);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    const NOW: u64 = 1_000_000_000;
+    const DEFAULT_GAP_TIMEOUT_NS: u64 = 1_000_000;
+
+    fn receiver(seq_width: usize) -> McastReceiver {
+        McastReceiver::new(None, McastConfig::new(0, seq_width)).unwrap()
+    }
+
+    // Arbitrate (seq, line) arrivals at `now` and return (type, seq, count) per event
+    fn feed(feed: &mut McastReceiver, arrivals: &[(u64, u32)], now: u64) -> Vec<(c_int, u64, u64)> {
+        let mut packets = vec![unsafe { mem::zeroed::<UdpPacket>() }; arrivals.len()];
+        let mut raw: Vec<McastArrivalRaw> = arrivals
+            .iter()
+            .zip(packets.iter_mut())
+            .map(|(&(seq, line), packet)| McastArrivalRaw { seq, line, packet })
+            .collect();
+        check(unsafe { udp_mcast_arbitrate(&mut *feed.rx, raw.as_mut_ptr(), raw.len(), now) }).unwrap();
+
+        let rx = &mut *feed.rx;
+        let pending = rx.pending as *const McastEventRaw;
+        let events = (0..rx.pending_count)
+            .map(|i| unsafe { &*pending.add(rx.pending_head + i) })
+            .map(|event| (event.event_type, event.seq, event.count))
+            .collect();
+        rx.pending_head = 0;
+        rx.pending_count = 0;
+        events
+    }
+
+    fn data(seqs: &[u64]) -> Vec<(c_int, u64, u64)> {
+        seqs.iter().map(|&seq| (MCAST_EVENT_DATA, seq, 1)).collect()
+    }
+
+    #[test]
+    fn test_duplicates_across_wrap() {
+        let mut rx = receiver(2);
+        let line_a = [(65534, 0), (65535, 0), (0, 0), (1, 0)];
+        assert_eq!(feed(&mut rx, &line_a, NOW), data(&[65534, 65535, 0, 1]));
+        assert_eq!(rx.next_seq(), Some(2));
+
+        // Line B's copies arrive after the wrap: all duplicates, nothing lost
+        let line_b = [(65534, 1), (65535, 1), (0, 1), (1, 1)];
+        assert!(feed(&mut rx, &line_b, NOW).is_empty());
+        assert_eq!(rx.stats().duplicates, 4);
+        assert_eq!(rx.stats().lines[1].duplicates, 4);
+
+        // Still in sequence after the wrap
+        assert_eq!(feed(&mut rx, &[(2, 0), (2, 1)], NOW), data(&[2]));
+        assert_eq!(rx.stats().gaps, 0);
+    }
+
+    #[test]
+    fn test_sort_across_wrap() {
+        let mut rx = receiver(1);
+        feed(&mut rx, &[(253, 0), (253, 1)], NOW);
+        // Batch read out of order across the 8-bit wrap
+        assert_eq!(feed(&mut rx, &[(0, 1), (254, 0), (255, 1), (1, 0)], NOW), data(&[254, 255, 0, 1]));
+        assert_eq!(rx.next_seq(), Some(2));
+    }
+
+    #[test]
+    fn test_gap_across_wrap() {
+        let mut rx = receiver(2);
+        feed(&mut rx, &[(65535, 0)], NOW);
+        // A single line passing the hole closes it at once
+        let events = feed(&mut rx, &[(2, 0)], NOW);
+        assert_eq!(events, vec![(MCAST_EVENT_DATA, 2, 1), (MCAST_EVENT_GAP, 0, 2)]);
+        assert_eq!(rx.stats().missing, 2);
+    }
+
+    #[test]
+    fn test_late_fill_from_other_line() {
+        let mut rx = receiver(4);
+        feed(&mut rx, &[(1, 0), (1, 1)], NOW);
+
+        // Line A is ahead and skips 3; B has not got there yet, so the hole stays open
+        assert_eq!(feed(&mut rx, &[(2, 0), (4, 0)], NOW), data(&[2, 4]));
+        assert_eq!(rx.rx.gap_count, 1);
+
+        // B's copy of 3 fills it a little later
+        assert_eq!(feed(&mut rx, &[(2, 1), (3, 1), (4, 1)], NOW + 1_000), data(&[3]));
+        let stats = rx.stats();
+        assert_eq!(stats.late_fills, 1);
+        assert_eq!(stats.gaps, 0);
+        assert_eq!(stats.duplicates, 3);
+        assert_eq!(stats.lines[1].won, 1);
+        assert_eq!(rx.rx.gap_count, 0);
+    }
+
+    #[test]
+    fn test_gap_reported_once_every_line_passed() {
+        let mut rx = receiver(4);
+        feed(&mut rx, &[(10, 0), (10, 1)], NOW);
+        assert_eq!(feed(&mut rx, &[(13, 0)], NOW), data(&[13]));
+
+        // B moves past 11..12 without them: reported, and the count is exact
+        assert_eq!(feed(&mut rx, &[(13, 1)], NOW), vec![(MCAST_EVENT_GAP, 11, 2)]);
+        let stats = rx.stats();
+        assert_eq!((stats.gaps, stats.missing), (1, 2));
+
+        // A copy after the report is a duplicate
+        assert!(feed(&mut rx, &[(12, 1)], NOW).is_empty());
+        assert_eq!(rx.stats().late_fills, 0);
+    }
+
+    #[test]
+    fn test_gap_timeout() {
+        let mut rx = receiver(4);
+        feed(&mut rx, &[(20, 0), (20, 1)], NOW);
+        feed(&mut rx, &[(21, 0), (24, 0)], NOW);
+
+        // Line B stays silent: held just short of the timeout, reported at it
+        let timeout_ns = DEFAULT_GAP_TIMEOUT_NS;
+        assert!(feed(&mut rx, &[], NOW + timeout_ns - 1).is_empty());
+        assert_eq!(feed(&mut rx, &[], NOW + timeout_ns), vec![(MCAST_EVENT_GAP, 22, 2)]);
+    }
+
+    #[test]
+    fn test_split_gap() {
+        let mut rx = receiver(4);
+        feed(&mut rx, &[(0, 0), (0, 1)], NOW);
+        feed(&mut rx, &[(6, 0)], NOW);
+
+        // 3 arrives inside the hole 1..5 on B, which has now passed 1..2 as well
+        let events = feed(&mut rx, &[(3, 1)], NOW);
+        assert_eq!(events, vec![(MCAST_EVENT_DATA, 3, 1), (MCAST_EVENT_GAP, 1, 2)]);
+        assert_eq!(rx.rx.gap_count, 1);
+        assert_eq!(feed(&mut rx, &[(6, 1)], NOW), vec![(MCAST_EVENT_GAP, 4, 2)]);
+        assert_eq!(rx.stats().missing, 4);
+    }
+}
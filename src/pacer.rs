@@ -0,0 +1,546 @@
+//! Token-bucket paced UDP sends.
+//!
+//! A [`UdpPacer`] queues datagrams per destination ("lane") and releases them
+//! in small `sendmmsg` batches no faster than a byte and/or datagram rate,
+//! letting at most a configured burst leave back to back. This smooths the
+//! microbursts a publisher produces (a whole book update at once) that a
+//! receiver's NIC ring or socket buffer would otherwise drop. Limits apply
+//! per lane and socket-wide; the buckets run on the TSC clock.
+//!
+//! [`PacerConfig::use_txtime`] hands datagrams to the socket slightly early,
+//! stamped with their departure time (`SO_TXTIME`), so an fq or etf qdisc
+//! does the spacing; [`PacerConfig::use_pacing_rate`] also sets
+//! `SO_MAX_PACING_RATE`, which VMA maps to NIC packet pacing where the
+//! adapter supports it. Both fall back to software pacing when refused
+//! ([`PacerStats::txtime_active`], [`PacerStats::pacing_rate_active`]).
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::pacer::{PaceLimit, PacerConfig, UdpPacer};
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! let mut socket = VmaUdpSocket::new().unwrap();
+//! socket.connect("192.168.1.102", 5003).unwrap();
+//!
+//! // 100 MB/s with at most 16 KB back to back
+//! let config = PacerConfig {
+//!     limit: PaceLimit::bytes_per_sec(100_000_000, 16 * 1024),
+//!     ..Default::default()
+//! };
+//! let mut pacer = UdpPacer::new(socket, config).unwrap();
+//!
+//! for _ in 0..1000 {
+//!     pacer.enqueue(UdpPacer::CONNECTED, &[0u8; 1024]).unwrap();
+//!     pacer.flush().unwrap();
+//! }
+//! pacer.drain(Some(1_000_000_000)).unwrap();
+//! println!("max queue depth {}", pacer.stats().max_depth);
+//! ```
+
+use std::ffi::c_void;
+use std::io::Error;
+use std::mem;
+use std::os::raw::c_int;
+use std::ptr;
+use crate::common::unixnano_to_ms;
+use crate::udp::{UdpEndpoint, UdpResult, UdpSocket, VmaUdpSocket};
+
+/// Number of lanes per pacer, including [`UdpPacer::CONNECTED`].
+pub const PACER_MAX_LANES: usize = 16;
+
+// Lane argument for the socket-wide limit (matches `UDP_PACER_SOCKET_LIMIT`)
+const SOCKET_LIMIT: u32 = u32::MAX;
+
+/// Rate limit (C `udp_pacer_limit_t`); a zero rate leaves that dimension unlimited.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PaceLimit {
+    /// Payload byte rate.
+    pub bytes_per_sec: u64,
+    /// Datagram rate.
+    pub packets_per_sec: u64,
+    /// Bytes that may leave back to back (raised to the largest datagram; 0 for that).
+    pub burst_bytes: u32,
+    /// Datagrams that may leave back to back (0 for 1).
+    pub burst_packets: u32,
+}
+
+impl PaceLimit {
+    /// Limit to `rate` payload bytes per second, `burst` bytes back to back.
+    pub fn bytes_per_sec(rate: u64, burst: u32) -> Self {
+        PaceLimit {
+            bytes_per_sec: rate,
+            burst_bytes: burst,
+            ..Default::default()
+        }
+    }
+
+    /// Limit to `rate` datagrams per second, `burst` datagrams back to back.
+    pub fn packets_per_sec(rate: u64, burst: u32) -> Self {
+        PaceLimit {
+            packets_per_sec: rate,
+            burst_packets: burst,
+            ..Default::default()
+        }
+    }
+}
+
+/// Pacer configuration (C `udp_pacer_config_t`).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PacerConfig {
+    /// Socket-wide limit, applied on top of each lane's own.
+    pub limit: PaceLimit,
+    /// Datagrams queued per lane (rounded up to a power of two; 0 for 1024).
+    pub capacity: u32,
+    /// Largest payload accepted (0 for 1472).
+    pub max_datagram: usize,
+    /// Datagrams per `sendmmsg` (0 for 8; at most 64).
+    pub batch: u32,
+    /// Hand datagrams over early with an `SO_TXTIME` departure time.
+    pub use_txtime: bool,
+    /// Departure times on `CLOCK_TAI` (etf qdisc) instead of `CLOCK_MONOTONIC` (fq).
+    pub txtime_tai: bool,
+    /// How early a stamped datagram may be handed over, in microseconds (0 for 200).
+    pub txtime_horizon_us: u32,
+    /// Also set `SO_MAX_PACING_RATE` to the socket-wide byte rate.
+    pub use_pacing_rate: bool,
+}
+
+/// Pacer counters and queue depth (C `udp_pacer_stats_t`).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PacerStats {
+    /// Datagrams accepted.
+    pub enqueued: u64,
+    /// Datagrams refused because their lane was full.
+    pub dropped: u64,
+    /// Datagrams handed to the socket.
+    pub sent: u64,
+    /// Payload bytes handed to the socket.
+    pub sent_bytes: u64,
+    /// Datagrams discarded after the socket refused them.
+    pub send_errors: u64,
+    /// Times a lane with queued datagrams was held back by a bucket.
+    pub throttled: u64,
+    /// Datagrams queued now.
+    pub depth: u64,
+    /// Payload bytes queued now.
+    pub depth_bytes: u64,
+    /// Highest depth seen.
+    pub max_depth: u64,
+    /// Sum of the queueing delays of the datagrams sent.
+    pub total_delay_ns: u64,
+    /// Longest queueing delay of a datagram sent.
+    pub max_delay_ns: u64,
+    /// The socket accepted `SO_TXTIME`.
+    pub txtime_active: bool,
+    /// The socket accepted `SO_MAX_PACING_RATE`.
+    pub pacing_rate_active: bool,
+}
+
+impl PacerStats {
+    /// Mean time a sent datagram spent queued.
+    pub fn average_delay_ns(&self) -> u64 {
+        if self.sent == 0 {
+            0
+        } else {
+            self.total_delay_ns / self.sent
+        }
+    }
+}
+
+/// Destination queue of a pacer.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct Lane(u32);
+
+impl Lane {
+    /// Index of the lane in the pacer.
+    pub fn index(&self) -> usize {
+        self.0 as usize
+    }
+}
+
+/// Outcome of [`UdpPacer::flush`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Flush {
+    /// Datagrams sent.
+    pub sent: usize,
+    /// Nanoseconds until the next queued datagram is due (`None` when the queues are empty).
+    pub next_due_in_ns: Option<u64>,
+}
+
+/// C representation of a token bucket.
+#[repr(C)]
+struct PacerBucketRaw {
+    ns_per_byte: u64,
+    ns_per_packet: u64,
+    byte_burst_ns: u64,
+    packet_burst_ns: u64,
+    byte_tat: u64,
+    packet_tat: u64,
+}
+
+/// C representation of the pacer structure.
+#[repr(C)]
+struct PacerRaw {
+    lanes: *mut c_void,
+    lane_count: u32,
+    capacity: u32,
+    mask: u32,
+    batch: u32,
+    stride: usize,
+    max_datagram: usize,
+    next_lane: u32,
+    socket_fd: c_int,
+    bucket: PacerBucketRaw,
+    horizon_ns: u64,
+    txtime_clock: c_int,
+    stats: PacerStats,
+}
+
+extern "C" {
+    fn udp_pacer_init(pacer: *mut PacerRaw, socket: *mut UdpSocket, config: *const PacerConfig) -> c_int;
+    fn udp_pacer_close(pacer: *mut PacerRaw) -> c_int;
+    fn udp_pacer_add_endpoint(
+        pacer: *mut PacerRaw,
+        endpoint: *const UdpEndpoint,
+        limit: *const PaceLimit,
+        lane: *mut u32,
+    ) -> c_int;
+    fn udp_pacer_set_limit(pacer: *mut PacerRaw, lane: u32, limit: *const PaceLimit) -> c_int;
+    fn udp_pacer_enqueue(pacer: *mut PacerRaw, lane: u32, data: *const c_void, length: usize) -> c_int;
+    fn udp_pacer_flush(pacer: *mut PacerRaw, socket: *mut UdpSocket, sent: *mut usize, next_due_ns: *mut u64) -> c_int;
+    fn udp_pacer_drain(pacer: *mut PacerRaw, socket: *mut UdpSocket, timeout_ms: c_int) -> c_int;
+    fn udp_pacer_get_stats(pacer: *const PacerRaw, stats: *mut PacerStats) -> c_int;
+    fn vma_clock_ns() -> u64;
+    #[cfg(test)]
+    fn udp_pacer_flush_at(
+        pacer: *mut PacerRaw,
+        socket: *mut UdpSocket,
+        now_ns: u64,
+        sent: *mut usize,
+        next_due_ns: *mut u64,
+    ) -> c_int;
+    #[cfg(test)]
+    fn udp_pacer_bucket_configure(bucket: *mut PacerBucketRaw, limit: *const PaceLimit, max_datagram: usize);
+    #[cfg(test)]
+    fn udp_pacer_bucket_due(bucket: *const PacerBucketRaw, length: usize) -> u64;
+    #[cfg(test)]
+    fn udp_pacer_bucket_charge(bucket: *mut PacerBucketRaw, length: usize, at: u64);
+}
+
+fn check(result: c_int) -> Result<(), UdpResult> {
+    if result != UdpResult::UdpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+    }
+    Ok(())
+}
+
+fn limit_ptr(limit: &Option<PaceLimit>) -> *const PaceLimit {
+    limit.as_ref().map_or(ptr::null(), |limit| limit as *const PaceLimit)
+}
+
+/// Paced send queue that owns its socket (one thread: enqueue, flush and stats are not synchronized).
+pub struct UdpPacer {
+    raw: PacerRaw,
+    socket: VmaUdpSocket,
+}
+
+unsafe impl Send for UdpPacer {}
+
+impl UdpPacer {
+    /// Lane that sends to the socket's connected address under the socket-wide limit only.
+    pub const CONNECTED: Lane = Lane(0);
+
+    /// Create a pacer and preallocate its queues (`SO_TXTIME`/`SO_MAX_PACING_RATE` are set on `socket`).
+    pub fn new(mut socket: VmaUdpSocket, config: PacerConfig) -> Result<Self, Error> {
+        let mut raw: PacerRaw = unsafe { mem::zeroed() };
+        check(unsafe { udp_pacer_init(&mut raw, socket.raw_mut(), &config) })?;
+        Ok(UdpPacer { raw, socket })
+    }
+
+    /// Add a lane for `endpoint` with its own limit (`None` for the socket-wide limit only).
+    ///
+    /// Fails with `OutOfMemory` once [`PACER_MAX_LANES`] lanes exist.
+    pub fn add_endpoint(&mut self, endpoint: &UdpEndpoint, limit: Option<PaceLimit>) -> Result<Lane, Error> {
+        let mut lane = 0u32;
+        check(unsafe { udp_pacer_add_endpoint(&mut self.raw, endpoint, limit_ptr(&limit), &mut lane) })?;
+        Ok(Lane(lane))
+    }
+
+    /// Change a lane's limit (`None` for unlimited); queued datagrams keep their place.
+    pub fn set_lane_limit(&mut self, lane: Lane, limit: Option<PaceLimit>) -> Result<(), Error> {
+        check(unsafe { udp_pacer_set_limit(&mut self.raw, lane.0, limit_ptr(&limit)) })?;
+        Ok(())
+    }
+
+    /// Change the socket-wide limit (`None` for unlimited), including `SO_MAX_PACING_RATE` when active.
+    pub fn set_socket_limit(&mut self, limit: Option<PaceLimit>) -> Result<(), Error> {
+        check(unsafe { udp_pacer_set_limit(&mut self.raw, SOCKET_LIMIT, limit_ptr(&limit)) })?;
+        Ok(())
+    }
+
+    /// Queue a copy of `data` on `lane`.
+    ///
+    /// Fails with `OutOfMemory` when the lane is full (the datagram counts as dropped).
+    #[inline]
+    pub fn enqueue(&mut self, lane: Lane, data: &[u8]) -> Result<(), Error> {
+        check(unsafe { udp_pacer_enqueue(&mut self.raw, lane.0, data.as_ptr() as *const c_void, data.len()) })?;
+        Ok(())
+    }
+
+    /// Send whatever is due without waiting; call again after `next_due_in_ns`.
+    ///
+    /// A full socket buffer is not an error (nothing is sent). A datagram the
+    /// socket refuses otherwise is discarded and the error returned.
+    #[inline]
+    pub fn flush(&mut self) -> Result<Flush, Error> {
+        let mut sent = 0usize;
+        let mut next_due = 0u64;
+        let result = check(unsafe { udp_pacer_flush(&mut self.raw, self.socket.raw_mut(), &mut sent, &mut next_due) });
+        match result {
+            Ok(()) | Err(UdpResult::UdpErrorTimeout) => Ok(Flush {
+                sent,
+                next_due_in_ns: if next_due == 0 {
+                    None
+                } else {
+                    Some(next_due.saturating_sub(unsafe { vma_clock_ns() }))
+                },
+            }),
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Flush until the queues are empty, waiting for the buckets in between.
+    ///
+    /// Returns `false` if datagrams are still queued at the timeout.
+    pub fn drain(&mut self, timeout_nano: Option<u64>) -> Result<bool, Error> {
+        let result = check(unsafe { udp_pacer_drain(&mut self.raw, self.socket.raw_mut(), unixnano_to_ms(timeout_nano)) });
+        match result {
+            Ok(()) => Ok(true),
+            Err(UdpResult::UdpErrorTimeout) => Ok(false),
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Counters and queue depth.
+    pub fn stats(&self) -> PacerStats {
+        let mut stats = PacerStats::default();
+        unsafe {
+            udp_pacer_get_stats(&self.raw, &mut stats);
+        }
+        stats
+    }
+
+    /// Datagrams queued now.
+    #[inline]
+    pub fn depth(&self) -> u64 {
+        self.raw.stats.depth
+    }
+
+    /// The socket the pacer sends through.
+    pub fn socket(&self) -> &VmaUdpSocket {
+        &self.socket
+    }
+
+    /// The socket the pacer sends through (for receiving or unpaced sends).
+    pub fn socket_mut(&mut self) -> &mut VmaUdpSocket {
+        &mut self.socket
+    }
+}
+
+impl Drop for UdpPacer {
+    fn drop(&mut self) {
+        unsafe {
+            udp_pacer_close(&mut self.raw);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::net::{Ipv4Addr, UdpSocket as StdUdpSocket};
+    use std::os::fd::AsRawFd;
+    use std::os::unix::net::UnixDatagram;
+    use std::time::Duration;
+
+    const T: u64 = 1_000_000_000_000;
+    const MS: u64 = 1_000_000;
+
+    fn bucket(limit: PaceLimit, max_datagram: usize) -> PacerBucketRaw {
+        let mut bucket: PacerBucketRaw = unsafe { mem::zeroed() };
+        unsafe { udp_pacer_bucket_configure(&mut bucket, &limit, max_datagram) };
+        bucket
+    }
+
+    // Datagrams of `length` bytes the bucket lets leave back to back at `now`
+    fn burst(bucket: &mut PacerBucketRaw, length: usize, now: u64) -> usize {
+        let mut count = 0;
+        while unsafe { udp_pacer_bucket_due(bucket, length) } <= now {
+            unsafe { udp_pacer_bucket_charge(bucket, length, now) };
+            count += 1;
+            assert!(count < 1000, "bucket never throttles");
+        }
+        count
+    }
+
+    fn receiver() -> (StdUdpSocket, UdpEndpoint) {
+        let socket = StdUdpSocket::bind("127.0.0.1:0").unwrap();
+        socket.set_read_timeout(Some(Duration::from_secs(1))).unwrap();
+        let port = socket.local_addr().unwrap().port();
+        (socket, UdpEndpoint::new(Ipv4Addr::LOCALHOST, port))
+    }
+
+    fn received(socket: &StdUdpSocket, count: usize) -> Vec<(u8, u8)> {
+        let mut buffer = [0u8; 64];
+        (0..count)
+            .map(|_| {
+                let n = socket.recv(&mut buffer).unwrap();
+                assert_eq!(n, 2);
+                (buffer[0], buffer[1])
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_burst_allowance() {
+        // 1 MB/s is 1 us per byte: three 1000-byte datagrams fit the 3000-byte burst
+        let mut bytes = bucket(PaceLimit::bytes_per_sec(1_000_000, 3000), 1000);
+        assert_eq!(burst(&mut bytes, 1000, T), 3);
+        assert_eq!(unsafe { udp_pacer_bucket_due(&bytes, 1000) }, T + MS);
+        assert_eq!(burst(&mut bytes, 1000, T + MS), 1);
+
+        // Idle time refills the bucket up to the burst, not beyond
+        assert_eq!(burst(&mut bytes, 1000, T + 1000 * MS), 3);
+
+        let mut packets = bucket(PaceLimit::packets_per_sec(1000, 2), 1000);
+        assert_eq!(burst(&mut packets, 1000, T), 2);
+        assert_eq!(unsafe { udp_pacer_bucket_due(&packets, 1000) }, T + MS);
+
+        // A byte burst below one datagram is raised to max_datagram
+        let mut small = bucket(PaceLimit::bytes_per_sec(1_000_000, 10), 1000);
+        assert_eq!(burst(&mut small, 1000, T), 1);
+
+        // No limit: always conforms
+        let mut unlimited = bucket(PaceLimit::default(), 1000);
+        assert_eq!(unsafe { udp_pacer_bucket_due(&unlimited, 1000) }, 0);
+        unsafe { udp_pacer_bucket_charge(&mut unlimited, 1000, T) };
+        assert_eq!(unlimited.byte_tat, 0);
+    }
+
+    #[test]
+    fn test_refund_after_partial_send() {
+        // A datagram socket pair with a minimal send buffer: sendmmsg stops part way
+        let (tx, rx) = UnixDatagram::pair().unwrap();
+        tx.set_nonblocking(true).unwrap();
+        let sndbuf: c_int = 1;
+        unsafe {
+            libc::setsockopt(
+                tx.as_raw_fd(),
+                libc::SOL_SOCKET,
+                libc::SO_SNDBUF,
+                &sndbuf as *const c_int as *const c_void,
+                mem::size_of::<c_int>() as libc::socklen_t,
+            );
+        }
+        let mut socket: UdpSocket = unsafe { mem::zeroed() };
+        socket.socket_fd = tx.as_raw_fd();
+
+        let config = PacerConfig {
+            limit: PaceLimit::bytes_per_sec(1_000_000, 64 * 1000),
+            max_datagram: 1000,
+            batch: 16,
+            ..Default::default()
+        };
+        let mut pacer: PacerRaw = unsafe { mem::zeroed() };
+        check(unsafe { udp_pacer_init(&mut pacer, &mut socket, &config) }).unwrap();
+        for i in 0..16u8 {
+            check(unsafe { udp_pacer_enqueue(&mut pacer, 0, [i; 1000].as_ptr() as *const c_void, 1000) }).unwrap();
+        }
+
+        let mut order = Vec::new();
+        let mut buffer = [0u8; 1000];
+        let mut charged = 0u64;
+        while pacer.stats.depth > 0 {
+            let mut sent = 0usize;
+            let result = unsafe { udp_pacer_flush_at(&mut pacer, &mut socket, T, &mut sent, ptr::null_mut()) };
+            assert!(result == UdpResult::UdpSuccess as i32 || result == UdpResult::UdpErrorTimeout as i32);
+            if order.is_empty() {
+                assert!(sent > 0 && sent < 16, "send buffer took {} of 16", sent);
+            }
+
+            // Only what the socket took is charged (1 ms per 1000 bytes from T)
+            charged += sent as u64;
+            assert_eq!(pacer.bucket.byte_tat, T + charged * MS);
+            assert_eq!(pacer.stats.sent, charged);
+
+            for _ in 0..sent {
+                assert_eq!(rx.recv(&mut buffer).unwrap(), 1000);
+                order.push(buffer[0]);
+            }
+        }
+
+        assert_eq!(order, (0..16u8).collect::<Vec<_>>());
+        assert_eq!(pacer.stats.send_errors, 0);
+        unsafe { udp_pacer_close(&mut pacer) };
+    }
+
+    #[test]
+    fn test_lane_round_robin() {
+        let (rx, endpoint) = receiver();
+        let config = PacerConfig { batch: 8, ..Default::default() };
+        let mut pacer = UdpPacer::new(VmaUdpSocket::new().unwrap(), config).unwrap();
+        let lanes: Vec<Lane> = (0..3).map(|_| pacer.add_endpoint(&endpoint, None).unwrap()).collect();
+        for seq in 0..4u8 {
+            for lane in &lanes {
+                pacer.enqueue(*lane, &[lane.index() as u8, seq]).unwrap();
+            }
+        }
+
+        // One datagram per lane per pass; the next flush starts one lane further on
+        assert_eq!(pacer.flush().unwrap().sent, 8);
+        assert_eq!(received(&rx, 8), vec![(1, 0), (2, 0), (3, 0), (1, 1), (2, 1), (3, 1), (1, 2), (2, 2)]);
+        assert_eq!(pacer.flush().unwrap().sent, 4);
+        assert_eq!(received(&rx, 4), vec![(1, 3), (2, 3), (3, 2), (3, 3)]);
+
+        // A throttled lane is skipped without holding up the others
+        pacer.set_lane_limit(lanes[1], Some(PaceLimit::packets_per_sec(1, 1))).unwrap();
+        for seq in 0..3u8 {
+            for lane in &lanes {
+                pacer.enqueue(*lane, &[lane.index() as u8, seq]).unwrap();
+            }
+        }
+        assert_eq!(pacer.flush().unwrap().sent, 7);
+        assert_eq!(received(&rx, 7), vec![(2, 0), (3, 0), (1, 0), (3, 1), (1, 1), (3, 2), (1, 2)]);
+        assert_eq!(pacer.stats().throttled, 1);
+        let flush = pacer.flush().unwrap();
+        assert_eq!(flush.sent, 0);
+        assert!(flush.next_due_in_ns.unwrap() > 900 * MS);
+        assert_eq!(pacer.depth(), 2);
+    }
+
+    #[test]
+    fn test_drop_counter_when_full() {
+        let (rx, endpoint) = receiver();
+        let config = PacerConfig { capacity: 4, ..Default::default() };
+        let mut pacer = UdpPacer::new(VmaUdpSocket::new().unwrap(), config).unwrap();
+        let lane = pacer.add_endpoint(&endpoint, None).unwrap();
+
+        for seq in 0..4u8 {
+            pacer.enqueue(lane, &[1, seq]).unwrap();
+        }
+        let err = pacer.enqueue(lane, &[1, 4]).unwrap_err();
+        assert_eq!(err.kind(), std::io::ErrorKind::OutOfMemory);
+        let stats = pacer.stats();
+        assert_eq!((stats.enqueued, stats.dropped, stats.depth, stats.max_depth), (4, 1, 4, 4));
+
+        // Sending frees the full lane
+        assert_eq!(pacer.flush().unwrap().sent, 4);
+        assert_eq!(received(&rx, 4), vec![(1, 0), (1, 1), (1, 2), (1, 3)]);
+        pacer.enqueue(lane, &[1, 4]).unwrap();
+        assert_eq!(pacer.stats().dropped, 1);
+    }
+}
@@ -0,0 +1,466 @@
+//! Lock-free SPSC/MPSC datagram handoff between a receive thread and a consumer.
+//!
+//! The receive thread fills preallocated, cache-line padded ring slots
+//! straight from the socket ([`RingProducer::fill`] uses `recvmmsg`,
+//! [`ZeroCopyProducer::fill`] leaves the payload in VMA's receive buffers),
+//! and the consumer reads the slots in place through a [`RingBatch`], which
+//! frees the whole batch with one store when dropped. Nothing is allocated
+//! and nothing is copied between the socket and the consumer.
+//!
+//! Use [`spsc`] for one receive thread, [`mpsc`] when several threads feed
+//! the same consumer, and [`spsc_zero_copy`] to skip the copy out of VMA.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use std::thread;
+//! use vma_socket::packet_ring;
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! let (mut producer, mut consumer) = packet_ring::spsc(4096, 2048).unwrap();
+//!
+//! thread::spawn(move || {
+//!     let mut socket = VmaUdpSocket::new().unwrap();
+//!     socket.bind("0.0.0.0", 5001).unwrap();
+//!     loop {
+//!         let _ = producer.fill(&mut socket, 64, Some(0));
+//!     }
+//! });
+//!
+//! loop {
+//!     let batch = consumer.peek(64);
+//!     for packet in batch.iter() {
+//!         println!("{} bytes from {}", packet.data.len(), packet.src_addr);
+//!     }
+//! } // the batch is released here
+//! ```
+
+use std::cell::UnsafeCell;
+use std::ffi::c_void;
+use std::io::Error;
+use std::mem;
+use std::net::SocketAddrV4;
+use std::os::raw::c_int;
+use std::ptr;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use crate::common::{sockaddr_from_rust, sockaddr_to_rust, unixnano_to_ms, SockAddrIn};
+use crate::udp::{PacketView, TimestampSource, UdpPacket, UdpResult, UdpSocket, VmaUdpSocket};
+
+// Producer models (match `udp_ring_mode_t`)
+const RING_SPSC: c_int = 0;
+const RING_MPSC: c_int = 1;
+
+/// C representation of the ring structure.
+#[repr(C)]
+struct PacketRingRaw {
+    packets: *mut UdpPacket,
+    payloads: *mut u8,
+    sequences: *mut u64,
+    packet_ids: *mut *mut c_void,
+    capacity: u32,
+    mask: u32,
+    stride: usize,
+    mode: c_int,
+    pad0: [u8; 64],
+    tail: u64,
+    head_cache: u64,
+    reclaimed: u64,
+    full: u64,
+    zcopy_socket: *mut UdpSocket,
+    pad1: [u8; 64],
+    head: u64,
+    pad2: [u8; 64],
+}
+
+extern "C" {
+    fn udp_packet_ring_init(ring: *mut PacketRingRaw, capacity: u32, stride: usize, mode: c_int) -> c_int;
+    fn udp_packet_ring_close(ring: *mut PacketRingRaw) -> c_int;
+    fn udp_packet_ring_fill(
+        ring: *mut PacketRingRaw,
+        socket: *mut UdpSocket,
+        max: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+    fn udp_packet_ring_fill_zcopy(
+        ring: *mut PacketRingRaw,
+        socket: *mut UdpSocket,
+        max: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+    fn udp_packet_ring_push(
+        ring: *mut PacketRingRaw,
+        data: *const c_void,
+        length: usize,
+        src_addr: *const SockAddrIn,
+        timestamp: u64,
+        source: TimestampSource,
+    ) -> c_int;
+    fn udp_packet_ring_reclaim(ring: *mut PacketRingRaw) -> c_int;
+    fn udp_packet_ring_peek(ring: *mut PacketRingRaw, max: usize, packets: *mut *const UdpPacket) -> usize;
+    fn udp_packet_ring_release(ring: *mut PacketRingRaw, count: usize);
+    fn udp_packet_ring_size(ring: *const PacketRingRaw) -> usize;
+}
+
+fn check(result: c_int) -> Result<(), UdpResult> {
+    if result != UdpResult::UdpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+    }
+    Ok(())
+}
+
+// Shared between the two ends; the C ring keeps each field to one writer or atomics.
+struct RingInner {
+    raw: UnsafeCell<PacketRingRaw>,
+    // Socket of a zero-copy ring, dropped after the ring returned its buffers
+    socket: UnsafeCell<Option<VmaUdpSocket>>,
+}
+
+unsafe impl Send for RingInner {}
+unsafe impl Sync for RingInner {}
+
+impl RingInner {
+    fn new(capacity: usize, slot_size: usize, mode: c_int, socket: Option<VmaUdpSocket>) -> Result<Arc<Self>, Error> {
+        let inner = Arc::new(RingInner {
+            raw: UnsafeCell::new(unsafe { mem::zeroed() }),
+            socket: UnsafeCell::new(socket),
+        });
+        let capacity = capacity.min(1 << 31) as u32;
+        check(unsafe { udp_packet_ring_init(inner.raw(), capacity, slot_size, mode) })?;
+        Ok(inner)
+    }
+
+    #[inline]
+    fn raw(&self) -> *mut PacketRingRaw {
+        self.raw.get()
+    }
+
+    fn fill(&self, socket: *mut UdpSocket, zero_copy: bool, max: usize, timeout_nano: Option<u64>) -> Result<usize, Error> {
+        let mut received: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        let result = unsafe {
+            if zero_copy {
+                udp_packet_ring_fill_zcopy(self.raw(), socket, max, timeout_ms, &mut received)
+            } else {
+                udp_packet_ring_fill(self.raw(), socket, max, timeout_ms, &mut received)
+            }
+        };
+        match check(result) {
+            Ok(()) => Ok(received),
+            Err(UdpResult::UdpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    fn push(&self, data: &[u8], src_addr: Option<SocketAddrV4>, timestamp: u64) -> Result<(), Error> {
+        let addr = src_addr.map(|addr| sockaddr_from_rust(&addr));
+        check(unsafe {
+            udp_packet_ring_push(
+                self.raw(),
+                data.as_ptr() as *const c_void,
+                data.len(),
+                addr.as_ref().map_or(ptr::null(), |addr| addr as *const SockAddrIn),
+                timestamp,
+                if timestamp > 0 { TimestampSource::User } else { TimestampSource::None },
+            )
+        })?;
+        Ok(())
+    }
+
+    fn full_count(&self) -> u64 {
+        unsafe { (*(ptr::addr_of_mut!((*self.raw()).full) as *const AtomicU64)).load(Ordering::Relaxed) }
+    }
+}
+
+impl Drop for RingInner {
+    fn drop(&mut self) {
+        // Returns held zero-copy buffers while the socket is still open
+        unsafe {
+            udp_packet_ring_close(self.raw());
+        }
+    }
+}
+
+/// Create a ring for one receive thread.
+///
+/// `capacity` is rounded up to a power of two and `slot_size` is the largest
+/// datagram a slot holds (0 for 2048).
+pub fn spsc(capacity: usize, slot_size: usize) -> Result<(RingProducer, RingConsumer), Error> {
+    let ring = RingInner::new(capacity, slot_size, RING_SPSC, None)?;
+    Ok((RingProducer { ring: Arc::clone(&ring) }, RingConsumer { ring }))
+}
+
+/// Create a ring that several threads can feed (the producer is `Clone`).
+pub fn mpsc(capacity: usize, slot_size: usize) -> Result<(SharedRingProducer, RingConsumer), Error> {
+    let ring = RingInner::new(capacity, slot_size, RING_MPSC, None)?;
+    Ok((SharedRingProducer { ring: Arc::clone(&ring) }, RingConsumer { ring }))
+}
+
+/// Create a ring filled zero-copy from `socket`, which the producer takes over.
+///
+/// Slots point into VMA's receive buffers, which go back to VMA once the
+/// consumer released them. Each slot held keeps a VMA buffer out of the
+/// receive ring, so keep `capacity` well below VMA's receive buffer count.
+pub fn spsc_zero_copy(socket: VmaUdpSocket, capacity: usize, slot_size: usize) -> Result<(ZeroCopyProducer, RingConsumer), Error> {
+    let ring = RingInner::new(capacity, slot_size, RING_SPSC, Some(socket))?;
+    Ok((ZeroCopyProducer { ring: Arc::clone(&ring) }, RingConsumer { ring }))
+}
+
+/// Producer end of an SPSC ring.
+pub struct RingProducer {
+    ring: Arc<RingInner>,
+}
+
+impl RingProducer {
+    /// Receive up to `max` datagrams from `socket` straight into free slots.
+    ///
+    /// Returns the number published (0 on timeout). When the ring is full
+    /// nothing is read from the socket and an `OutOfMemory` error is returned.
+    pub fn fill(&mut self, socket: &mut VmaUdpSocket, max: usize, timeout_nano: Option<u64>) -> Result<usize, Error> {
+        self.ring.fill(socket.raw_mut(), false, max, timeout_nano)
+    }
+
+    /// Copy one datagram into a free slot (`timestamp` 0 for none).
+    pub fn push(&mut self, data: &[u8], src_addr: Option<SocketAddrV4>, timestamp: u64) -> Result<(), Error> {
+        self.ring.push(data, src_addr, timestamp)
+    }
+
+    /// Number of fills and pushes that found the ring full.
+    pub fn full_count(&self) -> u64 {
+        self.ring.full_count()
+    }
+}
+
+/// Producer end of an MPSC ring (clone it for every producer thread).
+#[derive(Clone)]
+pub struct SharedRingProducer {
+    ring: Arc<RingInner>,
+}
+
+impl SharedRingProducer {
+    /// Receive up to `max` datagrams from `socket` straight into free slots.
+    ///
+    /// Returns the number published (0 on timeout). When the ring is full
+    /// nothing is read from the socket and an `OutOfMemory` error is returned.
+    pub fn fill(&self, socket: &mut VmaUdpSocket, max: usize, timeout_nano: Option<u64>) -> Result<usize, Error> {
+        self.ring.fill(socket.raw_mut(), false, max, timeout_nano)
+    }
+
+    /// Copy one datagram into a free slot (`timestamp` 0 for none).
+    pub fn push(&self, data: &[u8], src_addr: Option<SocketAddrV4>, timestamp: u64) -> Result<(), Error> {
+        self.ring.push(data, src_addr, timestamp)
+    }
+
+    /// Number of fills and pushes that found the ring full.
+    pub fn full_count(&self) -> u64 {
+        self.ring.full_count()
+    }
+}
+
+/// Producer end of a zero-copy SPSC ring; owns the socket it receives from.
+pub struct ZeroCopyProducer {
+    ring: Arc<RingInner>,
+}
+
+impl ZeroCopyProducer {
+    /// Receive up to `max` datagrams without copying them out of VMA.
+    ///
+    /// Buffers of slots the consumer released are returned to VMA first.
+    /// Returns the number published (0 on timeout). When the ring is full
+    /// nothing is read from the socket and an `OutOfMemory` error is returned.
+    pub fn fill(&mut self, max: usize, timeout_nano: Option<u64>) -> Result<usize, Error> {
+        let socket = self.socket().raw_mut() as *mut UdpSocket;
+        self.ring.fill(socket, true, max, timeout_nano)
+    }
+
+    /// Return buffers of released slots to VMA (call when idle).
+    pub fn reclaim(&mut self) -> Result<(), Error> {
+        check(unsafe { udp_packet_ring_reclaim(self.ring.raw()) })?;
+        Ok(())
+    }
+
+    /// The socket the ring receives from (e.g. to send replies).
+    pub fn socket(&mut self) -> &mut VmaUdpSocket {
+        // Only the producer touches the socket until the ring is closed
+        unsafe { (*self.ring.socket.get()).as_mut().expect("zero-copy ring without a socket") }
+    }
+
+    /// Number of fills that found the ring full.
+    pub fn full_count(&self) -> u64 {
+        self.ring.full_count()
+    }
+}
+
+/// Consumer end of a ring.
+pub struct RingConsumer {
+    ring: Arc<RingInner>,
+}
+
+impl RingConsumer {
+    /// Take up to `max` ready slots; they are freed when the batch is dropped.
+    ///
+    /// A batch stops at the end of the ring, so an empty batch means nothing
+    /// is ready and a short one may be followed by more.
+    #[inline]
+    pub fn peek(&mut self, max: usize) -> RingBatch<'_> {
+        let mut packets: *const UdpPacket = ptr::null();
+        let count = unsafe { udp_packet_ring_peek(self.ring.raw(), max, &mut packets) };
+        RingBatch { consumer: self, packets, count }
+    }
+
+    /// Number of slots published or being filled.
+    pub fn len(&self) -> usize {
+        unsafe { udp_packet_ring_size(self.ring.raw()) }
+    }
+
+    /// Whether no slot is published or being filled.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+/// Ready slots read in place; released together when dropped.
+pub struct RingBatch<'a> {
+    consumer: &'a mut RingConsumer,
+    packets: *const UdpPacket,
+    count: usize,
+}
+
+impl<'a> RingBatch<'a> {
+    /// Number of slots in the batch (including MPSC slots without a datagram).
+    pub fn len(&self) -> usize {
+        self.count
+    }
+
+    /// Whether the batch is empty.
+    pub fn is_empty(&self) -> bool {
+        self.count == 0
+    }
+
+    /// Get the datagram in slot `index` (`None` past the end or for a slot without a datagram).
+    pub fn get(&self, index: usize) -> Option<PacketView<'_>> {
+        if index >= self.count {
+            return None;
+        }
+
+        let packet = unsafe { &*self.packets.add(index) };
+        if packet.data.is_null() {
+            return None;
+        }
+
+        Some(PacketView {
+            data: unsafe { std::slice::from_raw_parts(packet.data as *const u8, packet.length) },
+            src_addr: sockaddr_to_rust(&packet.src_addr),
+            timestamp: packet.timestamp,
+            timestamp_source: packet.timestamp_source,
+        })
+    }
+
+    /// Iterate over the datagrams in the batch.
+    pub fn iter(&self) -> impl Iterator<Item = PacketView<'_>> {
+        (0..self.count).filter_map(move |i| self.get(i))
+    }
+}
+
+impl Drop for RingBatch<'_> {
+    /// Free every slot of the batch with a single store.
+    fn drop(&mut self) {
+        unsafe { udp_packet_ring_release(self.consumer.ring.raw(), self.count) }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::net::Ipv4Addr;
+    use std::thread;
+    use std::time::{Duration, Instant};
+
+    #[test]
+    fn test_spsc_wrap() {
+        let (mut producer, mut consumer) = spsc(8, 64).unwrap();
+        let src = SocketAddrV4::new(Ipv4Addr::new(10, 0, 0, 1), 5001);
+        let mut next_push = 0u32;
+        let mut next_pop = 0u32;
+
+        // Uneven rounds move the positions round the 8 slots many times
+        for round in 0..50 {
+            for _ in 0..(round % 8 + 1) {
+                producer.push(&next_push.to_le_bytes(), Some(src), next_push as u64 + 1).unwrap();
+                next_push += 1;
+            }
+            while !consumer.is_empty() {
+                let batch = consumer.peek(64);
+                assert!(!batch.is_empty());
+                for packet in batch.iter() {
+                    assert_eq!(packet.data, &next_pop.to_le_bytes());
+                    assert_eq!(packet.src_addr, std::net::SocketAddr::V4(src));
+                    assert_eq!(packet.timestamp, next_pop as u64 + 1);
+                    next_pop += 1;
+                }
+            }
+        }
+        assert_eq!(next_pop, next_push);
+
+        // A full ring refuses the next push; a batch stops at the end of the ring
+        let start = next_push % 8;
+        for i in 0..8u32 {
+            producer.push(&i.to_le_bytes(), None, 0).unwrap();
+        }
+        assert_eq!(producer.push(b"x", None, 0).unwrap_err().kind(), std::io::ErrorKind::OutOfMemory);
+        assert_eq!(producer.full_count(), 1);
+        assert_eq!(consumer.len(), 8);
+        assert_eq!(consumer.peek(64).len(), (8 - start) as usize);
+        assert_eq!(consumer.peek(64).len(), start as usize);
+        assert!(consumer.is_empty());
+    }
+
+    #[test]
+    fn test_mpsc_stress() {
+        const PRODUCERS: u32 = 4;
+        const PER_PRODUCER: u32 = 20_000;
+        let (producer, mut consumer) = mpsc(256, 64).unwrap();
+
+        let threads: Vec<_> = (0..PRODUCERS)
+            .map(|id| {
+                let producer = producer.clone();
+                thread::spawn(move || {
+                    for seq in 0..PER_PRODUCER {
+                        let mut message = [0u8; 8];
+                        message[..4].copy_from_slice(&id.to_le_bytes());
+                        message[4..].copy_from_slice(&seq.to_le_bytes());
+                        while producer.push(&message, None, 0).is_err() {
+                            thread::yield_now();
+                        }
+                    }
+                })
+            })
+            .collect();
+        drop(producer);
+
+        // Each producer's datagrams arrive once each and in its own order
+        let mut next = [0u32; PRODUCERS as usize];
+        let mut total = 0;
+        let deadline = Instant::now() + Duration::from_secs(30);
+        while total < PRODUCERS * PER_PRODUCER {
+            assert!(Instant::now() < deadline, "stalled after {} datagrams", total);
+            let batch = consumer.peek(64);
+            for packet in batch.iter() {
+                assert_eq!(packet.data.len(), 8);
+                let id = u32::from_le_bytes(packet.data[..4].try_into().unwrap()) as usize;
+                let seq = u32::from_le_bytes(packet.data[4..].try_into().unwrap());
+                assert_eq!(seq, next[id], "producer {} out of order", id);
+                next[id] += 1;
+                total += 1;
+            }
+        }
+
+        for thread in threads {
+            thread.join().unwrap();
+        }
+        assert_eq!(next, [PER_PRODUCER; PRODUCERS as usize]);
+        assert!(consumer.peek(64).iter().next().is_none());
+    }
+}
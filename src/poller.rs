@@ -0,0 +1,231 @@
+//! epoll-based readiness multiplexer for TCP servers with many clients.
+//!
+//! [`TcpServerPoller`] waits on a listening socket and any number of accepted
+//! clients with a single `epoll_wait`, replacing per-socket timed receives. Under
+//! `LD_PRELOAD=libvma.so` the epoll calls are offloaded by VMA, so readiness of
+//! accelerated sockets is detected from its rings.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use std::collections::HashMap;
+//! use std::os::fd::AsRawFd;
+//! use vma_socket::tcp::VmaTcpSocket;
+//! use vma_socket::poller::{TcpServerPoller, PollerEvent};
+//!
+//! let mut server = VmaTcpSocket::new().unwrap();
+//! server.bind("0.0.0.0", 5002).unwrap();
+//! server.listen(128).unwrap();
+//!
+//! let mut poller = TcpServerPoller::new(0).unwrap();
+//! poller.add_listener(&server, 0).unwrap();
+//!
+//! let mut clients = HashMap::new();
+//! let mut events = vec![PollerEvent::default(); 64];
+//! let mut buffer = vec![0u8; 4096];
+//! loop {
+//!     let n = poller.wait(&mut events, Some(100_000_000)).unwrap();
+//!     for event in &events[..n] {
+//!         if event.is_listener() {
+//!             if let Some(client) = server.accept(Some(0)).unwrap() {
+//!                 poller.add_client(&client, 0).unwrap();
+//!                 clients.insert(client.as_raw_fd(), client);
+//!             }
+//!         } else if let Some(client) = clients.get_mut(&event.fd) {
+//!             let received = client.recv(&mut buffer, Some(0)).unwrap_or(0);
+//!             if received == 0 || event.is_hangup() {
+//!                 poller.remove(event.fd).unwrap();
+//!                 clients.remove(&event.fd);
+//!             }
+//!         }
+//!     }
+//! }
+//! ```
+
+use std::ffi::c_void;
+use std::mem;
+use std::os::fd::{AsRawFd, RawFd};
+use std::os::raw::c_int;
+use crate::common::unixnano_to_ms;
+use crate::tcp::{Client, TcpResult, VmaTcpSocket};
+
+/// Maximum number of events returned by one wait (matches `TCP_POLLER_MAX_EVENTS`).
+pub const POLLER_MAX_EVENTS: usize = 256;
+
+/// Data (or a pending connection on the listener) is available.
+pub const POLLER_READABLE: u32 = 0x01;
+/// Socket has send buffer space (only reported when requested).
+pub const POLLER_WRITABLE: u32 = 0x02;
+/// Peer closed the connection.
+pub const POLLER_HANGUP: u32 = 0x04;
+/// Socket error.
+pub const POLLER_ERROR: u32 = 0x08;
+
+/// C representation of a readiness event.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct PollerEvent {
+    /// Ready descriptor
+    pub fd: c_int,
+    /// `POLLER_*` flags
+    pub events: u32,
+    /// Value given at registration
+    pub user_data: u64,
+    is_listener: bool,
+    client: *mut c_void,
+}
+
+impl Default for PollerEvent {
+    fn default() -> Self {
+        PollerEvent {
+            fd: -1,
+            events: 0,
+            user_data: 0,
+            is_listener: false,
+            client: std::ptr::null_mut(),
+        }
+    }
+}
+
+impl PollerEvent {
+    /// Whether the event belongs to the listening socket (a connection is ready to accept).
+    pub fn is_listener(&self) -> bool {
+        self.is_listener
+    }
+
+    /// Whether data is available.
+    pub fn is_readable(&self) -> bool {
+        self.events & POLLER_READABLE != 0
+    }
+
+    /// Whether the socket has send buffer space.
+    pub fn is_writable(&self) -> bool {
+        self.events & POLLER_WRITABLE != 0
+    }
+
+    /// Whether the peer closed the connection or the socket failed.
+    pub fn is_hangup(&self) -> bool {
+        self.events & (POLLER_HANGUP | POLLER_ERROR) != 0
+    }
+}
+
+/// C representation of the poller structure.
+#[repr(C)]
+struct TcpServerPollerRaw {
+    epoll_fd: c_int,
+    listener_fd: c_int,
+    slots: *mut c_void,
+    slot_capacity: c_int,
+    registered: c_int,
+}
+
+extern "C" {
+    fn tcp_poller_init(poller: *mut TcpServerPollerRaw, expected_fds: c_int) -> c_int;
+    fn tcp_poller_close(poller: *mut TcpServerPollerRaw) -> c_int;
+    fn tcp_poller_add_listener_fd(poller: *mut TcpServerPollerRaw, fd: c_int, user_data: u64) -> c_int;
+    fn tcp_poller_add_fd(poller: *mut TcpServerPollerRaw, fd: c_int, user_data: u64) -> c_int;
+    fn tcp_poller_set_writable(poller: *mut TcpServerPollerRaw, fd: c_int, want_write: bool) -> c_int;
+    fn tcp_poller_remove(poller: *mut TcpServerPollerRaw, fd: c_int) -> c_int;
+    fn tcp_poller_wait(
+        poller: *mut TcpServerPollerRaw,
+        events: *mut PollerEvent,
+        max_events: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+/// epoll-based readiness multiplexer for a listening socket and its clients.
+///
+/// Sockets are registered by file descriptor, so `Client` values can be moved
+/// freely while registered. Unregister a socket before closing or dropping it.
+pub struct TcpServerPoller {
+    poller: Box<TcpServerPollerRaw>,
+}
+
+// The poller owns its epoll fd and registration table exclusively.
+unsafe impl Send for TcpServerPoller {}
+
+impl TcpServerPoller {
+    /// Create a poller sized for `expected_fds` descriptors (0 for the default).
+    pub fn new(expected_fds: usize) -> Result<Self, std::io::Error> {
+        let mut poller: Box<TcpServerPollerRaw> = Box::new(unsafe { mem::zeroed() });
+        check(unsafe { tcp_poller_init(&mut *poller, expected_fds as c_int) })?;
+        Ok(TcpServerPoller { poller })
+    }
+
+    /// Register a descriptor.
+    pub fn add_fd(&mut self, fd: RawFd, user_data: u64) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_poller_add_fd(&mut *self.poller, fd, user_data) })?;
+        Ok(())
+    }
+
+    /// Register the listening socket (its events report `is_listener()`).
+    pub fn add_listener(&mut self, socket: &VmaTcpSocket, user_data: u64) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_poller_add_listener_fd(&mut *self.poller, socket.as_raw_fd(), user_data) })?;
+        Ok(())
+    }
+
+    /// Register an accepted client.
+    pub fn add_client(&mut self, client: &Client, user_data: u64) -> Result<(), std::io::Error> {
+        self.add_fd(client.as_raw_fd(), user_data)
+    }
+
+    /// Enable or disable writability reporting for a registered descriptor.
+    pub fn set_writable(&mut self, fd: RawFd, want_write: bool) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_poller_set_writable(&mut *self.poller, fd, want_write) })?;
+        Ok(())
+    }
+
+    /// Unregister a descriptor.
+    pub fn remove(&mut self, fd: RawFd) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_poller_remove(&mut *self.poller, fd) })?;
+        Ok(())
+    }
+
+    /// Number of registered descriptors.
+    pub fn len(&self) -> usize {
+        self.poller.registered as usize
+    }
+
+    /// Whether no descriptors are registered.
+    pub fn is_empty(&self) -> bool {
+        self.poller.registered == 0
+    }
+
+    /// Wait for ready descriptors, returns the number of events stored (0 on timeout).
+    pub fn wait(&mut self, events: &mut [PollerEvent], timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        let mut stored: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        let result = unsafe {
+            tcp_poller_wait(&mut *self.poller, events.as_mut_ptr(), events.len(), timeout_ms, &mut stored)
+        };
+
+        match check(result) {
+            Ok(()) => Ok(stored),
+            Err(TcpResult::TcpErrorTimeout) => Ok(0),
+            Err(e) => Err(e.into()),
+        }
+    }
+}
+
+impl AsRawFd for TcpServerPoller {
+    fn as_raw_fd(&self) -> RawFd {
+        self.poller.epoll_fd
+    }
+}
+
+impl Drop for TcpServerPoller {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_poller_close(&mut *self.poller);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+//! Pre-warmed TCP connection pool for fast failover.
+//!
+//! A [`ConnectionPool`] keeps spare sockets that are already created and
+//! configured exactly like a fresh [`VmaTcpSocket`] (optionally already
+//! connected to standby endpoints). When a connection drops,
+//! [`replace`](ConnectionPool::replace) swaps a spare into the socket in one
+//! call, so failover costs at most a handshake instead of socket creation,
+//! VMA offload setup and the handshake. The socket keeps its statistics.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::pool::ConnectionPool;
+//! use vma_socket::tcp::VmaTcpSocket;
+//!
+//! let mut pool = ConnectionPool::new(None, 2, true).unwrap();
+//! pool.add_endpoint("10.0.0.3", 9000).unwrap(); // standby gateway
+//! pool.refill(Some(500_000_000)).unwrap();
+//!
+//! let mut socket = VmaTcpSocket::new().unwrap();
+//! socket.connect("10.0.0.2", 9000, Some(1_000_000_000)).unwrap();
+//! // ... on a send or receive error:
+//! pool.replace(&mut socket, Some(500_000_000)).unwrap();
+//! pool.refill(Some(500_000_000)).unwrap(); // later, off the hot path
+//! ```
+
+use std::ffi::CString;
+use std::mem;
+use std::os::raw::{c_char, c_int};
+use std::ptr;
+use crate::common::{unixnano_to_ms, SockAddrIn, VmaOptions};
+use crate::tcp::{TcpResult, TcpSocket, VmaTcpSocket};
+
+/// Maximum number of spare sockets (matches `TCP_POOL_MAX_SPARES`).
+pub const POOL_MAX_SPARES: usize = 16;
+
+/// Maximum number of standby endpoints (matches `TCP_POOL_MAX_ENDPOINTS`).
+pub const POOL_MAX_ENDPOINTS: usize = 8;
+
+/// Pool counters.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PoolStats {
+    /// Spare sockets created
+    pub created: u64,
+    /// Spares connected ahead of time
+    pub connected: u64,
+    /// Spares swapped into a live socket
+    pub swaps: u64,
+    /// Pre-connected spares found dead and discarded
+    pub stale: u64,
+    /// Spare creations or connects that failed
+    pub failures: u64,
+}
+
+/// C representation of the pool structure.
+#[repr(C)]
+struct ConnPoolRaw {
+    vma_options: VmaOptions,
+    spares: [TcpSocket; POOL_MAX_SPARES],
+    spare_count: usize,
+    target: usize,
+    endpoints: [SockAddrIn; POOL_MAX_ENDPOINTS],
+    endpoint_count: usize,
+    next_endpoint: usize,
+    preconnect: bool,
+    stats: PoolStats,
+}
+
+extern "C" {
+    fn tcp_pool_init(pool: *mut ConnPoolRaw, options: *const VmaOptions, target: usize, preconnect: bool) -> c_int;
+    fn tcp_pool_close(pool: *mut ConnPoolRaw) -> c_int;
+    fn tcp_pool_add_endpoint(pool: *mut ConnPoolRaw, ip: *const c_char, port: u16) -> c_int;
+    fn tcp_pool_refill(pool: *mut ConnPoolRaw, timeout_ms: c_int, ready: *mut usize) -> c_int;
+    fn tcp_pool_replace(pool: *mut ConnPoolRaw, socket: *mut TcpSocket, timeout_ms: c_int) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+/// Spare sockets ready to replace a dropped connection.
+pub struct ConnectionPool {
+    pool: Box<ConnPoolRaw>,
+}
+
+// The pool owns its spare sockets exclusively.
+unsafe impl Send for ConnectionPool {}
+
+impl ConnectionPool {
+    /// Create an empty pool keeping `spares` sockets (filled by [`refill`](Self::refill)).
+    ///
+    /// With `preconnect`, spares are connected to the standby endpoints in turn.
+    pub fn new(options: Option<VmaOptions>, spares: usize, preconnect: bool) -> Result<Self, std::io::Error> {
+        let mut pool: Box<ConnPoolRaw> = Box::new(unsafe { mem::zeroed() });
+        let options_ptr = options.as_ref().map_or(ptr::null(), |o| o as *const VmaOptions);
+        check(unsafe { tcp_pool_init(&mut *pool, options_ptr, spares, preconnect) })?;
+        Ok(ConnectionPool { pool })
+    }
+
+    /// Add a standby endpoint.
+    pub fn add_endpoint(&mut self, addr: &str, port: u16) -> Result<(), std::io::Error> {
+        let c_addr = CString::new(addr).map_err(|_| std::io::Error::from(TcpResult::TcpErrorInvalidParam))?;
+        check(unsafe { tcp_pool_add_endpoint(&mut *self.pool, c_addr.as_ptr(), port) })?;
+        Ok(())
+    }
+
+    /// Top the pool up, returns the number of spares ready (call off the hot path).
+    pub fn refill(&mut self, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        let mut ready: usize = 0;
+        check(unsafe { tcp_pool_refill(&mut *self.pool, unixnano_to_ms(timeout_nano), &mut ready) })?;
+        Ok(ready)
+    }
+
+    /// Swap a spare into `socket`, connecting it first if it is not pre-connected.
+    ///
+    /// Returns false when the pool is empty.
+    pub fn replace(&mut self, socket: &mut VmaTcpSocket, timeout_nano: Option<u64>) -> Result<bool, std::io::Error> {
+        let result = unsafe { tcp_pool_replace(&mut *self.pool, socket.raw_mut(), unixnano_to_ms(timeout_nano)) };
+
+        match check(result) {
+            Ok(()) => Ok(true),
+            Err(TcpResult::TcpErrorNotInitialized) => Ok(false), // empty pool is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Number of spares ready.
+    pub fn available(&self) -> usize {
+        self.pool.spare_count
+    }
+
+    /// Pool counters.
+    pub fn stats(&self) -> PoolStats {
+        self.pool.stats
+    }
+}
+
+impl Drop for ConnectionPool {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_pool_close(&mut *self.pool);
+        }
+    }
+}
@@ -0,0 +1,675 @@
+//! Async adapters for VMA sockets driven by a dedicated reactor thread.
+//!
+//! A [`Reactor`] owns one thread that waits on an epoll set (offloaded by VMA
+//! when preloaded, so readiness of accelerated sockets comes from its rings)
+//! and wakes the tasks waiting on the sockets that became ready. The sockets
+//! themselves are only ever used with non-blocking calls from the task, so
+//! thousands of connections share the reactor thread instead of tying up a
+//! blocking thread each.
+//!
+//! The reactor parks in `epoll_wait` by default. With
+//! [`ReactorConfig::busy_poll_nano`] set it keeps polling without sleeping
+//! for that long after the last event and only then parks, trading one core
+//! for wakeup latency.
+//!
+//! The adapters work with any executor; with the `tokio` feature
+//! [`AsyncTcpStream`] also implements `tokio::io::AsyncRead` and `AsyncWrite`.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::reactor::AsyncUdpSocket;
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! async fn echo() -> std::io::Result<()> {
+//!     let mut socket = VmaUdpSocket::new()?;
+//!     socket.bind("0.0.0.0", 5001)?;
+//!     let mut socket = AsyncUdpSocket::new(socket)?;
+//!
+//!     let mut buffer = [0u8; 2048];
+//!     loop {
+//!         let (len, from) = socket.recv_from(&mut buffer).await?;
+//!         if let std::net::SocketAddr::V4(from) = from {
+//!             socket.send_to(&buffer[..len], from).await?;
+//!         }
+//!     }
+//! }
+//! ```
+
+use std::collections::HashMap;
+use std::future::poll_fn;
+use std::io::{Error, ErrorKind};
+use std::mem;
+use std::net::{SocketAddr, SocketAddrV4};
+use std::os::fd::{AsRawFd, RawFd};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::task::{ready, Context, Poll, Waker};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+use crate::tcp::{Client, TcpResult, VmaTcpSocket};
+use crate::udp::{UdpEndpoint, UdpResult, VmaUdpSocket};
+
+// Readiness bits; the bits above READINESS_BITS count reactor updates
+const READABLE: u64 = 0x01;
+const WRITABLE: u64 = 0x02;
+const READINESS_BITS: u32 = 16;
+
+// epoll data of the reactor's own wakeup eventfd
+const WAKE_TOKEN: u64 = 0;
+
+const DEFAULT_MAX_EVENTS: usize = 256;
+
+/// Reactor configuration.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ReactorConfig {
+    /// Keep polling without sleeping for this long after the last event (0 parks immediately)
+    pub busy_poll_nano: u64,
+    /// Events taken per `epoll_wait` (0 for 256)
+    pub max_events: usize,
+    /// CPU core the reactor thread is pinned to
+    pub cpu_core: Option<usize>,
+}
+
+impl ReactorConfig {
+    /// Busy-poll for `nano` nanoseconds after each event before parking.
+    pub fn busy_poll(nano: u64) -> Self {
+        ReactorConfig { busy_poll_nano: nano, ..Default::default() }
+    }
+}
+
+/// Readiness and waiting tasks of one registered socket.
+struct ScheduledIo {
+    readiness: AtomicU64,
+    reader: Mutex<Option<Waker>>,
+    writer: Mutex<Option<Waker>>,
+}
+
+impl ScheduledIo {
+    fn set_readiness(&self, ready: u64) {
+        let _ = self.readiness.fetch_update(Ordering::AcqRel, Ordering::Acquire, |current| {
+            let tick = (current >> READINESS_BITS).wrapping_add(1);
+            Some(tick << READINESS_BITS | current & ((1 << READINESS_BITS) - 1) | ready)
+        });
+    }
+
+    fn wake(&self, ready: u64) {
+        if ready & READABLE != 0 {
+            if let Some(waker) = self.reader.lock().unwrap().take() {
+                waker.wake();
+            }
+        }
+        if ready & WRITABLE != 0 {
+            if let Some(waker) = self.writer.lock().unwrap().take() {
+                waker.wake();
+            }
+        }
+    }
+
+    /// Readiness snapshot once `interest` is ready, registering the task otherwise.
+    fn poll_ready(&self, cx: &mut Context<'_>, interest: u64) -> Poll<u64> {
+        let current = self.readiness.load(Ordering::Acquire);
+        if current & interest != 0 {
+            return Poll::Ready(current);
+        }
+
+        let slot = if interest == READABLE { &self.reader } else { &self.writer };
+        {
+            let mut waker = slot.lock().unwrap();
+            if !waker.as_ref().map_or(false, |w| w.will_wake(cx.waker())) {
+                *waker = Some(cx.waker().clone());
+            }
+        }
+
+        // The reactor may have reported readiness before the waker was stored
+        let current = self.readiness.load(Ordering::Acquire);
+        if current & interest != 0 {
+            Poll::Ready(current)
+        } else {
+            Poll::Pending
+        }
+    }
+
+    /// Drop `interest` unless the reactor reported new readiness since `observed`.
+    fn clear_readiness(&self, observed: u64, interest: u64) {
+        let _ = self.readiness.compare_exchange(observed, observed & !interest, Ordering::AcqRel, Ordering::Acquire);
+    }
+}
+
+struct ReactorShared {
+    epoll_fd: RawFd,
+    wake_fd: RawFd,
+    running: AtomicBool,
+    next_token: AtomicU64,
+    registrations: Mutex<HashMap<u64, Arc<ScheduledIo>>>,
+}
+
+impl ReactorShared {
+    fn wake_thread(&self) {
+        let value: u64 = 1;
+        unsafe {
+            libc::write(self.wake_fd, &value as *const u64 as *const libc::c_void, mem::size_of::<u64>());
+        }
+    }
+}
+
+impl Drop for ReactorShared {
+    fn drop(&mut self) {
+        unsafe {
+            libc::close(self.epoll_fd);
+            libc::close(self.wake_fd);
+        }
+    }
+}
+
+fn epoll_add(epoll_fd: RawFd, fd: RawFd, events: u32, token: u64) -> Result<(), Error> {
+    let mut event = libc::epoll_event { events, u64: token };
+    if unsafe { libc::epoll_ctl(epoll_fd, libc::EPOLL_CTL_ADD, fd, &mut event) } < 0 {
+        return Err(Error::last_os_error());
+    }
+    Ok(())
+}
+
+fn set_nonblocking(fd: RawFd) -> Result<(), Error> {
+    let flags = unsafe { libc::fcntl(fd, libc::F_GETFL) };
+    if flags < 0 || unsafe { libc::fcntl(fd, libc::F_SETFL, flags | libc::O_NONBLOCK) } < 0 {
+        return Err(Error::last_os_error());
+    }
+    Ok(())
+}
+
+fn pin_thread(core: usize) {
+    unsafe {
+        let mut set: libc::cpu_set_t = mem::zeroed();
+        libc::CPU_SET(core, &mut set);
+        libc::sched_setaffinity(0, mem::size_of::<libc::cpu_set_t>(), &set);
+    }
+}
+
+fn run(shared: Arc<ReactorShared>, config: ReactorConfig) {
+    if let Some(core) = config.cpu_core {
+        pin_thread(core);
+    }
+
+    let max_events = if config.max_events > 0 { config.max_events } else { DEFAULT_MAX_EVENTS };
+    let mut events = vec![libc::epoll_event { events: 0, u64: 0 }; max_events];
+    let mut ready: Vec<(Arc<ScheduledIo>, u64)> = Vec::with_capacity(max_events);
+    let busy_poll = Duration::from_nanos(config.busy_poll_nano);
+    let mut last_event = Instant::now();
+
+    while shared.running.load(Ordering::Acquire) {
+        let timeout = if !busy_poll.is_zero() && last_event.elapsed() < busy_poll { 0 } else { -1 };
+        let n = unsafe { libc::epoll_wait(shared.epoll_fd, events.as_mut_ptr(), max_events as libc::c_int, timeout) };
+        if n <= 0 {
+            if n < 0 && Error::last_os_error().kind() != ErrorKind::Interrupted {
+                break;
+            }
+            continue;
+        }
+        last_event = Instant::now();
+
+        {
+            let registrations = shared.registrations.lock().unwrap();
+            for event in &events[..n as usize] {
+                let token = event.u64;
+                let flags = event.events;
+                if token == WAKE_TOKEN {
+                    let mut value: u64 = 0;
+                    unsafe {
+                        libc::read(shared.wake_fd, &mut value as *mut u64 as *mut libc::c_void, mem::size_of::<u64>());
+                    }
+                    continue;
+                }
+
+                // Errors and hangups are reported to both sides so the next call surfaces them
+                let mut readiness = 0;
+                let closed = (libc::EPOLLHUP | libc::EPOLLERR) as u32;
+                if flags & (libc::EPOLLIN | libc::EPOLLRDHUP) as u32 != 0 || flags & closed != 0 {
+                    readiness |= READABLE;
+                }
+                if flags & libc::EPOLLOUT as u32 != 0 || flags & closed != 0 {
+                    readiness |= WRITABLE;
+                }
+                if let Some(io) = registrations.get(&token) {
+                    ready.push((Arc::clone(io), readiness));
+                }
+            }
+        }
+
+        // Wake outside the lock so woken tasks can register and deregister freely
+        for (io, readiness) in ready.drain(..) {
+            io.set_readiness(readiness);
+            io.wake(readiness);
+        }
+    }
+}
+
+/// Reactor thread; stopped and joined when dropped.
+pub struct Reactor {
+    shared: Arc<ReactorShared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl Reactor {
+    /// Start a reactor thread.
+    pub fn new(config: ReactorConfig) -> Result<Self, Error> {
+        let epoll_fd = unsafe { libc::epoll_create1(libc::EPOLL_CLOEXEC) };
+        if epoll_fd < 0 {
+            return Err(Error::last_os_error());
+        }
+        let wake_fd = unsafe { libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC) };
+        if wake_fd < 0 {
+            let error = Error::last_os_error();
+            unsafe { libc::close(epoll_fd) };
+            return Err(error);
+        }
+
+        let shared = Arc::new(ReactorShared {
+            epoll_fd,
+            wake_fd,
+            running: AtomicBool::new(true),
+            next_token: AtomicU64::new(WAKE_TOKEN + 1),
+            registrations: Mutex::new(HashMap::new()),
+        });
+        epoll_add(epoll_fd, wake_fd, libc::EPOLLIN as u32, WAKE_TOKEN)?;
+
+        let thread_shared = Arc::clone(&shared);
+        let thread = thread::Builder::new()
+            .name("vma-reactor".into())
+            .spawn(move || run(thread_shared, config))?;
+
+        Ok(Reactor { shared, thread: Some(thread) })
+    }
+
+    /// Handle for registering sockets with this reactor.
+    pub fn handle(&self) -> ReactorHandle {
+        ReactorHandle { shared: Arc::clone(&self.shared) }
+    }
+
+    /// Process-wide reactor, started with the default configuration on first use.
+    pub fn global() -> ReactorHandle {
+        static GLOBAL: OnceLock<Reactor> = OnceLock::new();
+        GLOBAL
+            .get_or_init(|| Reactor::new(ReactorConfig::default()).expect("failed to start the VMA reactor"))
+            .handle()
+    }
+}
+
+impl Drop for Reactor {
+    fn drop(&mut self) {
+        self.shared.running.store(false, Ordering::Release);
+        self.shared.wake_thread();
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Handle to a reactor (cheap to clone).
+#[derive(Clone)]
+pub struct ReactorHandle {
+    shared: Arc<ReactorShared>,
+}
+
+impl ReactorHandle {
+    /// Number of registered sockets.
+    pub fn len(&self) -> usize {
+        self.shared.registrations.lock().unwrap().len()
+    }
+
+    /// Whether no socket is registered.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    fn register(&self, fd: RawFd) -> Result<Registration, Error> {
+        set_nonblocking(fd)?;
+
+        // Start out ready so the first call goes straight to the socket
+        let io = Arc::new(ScheduledIo {
+            readiness: AtomicU64::new(READABLE | WRITABLE),
+            reader: Mutex::new(None),
+            writer: Mutex::new(None),
+        });
+        let token = self.shared.next_token.fetch_add(1, Ordering::Relaxed);
+        self.shared.registrations.lock().unwrap().insert(token, Arc::clone(&io));
+
+        let events = (libc::EPOLLIN | libc::EPOLLOUT | libc::EPOLLRDHUP | libc::EPOLLET) as u32;
+        if let Err(error) = epoll_add(self.shared.epoll_fd, fd, events, token) {
+            self.shared.registrations.lock().unwrap().remove(&token);
+            return Err(error);
+        }
+
+        Ok(Registration { shared: Arc::clone(&self.shared), token, fd, io })
+    }
+}
+
+/// A socket's membership in the reactor (removed before the socket closes).
+struct Registration {
+    shared: Arc<ReactorShared>,
+    token: u64,
+    fd: RawFd,
+    io: Arc<ScheduledIo>,
+}
+
+impl Registration {
+    /// Run a non-blocking operation once `interest` is ready, retrying after new readiness.
+    fn poll_io<R>(&self, cx: &mut Context<'_>, interest: u64, mut op: impl FnMut() -> Result<R, Error>) -> Poll<Result<R, Error>> {
+        loop {
+            let observed = ready!(self.io.poll_ready(cx, interest));
+            match op() {
+                Err(e) if e.kind() == ErrorKind::WouldBlock => self.io.clear_readiness(observed, interest),
+                result => return Poll::Ready(result),
+            }
+        }
+    }
+}
+
+impl Drop for Registration {
+    fn drop(&mut self) {
+        unsafe {
+            libc::epoll_ctl(self.shared.epoll_fd, libc::EPOLL_CTL_DEL, self.fd, std::ptr::null_mut());
+        }
+        self.shared.registrations.lock().unwrap().remove(&self.token);
+    }
+}
+
+fn udp_io<R>(result: Result<R, UdpResult>) -> Result<R, Error> {
+    match result {
+        Ok(value) => Ok(value),
+        Err(UdpResult::UdpErrorTimeout) => Err(ErrorKind::WouldBlock.into()), // nothing queued / no buffer space
+        Err(e) => Err(e.into()),
+    }
+}
+
+fn tcp_recv_io(result: Result<usize, TcpResult>) -> Result<usize, Error> {
+    match result {
+        Ok(bytes) => Ok(bytes),
+        Err(TcpResult::TcpErrorTimeout) | Err(TcpResult::TcpErrorWouldBlock) => Err(ErrorKind::WouldBlock.into()),
+        Err(TcpResult::TcpErrorClosed) => Ok(0), // end of stream
+        Err(e) => Err(e.into()),
+    }
+}
+
+fn tcp_send_io(result: Result<usize, TcpResult>) -> Result<usize, Error> {
+    match result {
+        Ok(bytes) => Ok(bytes),
+        Err(TcpResult::TcpErrorTimeout) | Err(TcpResult::TcpErrorWouldBlock) => Err(ErrorKind::WouldBlock.into()),
+        Err(e) => Err(e.into()),
+    }
+}
+
+/// UDP socket driven by a reactor.
+pub struct AsyncUdpSocket {
+    // Declared first so the socket leaves the epoll set before it closes
+    registration: Registration,
+    socket: VmaUdpSocket,
+}
+
+impl AsyncUdpSocket {
+    /// Register a bound (or connected) socket with the global reactor.
+    pub fn new(socket: VmaUdpSocket) -> Result<Self, Error> {
+        Self::with_reactor(socket, &Reactor::global())
+    }
+
+    /// Register a bound (or connected) socket with `reactor`.
+    pub fn with_reactor(socket: VmaUdpSocket, reactor: &ReactorHandle) -> Result<Self, Error> {
+        let registration = reactor.register(socket.as_raw_fd())?;
+        Ok(AsyncUdpSocket { registration, socket })
+    }
+
+    /// Receive a datagram into `buffer`, returning its length and source address.
+    pub fn poll_recv_from(&mut self, cx: &mut Context<'_>, buffer: &mut [u8]) -> Poll<Result<(usize, SocketAddr), Error>> {
+        let socket = &mut self.socket;
+        self.registration.poll_io(cx, READABLE, || udp_io(socket.wrapper_mut().recv_from_into(buffer, Some(0))))
+    }
+
+    /// Receive a datagram from the connected peer.
+    pub fn poll_recv(&mut self, cx: &mut Context<'_>, buffer: &mut [u8]) -> Poll<Result<usize, Error>> {
+        let socket = &mut self.socket;
+        self.registration.poll_io(cx, READABLE, || udp_io(socket.wrapper_mut().recv(buffer, Some(0))))
+    }
+
+    /// Send a datagram to `target`.
+    pub fn poll_send_to(&mut self, cx: &mut Context<'_>, data: &[u8], target: SocketAddrV4) -> Poll<Result<usize, Error>> {
+        let socket = &mut self.socket;
+        let endpoint = UdpEndpoint::from(target);
+        self.registration.poll_io(cx, WRITABLE, || udp_io(socket.wrapper_mut().send_to_endpoint(data, &endpoint)))
+    }
+
+    /// Send a datagram to the connected peer.
+    pub fn poll_send(&mut self, cx: &mut Context<'_>, data: &[u8]) -> Poll<Result<usize, Error>> {
+        let socket = &mut self.socket;
+        self.registration.poll_io(cx, WRITABLE, || udp_io(socket.wrapper_mut().send(data)))
+    }
+
+    /// Receive a datagram into `buffer`, returning its length and source address.
+    pub async fn recv_from(&mut self, buffer: &mut [u8]) -> Result<(usize, SocketAddr), Error> {
+        poll_fn(|cx| self.poll_recv_from(cx, buffer)).await
+    }
+
+    /// Receive a datagram from the connected peer.
+    pub async fn recv(&mut self, buffer: &mut [u8]) -> Result<usize, Error> {
+        poll_fn(|cx| self.poll_recv(cx, buffer)).await
+    }
+
+    /// Send a datagram to `target`.
+    pub async fn send_to(&mut self, data: &[u8], target: SocketAddrV4) -> Result<usize, Error> {
+        poll_fn(|cx| self.poll_send_to(cx, data, target)).await
+    }
+
+    /// Send a datagram to the connected peer.
+    pub async fn send(&mut self, data: &[u8]) -> Result<usize, Error> {
+        poll_fn(|cx| self.poll_send(cx, data)).await
+    }
+
+    /// The underlying socket (for statistics; keep it non-blocking).
+    pub fn get_ref(&self) -> &VmaUdpSocket {
+        &self.socket
+    }
+
+    /// Remove the socket from the reactor and return it (still non-blocking).
+    pub fn into_inner(self) -> VmaUdpSocket {
+        let AsyncUdpSocket { registration, socket } = self;
+        drop(registration);
+        socket
+    }
+}
+
+enum TcpStreamInner {
+    Socket(VmaTcpSocket),
+    Client(Client),
+}
+
+/// Connected TCP socket or accepted client driven by a reactor.
+pub struct AsyncTcpStream {
+    // Declared first so the socket leaves the epoll set before it closes
+    registration: Registration,
+    stream: TcpStreamInner,
+}
+
+impl AsyncTcpStream {
+    /// Register a connected socket with the global reactor.
+    pub fn new(socket: VmaTcpSocket) -> Result<Self, Error> {
+        Self::with_reactor(socket, &Reactor::global())
+    }
+
+    /// Register a connected socket with `reactor`.
+    pub fn with_reactor(socket: VmaTcpSocket, reactor: &ReactorHandle) -> Result<Self, Error> {
+        let registration = reactor.register(socket.as_raw_fd())?;
+        Ok(AsyncTcpStream { registration, stream: TcpStreamInner::Socket(socket) })
+    }
+
+    /// Register an accepted client with `reactor`.
+    pub fn from_client(client: Client, reactor: &ReactorHandle) -> Result<Self, Error> {
+        let registration = reactor.register(client.as_raw_fd())?;
+        Ok(AsyncTcpStream { registration, stream: TcpStreamInner::Client(client) })
+    }
+
+    /// Receive available data (0 at end of stream).
+    pub fn poll_recv(&mut self, cx: &mut Context<'_>, buffer: &mut [u8]) -> Poll<Result<usize, Error>> {
+        let stream = &mut self.stream;
+        self.registration.poll_io(cx, READABLE, || match stream {
+            TcpStreamInner::Socket(socket) => tcp_recv_io(socket.wrapper_mut().recv(buffer, Some(0))),
+            TcpStreamInner::Client(client) => tcp_recv_io(client.recv(buffer, Some(0))),
+        })
+    }
+
+    /// Send as much of `data` as the socket accepts.
+    pub fn poll_send(&mut self, cx: &mut Context<'_>, data: &[u8]) -> Poll<Result<usize, Error>> {
+        let stream = &mut self.stream;
+        self.registration.poll_io(cx, WRITABLE, || match stream {
+            TcpStreamInner::Socket(socket) => tcp_send_io(socket.wrapper_mut().send(data)),
+            TcpStreamInner::Client(client) => tcp_send_io(client.send(data)),
+        })
+    }
+
+    /// Receive available data (0 at end of stream).
+    pub async fn recv(&mut self, buffer: &mut [u8]) -> Result<usize, Error> {
+        poll_fn(|cx| self.poll_recv(cx, buffer)).await
+    }
+
+    /// Send as much of `data` as the socket accepts.
+    pub async fn send(&mut self, data: &[u8]) -> Result<usize, Error> {
+        poll_fn(|cx| self.poll_send(cx, data)).await
+    }
+
+    /// Send all of `data`.
+    pub async fn send_all(&mut self, mut data: &[u8]) -> Result<(), Error> {
+        while !data.is_empty() {
+            let sent = self.send(data).await?;
+            data = &data[sent..];
+        }
+        Ok(())
+    }
+
+    /// Remote address of an accepted client (`None` for a connected socket).
+    pub fn peer_addr(&self) -> Option<SocketAddr> {
+        match &self.stream {
+            TcpStreamInner::Socket(_) => None,
+            TcpStreamInner::Client(client) => Some(client.address),
+        }
+    }
+
+    /// Shut down the sending side (the peer sees end of stream).
+    pub fn shutdown_write(&self) -> Result<(), Error> {
+        if unsafe { libc::shutdown(self.registration.fd, libc::SHUT_WR) } < 0 {
+            return Err(Error::last_os_error());
+        }
+        Ok(())
+    }
+}
+
+#[cfg(feature = "tokio")]
+impl tokio::io::AsyncRead for AsyncTcpStream {
+    fn poll_read(self: std::pin::Pin<&mut Self>, cx: &mut Context<'_>, buf: &mut tokio::io::ReadBuf<'_>) -> Poll<Result<(), Error>> {
+        // A full buffer reads nothing (the C receive rejects a zero-length buffer)
+        if buf.remaining() == 0 {
+            return Poll::Ready(Ok(()));
+        }
+
+        // Receive straight into the unfilled part; the kernel or VMA only writes to it
+        let unfilled = unsafe { &mut *(buf.unfilled_mut() as *mut [std::mem::MaybeUninit<u8>] as *mut [u8]) };
+        let received = ready!(self.get_mut().poll_recv(cx, unfilled))?;
+        unsafe { buf.assume_init(received) };
+        buf.advance(received);
+        Poll::Ready(Ok(()))
+    }
+}
+
+#[cfg(feature = "tokio")]
+impl tokio::io::AsyncWrite for AsyncTcpStream {
+    fn poll_write(self: std::pin::Pin<&mut Self>, cx: &mut Context<'_>, buf: &[u8]) -> Poll<Result<usize, Error>> {
+        self.get_mut().poll_send(cx, buf)
+    }
+
+    fn poll_flush(self: std::pin::Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), Error>> {
+        Poll::Ready(Ok(()))
+    }
+
+    fn poll_shutdown(self: std::pin::Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<Result<(), Error>> {
+        Poll::Ready(self.shutdown_write())
+    }
+}
+
+/// Listening TCP socket driven by a reactor.
+pub struct AsyncTcpListener {
+    // Declared first so the socket leaves the epoll set before it closes
+    registration: Registration,
+    socket: VmaTcpSocket,
+    reactor: ReactorHandle,
+}
+
+impl AsyncTcpListener {
+    /// Register a listening socket with the global reactor.
+    pub fn new(socket: VmaTcpSocket) -> Result<Self, Error> {
+        Self::with_reactor(socket, &Reactor::global())
+    }
+
+    /// Register a listening socket with `reactor` (accepted clients use it too).
+    pub fn with_reactor(socket: VmaTcpSocket, reactor: &ReactorHandle) -> Result<Self, Error> {
+        let registration = reactor.register(socket.as_raw_fd())?;
+        Ok(AsyncTcpListener { registration, socket, reactor: reactor.clone() })
+    }
+
+    /// Accept a pending connection.
+    pub fn poll_accept(&mut self, cx: &mut Context<'_>) -> Poll<Result<AsyncTcpStream, Error>> {
+        let socket = &mut self.socket;
+        let client = ready!(self.registration.poll_io(cx, READABLE, || match socket.accept(Some(0)) {
+            Ok(Some(client)) => Ok(client),
+            Ok(None) => Err(ErrorKind::WouldBlock.into()),
+            Err(e) => Err(e),
+        }))?;
+        Poll::Ready(AsyncTcpStream::from_client(client, &self.reactor))
+    }
+
+    /// Accept a pending connection.
+    pub async fn accept(&mut self) -> Result<AsyncTcpStream, Error> {
+        poll_fn(|cx| self.poll_accept(cx)).await
+    }
+}
+
+#[cfg(all(test, feature = "tokio"))]
+mod test {
+    use super::*;
+    use std::io::Write;
+    use std::net::TcpListener;
+    use std::pin::Pin;
+    use std::task::Waker;
+    use tokio::io::{AsyncRead, ReadBuf};
+
+    #[test]
+    fn test_poll_read_full_buffer() {
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let port = listener.local_addr().unwrap().port();
+        let mut socket = VmaTcpSocket::new().unwrap();
+        assert!(socket.connect("127.0.0.1", port, Some(1_000_000_000)).unwrap());
+        let (mut peer, _) = listener.accept().unwrap();
+        peer.write_all(b"abc").unwrap();
+
+        let mut stream = AsyncTcpStream::new(socket).unwrap();
+        let mut cx = Context::from_waker(Waker::noop());
+
+        // No room left: nothing to read, not an error
+        let mut storage = [0u8; 4];
+        let mut full = ReadBuf::new(&mut storage);
+        full.advance(4);
+        let result = Pin::new(&mut stream).poll_read(&mut cx, &mut full);
+        assert!(matches!(result, Poll::Ready(Ok(()))));
+        assert_eq!(full.filled().len(), 4);
+
+        // Reads into the unfilled part of an uninitialized buffer
+        let mut storage = [std::mem::MaybeUninit::<u8>::uninit(); 8];
+        let mut buf = ReadBuf::uninit(&mut storage);
+        for _ in 0..1000 {
+            match Pin::new(&mut stream).poll_read(&mut cx, &mut buf) {
+                Poll::Ready(result) => {
+                    result.unwrap();
+                    break;
+                }
+                Poll::Pending => std::thread::sleep(std::time::Duration::from_millis(1)),
+            }
+        }
+        assert_eq!(buf.filled(), b"abc");
+    }
+}
@@ -0,0 +1,202 @@
+//! SO_REUSEPORT sharded UDP receiver group.
+//!
+//! [`UdpRxGroup`] opens several sockets on the same port, each with its own
+//! VMA ring and a worker thread pinned to one entry of `cpu_cores`, and hands
+//! every datagram to a callback on the shard's thread. Throughput scales with
+//! the number of shards instead of being capped by one receiving core.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use std::sync::atomic::{AtomicU64, Ordering};
+//! use std::sync::Arc;
+//! use vma_socket::common::VmaOptions;
+//! use vma_socket::rx_group::{RxGroupConfig, RxSteering, UdpRxGroup};
+//!
+//! let mut options = VmaOptions::default();
+//! options.set_cores(&[2, 3, 4, 5]).unwrap();
+//!
+//! let received = Arc::new(AtomicU64::new(0));
+//! let counter = Arc::clone(&received);
+//! let config = RxGroupConfig { steering: RxSteering::FlowHash, ..RxGroupConfig::default() };
+//! let mut group = UdpRxGroup::new(Some(options), config, "0.0.0.0", 5001, move |_shard, packet| {
+//!     counter.fetch_add(packet.data.len() as u64, Ordering::Relaxed);
+//! }).unwrap();
+//! group.start().unwrap();
+//! ```
+
+use std::ffi::{c_void, CString};
+use std::mem;
+use std::os::raw::{c_char, c_int};
+use std::panic::{self, AssertUnwindSafe};
+use std::ptr;
+use crate::common::{sockaddr_to_rust, VmaOptions};
+use crate::stats::StatsValues;
+use crate::udp::{PacketView, UdpPacket, UdpResult};
+
+/// How datagrams are spread across the shards (kernel receive path).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum RxSteering {
+    /// Kernel SO_REUSEPORT hash of the 4-tuple
+    #[default]
+    Kernel = 0,
+    /// NIC/kernel flow hash modulo the shard count
+    FlowHash = 1,
+    /// Shard pinned to the CPU that processed the packet
+    Cpu = 2,
+}
+
+/// Group configuration (zero fields select the defaults).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RxGroupConfig {
+    /// Number of sockets (0 for one per `cpu_cores` entry, at least 1)
+    pub shard_count: u32,
+    /// Shard selection policy
+    pub steering: RxSteering,
+    /// Buffer slot size per datagram (0 for 2048)
+    pub stride: usize,
+    /// Datagrams per receive batch (0 for `UDP_MAX_BATCH`)
+    pub batch: usize,
+    /// Receive timeout between stop checks in milliseconds (0 for 100)
+    pub poll_timeout_ms: c_int,
+}
+
+type RawCallback = extern "C" fn(shard: u32, packets: *const UdpPacket, count: usize, context: *mut c_void);
+
+/// C representation of the group structure.
+#[repr(C)]
+struct UdpRxGroupRaw {
+    shards: *mut c_void,
+    shard_count: u32,
+    config: RxGroupConfig,
+    callback: Option<RawCallback>,
+    context: *mut c_void,
+    running: c_int,
+}
+
+extern "C" {
+    fn udp_rx_group_init(
+        group: *mut UdpRxGroupRaw,
+        options: *const VmaOptions,
+        config: *const RxGroupConfig,
+        ip: *const c_char,
+        port: u16,
+        callback: RawCallback,
+        context: *mut c_void,
+    ) -> c_int;
+    fn udp_rx_group_start(group: *mut UdpRxGroupRaw) -> c_int;
+    fn udp_rx_group_stop(group: *mut UdpRxGroupRaw) -> c_int;
+    fn udp_rx_group_close(group: *mut UdpRxGroupRaw) -> c_int;
+    fn udp_rx_group_get_shard_stats(group: *const UdpRxGroupRaw, shard: u32, values: *mut StatsValues) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), UdpResult> {
+    if result != UdpResult::UdpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+    }
+    Ok(())
+}
+
+type Handler = Box<dyn Fn(usize, PacketView<'_>) + Send + Sync>;
+
+extern "C" fn dispatch(shard: u32, packets: *const UdpPacket, count: usize, context: *mut c_void) {
+    let handler = unsafe { &*(context as *const Handler) };
+    let packets = unsafe { std::slice::from_raw_parts(packets, count) };
+
+    // A panic must not unwind into the C worker loop
+    let _ = panic::catch_unwind(AssertUnwindSafe(|| {
+        for packet in packets {
+            handler(shard as usize, PacketView {
+                data: unsafe { std::slice::from_raw_parts(packet.data as *const u8, packet.length) },
+                src_addr: sockaddr_to_rust(&packet.src_addr),
+                timestamp: packet.timestamp,
+                timestamp_source: packet.timestamp_source,
+            });
+        }
+    }));
+}
+
+/// Group of SO_REUSEPORT sockets on one port, one pinned worker thread per shard.
+pub struct UdpRxGroup {
+    group: Box<UdpRxGroupRaw>,
+    // Referenced by the C workers through `group.context`
+    _handler: Box<Handler>,
+}
+
+// Workers only touch their own shard; the handler is Send + Sync and the
+// shared statistics are read through their sequence counters.
+unsafe impl Send for UdpRxGroup {}
+unsafe impl Sync for UdpRxGroup {}
+
+impl UdpRxGroup {
+    /// Open and bind the shard sockets; `handler` runs on the shard threads once started.
+    pub fn new<A, F>(
+        options: Option<VmaOptions>,
+        config: RxGroupConfig,
+        addr: A,
+        port: u16,
+        handler: F,
+    ) -> Result<Self, std::io::Error>
+    where
+        A: Into<String>,
+        F: Fn(usize, PacketView<'_>) + Send + Sync + 'static,
+    {
+        let c_addr = CString::new(addr.into()).map_err(|_| std::io::Error::from(UdpResult::UdpErrorInvalidParam))?;
+        let handler: Box<Handler> = Box::new(Box::new(handler));
+        let mut group: Box<UdpRxGroupRaw> = Box::new(unsafe { mem::zeroed() });
+        let options_ptr = options.as_ref().map_or(ptr::null(), |o| o as *const VmaOptions);
+
+        check(unsafe {
+            udp_rx_group_init(
+                &mut *group,
+                options_ptr,
+                &config,
+                c_addr.as_ptr(),
+                port,
+                dispatch,
+                &*handler as *const Handler as *mut c_void,
+            )
+        })?;
+
+        Ok(UdpRxGroup { group, _handler: handler })
+    }
+
+    /// Start the worker threads.
+    pub fn start(&mut self) -> Result<(), std::io::Error> {
+        check(unsafe { udp_rx_group_start(&mut *self.group) })?;
+        Ok(())
+    }
+
+    /// Stop and join the worker threads.
+    pub fn stop(&mut self) -> Result<(), std::io::Error> {
+        check(unsafe { udp_rx_group_stop(&mut *self.group) })?;
+        Ok(())
+    }
+
+    /// Number of shards.
+    pub fn shard_count(&self) -> usize {
+        self.group.shard_count as usize
+    }
+
+    /// Effective configuration (defaults resolved).
+    pub fn config(&self) -> RxGroupConfig {
+        self.group.config
+    }
+
+    /// Consistent snapshot of one shard's counters and latency histograms.
+    pub fn shard_stats(&self, shard: usize) -> Result<StatsValues, std::io::Error> {
+        let mut values = StatsValues::default();
+        check(unsafe { udp_rx_group_get_shard_stats(&*self.group, shard as u32, &mut values) })?;
+        Ok(values)
+    }
+}
+
+impl Drop for UdpRxGroup {
+    fn drop(&mut self) {
+        unsafe {
+            udp_rx_group_close(&mut *self.group);
+        }
+    }
+}
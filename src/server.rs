@@ -0,0 +1,262 @@
+//! Multi-threaded TCP server with per-core connection ownership.
+//!
+//! [`TcpServerRuntime`] runs one acceptor thread and N worker threads pinned
+//! to the `cpu_cores` entries. Each accepted connection is handed to exactly
+//! one worker through that worker's lock-free single-producer queue and stays
+//! there: the worker waits on it with its own poller (VMA epoll when
+//! preloaded), reads and writes it, and closes it. Nothing is shared between
+//! workers, so a connection's packets stay on one core's ring and cache.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::common::VmaOptions;
+//! use vma_socket::server::{RuntimeConfig, RuntimeEvent, TcpServerRuntime};
+//!
+//! let mut options = VmaOptions::default();
+//! options.set_cores(&[2, 3]).unwrap();
+//!
+//! let mut server = TcpServerRuntime::new(Some(options), RuntimeConfig::default(), "0.0.0.0", 9000,
+//!     |_worker, client, event| {
+//!         if event == RuntimeEvent::Readable {
+//!             let mut buffer = [0u8; 4096];
+//!             match client.recv(&mut buffer, Some(0)) {
+//!                 Ok(n) => { let _ = client.send(&buffer[..n]); }, // echo
+//!                 Err(_) => return false, // close
+//!             }
+//!         }
+//!         true
+//!     }).unwrap();
+//! server.start().unwrap();
+//! ```
+
+use std::ffi::{c_void, CString};
+use std::mem;
+use std::os::raw::{c_char, c_int};
+use std::panic::{self, AssertUnwindSafe};
+use std::ptr;
+use crate::common::VmaOptions;
+use crate::tcp::{ClientRef, TcpClient, TcpResult, TcpSocket};
+
+/// How the acceptor picks a worker for a new connection.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum RuntimeAssign {
+    /// Worker with the fewest open (and queued) connections
+    #[default]
+    LeastLoaded = 0,
+    /// Hash of the peer address and port
+    Hash = 1,
+}
+
+/// Runtime configuration (zero fields select the defaults).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RuntimeConfig {
+    /// Number of workers (0 for one per `cpu_cores` entry, at least 1)
+    pub worker_count: u32,
+    /// Worker selection policy
+    pub assign: RuntimeAssign,
+    /// Handoff queue entries per worker (rounded to a power of two, 0 for 256)
+    pub queue_size: u32,
+    /// Open connections per worker (0 for 1024)
+    pub max_connections: u32,
+    /// Listen backlog (0 for 1024)
+    pub backlog: c_int,
+    /// Wait timeout between stop checks in milliseconds (0 for 100)
+    pub poll_timeout_ms: c_int,
+}
+
+/// Connection event delivered on the owning worker's thread.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RuntimeEvent {
+    /// Connection adopted by the worker
+    Open,
+    /// Data is available (read with a zero timeout)
+    Readable,
+    /// Connection is about to be closed
+    Closed,
+}
+
+// Event types (match `tcp_runtime_event_t`)
+const RUNTIME_EVENT_OPEN: c_int = 1;
+const RUNTIME_EVENT_READABLE: c_int = 2;
+const RUNTIME_EVENT_CLOSED: c_int = 3;
+
+/// Per-worker counters.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct WorkerStats {
+    /// Connections handed to this worker
+    pub accepted: u64,
+    /// Connections closed by this worker
+    pub closed: u64,
+    /// Connections closed because the worker was full
+    pub rejected: u64,
+    /// Readable events delivered
+    pub events: u64,
+    /// Connections currently open
+    pub connections: u32,
+}
+
+type RawCallback = extern "C" fn(worker: u32, client: *mut TcpClient, event: c_int, context: *mut c_void) -> bool;
+
+/// C representation of the runtime structure.
+#[repr(C)]
+struct TcpServerRuntimeRaw {
+    listener: TcpSocket,
+    workers: *mut c_void,
+    worker_count: u32,
+    config: RuntimeConfig,
+    callback: Option<RawCallback>,
+    context: *mut c_void,
+    acceptor: libc::pthread_t,
+    acceptor_started: bool,
+    handoff_failures: u64,
+    accept_failures: u64,
+    running: c_int,
+}
+
+extern "C" {
+    fn tcp_runtime_init(
+        runtime: *mut TcpServerRuntimeRaw,
+        options: *const VmaOptions,
+        config: *const RuntimeConfig,
+        ip: *const c_char,
+        port: u16,
+        callback: RawCallback,
+        context: *mut c_void,
+    ) -> c_int;
+    fn tcp_runtime_start(runtime: *mut TcpServerRuntimeRaw) -> c_int;
+    fn tcp_runtime_stop(runtime: *mut TcpServerRuntimeRaw) -> c_int;
+    fn tcp_runtime_close(runtime: *mut TcpServerRuntimeRaw) -> c_int;
+    fn tcp_runtime_get_handoff_failures(runtime: *const TcpServerRuntimeRaw) -> u64;
+    fn tcp_runtime_get_accept_failures(runtime: *const TcpServerRuntimeRaw) -> u64;
+    fn tcp_runtime_get_worker_stats(runtime: *const TcpServerRuntimeRaw, worker: u32, stats: *mut WorkerStats) -> c_int;
+}
+
+fn check(result: c_int) -> Result<(), TcpResult> {
+    if result != TcpResult::TcpSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+    }
+    Ok(())
+}
+
+type Handler = Box<dyn Fn(usize, &mut ClientRef<'_>, RuntimeEvent) -> bool + Send + Sync>;
+
+extern "C" fn dispatch(worker: u32, client: *mut TcpClient, event: c_int, context: *mut c_void) -> bool {
+    let handler = unsafe { &*(context as *const Handler) };
+    let event = match event {
+        RUNTIME_EVENT_OPEN => RuntimeEvent::Open,
+        RUNTIME_EVENT_READABLE => RuntimeEvent::Readable,
+        RUNTIME_EVENT_CLOSED => RuntimeEvent::Closed,
+        _ => return true,
+    };
+
+    // A panic must not unwind into the C worker loop; the connection is closed instead
+    panic::catch_unwind(AssertUnwindSafe(|| {
+        let mut client = unsafe { ClientRef::from_raw(client) };
+        handler(worker as usize, &mut client, event)
+    }))
+    .unwrap_or(false)
+}
+
+/// Acceptor plus pinned workers that each own their connections.
+pub struct TcpServerRuntime {
+    runtime: Box<TcpServerRuntimeRaw>,
+    // Referenced by the C threads through `runtime.context`
+    _handler: Box<Handler>,
+}
+
+// Each connection is only touched by its worker; the handler is Send + Sync
+// and the counters are read with atomic loads.
+unsafe impl Send for TcpServerRuntime {}
+unsafe impl Sync for TcpServerRuntime {}
+
+impl TcpServerRuntime {
+    /// Bind and listen; `handler` runs on the worker threads once started.
+    ///
+    /// The handler returns false to close the connection.
+    pub fn new<A, F>(
+        options: Option<VmaOptions>,
+        config: RuntimeConfig,
+        addr: A,
+        port: u16,
+        handler: F,
+    ) -> Result<Self, std::io::Error>
+    where
+        A: Into<String>,
+        F: Fn(usize, &mut ClientRef<'_>, RuntimeEvent) -> bool + Send + Sync + 'static,
+    {
+        let c_addr = CString::new(addr.into()).map_err(|_| std::io::Error::from(TcpResult::TcpErrorInvalidParam))?;
+        let handler: Box<Handler> = Box::new(Box::new(handler));
+        let mut runtime: Box<TcpServerRuntimeRaw> = Box::new(unsafe { mem::zeroed() });
+        let options_ptr = options.as_ref().map_or(ptr::null(), |o| o as *const VmaOptions);
+
+        check(unsafe {
+            tcp_runtime_init(
+                &mut *runtime,
+                options_ptr,
+                &config,
+                c_addr.as_ptr(),
+                port,
+                dispatch,
+                &*handler as *const Handler as *mut c_void,
+            )
+        })?;
+
+        Ok(TcpServerRuntime { runtime, _handler: handler })
+    }
+
+    /// Start the workers and the acceptor.
+    pub fn start(&mut self) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_runtime_start(&mut *self.runtime) })?;
+        Ok(())
+    }
+
+    /// Stop and join all threads; open connections stay with their workers.
+    pub fn stop(&mut self) -> Result<(), std::io::Error> {
+        check(unsafe { tcp_runtime_stop(&mut *self.runtime) })?;
+        Ok(())
+    }
+
+    /// Number of workers.
+    pub fn worker_count(&self) -> usize {
+        self.runtime.worker_count as usize
+    }
+
+    /// Effective configuration (defaults resolved).
+    pub fn config(&self) -> RuntimeConfig {
+        self.runtime.config
+    }
+
+    /// Port the listener was bound to.
+    pub fn local_port(&self) -> u16 {
+        u16::from_be(self.runtime.listener.local_addr.sin_port)
+    }
+
+    /// One worker's counters (approximate while running).
+    pub fn worker_stats(&self, worker: usize) -> Result<WorkerStats, std::io::Error> {
+        let mut stats = WorkerStats::default();
+        check(unsafe { tcp_runtime_get_worker_stats(&*self.runtime, worker as u32, &mut stats) })?;
+        Ok(stats)
+    }
+
+    /// Connections closed by the acceptor because a worker's queue was full.
+    pub fn handoff_failures(&self) -> u64 {
+        unsafe { tcp_runtime_get_handoff_failures(&*self.runtime) }
+    }
+
+    /// Accept calls that failed (e.g. out of file descriptors); the acceptor backs off after each.
+    pub fn accept_failures(&self) -> u64 {
+        unsafe { tcp_runtime_get_accept_failures(&*self.runtime) }
+    }
+}
+
+impl Drop for TcpServerRuntime {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_runtime_close(&mut *self.runtime);
+        }
+    }
+}
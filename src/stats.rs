@@ -0,0 +1,374 @@
+//! Per-socket statistics with latency histograms.
+//!
+//! Every socket keeps its counters in a cache-line-aligned block owned by the
+//! Rust wrapper and shared with the C code. The hot path updates it under a
+//! sequence counter, so a monitoring thread can take consistent snapshots
+//! through a [`StatsReader`] without ever stalling the socket's owner.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use std::thread;
+//! use std::time::Duration;
+//! use vma_socket::udp::VmaUdpSocket;
+//!
+//! let mut socket = VmaUdpSocket::new().unwrap();
+//! socket.bind("0.0.0.0", 5001).unwrap();
+//!
+//! let reader = socket.stats_reader();
+//! thread::spawn(move || loop {
+//!     let stats = reader.snapshot();
+//!     println!("rx={} p99={:?}ns", stats.rx_packets, stats.recv_latency().percentile_ns(0.99));
+//!     thread::sleep(Duration::from_secs(1));
+//! });
+//!
+//! let mut buffer = vec![0u8; 4096];
+//! loop {
+//!     let _ = socket.recv_from(&mut buffer, Some(100_000_000));
+//! }
+//! ```
+
+use std::cell::UnsafeCell;
+use std::os::raw::c_int;
+use std::sync::Arc;
+
+/// Number of latency histogram buckets (matches `VMA_STATS_HIST_BUCKETS`).
+pub const STATS_HIST_BUCKETS: usize = 128;
+
+/// C representation of the statistics values.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct StatsValues {
+    /// Number of received packets
+    pub rx_packets: u64,
+    /// Number of transmitted packets
+    pub tx_packets: u64,
+    /// Number of received bytes
+    pub rx_bytes: u64,
+    /// Number of transmitted bytes
+    pub tx_bytes: u64,
+    /// Receive attempts that found nothing queued
+    pub rx_would_block: u64,
+    /// Receive calls that timed out
+    pub rx_timeouts: u64,
+    /// Receive calls that failed
+    pub rx_errors: u64,
+    /// Send calls that would have blocked
+    pub tx_would_block: u64,
+    /// Send calls that failed
+    pub tx_errors: u64,
+    recv_latency: [u64; STATS_HIST_BUCKETS],
+    send_latency: [u64; STATS_HIST_BUCKETS],
+}
+
+/// Maximum number of VMA rings reported per socket (matches `VMA_SOCKET_MAX_RINGS`).
+pub const SOCKET_MAX_RINGS: usize = 8;
+
+/// C representation of a socket's offload and queue state.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SocketInfo {
+    /// libvma is loaded
+    pub vma_loaded: bool,
+    /// VMA serves the socket from its own rings (false: traffic takes the kernel path)
+    pub offloaded: bool,
+    /// Number of VMA rings serving the socket
+    pub ring_count: i32,
+    /// Ring channel descriptors, usable as ring ids (see [`rings`](Self::rings))
+    pub ring_fds: [i32; SOCKET_MAX_RINGS],
+    /// Bytes ready to read (VMA's ready queue when offloaded, -1 if unknown)
+    pub rx_ready_bytes: i32,
+    /// Bytes queued for sending or awaiting ACK (-1 if unknown)
+    pub tx_queued_bytes: i32,
+    /// The `kernel_*` fields were read
+    pub meminfo_valid: bool,
+    /// Packets the kernel socket dropped on a full receive queue
+    pub kernel_rx_drops: u32,
+    /// Bytes on the kernel socket's receive queue
+    pub kernel_rmem_alloc: u32,
+    /// Kernel socket receive buffer limit
+    pub kernel_rcvbuf: u32,
+}
+
+impl SocketInfo {
+    /// Descriptors of the VMA rings serving the socket.
+    pub fn rings(&self) -> &[i32] {
+        let count = (self.ring_count.max(0) as usize).min(SOCKET_MAX_RINGS);
+        &self.ring_fds[..count]
+    }
+}
+
+impl Default for StatsValues {
+    fn default() -> Self {
+        unsafe { std::mem::zeroed() }
+    }
+}
+
+impl StatsValues {
+    /// Histogram of successful receive syscall durations.
+    pub fn recv_latency(&self) -> LatencyHistogram<'_> {
+        LatencyHistogram { counts: &self.recv_latency }
+    }
+
+    /// Histogram of successful send syscall durations.
+    pub fn send_latency(&self) -> LatencyHistogram<'_> {
+        LatencyHistogram { counts: &self.send_latency }
+    }
+}
+
+/// Log-linear latency histogram (four sub-buckets per power of two of clock ticks).
+#[derive(Debug, Clone, Copy)]
+pub struct LatencyHistogram<'a> {
+    counts: &'a [u64; STATS_HIST_BUCKETS],
+}
+
+impl LatencyHistogram<'_> {
+    /// Raw bucket counts.
+    pub fn counts(&self) -> &[u64] {
+        self.counts
+    }
+
+    /// Total number of recorded samples.
+    pub fn total(&self) -> u64 {
+        self.counts.iter().sum()
+    }
+
+    /// Lower bound of a bucket in nanoseconds.
+    pub fn bucket_floor_ns(bucket: usize) -> u64 {
+        unsafe { vma_clock_ticks_to_ns(vma_stats_bucket_floor(bucket as c_int)) }
+    }
+
+    /// Non-empty buckets as `(lower bound in ns, count)`.
+    pub fn iter(&self) -> impl Iterator<Item = (u64, u64)> + '_ {
+        self.counts
+            .iter()
+            .enumerate()
+            .filter(|(_, &count)| count > 0)
+            .map(|(bucket, &count)| (Self::bucket_floor_ns(bucket), count))
+    }
+
+    /// Lower bound in nanoseconds of the bucket holding quantile `q` (0.0..=1.0).
+    pub fn percentile_ns(&self, q: f64) -> Option<u64> {
+        let total = self.total();
+        if total == 0 {
+            return None;
+        }
+
+        let rank = ((q.clamp(0.0, 1.0) * total as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (bucket, &count) in self.counts.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Some(Self::bucket_floor_ns(bucket));
+            }
+        }
+        None
+    }
+}
+
+/// C representation of the statistics block.
+#[repr(C, align(64))]
+pub struct StatsBlock {
+    inner: UnsafeCell<StatsBlockRaw>,
+}
+
+#[repr(C)]
+struct StatsBlockRaw {
+    seq: u64,
+    values: StatsValues,
+}
+
+impl std::fmt::Debug for StatsBlock {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("StatsBlock").field("values", &self.snapshot()).finish()
+    }
+}
+
+// Written by the socket's owner thread only; readers go through the sequence counter.
+unsafe impl Send for StatsBlock {}
+unsafe impl Sync for StatsBlock {}
+
+extern "C" {
+    fn vma_stats_snapshot(stats: *const StatsBlock, out: *mut StatsValues);
+    fn vma_stats_bucket_floor(bucket: c_int) -> u64;
+    fn vma_clock_ticks_to_ns(ticks: u64) -> u64;
+    #[cfg(test)]
+    fn vma_stats_bucket(ticks: u64) -> c_int;
+    #[cfg(test)]
+    fn vma_stats_rx(stats: *mut StatsBlock, packets: u64, bytes: u64, ticks: u64, empty_polls: u64);
+}
+
+impl StatsBlock {
+    pub(crate) fn new() -> Arc<Self> {
+        Arc::new(StatsBlock {
+            inner: UnsafeCell::new(StatsBlockRaw { seq: 0, values: StatsValues::default() }),
+        })
+    }
+
+    /// Pointer handed to the C socket.
+    pub(crate) fn as_ptr(&self) -> *mut StatsBlock {
+        self.inner.get() as *mut StatsBlock
+    }
+
+    /// Take a consistent copy of the counters.
+    pub fn snapshot(&self) -> StatsValues {
+        let mut values = StatsValues::default();
+        unsafe { vma_stats_snapshot(self, &mut values) };
+        values
+    }
+}
+
+/// Handle for reading a socket's statistics from another thread.
+///
+/// Keeps the statistics block alive after the socket is dropped.
+#[derive(Clone)]
+pub struct StatsReader {
+    block: Arc<StatsBlock>,
+}
+
+impl StatsReader {
+    pub(crate) fn new(block: Arc<StatsBlock>) -> Self {
+        StatsReader { block }
+    }
+
+    /// Take a consistent copy of the counters.
+    pub fn snapshot(&self) -> StatsValues {
+        self.block.snapshot()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+    use std::sync::mpsc;
+    use std::thread;
+    use std::time::Duration;
+
+    fn bucket(ticks: u64) -> usize {
+        unsafe { vma_stats_bucket(ticks) as usize }
+    }
+
+    fn floor(bucket: usize) -> u64 {
+        unsafe { vma_stats_bucket_floor(bucket as c_int) }
+    }
+
+    #[test]
+    fn test_histogram_bucketing() {
+        // Exact buckets below the first power-of-two group
+        for ticks in 0..4 {
+            assert_eq!(bucket(ticks), ticks as usize);
+        }
+
+        // Four linear sub-buckets per power of two
+        assert_eq!(bucket(4), 4);
+        assert_eq!(bucket(7), 7);
+        assert_eq!(bucket(8), 8);
+        assert_eq!(bucket(9), 8);
+        assert_eq!(bucket(10), 9);
+        assert_eq!(bucket(15), 11);
+        assert_eq!(bucket(16), 12);
+
+        // Each bucket covers [floor(b), floor(b + 1))
+        for b in 0..STATS_HIST_BUCKETS - 1 {
+            assert!(floor(b) < floor(b + 1), "bucket {} floor not increasing", b);
+            assert_eq!(bucket(floor(b)), b);
+            assert_eq!(bucket(floor(b + 1) - 1), b);
+        }
+
+        // Values past the range land in the last bucket
+        assert_eq!(bucket(u64::MAX), STATS_HIST_BUCKETS - 1);
+        assert_eq!(bucket(1 << 40), STATS_HIST_BUCKETS - 1);
+    }
+
+    #[test]
+    fn test_histogram_records_and_percentiles() {
+        let block = StatsBlock::new();
+        for ticks in [1u64, 9, 9, 1000] {
+            unsafe { vma_stats_rx(block.as_ptr(), 1, 10, ticks, 0) };
+        }
+
+        let stats = block.snapshot();
+        let latency = stats.recv_latency();
+        assert_eq!(stats.rx_packets, 4);
+        assert_eq!(latency.total(), 4);
+        assert_eq!(latency.counts()[bucket(1)], 1);
+        assert_eq!(latency.counts()[bucket(9)], 2);
+        assert_eq!(latency.counts()[bucket(1000)], 1);
+        assert_eq!(stats.send_latency().total(), 0);
+
+        let to_ns = |ticks| unsafe { vma_clock_ticks_to_ns(ticks) };
+        assert_eq!(latency.percentile_ns(0.0), Some(to_ns(floor(bucket(1)))));
+        assert_eq!(latency.percentile_ns(0.5), Some(to_ns(floor(bucket(9)))));
+        assert_eq!(latency.percentile_ns(1.0), Some(to_ns(floor(bucket(1000)))));
+        assert_eq!(latency.iter().count(), 3);
+        assert_eq!(StatsValues::default().recv_latency().percentile_ns(0.5), None);
+    }
+
+    #[test]
+    fn test_snapshot_not_torn() {
+        const UPDATES: u64 = 200_000;
+        const BYTES: u64 = 100;
+
+        let block = StatsBlock::new();
+        let done = Arc::new(AtomicBool::new(false));
+
+        let writer = {
+            let block = block.clone();
+            let done = done.clone();
+            thread::spawn(move || {
+                for i in 0..UPDATES {
+                    unsafe { vma_stats_rx(block.as_ptr(), 1, BYTES, i % 5000, 1) };
+                }
+                done.store(true, Ordering::Release);
+            })
+        };
+
+        // Every update touches packets, bytes, empty polls and one histogram bucket together
+        let reader = StatsReader::new(block.clone());
+        let mut snapshots = 0u64;
+        let mut last = 0;
+        loop {
+            let finished = done.load(Ordering::Acquire);
+            let stats = reader.snapshot();
+            assert_eq!(stats.rx_bytes, stats.rx_packets * BYTES);
+            assert_eq!(stats.rx_would_block, stats.rx_packets);
+            assert_eq!(stats.recv_latency().total(), stats.rx_packets);
+            assert!(stats.rx_packets >= last);
+            last = stats.rx_packets;
+            snapshots += 1;
+            if finished {
+                break;
+            }
+        }
+
+        writer.join().unwrap();
+        assert_eq!(last, UPDATES);
+        assert!(snapshots > 1);
+    }
+
+    #[test]
+    fn test_snapshot_waits_for_open_update() {
+        let block = StatsBlock::new();
+        let raw = block.inner.get();
+        let seq = unsafe { &*(std::ptr::addr_of!((*raw).seq) as *const AtomicU64) };
+
+        // Open an update and leave the values half written
+        seq.store(1, Ordering::Relaxed);
+        unsafe { (*raw).values.rx_packets = 7 };
+
+        let (tx, rx) = mpsc::channel();
+        let reader = StatsReader::new(block.clone());
+        let handle = thread::spawn(move || tx.send(reader.snapshot()).unwrap());
+
+        thread::sleep(Duration::from_millis(50));
+        assert!(rx.try_recv().is_err(), "snapshot returned during an open update");
+
+        unsafe { (*raw).values.rx_bytes = 700 };
+        seq.store(2, Ordering::Release);
+
+        let stats = rx.recv_timeout(Duration::from_secs(5)).unwrap();
+        assert_eq!((stats.rx_packets, stats.rx_bytes), (7, 700));
+        handle.join().unwrap();
+    }
+}
@@ -103,11 +103,17 @@
 //! - [`tcp`]: High-performance TCP socket implementation
 //! - [`common`]: Shared types and utilities used by both implementations
 
-use crate::common::{unixnano_to_ms, sockaddr_to_rust, SockAddrIn, VmaOptions};
+use crate::common::{unixnano_to_ms, sockaddr_to_rust, SockAddrIn, VmaOptions, WaitMode, WaitStats};
+use std::collections::VecDeque;
 use std::ffi::{c_void, CString};
+use std::io::IoSlice;
+use std::marker::PhantomData;
 use std::mem;
 use std::net::SocketAddr;
+use std::os::fd::{AsRawFd, RawFd};
 use std::os::raw::{c_char, c_int, c_ulonglong};
+use std::sync::Arc;
+use crate::stats::{SocketInfo, StatsBlock, StatsReader, StatsValues};
 
 // External declarations for C functions - using VmaOptions directly
 extern "C" {
@@ -116,11 +122,28 @@ extern "C" {
     fn tcp_socket_bind(socket: *mut TcpSocket, ip: *const c_char, port: u16) -> c_int;
     fn tcp_socket_listen(socket: *mut TcpSocket, backlog: c_int) -> c_int;
     fn tcp_socket_accept(socket: *mut TcpSocket, client: *mut TcpClient, timeout_ms: c_int) -> c_int;
+    fn tcp_socket_accept_batch(
+        socket: *mut TcpSocket,
+        clients: *mut TcpClient,
+        max_clients: usize,
+        timeout_ms: c_int,
+        accepted: *mut usize,
+    ) -> c_int;
     fn tcp_socket_connect(socket: *mut TcpSocket, ip: *const c_char, port: u16, timeout_ms: c_int) -> c_int;
     fn tcp_socket_reconnect(socket: *mut TcpSocket, timeout_ms: c_int) -> c_int;
-    fn tcp_socket_is_connected(socket: *mut TcpSocket) -> bool;
+    fn tcp_socket_is_connected(socket: *const TcpSocket) -> bool;
+    fn tcp_socket_probe(socket: *mut TcpSocket) -> bool;
+    fn tcp_socket_mark_disconnected(socket: *mut TcpSocket);
     fn tcp_socket_send(socket: *mut TcpSocket, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
     fn tcp_socket_send_to_client(client: *mut TcpClient, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
+    fn tcp_socket_sendv(socket: *mut TcpSocket, iov: *const IoSlice<'_>, iovcnt: usize, bytes_sent: *mut usize) -> c_int;
+    fn tcp_socket_sendv_to_client(client: *mut TcpClient, iov: *const IoSlice<'_>, iovcnt: usize, bytes_sent: *mut usize) -> c_int;
+    fn tcp_send_batch_init(batch: *mut SendBatchRaw, capacity: usize) -> c_int;
+    fn tcp_send_batch_close(batch: *mut SendBatchRaw) -> c_int;
+    fn tcp_send_batch_add(batch: *mut SendBatchRaw, data: *const c_void, length: usize) -> c_int;
+    fn tcp_send_batch_addv(batch: *mut SendBatchRaw, iov: *const IoSlice<'_>, iovcnt: usize) -> c_int;
+    fn tcp_socket_send_batch(socket: *mut TcpSocket, batch: *mut SendBatchRaw, bytes_sent: *mut usize) -> c_int;
+    fn tcp_socket_send_batch_to_client(client: *mut TcpClient, batch: *mut SendBatchRaw, bytes_sent: *mut usize) -> c_int;
     fn tcp_socket_recv(
         socket: *mut TcpSocket,
         buffer: *mut c_void,
@@ -136,6 +159,32 @@ extern "C" {
         bytes_received: *mut usize,
     ) -> c_int;
     fn tcp_socket_close_client(client: *mut TcpClient) -> c_int;
+    fn tcp_socket_set_stats_block(socket: *mut TcpSocket, stats: *mut StatsBlock) -> c_int;
+    fn tcp_socket_get_extended_stats(socket: *const TcpSocket, stats: *mut TcpExtendedStats) -> c_int;
+    fn tcp_socket_get_client_extended_stats(client: *const TcpClient, stats: *mut TcpExtendedStats) -> c_int;
+    fn tcp_socket_enable_zerocopy(socket: *mut TcpSocket) -> c_int;
+    fn tcp_socket_enable_client_zerocopy(client: *mut TcpClient) -> c_int;
+    fn tcp_socket_send_zerocopy(
+        socket: *mut TcpSocket,
+        data: *const c_void,
+        length: usize,
+        bytes_sent: *mut usize,
+        ticket: *mut ZeroCopyTicket,
+    ) -> c_int;
+    fn tcp_socket_send_zerocopy_to_client(
+        client: *mut TcpClient,
+        data: *const c_void,
+        length: usize,
+        bytes_sent: *mut usize,
+        ticket: *mut ZeroCopyTicket,
+    ) -> c_int;
+    fn tcp_zerocopy_reap(
+        zc: *mut TcpZeroCopy,
+        completions: *mut ZeroCopyCompletion,
+        max: usize,
+        timeout_ms: c_int,
+        count: *mut usize,
+    ) -> c_int;
     fn tcp_socket_get_stats(
         socket: *mut TcpSocket,
         rx_packets: *mut c_ulonglong,
@@ -169,11 +218,12 @@ pub struct TcpSocket {
     pub remote_addr: SockAddrIn,
     pub is_bound: bool,
     pub state: TcpConnectionState,
-    pub rx_packets: c_ulonglong,
-    pub tx_packets: c_ulonglong,
-    pub rx_bytes: c_ulonglong,
-    pub tx_bytes: c_ulonglong,
+    pub stats: *mut StatsBlock,
+    pub owns_stats: bool,
     pub backlog: c_int,
+    pub wait_mode: WaitMode,
+    pub wait_stats: WaitStats,
+    pub zerocopy: TcpZeroCopy,
 }
 
 /// C representation of a TCP client connection.
@@ -184,6 +234,311 @@ pub struct TcpClient {
     pub addr: SockAddrIn,
     pub rx_bytes: c_ulonglong,
     pub tx_bytes: c_ulonglong,
+    pub wait_mode: WaitMode,
+    pub wait_stats: WaitStats,
+    pub zerocopy: TcpZeroCopy,
+}
+
+/// Offload, ring and `TCP_INFO` statistics of a TCP connection.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct TcpExtendedStats {
+    /// Offload state, VMA rings, queue occupancy and kernel drops
+    pub info: SocketInfo,
+    /// The fields below were read (`TCP_INFO`)
+    pub tcp_info_valid: bool,
+    /// Kernel TCP state (`TCP_ESTABLISHED`, ...)
+    pub tcp_state: u8,
+    /// Smoothed round-trip time in microseconds
+    pub rtt_us: u32,
+    /// Round-trip time variance in microseconds
+    pub rtt_var_us: u32,
+    /// Congestion window in segments
+    pub snd_cwnd: u32,
+    /// Segments in flight
+    pub unacked: u32,
+    /// Segments currently considered lost
+    pub lost: u32,
+    /// Retransmitted segments over the connection lifetime
+    pub total_retrans: u32,
+    /// Receive window the stack is advertising towards
+    pub rcv_space: u32,
+}
+
+/// Zero-copy send counters of a connection.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ZeroCopyStats {
+    /// Sends issued with `MSG_ZEROCOPY`
+    pub zerocopy_sends: u64,
+    /// Sends copied instead (zero-copy refused, below `ZEROCOPY_MIN_BYTES`, or notification memory exhausted)
+    pub copied_sends: u64,
+    /// Zero-copy sends reported complete
+    pub completions: u64,
+    /// Of those, completed by a kernel copy after all (loopback, or a device without scatter-gather)
+    pub copied_completions: u64,
+}
+
+/// Zero-copy sends smaller than this are copied (matches `TCP_ZEROCOPY_MIN_BYTES`).
+pub const ZEROCOPY_MIN_BYTES: usize = 16384;
+
+/// C representation of a connection's zero-copy send state (kept by the
+/// connection so sequence numbers carry over from one sender to the next).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct TcpZeroCopy {
+    socket_fd: c_int,
+    enabled: bool,
+    next_seq: u32,
+    stats: ZeroCopyStats,
+}
+
+/// C representation of the outcome of one zero-copy send.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+struct ZeroCopyTicket {
+    seq: u32,
+    pinned: bool,
+}
+
+/// C representation of a zero-copy completion range.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+struct ZeroCopyCompletion {
+    lo: u32,
+    hi: u32,
+    copied: bool,
+}
+
+// Completions read per error-queue pass
+const ZEROCOPY_REAP_BATCH: usize = 64;
+
+// How long dropping a sender waits for its sends to complete before leaking their buffers
+const ZEROCOPY_DROP_WAIT_NS: u64 = 1_000_000_000;
+
+/// Buffer lent to zero-copy sends; clone the `Arc` to send one buffer to many connections.
+pub type ZeroCopyBuffer = Arc<dyn AsRef<[u8]> + Send + Sync>;
+
+// Connection a zero-copy sender writes to
+enum ZeroCopyTarget {
+    Socket(*mut TcpSocket),
+    Client(*mut TcpClient),
+}
+
+/// Zero-copy send state of one connection.
+///
+/// Created by `zerocopy_sender()` on a connected socket or an accepted client,
+/// which it borrows so the descriptor cannot be closed or reused under it.
+/// Every send that went out with `MSG_ZEROCOPY` keeps a clone of its buffer
+/// until [`reap`](ZeroCopySender::reap) reads its completion from the socket
+/// error queue, so the bytes cannot change or be freed while the stack (or
+/// the NIC, under VMA) still reads them. Dropping the sender waits up to a
+/// second for sends in flight and leaks the buffers of any still pending
+/// rather than free memory that is being sent; call
+/// [`wait_all`](ZeroCopySender::wait_all) first to bound the wait yourself.
+/// The connection keeps its zero-copy state, so a later sender picks up
+/// where this one stopped.
+///
+/// # Example
+///
+/// ```rust,no_run
+/// use std::sync::Arc;
+/// use vma_socket::tcp::{VmaTcpSocket, ZeroCopyBuffer};
+///
+/// let mut server = VmaTcpSocket::new().unwrap();
+/// server.bind("0.0.0.0", 5002).unwrap();
+/// server.listen(128).unwrap();
+///
+/// // One snapshot shared by every client with no per-client copy
+/// let snapshot: ZeroCopyBuffer = Arc::new(vec![0u8; 8 << 20]);
+///
+/// if let Some(mut client) = server.accept(None).unwrap() {
+///     let mut sender = client.zerocopy_sender().unwrap();
+///     let mut offset = 0;
+///     while offset < (*snapshot).as_ref().len() {
+///         offset += sender.send(&snapshot, offset).unwrap();
+///         sender.reap(Some(0)).unwrap();
+///     }
+///     sender.wait_all(Some(1_000_000_000)).unwrap();
+/// }
+/// ```
+pub struct ZeroCopySender<'a> {
+    target: ZeroCopyTarget,
+    // Buffers of the zero-copy sends from base_seq on (None once complete)
+    pinned: VecDeque<Option<ZeroCopyBuffer>>,
+    base_seq: u32,
+    in_flight: usize,
+    completions: Vec<ZeroCopyCompletion>,
+    _connection: PhantomData<&'a mut TcpSocket>,
+}
+
+// The sender holds the connection's only mutable borrow
+unsafe impl Send for ZeroCopySender<'_> {}
+
+impl<'a> ZeroCopySender<'a> {
+    fn new(target: ZeroCopyTarget) -> Self {
+        let mut sender = ZeroCopySender {
+            target,
+            pinned: VecDeque::new(),
+            in_flight: 0,
+            completions: vec![ZeroCopyCompletion::default(); ZEROCOPY_REAP_BATCH],
+            base_seq: 0,
+            _connection: PhantomData,
+        };
+        // Sends of earlier senders are not ours to release
+        sender.base_seq = unsafe { (*sender.raw()).next_seq };
+        sender
+    }
+
+    // Zero-copy state kept in the connection
+    fn raw(&self) -> *mut TcpZeroCopy {
+        unsafe {
+            match self.target {
+                ZeroCopyTarget::Socket(socket) => std::ptr::addr_of_mut!((*socket).zerocopy),
+                ZeroCopyTarget::Client(client) => std::ptr::addr_of_mut!((*client).zerocopy),
+            }
+        }
+    }
+
+    /// Send `buffer[offset..]` without copying it (one send; may be partial, 0 if it would block).
+    ///
+    /// Returns the bytes sent; resume from `offset` plus that. The sender
+    /// holds the buffer until the send completes.
+    pub fn send(&mut self, buffer: &ZeroCopyBuffer, offset: usize) -> Result<usize, std::io::Error> {
+        let data = match (**buffer).as_ref().get(offset..) {
+            Some(data) => data,
+            None => return Err(TcpResult::TcpErrorInvalidParam.into()),
+        };
+
+        let mut bytes_sent: usize = 0;
+        let mut ticket = ZeroCopyTicket::default();
+        let result = unsafe {
+            match self.target {
+                ZeroCopyTarget::Socket(socket) => tcp_socket_send_zerocopy(
+                    socket, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent, &mut ticket,
+                ),
+                ZeroCopyTarget::Client(client) => tcp_socket_send_zerocopy_to_client(
+                    client, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent, &mut ticket,
+                ),
+            }
+        };
+
+        if result == TcpResult::TcpErrorWouldBlock as i32 {
+            return Ok(0); // would block is not an error
+        }
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) }.into());
+        }
+
+        if ticket.pinned {
+            // Sequence numbers are consecutive, so the queue index is seq - base_seq
+            debug_assert_eq!(ticket.seq.wrapping_sub(self.base_seq) as usize, self.pinned.len());
+            self.pinned.push_back(Some(Arc::clone(buffer)));
+            self.in_flight += 1;
+        }
+
+        Ok(bytes_sent)
+    }
+
+    /// Release the buffers of completed sends.
+    ///
+    /// Waits up to `timeout_nano` for the first completion (`Some(0)` polls)
+    /// and returns the number of sends completed.
+    pub fn reap(&mut self, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        let mut timeout_ms = unixnano_to_ms(timeout_nano);
+        let mut released = 0;
+
+        loop {
+            let mut count: usize = 0;
+            let result = unsafe {
+                tcp_zerocopy_reap(self.raw(), self.completions.as_mut_ptr(), self.completions.len(), timeout_ms, &mut count)
+            };
+            if result == TcpResult::TcpErrorTimeout as i32 {
+                break;
+            }
+            if result != TcpResult::TcpSuccess as i32 {
+                return Err(unsafe { mem::transmute::<i32, TcpResult>(result) }.into());
+            }
+
+            for i in 0..count {
+                let completion = self.completions[i];
+                let sends = completion.hi.wrapping_sub(completion.lo) as u64 + 1;
+                for k in 0..sends {
+                    let index = completion.lo.wrapping_add(k as u32).wrapping_sub(self.base_seq) as usize;
+                    if let Some(slot) = self.pinned.get_mut(index) {
+                        if slot.take().is_some() {
+                            self.in_flight -= 1;
+                            released += 1;
+                        }
+                    }
+                }
+            }
+
+            // Completions can arrive out of order; the queue shrinks from the oldest
+            while let Some(None) = self.pinned.front() {
+                self.pinned.pop_front();
+                self.base_seq = self.base_seq.wrapping_add(1);
+            }
+
+            if count < self.completions.len() {
+                break;
+            }
+            timeout_ms = 0;
+        }
+
+        Ok(released)
+    }
+
+    /// Reap until no send is in flight; `false` if some still are at the timeout.
+    pub fn wait_all(&mut self, timeout_nano: Option<u64>) -> Result<bool, std::io::Error> {
+        let deadline = timeout_nano.map(|t| std::time::Instant::now() + std::time::Duration::from_nanos(t));
+
+        while self.in_flight > 0 {
+            let remaining = match deadline {
+                Some(deadline) => {
+                    let now = std::time::Instant::now();
+                    if now >= deadline {
+                        return Ok(false);
+                    }
+                    Some((deadline - now).as_nanos() as u64)
+                }
+                None => None,
+            };
+            self.reap(remaining)?;
+        }
+
+        Ok(true)
+    }
+
+    /// Number of zero-copy sends whose buffers are still held.
+    pub fn in_flight(&self) -> usize {
+        self.in_flight
+    }
+
+    /// Whether the connection accepted `SO_ZEROCOPY` (otherwise every send is copied).
+    pub fn is_enabled(&self) -> bool {
+        unsafe { (*self.raw()).enabled }
+    }
+
+    /// Zero-copy send and completion counters of the connection.
+    pub fn stats(&self) -> ZeroCopyStats {
+        unsafe { (*self.raw()).stats }
+    }
+}
+
+impl Drop for ZeroCopySender<'_> {
+    fn drop(&mut self) {
+        if self.in_flight == 0 {
+            return;
+        }
+
+        // Freeing a buffer the stack or the NIC still reads would put garbage on the wire
+        if !matches!(self.wait_all(Some(ZEROCOPY_DROP_WAIT_NS)), Ok(true)) {
+            for buffer in self.pinned.drain(..).flatten() {
+                mem::forget(buffer);
+            }
+        }
+    }
 }
 
 /// Result codes returned by the C TCP socket functions.
@@ -206,6 +561,7 @@ pub enum TcpResult {
     TcpErrorClosed = -13,
     TcpErrorWouldBlock = -14,
     TcpErrorAlreadyConnected = -15,
+    TcpErrorProtocol = -16,
 }
 
 use std::io::{Error, ErrorKind};
@@ -229,6 +585,91 @@ impl From<TcpResult> for std::io::Error {
             TcpResult::TcpErrorClosed => Error::new(ErrorKind::ConnectionAborted, "Connection closed"),
             TcpResult::TcpErrorWouldBlock => Error::new(ErrorKind::WouldBlock, "Would block"),
             TcpResult::TcpErrorAlreadyConnected => Error::new(ErrorKind::AlreadyExists, "Already connected"),
+            TcpResult::TcpErrorProtocol => Error::new(ErrorKind::InvalidData, "Malformed message framing"),
+        }
+    }
+}
+
+/// Maximum number of buffers per vectored send (matches `TCP_MAX_IOV`).
+pub const TCP_MAX_IOV: usize = 64;
+
+/// C representation of a coalescing send buffer.
+#[repr(C)]
+#[derive(Debug)]
+struct SendBatchRaw {
+    buffer: *mut u8,
+    capacity: usize,
+    length: usize,
+    messages: usize,
+}
+
+/// Coalescing send buffer.
+///
+/// Messages produced in one loop iteration are copied in with [`push`](Self::push)
+/// and leave as a single write (one segment with `TCP_NODELAY`) when the batch is
+/// passed to `send_batch`. The buffer is reused across flushes.
+#[derive(Debug)]
+pub struct SendBatch {
+    raw: SendBatchRaw,
+}
+
+// The batch owns its buffer exclusively.
+unsafe impl Send for SendBatch {}
+
+impl SendBatch {
+    /// Allocate a batch of `capacity` bytes.
+    pub fn new(capacity: usize) -> Result<Self, std::io::Error> {
+        let mut raw: SendBatchRaw = unsafe { mem::zeroed() };
+        let result = unsafe { tcp_send_batch_init(&mut raw, capacity) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) }.into());
+        }
+        
+        Ok(SendBatch { raw })
+    }
+    
+    /// Append one message, returns false if it does not fit in the space left.
+    pub fn push(&mut self, data: &[u8]) -> bool {
+        unsafe { tcp_send_batch_add(&mut self.raw, data.as_ptr() as *const c_void, data.len()) == TcpResult::TcpSuccess as i32 }
+    }
+    
+    /// Append one message made of several parts, returns false if it does not fit in the space left.
+    pub fn push_vectored(&mut self, parts: &[IoSlice<'_>]) -> bool {
+        unsafe { tcp_send_batch_addv(&mut self.raw, parts.as_ptr(), parts.len()) == TcpResult::TcpSuccess as i32 }
+    }
+    
+    /// Bytes pending.
+    pub fn len(&self) -> usize {
+        self.raw.length
+    }
+    
+    /// Whether nothing is pending.
+    pub fn is_empty(&self) -> bool {
+        self.raw.length == 0
+    }
+    
+    /// Messages pending.
+    pub fn messages(&self) -> usize {
+        self.raw.messages
+    }
+    
+    /// Buffer size in bytes.
+    pub fn capacity(&self) -> usize {
+        self.raw.capacity
+    }
+    
+    /// Drop everything pending.
+    pub fn clear(&mut self) {
+        self.raw.length = 0;
+        self.raw.messages = 0;
+    }
+}
+
+impl Drop for SendBatch {
+    fn drop(&mut self) {
+        unsafe {
+            tcp_send_batch_close(&mut self.raw);
         }
     }
 }
@@ -248,7 +689,7 @@ impl Client {
     /// Create a new Client from a TcpClient structure.
     ///
     /// This is used internally by the accept() method.
-    fn new(client: TcpClient) -> Self {
+    pub(crate) fn new(client: TcpClient) -> Self {
         let address = sockaddr_to_rust(&client.addr);
         Client {
             inner: client,
@@ -275,6 +716,37 @@ impl Client {
         Ok(bytes_sent)
     }
     
+    /// Send several buffers to the client as one write.
+    ///
+    /// Partial writes are resumed internally. `TcpErrorWouldBlock` means
+    /// nothing was written; a peer that stops reading partway yields the short
+    /// count once `TCP_SEND_STALL_TIMEOUT_MS` passes, and the caller resumes
+    /// from there.
+    pub fn sendv(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_sendv_to_client(&mut self.inner, bufs.as_ptr(), bufs.len(), &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
+    /// Send and empty a coalescing batch (kept on `TcpErrorWouldBlock`, its unsent rest if the peer stalled partway).
+    pub fn send_batch(&mut self, batch: &mut SendBatch) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_send_batch_to_client(&mut self.inner, &mut batch.raw, &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
     /// Receive data from the client.
     pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, TcpResult> {
         let mut bytes_received: usize = 0;
@@ -298,6 +770,41 @@ impl Client {
         Ok(bytes_received)
     }
     
+    /// Get receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.inner.wait_stats
+    }
+    
+    /// Get offload, ring and `TCP_INFO` statistics of the connection.
+    pub fn extended_stats(&self) -> Result<TcpExtendedStats, TcpResult> {
+        let mut stats = TcpExtendedStats::default();
+        let result = unsafe { tcp_socket_get_client_extended_stats(&self.inner, &mut stats) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(stats)
+    }
+    
+    /// Enable zero-copy sends (`SO_ZEROCOPY`) on the connection.
+    ///
+    /// The sender borrows the client; send through it with [`ZeroCopySender::send`].
+    pub fn zerocopy_sender(&mut self) -> Result<ZeroCopySender<'_>, TcpResult> {
+        let result = unsafe { tcp_socket_enable_client_zerocopy(&mut self.inner) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(ZeroCopySender::new(ZeroCopyTarget::Client(&mut self.inner)))
+    }
+    
+    /// C client structure (for modules layered on the connection).
+    pub(crate) fn raw(&self) -> &TcpClient {
+        &self.inner
+    }
+    
     /// Explicitly close the client connection.
     ///
     /// Note: The connection will be closed automatically when the Client is dropped.
@@ -312,6 +819,12 @@ impl Client {
     }
 }
 
+impl AsRawFd for Client {
+    fn as_raw_fd(&self) -> RawFd {
+        self.inner.socket_fd
+    }
+}
+
 impl Drop for Client {
     /// Automatically close the client connection when it goes out of scope.
     fn drop(&mut self) {
@@ -323,13 +836,114 @@ impl Drop for Client {
     }
 }
 
+/// Borrowed client connection owned by C code (e.g. a server runtime worker).
+///
+/// Offers the same operations as [`Client`] but never closes the connection.
+#[derive(Debug)]
+pub struct ClientRef<'a> {
+    inner: &'a mut TcpClient,
+}
+
+impl<'a> ClientRef<'a> {
+    /// Wrap a client structure owned elsewhere.
+    ///
+    /// # Safety
+    ///
+    /// `client` must point to a valid client structure that is not accessed
+    /// otherwise for the lifetime `'a`.
+    pub(crate) unsafe fn from_raw(client: *mut TcpClient) -> Self {
+        ClientRef { inner: &mut *client }
+    }
+    
+    /// The client's remote address and port.
+    pub fn address(&self) -> SocketAddr {
+        sockaddr_to_rust(&self.inner.addr)
+    }
+    
+    /// Send data to the client.
+    pub fn send(&mut self, data: &[u8]) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe {
+            tcp_socket_send_to_client(self.inner, data.as_ptr() as *const c_void, data.len(), &mut bytes_sent)
+        };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
+    /// Send several buffers to the client as one write (fewer bytes if the peer stalled partway).
+    pub fn sendv(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_sendv_to_client(self.inner, bufs.as_ptr(), bufs.len(), &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
+    /// Send and empty a coalescing batch (kept on `TcpErrorWouldBlock`, its unsent rest if the peer stalled partway).
+    pub fn send_batch(&mut self, batch: &mut SendBatch) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_send_batch_to_client(self.inner, &mut batch.raw, &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
+    /// Receive data from the client.
+    pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, TcpResult> {
+        let mut bytes_received: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        let result = unsafe {
+            tcp_socket_recv_from_client(
+                self.inner,
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                timeout_ms,
+                &mut bytes_received,
+            )
+        };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_received)
+    }
+    
+    /// Bytes received from and sent to this client.
+    pub fn traffic(&self) -> (u64, u64) {
+        (self.inner.rx_bytes, self.inner.tx_bytes)
+    }
+}
+
+impl AsRawFd for ClientRef<'_> {
+    fn as_raw_fd(&self) -> RawFd {
+        self.inner.socket_fd
+    }
+}
+
 /// Low-level wrapper around the C TCP socket implementation.
 /// Uses stack allocation instead of heap allocation for better performance.
 #[derive(Debug, Clone)]
 pub struct TcpSocketWrapper {
     socket: TcpSocket,
+    stats: Arc<StatsBlock>,
 }
 
+// The socket is used from one thread at a time; the stats block is shared through `StatsReader`.
+unsafe impl Send for TcpSocketWrapper {}
+
 impl TcpSocketWrapper {
     /// Create a new TCP socket with the specified options.
     pub fn new(options: Option<VmaOptions>) -> Result<Self, TcpResult> {
@@ -337,18 +951,21 @@ impl TcpSocketWrapper {
         
         let c_options = options.unwrap_or_default();
         
-        let result = unsafe { 
-            println!("Initializing TCP socket with options: use_socketxtreme={}, optimize_for_latency={}, ring_count={}",
-                c_options.use_socketxtreme, c_options.optimize_for_latency, c_options.ring_count);
-            tcp_socket_init(&mut socket, &c_options)
-        };
+        let result = unsafe { tcp_socket_init(&mut socket, &c_options) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
         
+        // Move the counters into a block readers on other threads can hold on to
+        let stats = StatsBlock::new();
+        let result = unsafe { tcp_socket_set_stats_block(&mut socket, stats.as_ptr()) };
         if result != TcpResult::TcpSuccess as i32 {
-            println!("TCP socket initialization failed with code: {}", result);
+            unsafe { tcp_socket_close(&mut socket) };
             return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
         }
         
-        Ok(TcpSocketWrapper { socket })
+        Ok(TcpSocketWrapper { socket, stats })
     }
     
     /// Bind the socket to a local address and port.
@@ -388,6 +1005,29 @@ impl TcpSocketWrapper {
         Ok(Client::new(client))
     }
     
+    /// Accept every pending connection, up to `max_clients`, appending them to `clients`.
+    ///
+    /// Waits for the first connection only while nothing is pending.
+    pub fn accept_batch(&mut self, clients: &mut Vec<Client>, max_clients: usize, timeout_nano: Option<u64>) -> Result<usize, TcpResult> {
+        let mut raw: Vec<TcpClient> = Vec::with_capacity(max_clients);
+        let mut accepted: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            tcp_socket_accept_batch(&mut self.socket, raw.as_mut_ptr(), max_clients, timeout_ms, &mut accepted)
+        };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        // The C side initialized the first `accepted` entries
+        unsafe { raw.set_len(accepted) };
+        clients.extend(raw.into_iter().map(Client::new));
+        
+        Ok(accepted)
+    }
+    
     /// Connect to a server (client).
     pub fn connect<A: Into<String>>(&mut self, addr: A, port: u16, timeout_nano: Option<u64>) -> Result<(), TcpResult> {
         let c_addr = CString::new(addr.into()).unwrap();
@@ -414,9 +1054,19 @@ impl TcpSocketWrapper {
         Ok(())
     }
     
-    /// Check if the socket is currently connected.
-    pub fn is_connected(&mut self) -> bool {
-        unsafe { tcp_socket_is_connected(&mut self.socket) }
+    /// Check the tracked connection state (no system call).
+    pub fn is_connected(&self) -> bool {
+        unsafe { tcp_socket_is_connected(&self.socket) }
+    }
+    
+    /// Ask the kernel whether the connection is still alive (off the hot path).
+    pub fn probe(&mut self) -> bool {
+        unsafe { tcp_socket_probe(&mut self.socket) }
+    }
+    
+    /// Record that the connection is gone (hangup or error event, heartbeat timeout).
+    pub fn mark_disconnected(&mut self) {
+        unsafe { tcp_socket_mark_disconnected(&mut self.socket) }
     }
     
     /// Send data over the connected socket.
@@ -438,6 +1088,32 @@ impl TcpSocketWrapper {
         Ok(bytes_sent)
     }
     
+    /// Send several buffers as one write, resuming partial writes internally (fewer bytes if the peer stalled partway).
+    pub fn sendv(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_sendv(&mut self.socket, bufs.as_ptr(), bufs.len(), &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
+    /// Send and empty a coalescing batch (kept on `TcpErrorWouldBlock`, its unsent rest if the peer stalled partway).
+    pub fn send_batch(&mut self, batch: &mut SendBatch) -> Result<usize, TcpResult> {
+        let mut bytes_sent: usize = 0;
+        let result = unsafe { tcp_socket_send_batch(&mut self.socket, &mut batch.raw, &mut bytes_sent) };
+        
+        // A send that stalled or failed partway reports how far it got; a failure shows again on the next call
+        if result != TcpResult::TcpSuccess as i32 && bytes_sent == 0 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+    
     /// Receive data from the connected socket.
     pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, TcpResult> {
         let mut bytes_received: usize = 0;
@@ -483,6 +1159,52 @@ impl TcpSocketWrapper {
         
         Ok((rx_packets, tx_packets, rx_bytes, tx_bytes))
     }
+    
+    /// Get receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.socket.wait_stats
+    }
+    
+    /// Take a consistent snapshot of all counters and latency histograms.
+    pub fn stats_snapshot(&self) -> StatsValues {
+        self.stats.snapshot()
+    }
+    
+    /// Enable zero-copy sends (`SO_ZEROCOPY`) on the connected socket.
+    ///
+    /// The sender borrows the socket; send through it with [`ZeroCopySender::send`].
+    pub fn zerocopy_sender(&mut self) -> Result<ZeroCopySender<'_>, TcpResult> {
+        let result = unsafe { tcp_socket_enable_zerocopy(&mut self.socket) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(ZeroCopySender::new(ZeroCopyTarget::Socket(&mut self.socket)))
+    }
+    
+    /// Get offload, ring and `TCP_INFO` statistics of the connection.
+    pub fn extended_stats(&self) -> Result<TcpExtendedStats, TcpResult> {
+        let mut stats = TcpExtendedStats::default();
+        let result = unsafe { tcp_socket_get_extended_stats(&self.socket, &mut stats) };
+        
+        if result != TcpResult::TcpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, TcpResult>(result) });
+        }
+        
+        Ok(stats)
+    }
+    
+    /// Handle for reading the statistics from another thread.
+    pub fn stats_reader(&self) -> StatsReader {
+        StatsReader::new(Arc::clone(&self.stats))
+    }
+}
+
+impl AsRawFd for TcpSocketWrapper {
+    fn as_raw_fd(&self) -> RawFd {
+        self.socket.socket_fd
+    }
 }
 
 impl Drop for TcpSocketWrapper {
@@ -500,6 +1222,12 @@ pub struct VmaTcpSocket {
     inner: TcpSocketWrapper,
 }
 
+impl AsRawFd for VmaTcpSocket {
+    fn as_raw_fd(&self) -> RawFd {
+        self.inner.as_raw_fd()
+    }
+}
+
 impl VmaTcpSocket {
     /// Create a new TCP socket with default VMA options.
     pub fn new() -> Result<Self, std::io::Error> {
@@ -538,6 +1266,17 @@ impl VmaTcpSocket {
         }
     }
     
+    /// Accept every pending connection, up to `max_clients`, appending them to `clients`.
+    ///
+    /// Returns the number accepted (0 on timeout).
+    pub fn accept_batch(&mut self, clients: &mut Vec<Client>, max_clients: usize, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        match self.inner.accept_batch(clients, max_clients, timeout_nano) {
+            Ok(count) => Ok(count),
+            Err(TcpResult::TcpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+    
     /// Connect to a server (client).
     pub fn connect<A: Into<String>>(&mut self, addr: A, port: u16, timeout: Option<u64>) -> Result<bool, std::io::Error> {
         match self.inner.connect(addr, port, timeout) {
@@ -557,11 +1296,30 @@ impl VmaTcpSocket {
         }
     }
     
-    /// Check if the socket is currently connected.
-    pub fn is_connected(&mut self) -> bool {
+    /// Check the tracked connection state.
+    ///
+    /// This is a memory read: the state drops when a send or receive fails,
+    /// the peer closes, or [`mark_disconnected`](Self::mark_disconnected) is
+    /// called for a hangup event or heartbeat timeout.
+    pub fn is_connected(&self) -> bool {
         self.inner.is_connected()
     }
     
+    /// Ask the kernel whether the connection is still alive (off the hot path).
+    ///
+    /// Detects an orderly close or reset that no send or receive has seen yet.
+    pub fn probe(&mut self) -> bool {
+        self.inner.probe()
+    }
+    
+    /// Record that the connection is gone.
+    ///
+    /// Call on a poller hangup, a SocketXtreme `Closed`/`Error` event or a
+    /// heartbeat timeout.
+    pub fn mark_disconnected(&mut self) {
+        self.inner.mark_disconnected()
+    }
+    
     /// Send data over the connected socket.
     pub fn send(&mut self, data: &[u8]) -> Result<usize, std::io::Error> {
         match self.inner.send(data) {
@@ -571,6 +1329,26 @@ impl VmaTcpSocket {
         }
     }
     
+    /// Send several buffers as one write, resuming partial writes internally.
+    ///
+    /// Same contract as [`Client::sendv`], with `Ok(0)` for would block.
+    pub fn sendv(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize, std::io::Error> {
+        match self.inner.sendv(bufs) {
+            Ok(bytes) => Ok(bytes),
+            Err(TcpResult::TcpErrorWouldBlock) => Ok(0), // would block is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+    
+    /// Send and empty a coalescing batch (0 and the batch kept if it would block).
+    pub fn send_batch(&mut self, batch: &mut SendBatch) -> Result<usize, std::io::Error> {
+        match self.inner.send_batch(batch) {
+            Ok(bytes) => Ok(bytes),
+            Err(TcpResult::TcpErrorWouldBlock) => Ok(0), // would block is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+    
     /// Receive data from the connected socket.
     pub fn recv(&mut self, buffer: &mut [u8], timeout: Option<u64>) -> Result<usize, std::io::Error> {
         match self.inner.recv(buffer, timeout) {
@@ -586,4 +1364,140 @@ impl VmaTcpSocket {
         self.inner.get_stats()
             .map_err(|e| e.into())
     }
-}
\ No newline at end of file
+    
+    /// Get receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.inner.get_wait_stats()
+    }
+    
+    /// Take a consistent snapshot of all counters and latency histograms.
+    pub fn stats_snapshot(&self) -> StatsValues {
+        self.inner.stats_snapshot()
+    }
+    
+    /// Enable zero-copy sends (`SO_ZEROCOPY`) on the connected socket.
+    ///
+    /// The sender borrows the socket; see [`ZeroCopySender`].
+    pub fn zerocopy_sender(&mut self) -> Result<ZeroCopySender<'_>, std::io::Error> {
+        self.inner
+            .zerocopy_sender()
+            .map_err(|e| e.into())
+    }
+    
+    /// Get offload, ring and `TCP_INFO` statistics of the connection.
+    pub fn extended_stats(&self) -> Result<TcpExtendedStats, std::io::Error> {
+        self.inner
+            .extended_stats()
+            .map_err(|e| e.into())
+    }
+    
+    /// Handle for reading the statistics from another thread.
+    pub fn stats_reader(&self) -> StatsReader {
+        self.inner.stats_reader()
+    }
+    
+    /// Mutable C socket structure (for modules layered on or replacing the connection).
+    pub(crate) fn raw_mut(&mut self) -> &mut TcpSocket {
+        &mut self.inner.socket
+    }
+    
+    /// Low-level wrapper with the raw result codes (for the async adapters).
+    pub(crate) fn wrapper_mut(&mut self) -> &mut TcpSocketWrapper {
+        &mut self.inner
+    }
+}
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::io::Read;
+    use std::net::TcpListener;
+    use std::thread;
+
+    // Connected socket whose peer drains everything it receives
+    fn connected_pair() -> (VmaTcpSocket, thread::JoinHandle<usize>) {
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let port = listener.local_addr().unwrap().port();
+        let drain = thread::spawn(move || {
+            let (mut stream, _) = listener.accept().unwrap();
+            let mut buffer = vec![0u8; 1 << 16];
+            let mut total = 0;
+            while let Ok(n) = stream.read(&mut buffer) {
+                if n == 0 {
+                    break;
+                }
+                total += n;
+            }
+            total
+        });
+
+        let mut socket = VmaTcpSocket::new().unwrap();
+        assert!(socket.connect("127.0.0.1", port, Some(1_000_000_000)).unwrap());
+        (socket, drain)
+    }
+
+    fn send_all(sender: &mut ZeroCopySender<'_>, buffer: &ZeroCopyBuffer) {
+        let mut offset = 0;
+        while offset < (**buffer).as_ref().len() {
+            offset += sender.send(buffer, offset).unwrap();
+            sender.reap(Some(0)).unwrap();
+        }
+    }
+
+    #[test]
+    fn test_zerocopy_sender_recreated() {
+        let (mut socket, drain) = connected_pair();
+        let buffer: ZeroCopyBuffer = Arc::new(vec![0x5au8; 4 * ZEROCOPY_MIN_BYTES]);
+
+        let first_sends = {
+            let mut sender = socket.zerocopy_sender().unwrap();
+            send_all(&mut sender, &buffer);
+            assert!(sender.wait_all(Some(1_000_000_000)).unwrap());
+            sender.stats().zerocopy_sends
+        };
+
+        // Dropped with a send in flight: the sender waits for it
+        {
+            let mut sender = socket.zerocopy_sender().unwrap();
+            send_all(&mut sender, &buffer);
+        }
+        assert_eq!(Arc::strong_count(&buffer), 1);
+
+        // The numbering continues where the earlier senders stopped
+        let mut sender = socket.zerocopy_sender().unwrap();
+        if !sender.is_enabled() {
+            return; // SO_ZEROCOPY refused: every send was copied
+        }
+        assert!(first_sends > 0);
+        let before = sender.stats();
+        send_all(&mut sender, &buffer);
+        assert!(sender.wait_all(Some(1_000_000_000)).unwrap());
+        assert_eq!(sender.in_flight(), 0);
+        assert_eq!(Arc::strong_count(&buffer), 1);
+        let after = sender.stats();
+        assert!(after.zerocopy_sends > before.zerocopy_sends);
+        assert_eq!(after.completions, after.zerocopy_sends);
+        drop(sender);
+
+        drop(socket);
+        assert_eq!(drain.join().unwrap(), 3 * 4 * ZEROCOPY_MIN_BYTES);
+    }
+
+    #[test]
+    fn test_sendv_stall_counts_partial_bytes() {
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let port = listener.local_addr().unwrap().port();
+        let mut socket = VmaTcpSocket::new().unwrap();
+        assert!(socket.connect("127.0.0.1", port, Some(1_000_000_000)).unwrap());
+        let (peer, _) = listener.accept().unwrap(); // never reads
+
+        // Far more than the socket buffers hold: the peer stalls the send partway
+        let data = vec![0u8; 64 << 20];
+        let sent = socket.sendv(&[IoSlice::new(&data)]).unwrap();
+        assert!(sent > 0 && sent < data.len());
+
+        let stats = socket.stats_reader().snapshot();
+        assert_eq!(stats.tx_bytes, sent as u64);
+        assert_eq!(stats.tx_would_block, 1);
+        drop(peer);
+    }
+}
@@ -0,0 +1,397 @@
+//! Per-call hot-path tracing.
+//!
+//! With the `trace` feature the C socket calls (UDP send/receive in all
+//! variants, TCP send/receive) stamp the clock at entry, at the start and end
+//! of the syscall that completed the call (so waiting in `poll()` or
+//! busy-polling shows up between entry and syscall start) and at exit. The
+//! stamps go into a per-thread lock-free ring in the shared memory segment
+//! `/dev/shm/vma_trace.<pid>`, which a [`TraceReader`] in any process can map.
+//!
+//! Recording starts switched off (unless `VMA_TRACE=1` is set when the first
+//! socket is created) and is switched on and off remotely with
+//! [`TraceReader::set_enabled`]; while off, a traced call costs one load and
+//! a predicted branch. Without the feature nothing is compiled in. Time spent
+//! in the Rust wrapper is the difference between your own timing of a call
+//! and the event's [`total_ns`](TraceEvent::total_ns).
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use std::thread;
+//! use std::time::Duration;
+//! use vma_socket::trace::TraceReader;
+//!
+//! let pid = 12345; // traced process
+//! let mut reader = TraceReader::attach(pid).unwrap();
+//! reader.set_enabled(true);
+//!
+//! let mut events = Vec::new();
+//! loop {
+//!     reader.poll(&mut events);
+//!     for event in events.drain(..) {
+//!         println!("{} fd={} wait={}ns syscall={}ns", event.op.name(), event.fd, event.wait_ns, event.syscall_ns);
+//!     }
+//!     thread::sleep(Duration::from_millis(10));
+//! }
+//! ```
+
+use std::ffi::CString;
+use std::io::{Error, ErrorKind};
+use std::mem;
+use std::ptr;
+use std::sync::atomic::{fence, AtomicU32, AtomicU64, Ordering};
+
+/// Segment layout version (matches `VMA_TRACE_VERSION`).
+pub const TRACE_VERSION: u32 = 1;
+const TRACE_MAGIC: u32 = 0x4352_5456;
+
+/// Number of per-thread rings (matches `VMA_TRACE_MAX_THREADS`).
+pub const TRACE_MAX_THREADS: usize = 64;
+
+/// Records per ring (matches `VMA_TRACE_RING_SIZE`).
+pub const TRACE_RING_SIZE: usize = 4096;
+
+#[repr(C)]
+struct TraceHeader {
+    magic: u32,
+    version: u32,
+    pid: u32,
+    enabled: u32,
+    clock_mult: u64,
+    ring_count: u32,
+    ring_size: u32,
+    record_size: u32,
+    unclaimed: u32,
+    _pad: [u8; 24],
+}
+
+/// C representation of one traced call (clock ticks).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct TraceRecord {
+    /// Call entry
+    pub entry: u64,
+    /// Start of the last syscall
+    pub attempt: u64,
+    /// Return of the last syscall
+    pub syscall_end: u64,
+    /// Call exit
+    pub exit: u64,
+    /// Socket descriptor
+    pub fd: i32,
+    /// Operation code
+    pub op: i16,
+    /// Result code
+    pub result: i16,
+    /// Bytes (or datagrams, for batch calls) transferred
+    pub bytes: u32,
+    _reserved: u32,
+}
+
+#[repr(C)]
+struct TraceRing {
+    tid: u32,
+    _generation: u32,
+    head: u64,
+    _pad: [u8; 48],
+    records: [TraceRecord; TRACE_RING_SIZE],
+}
+
+/// Traced operation.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum TraceOp {
+    /// `udp_socket_send`
+    UdpSend,
+    /// `udp_socket_sendto` / `udp_socket_sendto_endpoint`
+    UdpSendTo,
+    /// `udp_socket_send_batch`
+    UdpSendBatch,
+    /// `udp_socket_recv`
+    UdpRecv,
+    /// `udp_socket_recvfrom`
+    UdpRecvFrom,
+    /// `udp_socket_recv_batch` / `udp_socket_recv_batch_pooled`
+    UdpRecvBatch,
+    /// `udp_socket_recv_zcopy`
+    UdpRecvZcopy,
+    /// `tcp_socket_send`
+    TcpSend,
+    /// `tcp_socket_send_to_client`
+    TcpSendClient,
+    /// `tcp_socket_recv`
+    TcpRecv,
+    /// `tcp_socket_recv_from_client`
+    TcpRecvClient,
+    /// `udp_socket_send_segmented`
+    UdpSendSegmented,
+    /// `udp_socket_recv_gro`
+    UdpRecvGro,
+    /// `udp_pacer_flush`
+    UdpPacerFlush,
+    /// `tcp_socket_send_zerocopy`
+    TcpSendZerocopy,
+    /// `tcp_socket_send_zerocopy_to_client`
+    TcpSendZerocopyClient,
+    /// Code written by a newer library
+    Unknown(i16),
+}
+
+impl TraceOp {
+    fn from_raw(op: i16) -> Self {
+        match op {
+            1 => TraceOp::UdpSend,
+            2 => TraceOp::UdpSendTo,
+            3 => TraceOp::UdpSendBatch,
+            4 => TraceOp::UdpRecv,
+            5 => TraceOp::UdpRecvFrom,
+            6 => TraceOp::UdpRecvBatch,
+            7 => TraceOp::UdpRecvZcopy,
+            8 => TraceOp::TcpSend,
+            9 => TraceOp::TcpSendClient,
+            10 => TraceOp::TcpRecv,
+            11 => TraceOp::TcpRecvClient,
+            12 => TraceOp::UdpSendSegmented,
+            13 => TraceOp::UdpRecvGro,
+            14 => TraceOp::UdpPacerFlush,
+            15 => TraceOp::TcpSendZerocopy,
+            16 => TraceOp::TcpSendZerocopyClient,
+            other => TraceOp::Unknown(other),
+        }
+    }
+
+    /// Short name for reports.
+    pub fn name(&self) -> &'static str {
+        match self {
+            TraceOp::UdpSend => "udp_send",
+            TraceOp::UdpSendTo => "udp_sendto",
+            TraceOp::UdpSendBatch => "udp_send_batch",
+            TraceOp::UdpRecv => "udp_recv",
+            TraceOp::UdpRecvFrom => "udp_recvfrom",
+            TraceOp::UdpRecvBatch => "udp_recv_batch",
+            TraceOp::UdpRecvZcopy => "udp_recv_zcopy",
+            TraceOp::TcpSend => "tcp_send",
+            TraceOp::TcpSendClient => "tcp_send_client",
+            TraceOp::TcpRecv => "tcp_recv",
+            TraceOp::TcpRecvClient => "tcp_recv_client",
+            TraceOp::UdpSendSegmented => "udp_send_segmented",
+            TraceOp::UdpRecvGro => "udp_recv_gro",
+            TraceOp::UdpPacerFlush => "udp_pacer_flush",
+            TraceOp::TcpSendZerocopy => "tcp_send_zerocopy",
+            TraceOp::TcpSendZerocopyClient => "tcp_send_zerocopy_client",
+            TraceOp::Unknown(_) => "unknown",
+        }
+    }
+}
+
+/// One traced call with its time split into phases.
+#[derive(Debug, Clone, Copy)]
+pub struct TraceEvent {
+    /// Thread that made the call (kernel thread id)
+    pub tid: u32,
+    /// Operation
+    pub op: TraceOp,
+    /// Socket descriptor
+    pub fd: i32,
+    /// Result code of the call (0 for success, see `UdpResult` / `TcpResult`)
+    pub result: i32,
+    /// Bytes (or datagrams, for batch calls) transferred
+    pub bytes: u32,
+    /// Call entry on the trace clock (nanoseconds, for ordering events)
+    pub entry_ns: u64,
+    /// Entry to the start of the last syscall: waiting and failed polls
+    pub wait_ns: u64,
+    /// The last syscall (VMA or the kernel)
+    pub syscall_ns: u64,
+    /// Last syscall return to exit: timestamps, statistics (and the final wait of a timeout)
+    pub post_ns: u64,
+    /// Entry to exit
+    pub total_ns: u64,
+}
+
+extern "C" {
+    fn vma_trace_compiled() -> bool;
+}
+
+/// Whether this build records traces (the `trace` feature).
+pub fn is_compiled() -> bool {
+    unsafe { vma_trace_compiled() }
+}
+
+/// Read cursor of one ring.
+#[derive(Debug, Clone, Copy, Default)]
+struct Cursor {
+    next: u64,
+}
+
+/// Reader attached to a traced process's segment.
+///
+/// Starts at the events recorded after attaching. Readers only take records;
+/// several can attach to one process, each seeing every event.
+#[derive(Debug)]
+pub struct TraceReader {
+    base: *mut u8,
+    len: usize,
+    clock_mult: u64,
+    cursors: Vec<Cursor>,
+    lost: u64,
+}
+
+// The mapping is only read (and the enabled word written atomically).
+unsafe impl Send for TraceReader {}
+
+impl TraceReader {
+    /// Map the trace segment of process `pid`.
+    pub fn attach(pid: u32) -> Result<Self, Error> {
+        let name = CString::new(format!("/vma_trace.{}", pid)).unwrap();
+        let fd = unsafe { libc::shm_open(name.as_ptr(), libc::O_RDWR, 0) };
+        if fd < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        let len = mem::size_of::<TraceHeader>() + TRACE_MAX_THREADS * mem::size_of::<TraceRing>();
+        let mut stat: libc::stat = unsafe { mem::zeroed() };
+        if unsafe { libc::fstat(fd, &mut stat) } < 0 || (stat.st_size as usize) < len {
+            unsafe { libc::close(fd) };
+            return Err(Error::new(ErrorKind::InvalidData, "trace segment is too small"));
+        }
+
+        let base = unsafe {
+            libc::mmap(ptr::null_mut(), len, libc::PROT_READ | libc::PROT_WRITE, libc::MAP_SHARED, fd, 0)
+        };
+        unsafe { libc::close(fd) };
+        if base == libc::MAP_FAILED {
+            return Err(Error::last_os_error());
+        }
+
+        let mut reader = TraceReader {
+            base: base as *mut u8,
+            len,
+            clock_mult: 0,
+            cursors: vec![Cursor::default(); TRACE_MAX_THREADS],
+            lost: 0,
+        };
+
+        let header = reader.header();
+        let magic = unsafe { &*(ptr::addr_of!(header.magic) as *const AtomicU32) }.load(Ordering::Acquire);
+        if magic != TRACE_MAGIC
+            || header.version != TRACE_VERSION
+            || header.ring_count as usize != TRACE_MAX_THREADS
+            || header.ring_size as usize != TRACE_RING_SIZE
+            || header.record_size as usize != mem::size_of::<TraceRecord>()
+        {
+            return Err(Error::new(ErrorKind::InvalidData, "not a compatible trace segment"));
+        }
+        reader.clock_mult = header.clock_mult;
+
+        for index in 0..TRACE_MAX_THREADS {
+            reader.cursors[index].next = reader.head(index).load(Ordering::Acquire);
+        }
+        Ok(reader)
+    }
+
+    fn header(&self) -> &TraceHeader {
+        unsafe { &*(self.base as *const TraceHeader) }
+    }
+
+    fn enabled_word(&self) -> &AtomicU32 {
+        unsafe { &*(ptr::addr_of!((*(self.base as *const TraceHeader)).enabled) as *const AtomicU32) }
+    }
+
+    fn ring(&self, index: usize) -> *const TraceRing {
+        unsafe { (self.base.add(mem::size_of::<TraceHeader>()) as *const TraceRing).add(index) }
+    }
+
+    fn head(&self, index: usize) -> &AtomicU64 {
+        unsafe { &*(ptr::addr_of!((*self.ring(index)).head) as *const AtomicU64) }
+    }
+
+    fn ticks_to_ns(&self, ticks: u64) -> u64 {
+        ((ticks as u128 * self.clock_mult as u128) >> 32) as u64
+    }
+
+    /// Process the segment belongs to.
+    pub fn pid(&self) -> u32 {
+        self.header().pid
+    }
+
+    /// Whether the traced process is recording.
+    pub fn is_enabled(&self) -> bool {
+        self.enabled_word().load(Ordering::Relaxed) != 0
+    }
+
+    /// Switch recording on or off in the traced process.
+    pub fn set_enabled(&self, enabled: bool) {
+        self.enabled_word().store(enabled as u32, Ordering::Relaxed);
+    }
+
+    /// Threads that made traced calls but found no free ring (their calls are not recorded).
+    pub fn unclaimed_threads(&self) -> u32 {
+        unsafe { &*(ptr::addr_of!((*(self.base as *const TraceHeader)).unclaimed) as *const AtomicU32) }
+            .load(Ordering::Relaxed)
+    }
+
+    /// Events overwritten before this reader got to them.
+    pub fn lost(&self) -> u64 {
+        self.lost
+    }
+
+    /// Append the events recorded since the last call to `out`.
+    ///
+    /// Returns the number of events appended. Poll at least every
+    /// `TRACE_RING_SIZE` calls per thread, or the oldest are counted in
+    /// [`lost`](Self::lost).
+    pub fn poll(&mut self, out: &mut Vec<TraceEvent>) -> usize {
+        let before = out.len();
+        for index in 0..TRACE_MAX_THREADS {
+            let ring = self.ring(index);
+            let head = self.head(index).load(Ordering::Acquire);
+            let cursor = self.cursors[index].next;
+            if head == cursor {
+                continue;
+            }
+
+            let size = TRACE_RING_SIZE as u64;
+            let start = cursor.max(head.saturating_sub(size));
+            let mut copied = Vec::with_capacity((head - start) as usize);
+            for pos in start..head {
+                let record = unsafe { ptr::addr_of!((*ring).records[(pos % size) as usize]) };
+                copied.push(unsafe { ptr::read_volatile(record) });
+            }
+
+            // The writer may have overwritten the oldest slots while they were copied
+            fence(Ordering::Acquire);
+            let now = self.head(index).load(Ordering::Acquire);
+            let intact_from = if now >= size { now - size + 1 } else { 0 };
+            let skip = intact_from.saturating_sub(start).min(copied.len() as u64) as usize;
+            self.lost += (start - cursor) + skip as u64;
+
+            let tid = unsafe { &*(ptr::addr_of!((*ring).tid) as *const AtomicU32) }.load(Ordering::Relaxed);
+            for record in &copied[skip..] {
+                out.push(self.event(tid, record));
+            }
+            self.cursors[index].next = head;
+        }
+        out.len() - before
+    }
+
+    fn event(&self, tid: u32, record: &TraceRecord) -> TraceEvent {
+        TraceEvent {
+            tid,
+            op: TraceOp::from_raw(record.op),
+            fd: record.fd,
+            result: record.result as i32,
+            bytes: record.bytes,
+            entry_ns: self.ticks_to_ns(record.entry),
+            wait_ns: self.ticks_to_ns(record.attempt.saturating_sub(record.entry)),
+            syscall_ns: self.ticks_to_ns(record.syscall_end.saturating_sub(record.attempt)),
+            post_ns: self.ticks_to_ns(record.exit.saturating_sub(record.syscall_end)),
+            total_ns: self.ticks_to_ns(record.exit.saturating_sub(record.entry)),
+        }
+    }
+}
+
+impl Drop for TraceReader {
+    fn drop(&mut self) {
+        unsafe { libc::munmap(self.base as *mut libc::c_void, self.len) };
+    }
+}
@@ -57,7 +57,8 @@
 //! ## Creating a UDP client
 //!
 //! ```rust,no_run
-//! use vma_socket::udp::VmaUdpSocket;
+//! use std::net::Ipv4Addr;
+//! use vma_socket::udp::{UdpEndpoint, VmaUdpSocket};
 //! use vma_socket::common::VmaOptions;
 //!
 //! // Create socket with throughput optimizations
@@ -74,6 +75,10 @@
 //!
 //! // Or send to a specific target without prior connect()
 //! socket.send_to(data, "192.168.1.101", 5002).unwrap();
+//!
+//! // Resolve a hot destination once and reuse it (no parsing, no allocation)
+//! let endpoint = UdpEndpoint::new(Ipv4Addr::new(192, 168, 1, 102), 5003);
+//! socket.send_to_endpoint(data, &endpoint).unwrap();
 //! ```
 //!
 //! ## Performance statistics
@@ -91,10 +96,15 @@
 //! ```
 
 use std::ffi::{c_void, CString};
+use std::marker::PhantomData;
 use std::mem;
-use std::net::SocketAddr;
+use std::net::{Ipv4Addr, SocketAddr, SocketAddrV4};
+use std::os::fd::{AsRawFd, RawFd};
 use std::os::raw::{c_char, c_int, c_ulonglong};
-use crate::common::{SockAddrIn, VmaOptions, unixnano_to_ms, sockaddr_to_rust};
+use std::sync::Arc;
+use crate::buffer_pool::{BufferPool, PooledBuffer};
+use crate::common::{SockAddrIn, VmaOptions, WaitMode, WaitStats, unixnano_to_ms, sockaddr_to_rust, sockaddr_from_rust};
+use crate::stats::{SocketInfo, StatsBlock, StatsReader, StatsValues};
 
 /// C representation of a UDP socket.
 #[repr(C)]
@@ -106,10 +116,32 @@ pub struct UdpSocket {
     pub remote_addr: SockAddrIn,
     pub is_bound: bool,
     pub is_connected: bool,
-    pub rx_packets: c_ulonglong,
-    pub tx_packets: c_ulonglong,
-    pub rx_bytes: c_ulonglong,
-    pub tx_bytes: c_ulonglong,
+    pub stats: *mut StatsBlock,
+    pub owns_stats: bool,
+    pub wait_mode: WaitMode,
+    pub wait_stats: WaitStats,
+    pub rxq_ovfl_enabled: bool,
+    pub rxq_drops: u32,
+    pub zcopy_vma_packets: u64,
+    pub zcopy_os_packets: u64,
+    pub gso_state: c_int,
+    pub gro_enabled: bool,
+}
+
+/// Offload, ring and drop statistics of a UDP socket.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct UdpExtendedStats {
+    /// Offload state, VMA rings, queue occupancy and kernel drops
+    pub info: SocketInfo,
+    /// Drop counting via `SO_RXQ_OVFL` is on
+    pub rxq_ovfl_enabled: bool,
+    /// Cumulative drops when the last received datagram was queued (`SO_RXQ_OVFL`)
+    pub rxq_drops: u32,
+    /// Zero-copy receives served from VMA buffers
+    pub zcopy_vma_packets: u64,
+    /// Zero-copy receives VMA copied from the kernel path
+    pub zcopy_os_packets: u64,
 }
 
 /// C representation of a UDP packet.
@@ -120,6 +152,101 @@ pub struct UdpPacket {
     pub length: usize,
     pub src_addr: SockAddrIn,
     pub timestamp: c_ulonglong,
+    pub timestamp_source: TimestampSource,
+}
+
+/// Clock source of a receive timestamp.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum TimestampSource {
+    /// No timestamp
+    None = 0,
+    /// `CLOCK_REALTIME` read after the receive call returned
+    User = 1,
+    /// Kernel software receive timestamp
+    Kernel = 2,
+    /// NIC hardware receive timestamp
+    Hardware = 3,
+}
+
+/// C representation of a zero-copy UDP packet.
+#[repr(C)]
+#[derive(Debug, Clone)]
+pub struct UdpZcopyPacket {
+    pub packet: UdpPacket,
+    pub packet_id: *mut c_void,
+}
+
+/// Pre-resolved destination endpoint (C `udp_endpoint_t`).
+///
+/// Resolve once and reuse for every send to the same destination; sending to an
+/// endpoint does no address parsing and no allocation.
+#[repr(C)]
+#[derive(Debug, Clone)]
+pub struct UdpEndpoint {
+    addr: SockAddrIn,
+}
+
+impl UdpEndpoint {
+    /// Create an endpoint for the given IPv4 address and port.
+    pub fn new(ip: Ipv4Addr, port: u16) -> Self {
+        UdpEndpoint::from(SocketAddrV4::new(ip, port))
+    }
+
+    /// The destination address of this endpoint.
+    pub fn addr(&self) -> SocketAddr {
+        sockaddr_to_rust(&self.addr)
+    }
+}
+
+impl From<SocketAddrV4> for UdpEndpoint {
+    fn from(addr: SocketAddrV4) -> Self {
+        UdpEndpoint {
+            addr: sockaddr_from_rust(&addr),
+        }
+    }
+}
+
+/// C representation of a batched send entry.
+///
+/// Borrows its payload for `'a`; the destination is resolved once at construction.
+#[repr(C)]
+#[derive(Debug, Clone)]
+pub struct UdpSendMsg<'a> {
+    data: *const c_void,
+    length: usize,
+    dest_addr: SockAddrIn,
+    bytes_sent: usize,
+    _data: PhantomData<&'a [u8]>,
+}
+
+impl<'a> UdpSendMsg<'a> {
+    /// Create a send entry for `data` addressed to `dest`.
+    pub fn new(data: &'a [u8], dest: SocketAddrV4) -> Self {
+        UdpSendMsg {
+            data: data.as_ptr() as *const c_void,
+            length: data.len(),
+            dest_addr: sockaddr_from_rust(&dest),
+            bytes_sent: 0,
+            _data: PhantomData,
+        }
+    }
+
+    /// Create a send entry for `data` addressed to a pre-resolved endpoint.
+    pub fn to_endpoint(data: &'a [u8], endpoint: &UdpEndpoint) -> Self {
+        UdpSendMsg {
+            data: data.as_ptr() as *const c_void,
+            length: data.len(),
+            dest_addr: endpoint.addr.clone(),
+            bytes_sent: 0,
+            _data: PhantomData,
+        }
+    }
+
+    /// Number of bytes sent for this entry by the last batch call.
+    pub fn bytes_sent(&self) -> usize {
+        self.bytes_sent
+    }
 }
 
 /// Result codes returned by the C UDP socket functions.
@@ -137,6 +264,7 @@ pub enum UdpResult {
     UdpErrorInvalidParam = -8,
     UdpErrorNotInitialized = -9,
     UdpErrorClosed = -10,
+    UdpErrorNoBuffers = -11,
 }
 
 use std::io::{Error, ErrorKind};
@@ -154,6 +282,7 @@ impl From<UdpResult> for std::io::Error {
             UdpResult::UdpErrorInvalidParam => Error::new(ErrorKind::InvalidInput, "Invalid parameter"),
             UdpResult::UdpErrorNotInitialized => Error::new(ErrorKind::NotConnected, "Not initialized"),
             UdpResult::UdpErrorClosed => Error::new(ErrorKind::ConnectionAborted, "Socket closed"),
+            UdpResult::UdpErrorNoBuffers => Error::new(ErrorKind::OutOfMemory, "No free receive buffer"),
         }
     }
 }
@@ -165,14 +294,36 @@ extern "C" {
     fn udp_socket_bind(socket: *mut UdpSocket, ip: *const c_char, port: u16) -> c_int;
     fn udp_socket_connect(socket: *mut UdpSocket, ip: *const c_char, port: u16) -> c_int;
     fn udp_socket_send(socket: *mut UdpSocket, data: *const c_void, length: usize, bytes_sent: *mut usize) -> c_int;
-    fn udp_socket_sendto(
+    fn udp_socket_sendto_endpoint(
         socket: *mut UdpSocket,
         data: *const c_void,
         length: usize,
-        ip: *const c_char,
-        port: u16,
+        endpoint: *const UdpEndpoint,
         bytes_sent: *mut usize,
     ) -> c_int;
+    fn udp_socket_send_segmented(
+        socket: *mut UdpSocket,
+        data: *const c_void,
+        length: usize,
+        segment_size: usize,
+        endpoint: *const UdpEndpoint,
+        bytes_sent: *mut usize,
+    ) -> c_int;
+    fn udp_socket_set_gro(socket: *mut UdpSocket, enable: bool) -> c_int;
+    fn udp_socket_recv_gro(
+        socket: *mut UdpSocket,
+        packet: *mut UdpPacket,
+        buffer: *mut c_void,
+        buffer_size: usize,
+        timeout_ms: c_int,
+        segment_size: *mut usize,
+    ) -> c_int;
+    fn udp_socket_send_batch(
+        socket: *mut UdpSocket,
+        msgs: *mut UdpSendMsg,
+        count: usize,
+        sent_count: *mut usize,
+    ) -> c_int;
     fn udp_socket_recv(
         socket: *mut UdpSocket,
         buffer: *mut c_void,
@@ -187,6 +338,33 @@ extern "C" {
         buffer_size: usize,
         timeout_ms: c_int,
     ) -> c_int;
+    fn udp_socket_recv_batch(
+        socket: *mut UdpSocket,
+        pkts: *mut UdpPacket,
+        bufs: *mut c_void,
+        stride: usize,
+        max: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+    fn udp_socket_recv_batch_pooled(
+        socket: *mut UdpSocket,
+        pool: *mut c_void,
+        pkts: *mut UdpPacket,
+        max: usize,
+        timeout_ms: c_int,
+        n: *mut usize,
+    ) -> c_int;
+    fn udp_socket_recv_zcopy(
+        socket: *mut UdpSocket,
+        zpkt: *mut UdpZcopyPacket,
+        buffer: *mut c_void,
+        buffer_size: usize,
+        timeout_ms: c_int,
+    ) -> c_int;
+    fn udp_socket_release_packets(socket: *mut UdpSocket, zpkts: *mut UdpZcopyPacket, count: usize) -> c_int;
+    fn udp_socket_set_stats_block(socket: *mut UdpSocket, stats: *mut StatsBlock) -> c_int;
+    fn udp_socket_get_extended_stats(socket: *mut UdpSocket, stats: *mut UdpExtendedStats) -> c_int;
     fn udp_socket_get_stats(
         socket: *mut UdpSocket,
         rx_packets: *mut c_ulonglong,
@@ -207,6 +385,185 @@ pub struct Packet {
     
     /// Hardware timestamp (if available) in nanoseconds since the epoch.
     pub timestamp: u64,
+    
+    /// Clock that produced `timestamp`.
+    pub timestamp_source: TimestampSource,
+}
+
+/// A received UDP packet whose payload lives in a [`BufferPool`] buffer.
+///
+/// The packet owns its buffer and can be moved to another thread; the buffer
+/// returns to the pool when the packet is dropped.
+#[derive(Debug)]
+pub struct PooledPacket {
+    /// The packet payload data.
+    pub data: PooledBuffer,
+    
+    /// The source address from which the packet was received.
+    pub src_addr: SocketAddr,
+    
+    /// Receive timestamp in nanoseconds since the epoch.
+    pub timestamp: u64,
+    
+    /// Clock that produced `timestamp`.
+    pub timestamp_source: TimestampSource,
+}
+
+/// A datagram received without copying, borrowed from VMA's receive ring.
+///
+/// The payload stays in the VMA-owned buffer until the `PacketRef` is dropped,
+/// at which point the buffer is returned to VMA. The socket cannot be used
+/// while a `PacketRef` is alive.
+#[derive(Debug)]
+pub struct PacketRef<'a> {
+    socket: &'a mut UdpSocketWrapper,
+    packet: UdpZcopyPacket,
+    _buffer: PhantomData<&'a mut [u8]>,
+}
+
+impl<'a> PacketRef<'a> {
+    /// The packet payload data.
+    pub fn data(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.packet.packet.data as *const u8, self.packet.packet.length) }
+    }
+
+    /// The source address from which the packet was received.
+    pub fn src_addr(&self) -> SocketAddr {
+        sockaddr_to_rust(&self.packet.packet.src_addr)
+    }
+
+    /// Receive timestamp in nanoseconds since the epoch.
+    pub fn timestamp(&self) -> u64 {
+        self.packet.packet.timestamp
+    }
+
+    /// Clock that produced the timestamp.
+    pub fn timestamp_source(&self) -> TimestampSource {
+        self.packet.packet.timestamp_source
+    }
+
+    /// Whether the payload lives in a VMA buffer (false if it was copied into the scratch buffer).
+    pub fn is_zero_copy(&self) -> bool {
+        !self.packet.packet_id.is_null()
+    }
+}
+
+impl Drop for PacketRef<'_> {
+    /// Return the VMA buffer when the packet goes out of scope.
+    fn drop(&mut self) {
+        if self.is_zero_copy() {
+            let _ = self.socket.release_packets(std::slice::from_mut(&mut self.packet));
+        }
+    }
+}
+
+/// Maximum number of datagrams received by a single batch call (matches `UDP_MAX_BATCH`).
+pub const UDP_MAX_BATCH: usize = 64;
+
+/// Largest super-buffer sent in one segmentation offload call (matches `UDP_GSO_MAX_BYTES`).
+pub const UDP_GSO_MAX_BYTES: usize = 65000;
+
+/// Receive buffer size that holds any coalesced buffer (matches `UDP_GRO_BUFFER_SIZE`).
+pub const UDP_GRO_BUFFER_SIZE: usize = 65536;
+
+/// Consecutive datagrams from one source returned by [`VmaUdpSocket::recv_gro`].
+#[derive(Clone, Copy, Debug)]
+pub struct GroPacket<'a> {
+    /// The datagrams back to back.
+    pub data: &'a [u8],
+    
+    /// Size of each datagram (the last one may be shorter).
+    pub segment_size: usize,
+    
+    /// The source address from which the datagrams were received.
+    pub src_addr: SocketAddr,
+}
+
+impl<'a> GroPacket<'a> {
+    /// The individual datagrams.
+    pub fn segments(&self) -> std::slice::Chunks<'a, u8> {
+        self.data.chunks(self.segment_size.max(1))
+    }
+}
+
+/// A borrowed view of one datagram inside a [`RecvBatch`].
+#[derive(Clone, Copy, Debug)]
+pub struct PacketView<'a> {
+    /// The packet payload data.
+    pub data: &'a [u8],
+    
+    /// The source address from which the packet was received.
+    pub src_addr: SocketAddr,
+    
+    /// Receive timestamp in nanoseconds since the epoch.
+    pub timestamp: u64,
+    
+    /// Clock that produced `timestamp`.
+    pub timestamp_source: TimestampSource,
+}
+
+/// Reusable storage for batched receives.
+///
+/// Holds `capacity` buffer slots of `stride` bytes each, allocated once and
+/// refilled by every call to [`VmaUdpSocket::recv_batch`].
+#[derive(Debug)]
+pub struct RecvBatch {
+    packets: Vec<UdpPacket>,
+    buffers: Vec<u8>,
+    stride: usize,
+    len: usize,
+}
+
+// The raw pointers in `packets` only ever point into `buffers`, which moves with the batch.
+unsafe impl Send for RecvBatch {}
+
+impl RecvBatch {
+    /// Create a batch with `capacity` slots of `stride` bytes (capacity is capped at `UDP_MAX_BATCH`).
+    pub fn new(capacity: usize, stride: usize) -> Self {
+        let capacity = capacity.clamp(1, UDP_MAX_BATCH);
+        RecvBatch {
+            packets: vec![unsafe { mem::zeroed::<UdpPacket>() }; capacity],
+            buffers: vec![0u8; capacity * stride],
+            stride,
+            len: 0,
+        }
+    }
+
+    /// Maximum number of datagrams this batch can hold.
+    pub fn capacity(&self) -> usize {
+        self.packets.len()
+    }
+
+    /// Number of datagrams received by the last call.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Whether the last call received no datagrams.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Get the datagram at `index`.
+    pub fn get(&self, index: usize) -> Option<PacketView<'_>> {
+        if index >= self.len {
+            return None;
+        }
+        
+        let packet = &self.packets[index];
+        let offset = index * self.stride;
+        Some(PacketView {
+            data: &self.buffers[offset..offset + packet.length],
+            src_addr: sockaddr_to_rust(&packet.src_addr),
+            timestamp: packet.timestamp,
+            timestamp_source: packet.timestamp_source,
+        })
+    }
+
+    /// Iterate over the datagrams received by the last call.
+    pub fn iter(&self) -> impl Iterator<Item = PacketView<'_>> {
+        (0..self.len).filter_map(move |i| self.get(i))
+    }
 }
 
 /// Low-level wrapper around the C UDP socket implementation.
@@ -214,8 +571,12 @@ pub struct Packet {
 #[derive(Debug, Clone)]
 pub struct UdpSocketWrapper {
     socket: UdpSocket,
+    stats: Arc<StatsBlock>,
 }
 
+// The socket is used from one thread at a time; the stats block is shared through `StatsReader`.
+unsafe impl Send for UdpSocketWrapper {}
+
 impl UdpSocketWrapper {
     /// Create a new UDP socket with the specified options.
     pub fn new(options: Option<VmaOptions>) -> Result<Self, UdpResult> {
@@ -226,19 +587,21 @@ impl UdpSocketWrapper {
         let c_options = options.unwrap_or_default();
 
         // Initialize socket with options
-        let result = unsafe { 
-            // Print for debugging
-            println!("Initializing UDP socket with options: use_socketxtreme={}, optimize_for_latency={}, ring_count={}",
-                c_options.use_socketxtreme, c_options.optimize_for_latency, c_options.ring_count);
-            udp_socket_init(&mut socket, &c_options)
-        };
+        let result = unsafe { udp_socket_init(&mut socket, &c_options) };
         
         if result != UdpResult::UdpSuccess as i32 {
-            println!("UDP socket initialization failed with code: {}", result);
             return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
         }
         
-        Ok(UdpSocketWrapper { socket })
+        // Move the counters into a block readers on other threads can hold on to
+        let stats = StatsBlock::new();
+        let result = unsafe { udp_socket_set_stats_block(&mut socket, stats.as_ptr()) };
+        if result != UdpResult::UdpSuccess as i32 {
+            unsafe { udp_socket_close(&mut socket) };
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(UdpSocketWrapper { socket, stats })
     }
 
     /// Bind the socket to a local address and port.
@@ -286,16 +649,20 @@ impl UdpSocketWrapper {
 
     /// Send data to a specified address and port.
     pub fn send_to<A: Into<String>>(&mut self, data: &[u8], addr: A, port: u16) -> Result<usize, UdpResult> {
-        let c_addr = CString::new(addr.into()).unwrap();
+        let ip: Ipv4Addr = addr.into().parse().map_err(|_| UdpResult::UdpErrorInvalidParam)?;
+        self.send_to_endpoint(data, &UdpEndpoint::new(ip, port))
+    }
+
+    /// Send data to a pre-resolved endpoint.
+    pub fn send_to_endpoint(&mut self, data: &[u8], endpoint: &UdpEndpoint) -> Result<usize, UdpResult> {
         let mut bytes_sent: usize = 0;
         
         let result = unsafe {
-            udp_socket_sendto(
+            udp_socket_sendto_endpoint(
                 &mut self.socket,
                 data.as_ptr() as *const c_void,
                 data.len(),
-                c_addr.as_ptr(),
-                port,
+                endpoint,
                 &mut bytes_sent,
             )
         };
@@ -307,6 +674,28 @@ impl UdpSocketWrapper {
         Ok(bytes_sent)
     }
 
+    /// Send a batch of datagrams, each to its own destination.
+    ///
+    /// Returns the number of datagrams sent; per-entry byte counts are stored in `msgs`.
+    pub fn send_batch(&mut self, msgs: &mut [UdpSendMsg]) -> Result<usize, UdpResult> {
+        let mut sent_count: usize = 0;
+        
+        let result = unsafe {
+            udp_socket_send_batch(
+                &mut self.socket,
+                msgs.as_mut_ptr(),
+                msgs.len(),
+                &mut sent_count,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(sent_count)
+    }
+
     /// Receive data from the connected remote address.
     pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, UdpResult> {
         let mut bytes_received: usize = 0;
@@ -358,9 +747,239 @@ impl UdpSocketWrapper {
             data,
             src_addr,
             timestamp: packet.timestamp,
+            timestamp_source: packet.timestamp_source,
         })
     }
 
+    /// Receive a datagram into `buffer`, returning its length and source address.
+    pub fn recv_from_into(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<(usize, SocketAddr), UdpResult> {
+        let mut packet = unsafe { mem::zeroed::<UdpPacket>() };
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recvfrom(
+                &mut self.socket,
+                &mut packet,
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                timeout_ms,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok((packet.length, sockaddr_to_rust(&packet.src_addr)))
+    }
+
+    /// Send `data` as consecutive datagrams of `segment_size` bytes, to `endpoint`
+    /// or the connected address.
+    ///
+    /// Uses segmentation offload (`UDP_SEGMENT`) on the kernel path and
+    /// `sendmmsg` when VMA offloads the socket. Returns the bytes sent.
+    pub fn send_segmented(&mut self, data: &[u8], segment_size: usize, endpoint: Option<&UdpEndpoint>) -> Result<usize, UdpResult> {
+        let mut bytes_sent: usize = 0;
+        
+        let result = unsafe {
+            udp_socket_send_segmented(
+                &mut self.socket,
+                data.as_ptr() as *const c_void,
+                data.len(),
+                segment_size,
+                endpoint.map_or(std::ptr::null(), |e| e as *const UdpEndpoint),
+                &mut bytes_sent,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(bytes_sent)
+    }
+
+    /// Turn coalesced receives (`UDP_GRO`) on or off.
+    ///
+    /// Returns whether the kernel coalesces; without it `recv_gro` returns one
+    /// datagram at a time.
+    pub fn set_gro(&mut self, enable: bool) -> Result<bool, UdpResult> {
+        let result = unsafe { udp_socket_set_gro(&mut self.socket, enable) };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(self.socket.gro_enabled)
+    }
+
+    /// Receive coalesced datagrams into `buffer`.
+    ///
+    /// Returns the total length, the datagram size and the source address.
+    pub fn recv_gro(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<(usize, usize, SocketAddr), UdpResult> {
+        let mut packet = unsafe { mem::zeroed::<UdpPacket>() };
+        let mut segment_size: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recv_gro(
+                &mut self.socket,
+                &mut packet,
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                timeout_ms,
+                &mut segment_size,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok((packet.length, segment_size, sockaddr_to_rust(&packet.src_addr)))
+    }
+
+    /// Receive up to `packets.len()` datagrams into `buffers`, one `stride`-sized slot each.
+    pub fn recv_batch(
+        &mut self,
+        packets: &mut [UdpPacket],
+        buffers: &mut [u8],
+        stride: usize,
+        timeout_nano: Option<u64>,
+    ) -> Result<usize, UdpResult> {
+        if stride == 0 || buffers.len() < packets.len() * stride {
+            return Err(UdpResult::UdpErrorInvalidParam);
+        }
+        
+        let mut received: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recv_batch(
+                &mut self.socket,
+                packets.as_mut_ptr(),
+                buffers.as_mut_ptr() as *mut c_void,
+                stride,
+                packets.len(),
+                timeout_ms,
+                &mut received,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(received)
+    }
+
+    /// Receive a datagram into a buffer taken from `pool`.
+    pub fn recv_from_pooled(&mut self, pool: &BufferPool, timeout_nano: Option<u64>) -> Result<PooledPacket, UdpResult> {
+        let mut buffer = pool.alloc().ok_or(UdpResult::UdpErrorNoBuffers)?;
+        let mut packet = unsafe { mem::zeroed::<UdpPacket>() };
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recvfrom(
+                &mut self.socket,
+                &mut packet,
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                timeout_ms,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        buffer.set_len(packet.length);
+        Ok(PooledPacket {
+            data: buffer,
+            src_addr: sockaddr_to_rust(&packet.src_addr),
+            timestamp: packet.timestamp,
+            timestamp_source: packet.timestamp_source,
+        })
+    }
+
+    /// Receive up to `max` datagrams into buffers taken from `pool`, appending them to `packets`.
+    pub fn recv_batch_pooled(
+        &mut self,
+        pool: &BufferPool,
+        packets: &mut Vec<PooledPacket>,
+        max: usize,
+        timeout_nano: Option<u64>,
+    ) -> Result<usize, UdpResult> {
+        let mut raw: [UdpPacket; UDP_MAX_BATCH] = unsafe { mem::zeroed() };
+        let mut received: usize = 0;
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recv_batch_pooled(
+                &mut self.socket,
+                pool.as_raw(),
+                raw.as_mut_ptr(),
+                max.min(UDP_MAX_BATCH),
+                timeout_ms,
+                &mut received,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        // The C side handed us ownership of the first `received` buffers
+        packets.reserve(received);
+        for packet in &raw[..received] {
+            packets.push(PooledPacket {
+                data: unsafe { pool.from_raw(packet.data, packet.length) },
+                src_addr: sockaddr_to_rust(&packet.src_addr),
+                timestamp: packet.timestamp,
+                timestamp_source: packet.timestamp_source,
+            });
+        }
+        
+        Ok(received)
+    }
+
+    /// Receive a datagram zero-copy; `buffer` holds the VMA descriptor or the copied data.
+    pub fn recv_zcopy(
+        &mut self,
+        zpkt: &mut UdpZcopyPacket,
+        buffer: &mut [u8],
+        timeout_nano: Option<u64>,
+    ) -> Result<(), UdpResult> {
+        let timeout_ms = unixnano_to_ms(timeout_nano);
+        
+        let result = unsafe {
+            udp_socket_recv_zcopy(
+                &mut self.socket,
+                zpkt,
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                timeout_ms,
+            )
+        };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(())
+    }
+
+    /// Return zero-copy packets to VMA.
+    pub fn release_packets(&mut self, zpkts: &mut [UdpZcopyPacket]) -> Result<(), UdpResult> {
+        let result = unsafe { udp_socket_release_packets(&mut self.socket, zpkts.as_mut_ptr(), zpkts.len()) };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(())
+    }
+
     /// Get socket statistics.
     pub fn get_stats(&mut self) -> Result<(u64, u64, u64, u64), UdpResult> {
         let mut rx_packets: c_ulonglong = 0;
@@ -384,6 +1003,42 @@ impl UdpSocketWrapper {
         
         Ok((rx_packets, tx_packets, rx_bytes, tx_bytes))
     }
+    
+    /// Get receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.socket.wait_stats
+    }
+    
+    /// Take a consistent snapshot of all counters and latency histograms.
+    pub fn stats_snapshot(&self) -> StatsValues {
+        self.stats.snapshot()
+    }
+    
+    /// Get offload, ring and drop statistics.
+    ///
+    /// The first call turns on `SO_RXQ_OVFL`; from then on `recv_from` and the
+    /// batch receives pick up the drop count reported with each datagram.
+    pub fn extended_stats(&mut self) -> Result<UdpExtendedStats, UdpResult> {
+        let mut stats = UdpExtendedStats::default();
+        let result = unsafe { udp_socket_get_extended_stats(&mut self.socket, &mut stats) };
+        
+        if result != UdpResult::UdpSuccess as i32 {
+            return Err(unsafe { mem::transmute::<i32, UdpResult>(result) });
+        }
+        
+        Ok(stats)
+    }
+    
+    /// Handle for reading the statistics from another thread.
+    pub fn stats_reader(&self) -> StatsReader {
+        StatsReader::new(Arc::clone(&self.stats))
+    }
+}
+
+impl AsRawFd for UdpSocketWrapper {
+    fn as_raw_fd(&self) -> RawFd {
+        self.socket.socket_fd
+    }
 }
 
 impl Drop for UdpSocketWrapper {
@@ -398,6 +1053,13 @@ impl Drop for UdpSocketWrapper {
 pub struct VmaUdpSocket {
     inner: UdpSocketWrapper,
 }
+
+impl AsRawFd for VmaUdpSocket {
+    fn as_raw_fd(&self) -> RawFd {
+        self.inner.as_raw_fd()
+    }
+}
+
 impl VmaUdpSocket {
     /// Create a new UDP socket with default VMA options.
     pub fn new() -> Result<Self, std::io::Error> {
@@ -441,6 +1103,78 @@ impl VmaUdpSocket {
             .map_err(|e| e.into())
     }
 
+    /// Send data to an IPv4 socket address without parsing or allocating.
+    pub fn send_to_addr(&mut self, data: &[u8], addr: SocketAddrV4) -> Result<usize, std::io::Error> {
+        self.inner
+            .send_to_endpoint(data, &UdpEndpoint::from(addr))
+            .map_err(|e| e.into())
+    }
+
+    /// Send data to a pre-resolved endpoint.
+    pub fn send_to_endpoint(&mut self, data: &[u8], endpoint: &UdpEndpoint) -> Result<usize, std::io::Error> {
+        self.inner
+            .send_to_endpoint(data, endpoint)
+            .map_err(|e| e.into())
+    }
+
+    /// Send a batch of datagrams, each to its own destination.
+    pub fn send_batch(&mut self, msgs: &mut [UdpSendMsg]) -> Result<usize, std::io::Error> {
+        self.inner
+            .send_batch(msgs)
+            .map_err(|e| e.into())
+    }
+
+    /// Send `data` as consecutive datagrams of `segment_size` bytes, to `endpoint`
+    /// or the connected address.
+    ///
+    /// One segmentation offload call per 64KB on the kernel path, `sendmmsg`
+    /// when VMA offloads the socket; the receiver sees the same datagrams.
+    /// Returns the bytes sent, fewer than `data.len()` if the socket buffer filled up.
+    /// Segment sizes the kernel rejects fail with `InvalidInput`.
+    pub fn send_segmented(&mut self, data: &[u8], segment_size: usize, endpoint: Option<&UdpEndpoint>) -> Result<usize, std::io::Error> {
+        self.inner
+            .send_segmented(data, segment_size, endpoint)
+            .map_err(|e| e.into())
+    }
+
+    /// Turn coalesced receives on or off; returns whether the kernel coalesces.
+    pub fn set_gro(&mut self, enable: bool) -> Result<bool, std::io::Error> {
+        self.inner
+            .set_gro(enable)
+            .map_err(|e| e.into())
+    }
+
+    /// Receive datagrams the kernel coalesced from one source (a single
+    /// datagram on paths without GRO).
+    ///
+    /// `buffer` should hold [`UDP_GRO_BUFFER_SIZE`] bytes.
+    ///
+    /// ```rust,no_run
+    /// use vma_socket::udp::{VmaUdpSocket, UDP_GRO_BUFFER_SIZE};
+    ///
+    /// let mut socket = VmaUdpSocket::new().unwrap();
+    /// socket.bind("0.0.0.0", 5001).unwrap();
+    /// socket.set_gro(true).unwrap();
+    ///
+    /// let mut buffer = vec![0u8; UDP_GRO_BUFFER_SIZE];
+    /// if let Some(packet) = socket.recv_gro(&mut buffer, Some(1_000_000)).unwrap() {
+    ///     for datagram in packet.segments() {
+    ///         println!("{} bytes", datagram.len());
+    ///     }
+    /// }
+    /// ```
+    pub fn recv_gro<'a>(&mut self, buffer: &'a mut [u8], timeout_nano: Option<u64>) -> Result<Option<GroPacket<'a>>, std::io::Error> {
+        match self.inner.recv_gro(buffer, timeout_nano) {
+            Ok((length, segment_size, src_addr)) => Ok(Some(GroPacket {
+                data: &buffer[..length],
+                segment_size,
+                src_addr,
+            })),
+            Err(UdpResult::UdpErrorTimeout) => Ok(None), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
     /// Receive data from the connected remote address.
     pub fn recv(&mut self, buffer: &mut [u8], timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
         match self.inner.recv(buffer, timeout_nano) {
@@ -459,10 +1193,106 @@ impl VmaUdpSocket {
         }
     }
 
+    /// Receive a datagram without copying it out of VMA's receive ring.
+    ///
+    /// `buffer` is scratch space for VMA's packet descriptor, and receives the
+    /// payload when zero-copy delivery is not possible (e.g. a non-offloaded socket).
+    /// Packets carry user timestamps only (`TimestampSource::User`), even with
+    /// receive timestamping enabled.
+    pub fn recv_zcopy<'a>(&'a mut self, buffer: &'a mut [u8], timeout_nano: Option<u64>) -> Result<Option<PacketRef<'a>>, std::io::Error> {
+        let mut packet = unsafe { mem::zeroed::<UdpZcopyPacket>() };
+        match self.inner.recv_zcopy(&mut packet, buffer, timeout_nano) {
+            Ok(()) => Ok(Some(PacketRef {
+                socket: &mut self.inner,
+                packet,
+                _buffer: PhantomData,
+            })),
+            Err(UdpResult::UdpErrorTimeout) => Ok(None), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Receive a batch of datagrams into the buffers owned by `batch`.
+    ///
+    /// Returns the number of datagrams received (0 on timeout).
+    pub fn recv_batch(&mut self, batch: &mut RecvBatch, timeout_nano: Option<u64>) -> Result<usize, std::io::Error> {
+        batch.len = 0;
+        match self.inner.recv_batch(&mut batch.packets, &mut batch.buffers, batch.stride, timeout_nano) {
+            Ok(count) => {
+                batch.len = count;
+                Ok(count)
+            },
+            Err(UdpResult::UdpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Receive a datagram into a buffer taken from `pool`.
+    ///
+    /// Returns `None` on timeout and an `OutOfMemory` error if every pool
+    /// buffer is in use.
+    pub fn recv_from_pooled(&mut self, pool: &BufferPool, timeout_nano: Option<u64>) -> Result<Option<PooledPacket>, std::io::Error> {
+        match self.inner.recv_from_pooled(pool, timeout_nano) {
+            Ok(packet) => Ok(Some(packet)),
+            Err(UdpResult::UdpErrorTimeout) => Ok(None), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Receive up to `max` datagrams into pool buffers, appending them to `packets`.
+    ///
+    /// Each packet owns its buffer and can be handed to another thread. Returns
+    /// the number of datagrams received (0 on timeout).
+    pub fn recv_batch_pooled(
+        &mut self,
+        pool: &BufferPool,
+        packets: &mut Vec<PooledPacket>,
+        max: usize,
+        timeout_nano: Option<u64>,
+    ) -> Result<usize, std::io::Error> {
+        match self.inner.recv_batch_pooled(pool, packets, max, timeout_nano) {
+            Ok(count) => Ok(count),
+            Err(UdpResult::UdpErrorTimeout) => Ok(0), // timeout is not an error
+            Err(e) => Err(e.into()),
+        }
+    }
+
     /// Get socket statistics.
     pub fn get_stats(&mut self) -> Result<(u64, u64, u64, u64), std::io::Error> {
         self.inner
             .get_stats()
             .map_err(|e| e.into())
     }
+    
+    /// Get receive wait counters (spin hits vs. blocking wakeups).
+    pub fn get_wait_stats(&self) -> WaitStats {
+        self.inner.get_wait_stats()
+    }
+    
+    /// Take a consistent snapshot of all counters and latency histograms.
+    pub fn stats_snapshot(&self) -> StatsValues {
+        self.inner.stats_snapshot()
+    }
+    
+    /// Get offload, ring and drop statistics (enables `SO_RXQ_OVFL` on first use).
+    pub fn extended_stats(&mut self) -> Result<UdpExtendedStats, std::io::Error> {
+        self.inner
+            .extended_stats()
+            .map_err(|e| e.into())
+    }
+    
+    /// Handle for reading the statistics from another thread.
+    pub fn stats_reader(&self) -> StatsReader {
+        self.inner.stats_reader()
+    }
+    
+    /// Mutable C socket structure (for modules that receive on its behalf).
+    pub(crate) fn raw_mut(&mut self) -> &mut UdpSocket {
+        &mut self.inner.socket
+    }
+    
+    /// Low-level wrapper with the raw result codes (for the async adapters).
+    pub(crate) fn wrapper_mut(&mut self) -> &mut UdpSocketWrapper {
+        &mut self.inner
+    }
 }
@@ -0,0 +1,406 @@
+//! SocketXtreme completion engine for servicing many VMA sockets from one thread.
+//!
+//! With `VmaOptions::use_socketxtreme` enabled, VMA exposes the completion queues of
+//! its rings directly. [`XtremeEngine`] collects the rings of every registered UDP and
+//! TCP socket and drains them with `socketxtreme_poll`, so a single pinned thread can
+//! service hundreds of sockets without any system calls.
+//!
+//! Sockets must own their VMA rings before they are registered: bind UDP sockets, and
+//! register TCP sockets after `listen()` or `connect()`. Connections accepted on a
+//! registered listener are registered automatically.
+//!
+//! # Example
+//!
+//! ```rust,no_run
+//! use vma_socket::udp::VmaUdpSocket;
+//! use vma_socket::common::VmaOptions;
+//! use vma_socket::xtreme::{XtremeEngine, XtremeEventType};
+//!
+//! let mut feeds = Vec::new();
+//! for port in 5001..5101 {
+//!     let mut socket = VmaUdpSocket::with_options(VmaOptions::low_latency()).unwrap();
+//!     socket.bind("0.0.0.0", port).unwrap();
+//!     feeds.push(socket);
+//! }
+//!
+//! let mut engine = XtremeEngine::new().unwrap();
+//! for (index, socket) in feeds.iter().enumerate() {
+//!     engine.add_udp(socket, index as u64).unwrap();
+//! }
+//!
+//! loop {
+//!     engine.dispatch(|event| {
+//!         if event.kind == XtremeEventType::Packet {
+//!             println!("feed {}: {} bytes", event.user_data, event.total_length());
+//!         }
+//!     }).unwrap();
+//! }
+//! ```
+
+use std::ffi::c_void;
+use std::mem;
+use std::net::SocketAddr;
+use std::os::fd::{AsRawFd, RawFd};
+use std::os::raw::c_int;
+use std::panic::{self, AssertUnwindSafe};
+use crate::common::{SockAddrIn, sockaddr_to_rust};
+use crate::tcp::VmaTcpSocket;
+use crate::udp::VmaUdpSocket;
+
+/// Maximum number of sockets registered with one engine (matches `VMA_XTREME_MAX_SOCKETS`).
+pub const XTREME_MAX_SOCKETS: usize = 1024;
+
+/// Maximum number of distinct rings driven by one engine (matches `VMA_XTREME_MAX_RINGS`).
+pub const XTREME_MAX_RINGS: usize = 64;
+
+/// Most events one completion produces (matches `VMA_XTREME_EVENTS_PER_COMPLETION`);
+/// the smallest array [`XtremeEngine::poll`] accepts.
+pub const XTREME_EVENTS_PER_COMPLETION: usize = 3;
+
+/// Completion event types.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum XtremeEventType {
+    /// Data received on a registered socket
+    Packet = 1,
+    /// New connection accepted on a registered listener
+    Accepted = 2,
+    /// Peer closed the connection
+    Closed = 3,
+    /// Socket error
+    Error = 4,
+}
+
+/// C representation of a completion event.
+///
+/// Not `Clone`: a packet event owns its VMA buffers until released, and a
+/// copy would let them be released twice.
+#[repr(C)]
+#[derive(Debug)]
+pub struct XtremeEvent {
+    /// Event type
+    pub kind: XtremeEventType,
+    /// Socket the event belongs to (the new connection for `Accepted`)
+    pub fd: c_int,
+    /// Listening socket (`Accepted` only, -1 otherwise)
+    pub listen_fd: c_int,
+    /// Value given at registration (the listener's for `Accepted`)
+    pub user_data: u64,
+    data: *const c_void,
+    length: usize,
+    total_length: usize,
+    num_bufs: usize,
+    src_addr: SockAddrIn,
+    /// Hardware receive timestamp in nanoseconds (0 if unavailable)
+    pub hw_timestamp: u64,
+    vma_buffers: *mut c_void,
+}
+
+impl XtremeEvent {
+    fn empty() -> Self {
+        XtremeEvent {
+            kind: XtremeEventType::Packet,
+            fd: -1,
+            listen_fd: -1,
+            user_data: 0,
+            data: std::ptr::null(),
+            length: 0,
+            total_length: 0,
+            num_bufs: 0,
+            src_addr: unsafe { mem::zeroed::<SockAddrIn>() },
+            hw_timestamp: 0,
+            vma_buffers: std::ptr::null_mut(),
+        }
+    }
+
+    /// First receive buffer of a `Packet` event (VMA-owned until released).
+    pub fn data(&self) -> &[u8] {
+        if self.data.is_null() {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.data as *const u8, self.length) }
+    }
+
+    /// Total packet length across all chained buffers.
+    pub fn total_length(&self) -> usize {
+        self.total_length
+    }
+
+    /// Source address (UDP packets) or peer address (accepted connections).
+    pub fn src_addr(&self) -> SocketAddr {
+        sockaddr_to_rust(&self.src_addr)
+    }
+
+    /// Copy the full payload (all chained buffers) into `buffer`, returns the bytes copied.
+    pub fn copy_to(&self, buffer: &mut [u8]) -> usize {
+        unsafe { vma_xtreme_event_copy(self, buffer.as_mut_ptr() as *mut c_void, buffer.len()) }
+    }
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+struct XtremeEntry {
+    fd: c_int,
+    user_data: u64,
+}
+
+/// C representation of the engine structure.
+#[repr(C)]
+struct VmaXtremeEngine {
+    api: *mut c_void,
+    ring_fds: [c_int; XTREME_MAX_RINGS],
+    ring_count: c_int,
+    entries: [XtremeEntry; XTREME_MAX_SOCKETS],
+    socket_count: c_int,
+    events_polled: u64,
+}
+
+/// Result codes returned by the C engine functions.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum XtremeResult {
+    XtremeSuccess = 0,
+    XtremeErrorNotAvailable = -1,
+    XtremeErrorInvalidParam = -2,
+    XtremeErrorFull = -3,
+    XtremeErrorNotFound = -4,
+    XtremeErrorPoll = -5,
+    XtremeErrorNoRings = -6,
+}
+
+use std::io::{Error, ErrorKind};
+impl From<XtremeResult> for std::io::Error {
+    fn from(result: XtremeResult) -> Self {
+        match result {
+            XtremeResult::XtremeSuccess => Error::new(ErrorKind::Other, "Unexpected success"),
+            XtremeResult::XtremeErrorNotAvailable => Error::new(ErrorKind::Unsupported, "SocketXtreme not available"),
+            XtremeResult::XtremeErrorInvalidParam => Error::new(ErrorKind::InvalidInput, "Invalid parameter"),
+            XtremeResult::XtremeErrorFull => Error::new(ErrorKind::OutOfMemory, "Engine is full"),
+            XtremeResult::XtremeErrorNotFound => Error::new(ErrorKind::NotFound, "Socket not registered"),
+            XtremeResult::XtremeErrorPoll => Error::new(ErrorKind::Other, "SocketXtreme poll failed"),
+            XtremeResult::XtremeErrorNoRings => Error::new(ErrorKind::NotConnected, "Socket has no VMA ring"),
+        }
+    }
+}
+
+type XtremeCallback = unsafe extern "C" fn(event: *const XtremeEvent, context: *mut c_void);
+
+extern "C" {
+    fn vma_xtreme_engine_init(engine: *mut VmaXtremeEngine) -> c_int;
+    fn vma_xtreme_engine_close(engine: *mut VmaXtremeEngine) -> c_int;
+    fn vma_xtreme_engine_add_fd(engine: *mut VmaXtremeEngine, fd: c_int, user_data: u64) -> c_int;
+    fn vma_xtreme_engine_remove_fd(engine: *mut VmaXtremeEngine, fd: c_int) -> c_int;
+    fn vma_xtreme_engine_poll(
+        engine: *mut VmaXtremeEngine,
+        events: *mut XtremeEvent,
+        max_events: usize,
+        n: *mut usize,
+    ) -> c_int;
+    fn vma_xtreme_engine_dispatch(
+        engine: *mut VmaXtremeEngine,
+        callback: XtremeCallback,
+        context: *mut c_void,
+        n: *mut usize,
+    ) -> c_int;
+    fn vma_xtreme_engine_release(engine: *mut VmaXtremeEngine, events: *mut XtremeEvent, count: usize) -> c_int;
+    fn vma_xtreme_event_copy(event: *const XtremeEvent, buffer: *mut c_void, buffer_size: usize) -> usize;
+    #[cfg(test)]
+    fn vma_xtreme_engine_translate(
+        engine: *mut VmaXtremeEngine,
+        completion: *const test::Completion,
+        out: *mut XtremeEvent,
+    ) -> usize;
+}
+
+fn check(result: c_int) -> Result<(), XtremeResult> {
+    if result != XtremeResult::XtremeSuccess as i32 {
+        return Err(unsafe { mem::transmute::<i32, XtremeResult>(result) });
+    }
+    Ok(())
+}
+
+unsafe extern "C" fn dispatch_trampoline<F: FnMut(&XtremeEvent)>(event: *const XtremeEvent, context: *mut c_void) {
+    let callback = &mut *(context as *mut F);
+
+    // A panic must not unwind into the C dispatch loop
+    let _ = panic::catch_unwind(AssertUnwindSafe(|| callback(&*event)));
+}
+
+/// SocketXtreme completion engine.
+pub struct XtremeEngine {
+    engine: Box<VmaXtremeEngine>,
+}
+
+// The engine only refers to VMA-global state and socket fds.
+unsafe impl Send for XtremeEngine {}
+
+impl XtremeEngine {
+    /// Create an engine (fails if VMA is not loaded or SocketXtreme is unsupported).
+    pub fn new() -> Result<Self, std::io::Error> {
+        let mut engine: Box<VmaXtremeEngine> = Box::new(unsafe { mem::zeroed() });
+        check(unsafe { vma_xtreme_engine_init(&mut *engine) })?;
+        Ok(XtremeEngine { engine })
+    }
+
+    /// Register a socket by file descriptor.
+    pub fn add_fd(&mut self, fd: RawFd, user_data: u64) -> Result<(), std::io::Error> {
+        check(unsafe { vma_xtreme_engine_add_fd(&mut *self.engine, fd, user_data) })
+            .map_err(|e| e.into())
+    }
+
+    /// Register a bound UDP socket.
+    pub fn add_udp(&mut self, socket: &VmaUdpSocket, user_data: u64) -> Result<(), std::io::Error> {
+        self.add_fd(socket.as_raw_fd(), user_data)
+    }
+
+    /// Register a listening or connected TCP socket.
+    pub fn add_tcp(&mut self, socket: &VmaTcpSocket, user_data: u64) -> Result<(), std::io::Error> {
+        self.add_fd(socket.as_raw_fd(), user_data)
+    }
+
+    /// Unregister a socket.
+    pub fn remove_fd(&mut self, fd: RawFd) -> Result<(), std::io::Error> {
+        check(unsafe { vma_xtreme_engine_remove_fd(&mut *self.engine, fd) })
+            .map_err(|e| e.into())
+    }
+
+    /// Number of registered sockets.
+    pub fn socket_count(&self) -> usize {
+        self.engine.socket_count as usize
+    }
+
+    /// Number of distinct rings being polled.
+    pub fn ring_count(&self) -> usize {
+        self.engine.ring_count as usize
+    }
+
+    /// Poll all rings once and deliver every event to `callback`.
+    ///
+    /// Packet buffers are returned to VMA after the callback returns. A panic
+    /// in `callback` is caught at the C boundary and the next event delivered.
+    pub fn dispatch<F: FnMut(&XtremeEvent)>(&mut self, mut callback: F) -> Result<usize, std::io::Error> {
+        let mut delivered: usize = 0;
+        let result = unsafe {
+            vma_xtreme_engine_dispatch(
+                &mut *self.engine,
+                dispatch_trampoline::<F>,
+                &mut callback as *mut F as *mut c_void,
+                &mut delivered,
+            )
+        };
+        check(result)?;
+        Ok(delivered)
+    }
+
+    /// Poll all rings once and store events in `events`.
+    ///
+    /// Packet events keep their VMA buffers until passed to [`XtremeEngine::release`].
+    pub fn poll(&mut self, events: &mut [XtremeEvent]) -> Result<usize, std::io::Error> {
+        let mut stored: usize = 0;
+        let result = unsafe {
+            vma_xtreme_engine_poll(&mut *self.engine, events.as_mut_ptr(), events.len(), &mut stored)
+        };
+        check(result)?;
+        Ok(stored)
+    }
+
+    /// Return the VMA buffers referenced by polled events.
+    pub fn release(&mut self, events: &mut [XtremeEvent]) -> Result<(), std::io::Error> {
+        check(unsafe { vma_xtreme_engine_release(&mut *self.engine, events.as_mut_ptr(), events.len()) })
+            .map_err(|e| e.into())
+    }
+
+    /// Allocate an event array suitable for [`XtremeEngine::poll`].
+    pub fn event_buffer(capacity: usize) -> Vec<XtremeEvent> {
+        (0..capacity.max(XTREME_EVENTS_PER_COMPLETION)).map(|_| XtremeEvent::empty()).collect()
+    }
+}
+
+impl Drop for XtremeEngine {
+    fn drop(&mut self) {
+        unsafe {
+            vma_xtreme_engine_close(&mut *self.engine);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    // Mirrors of the SocketXtreme completion types (mellanox/vma_extra.h)
+    #[repr(C)]
+    struct VmaBuff {
+        next: *mut VmaBuff,
+        payload: *mut c_void,
+        len: u16,
+    }
+
+    #[repr(C)]
+    struct PacketDesc {
+        num_bufs: usize,
+        total_len: u16,
+        buff_lst: *mut VmaBuff,
+        hw_timestamp: libc::timespec,
+    }
+
+    #[repr(C)]
+    pub(super) struct Completion {
+        packet: PacketDesc,
+        events: u64,
+        user_data: u64,
+        src: SockAddrIn,
+        listen_fd: c_int,
+    }
+
+    const SOCKETXTREME_PACKET: u64 = 1 << 32;
+    const SOCKETXTREME_NEW_CONNECTION_ACCEPTED: u64 = 1 << 33;
+
+    // Register an fd the way insert_entry does, without the VMA API
+    fn register(engine: &mut VmaXtremeEngine, fd: c_int, user_data: u64) {
+        let slot = ((fd as u32).wrapping_mul(2654435761) as usize) & (XTREME_MAX_SOCKETS - 1);
+        engine.entries[slot] = XtremeEntry { fd, user_data };
+        engine.socket_count += 1;
+    }
+
+    #[test]
+    fn test_completion_with_every_event() {
+        let mut engine: Box<VmaXtremeEngine> = Box::new(unsafe { mem::zeroed() });
+        unsafe { vma_xtreme_engine_init(&mut *engine) }; // NotAvailable without VMA; the tables are set up
+        register(&mut engine, 40, 7);
+
+        let mut payload = *b"hello";
+        let mut buff = VmaBuff { next: std::ptr::null_mut(), payload: payload.as_mut_ptr() as *mut c_void, len: 5 };
+        let mut completion: Completion = unsafe { mem::zeroed() };
+        completion.packet.num_bufs = 1;
+        completion.packet.total_len = 5;
+        completion.packet.buff_lst = &mut buff;
+        completion.packet.hw_timestamp.tv_sec = 2;
+        completion.packet.hw_timestamp.tv_nsec = 5;
+        completion.events = SOCKETXTREME_NEW_CONNECTION_ACCEPTED
+            | SOCKETXTREME_PACKET
+            | (libc::EPOLLHUP | libc::EPOLLRDHUP) as u64;
+        completion.user_data = 41;
+        completion.listen_fd = 40;
+
+        let mut events: Vec<XtremeEvent> = (0..XTREME_EVENTS_PER_COMPLETION + 1).map(|_| XtremeEvent::empty()).collect();
+        let count = unsafe { vma_xtreme_engine_translate(&mut *engine, &completion, events.as_mut_ptr()) };
+        assert_eq!(count, XTREME_EVENTS_PER_COMPLETION);
+
+        assert_eq!(events[0].kind, XtremeEventType::Accepted);
+        assert_eq!((events[0].fd, events[0].listen_fd, events[0].user_data), (41, 40, 7));
+
+        assert_eq!(events[1].kind, XtremeEventType::Packet);
+        assert_eq!(events[1].data(), b"hello");
+        assert_eq!(events[1].total_length(), 5);
+        assert_eq!(events[1].hw_timestamp, 2_000_000_005);
+        assert_eq!(events[1].user_data, 7);
+
+        assert_eq!(events[2].kind, XtremeEventType::Closed);
+        assert_eq!(events[2].fd, 41);
+
+        // Nothing written past the budget; the closed connection is unregistered again
+        assert_eq!(events[3].fd, -1);
+        assert_eq!(engine.socket_count, 1);
+    }
+}